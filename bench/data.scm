@@ -0,0 +1,73 @@
+;;
+;; Benchmarks: hash tables, strings, regexp and bignums
+;;
+
+(define *bench-words*
+  (list-tabulate 1000 (^i (format "word~d-~d" i (* i i)))))
+
+(define-benchmark "hash/eqv"
+  (let1 h (make-hash-table 'eqv?)
+    (dotimes [i 1000] (hash-table-put! h i i))
+    (dotimes [i 1000] (hash-table-get h i #f))))
+
+(define-benchmark "hash/string"
+  (let1 h (make-hash-table 'string=?)
+    (dolist [w *bench-words*] (hash-table-put! h w #t))
+    (dolist [w *bench-words*] (hash-table-get h w #f))))
+
+(define-benchmark "hash/equal"
+  (let1 h (make-hash-table 'equal?)
+    (dotimes [i 1000] (hash-table-put! h (list i (* i 2)) i))
+    (dotimes [i 1000] (hash-table-get h (list i (* i 2)) #f))))
+
+(define-benchmark "hash/update"
+  (let1 h (make-hash-table 'eq?)
+    (dotimes [i 10000] (hash-table-update! h (mod i 16) (cut + <> 1) 0))))
+
+(define-benchmark "string/append"
+  (apply string-append *bench-words*))
+
+(define-benchmark "string/output-port"
+  (with-output-to-string
+    (^[] (dolist [w *bench-words*] (display w) (write-char #\space)))))
+
+(define-benchmark "string/index"
+  (let1 s (string-join *bench-words* " ")
+    (dotimes [i 100] (string-index s #\z))))
+
+(define-benchmark "string/split"
+  (string-split (string-join *bench-words* " ") #\space))
+
+(define-benchmark "string/number->string"
+  (dotimes [i 1000] (number->string i)))
+
+(define-benchmark "regexp/match"
+  (dolist [w *bench-words*] (#/word(\d+)-(\d+)/ w)))
+
+(define-benchmark "regexp/compile"
+  (string->regexp "^([a-z]+)(\\d*)-(\\d+)$"))
+
+(define-benchmark "regexp/replace-all"
+  (regexp-replace-all #/\d+/ (string-join *bench-words* " ") "N"))
+
+(define *bench-big* (expt 3 1000))
+
+(define-benchmark "bignum/add"
+  (dotimes [i 1000] (+ *bench-big* i)))
+
+(define-benchmark "bignum/mul"
+  (* *bench-big* *bench-big*))
+
+(define-benchmark "bignum/factorial"
+  (let loop ([i 1] [r 1])
+    (if (> i 300) r (loop (+ i 1) (* r i)))))
+
+(define-benchmark "bignum/quotient"
+  (quotient (* *bench-big* *bench-big*) (+ *bench-big* 1)))
+
+(define-benchmark "bignum/number->string"
+  (number->string *bench-big*))
+
+(define-benchmark "flonum/sum"
+  (let loop ([i 0] [s 0.0])
+    (if (= i 10000) s (loop (+ i 1) (+ s (* i 0.5))))))
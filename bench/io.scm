@@ -0,0 +1,55 @@
+;;
+;; Benchmarks: port I/O, reader and writer
+;;
+
+(define *bench-lines*
+  (string-join (list-tabulate 1000 (^i (format "line ~d of the text" i)))
+               "\n"))
+
+(define *bench-datum*
+  (list-tabulate 100 (^i `(item ,i "string" #(1 2.5 ,i) (a . b) #\c))))
+
+(define *bench-datum-string* (write-to-string *bench-datum*))
+
+(define-benchmark "port/write-char"
+  (call-with-output-string
+    (^p (dotimes [i 10000] (write-char #\a p)))))
+
+(define-benchmark "port/read-char"
+  (with-input-from-string *bench-lines*
+    (^[] (generator-for-each values read-char))))
+
+(define-benchmark "port/read-line"
+  (with-input-from-string *bench-lines*
+    (^[] (generator-for-each values read-line))))
+
+(define-benchmark "port/write-byte"
+  (call-with-output-string
+    (^p (dotimes [i 10000] (write-byte 65 p)))))
+
+(define *bench-file* (string-append (sys-tmpdir) "/gauche-bench.o"))
+
+(define-benchmark "port/file"
+  (with-output-to-file *bench-file*
+    (^[] (display *bench-lines*)))
+  (with-input-from-file *bench-file*
+    (^[] (generator-for-each values read-line))))
+
+(define-benchmark "reader/read"
+  (read-from-string *bench-datum-string*))
+
+(define-benchmark "reader/symbols"
+  (with-input-from-string "(foo bar baz quux a-long-symbol-name |x y|)"
+    read))
+
+(define-benchmark "reader/numbers"
+  (read-from-string "(1 2.5 -3 1/3 12345678901234567890 1e10 #x1f)"))
+
+(define-benchmark "writer/write"
+  (write-to-string *bench-datum*))
+
+(define-benchmark "writer/display"
+  (with-output-to-string (^[] (display *bench-datum*))))
+
+(define-benchmark "writer/write-shared"
+  (with-output-to-string (^[] (write-shared *bench-datum*))))
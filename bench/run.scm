@@ -0,0 +1,219 @@
+;;
+;; Benchmark runner
+;;
+;;  gosh -ftest run.scm [options] suite.scm ...
+;;
+;;  Relative suite names are taken from the directory of this script.
+;;  "make bench" runs the suites listed in BENCHES.
+;;
+;;  Each suite file registers benchmarks with define-benchmark.  Every
+;;  benchmark is run for a warm-up, then its iteration count is
+;;  calibrated so that one sample takes at least MIN-TIME seconds, and
+;;  then SAMPLES samples are taken.  We report the median time per
+;;  iteration and the median absolute deviation (MAD), which aren't
+;;  swayed by an occasional GC or scheduling hiccup as the mean is.
+;;
+;;  Options:
+;;   -o, --output FILE     Write the results as an S-expression to FILE.
+;;   -j, --json FILE       Write the results as JSON to FILE.
+;;   -b, --baseline FILE   Compare with the results saved in FILE, if
+;;                         it exists.  Exits with 1 if any benchmark
+;;                         regressed.
+;;   -n, --samples N       Number of samples (default 10).
+;;   -t, --min-time SECS   Minimum duration of a sample (default 0.05).
+;;   -s, --select REGEXP   Only run benchmarks whose name matches REGEXP.
+;;   --threshold PERCENT   Slowdown regarded as a regression (default 10).
+;;
+;;  The result file is a list:
+;;
+;;   (gauche-benchmark
+;;     (version "0.9.4") (time 1476748800) (samples 10)
+;;     (results ("vm/fib" :median 1.2e-3 :mad 3.0e-6 :min 1.19e-3
+;;                        :iterations 42)
+;;              ...))
+;;
+;;  All times are in seconds per iteration.
+;;
+
+(use gauche.parseopt)
+(use rfc.json)
+(use srfi-1)
+(use srfi-13)
+
+;;-----------------------------------------------------------------
+;; Registering benchmarks
+;;
+
+(define *bench-dir* (sys-dirname (current-load-path)))
+
+(define *benchmarks* '())               ;((name . thunk) ...), reversed
+
+;; (define-benchmark name body ...)
+;;   BODY is run repeatedly.  Make one iteration do a modest amount of
+;;   work (roughly 10us-10ms); the runner takes care of repeating it.
+(define-syntax define-benchmark
+  (syntax-rules ()
+    [(_ name body ...)
+     (push! *benchmarks* (cons name (^[] body ...)))]))
+
+;;-----------------------------------------------------------------
+;; Measurement
+;;
+
+(define (current-seconds)
+  (receive (sec nsec) (sys-clock-gettime-monotonic)
+    (if sec
+      (+ sec (/. nsec 1e9))
+      (receive (sec usec) (sys-gettimeofday)
+        (+ sec (/. usec 1e6))))))
+
+(define (time-iterations thunk count)
+  (let1 start (current-seconds)
+    (dotimes [i count] (thunk))
+    (- (current-seconds) start)))
+
+;; Find the iteration count with which a sample takes at least MIN-TIME.
+(define (calibrate thunk min-time)
+  (let loop ([count 1])
+    (let1 t (time-iterations thunk count)
+      (cond [(>= t min-time) count]
+            [(< t (/ min-time 100)) (loop (* count 10))]
+            [else (loop (max (+ count 1)
+                             (ceiling->exact (* count 1.2 (/ min-time t)))))]))))
+
+(define (median xs)
+  (let* ([v (list->vector (sort xs))]
+         [n (vector-length v)]
+         [k (quotient n 2)])
+    (if (odd? n)
+      (vector-ref v k)
+      (/ (+ (vector-ref v (- k 1)) (vector-ref v k)) 2))))
+
+(define (run-benchmark name thunk samples min-time)
+  (gc)
+  (thunk)                               ;warm-up
+  (let* ([count (calibrate thunk min-time)]
+         [ts (list-tabulate samples
+                            (^_ (/ (time-iterations thunk count) count)))]
+         [med (median ts)])
+    `(,name :median ,med
+            :mad ,(median (map (^t (abs (- t med))) ts))
+            :min ,(apply min ts)
+            :iterations ,count)))
+
+;;-----------------------------------------------------------------
+;; Reporting
+;;
+
+(define (format-flonum val digs)
+  (let* ([scale (expt 10 digs)]
+         [n (round->exact (* val scale))])
+    (format "~d.~v,'0d" (div n scale) digs (mod n scale))))
+
+(define (format-time secs)
+  (cond [(< secs 1e-6) (format "~7@ans" (format-flonum (* secs 1e9) 1))]
+        [(< secs 1e-3) (format "~7@aus" (format-flonum (* secs 1e6) 2))]
+        [(< secs 1)    (format "~7@ams" (format-flonum (* secs 1e3) 2))]
+        [else          (format "~7@as " (format-flonum secs 3))]))
+
+(define (result-ref r key) (get-keyword key (cdr r)))
+
+;; Returns one of 'regressed, 'improved or #f.  A change has to exceed
+;; both the threshold and the noise of the two measurements.
+(define (compare r base threshold)
+  (let* ([m  (result-ref r :median)]
+         [bm (result-ref base :median)]
+         [noise (* 3 (+ (result-ref r :mad) (result-ref base :mad)))])
+    (cond [(and (> m (* bm (+ 1 threshold))) (> (- m bm) noise)) 'regressed]
+          [(and (< m (/ bm (+ 1 threshold))) (> (- bm m) noise)) 'improved]
+          [else #f])))
+
+(define (report r base threshold)
+  (let* ([m (result-ref r :median)]
+         [spread (if (zero? m) 0 (/ (result-ref r :mad) m))])
+    (format #t "  ~30a ~a +-~6@a%"
+            (car r) (format-time m) (format-flonum (* spread 100) 1))
+    (if base
+      (let1 change (- (/ m (result-ref base :median)) 1)
+        (format #t "  ~7@a%~a\n"
+                (string-append (if (negative? change) "" "+")
+                               (format-flonum (* change 100) 1))
+                (case (compare r base threshold)
+                  [(regressed) "  REGRESSED"]
+                  [(improved)  "  improved"]
+                  [else ""])))
+      (newline))
+    (flush)))
+
+;;-----------------------------------------------------------------
+;; Result files
+;;
+
+(define (make-result-data samples results)
+  `(gauche-benchmark
+    (version ,(gauche-version))
+    (time ,(sys-time))
+    (samples ,samples)
+    (results ,@results)))
+
+(define (read-baseline file)
+  (and file
+       (file-exists? file)
+       (let1 data (with-input-from-file file read)
+         (unless (and (pair? data) (eq? (car data) 'gauche-benchmark))
+           (error "not a benchmark result file:" file))
+         (cdr (assq 'results (cdr data))))))
+
+(define (write-json file data)
+  (with-output-to-file file
+    (^[]
+      (construct-json
+       (map (^e (if (eq? (car e) 'results)
+                  (cons "results"
+                        (list->vector
+                         (map (^r `(("name" . ,(car r))
+                                    ,@(map (^p (cons (keyword->string (car p))
+                                                     (cadr p)))
+                                           (slices (cdr r) 2))))
+                              (cdr e))))
+                  (cons (symbol->string (car e)) (cadr e))))
+            (cdr data)))
+      (newline))))
+
+;;-----------------------------------------------------------------
+;; Main
+;;
+
+(define (main args)
+  (let-args (cdr args) ([output    "o|output=s" #f]
+                        [json      "j|json=s" #f]
+                        [baseline  "b|baseline=s" #f]
+                        [samples   "n|samples=i" 10]
+                        [min-time  "t|min-time=n" 0.05]
+                        [select    "s|select=s" #f]
+                        [threshold "threshold=n" 10]
+                        . suites)
+    (dolist [suite suites]
+      (load (if (string-prefix? "/" suite)
+              suite
+              (string-append *bench-dir* "/" suite))))
+    (let* ([rx (and select (string->regexp select))]
+           [benches (filter (^b (or (not rx) (rx (car b))))
+                            (reverse *benchmarks*))]
+           [base (read-baseline baseline)]
+           [threshold (/ threshold 100)]
+           [results
+            (map (^b (rlet1 r (run-benchmark (car b) (cdr b)
+                                             samples min-time)
+                       (report r (and base (assoc (car b) base)) threshold)))
+                 benches)]
+           [data (make-result-data samples results)])
+      (when output
+        (with-output-to-file output (^[] (write data) (newline))))
+      (when json (write-json json data))
+      (if (and base
+               (any (^r (and-let* ([b (assoc (car r) base)])
+                          (eq? (compare r b threshold) 'regressed)))
+                    results))
+        (begin (print "Some benchmarks regressed from " baseline) 1)
+        0))))
@@ -0,0 +1,49 @@
+;;
+;; Benchmarks: GC and threads
+;;
+
+(define-benchmark "gc/cons"
+  (let loop ([i 0] [r '()])
+    (if (= i 10000) (length r) (loop (+ i 1) (cons i r)))))
+
+(define-benchmark "gc/vector"
+  (dotimes [i 1000] (make-vector 10 i)))
+
+(define-benchmark "gc/string"
+  (dotimes [i 1000] (make-string 20 #\a)))
+
+(define-benchmark "gc/collect"
+  (gc))
+
+(cond-expand
+ [gauche.sys.threads
+  (use gauche.threads)
+
+  (define-benchmark "thread/spawn-join"
+    (dotimes [i 10]
+      (thread-join! (thread-start! (make-thread (^[] i))))))
+
+  (define-benchmark "thread/mutex"
+    (let1 m (make-mutex)
+      (dotimes [i 1000] (mutex-lock! m) (mutex-unlock! m))))
+
+  (define-benchmark "thread/ping-pong"
+    (let* ([m (make-mutex)]
+           [cv (make-condition-variable)]
+           [turn 0]
+           [n 100]
+           [player (^[me]
+                     (dotimes [i n]
+                       (mutex-lock! m)
+                       (let loop ()
+                         (unless (= turn me)
+                           (mutex-unlock! m cv)
+                           (mutex-lock! m)
+                           (loop)))
+                       (set! turn (- 1 me))
+                       (condition-variable-broadcast! cv)
+                       (mutex-unlock! m)))]
+           [t (thread-start! (make-thread (^[] (player 1))))])
+      (player 0)
+      (thread-join! t)))]
+ [else])
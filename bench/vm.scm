@@ -0,0 +1,76 @@
+;;
+;; Benchmarks: VM, closures and generic dispatch
+;;
+
+(define (fib n)
+  (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))
+
+(define (tak x y z)
+  (if (not (< y x))
+    z
+    (tak (tak (- x 1) y z) (tak (- y 1) z x) (tak (- z 1) x y))))
+
+(define-benchmark "vm/loop"
+  (let loop ([i 0] [s 0])
+    (if (= i 10000) s (loop (+ i 1) (+ s i)))))
+
+(define-benchmark "vm/fib"  (fib 20))
+(define-benchmark "vm/tak"  (tak 18 12 6))
+
+(define-benchmark "vm/apply"
+  (let1 args '(1 2 3 4 5)
+    (dotimes [i 1000] (apply + args))))
+
+(define-benchmark "vm/values"
+  (dotimes [i 1000] (receive (a b c) (values i i i) (+ a b c))))
+
+(define-benchmark "vm/dynamic-wind"
+  (dotimes [i 1000] (dynamic-wind (^[] #f) (^[] i) (^[] #f))))
+
+(define-benchmark "vm/call/cc"
+  (dotimes [i 1000] (call/cc (^k (k i)))))
+
+(define-benchmark "vm/guard"
+  (dotimes [i 1000] (guard (e [else e]) (raise i))))
+
+(define (make-counter)
+  (let1 n 0 (^[] (inc! n) n)))
+
+(define-benchmark "closure/create"
+  (let loop ([i 0] [r '()])
+    (if (= i 1000) r (loop (+ i 1) (cons (^[] i) r)))))
+
+(define-benchmark "closure/call"
+  (let1 c (make-counter)
+    (dotimes [i 10000] (c))))
+
+(define-benchmark "closure/higher-order"
+  (fold + 0 (map (cut * <> 2) (filter odd? (iota 1000)))))
+
+(define-class <bench-shape> () ((name :init-value 'shape)))
+(define-class <bench-rect> (<bench-shape>)
+  ((w :init-keyword :w) (h :init-keyword :h)))
+(define-class <bench-circle> (<bench-shape>)
+  ((r :init-keyword :r)))
+(define-class <bench-square> (<bench-rect>) ())
+
+(define-generic bench-area)
+(define-method bench-area ((s <bench-rect>)) (* (~ s'w) (~ s'h)))
+(define-method bench-area ((s <bench-circle>)) (* 3 (~ s'r) (~ s'r)))
+(define-method bench-area ((s <bench-square>))
+  (+ (next-method) 0))
+
+(define *bench-shapes*
+  (list-tabulate 100 (^i (case (mod i 3)
+                           [(0) (make <bench-rect> :w i :h 2)]
+                           [(1) (make <bench-circle> :r i)]
+                           [else (make <bench-square> :w i :h i)]))))
+
+(define-benchmark "generic/dispatch"
+  (dolist [s *bench-shapes*] (bench-area s)))
+
+(define-benchmark "generic/slot-ref"
+  (dolist [s *bench-shapes*] (slot-ref s 'name)))
+
+(define-benchmark "generic/make"
+  (dotimes [i 100] (make <bench-rect> :w i :h i)))
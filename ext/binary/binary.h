@@ -81,3 +81,8 @@ extern void Scm_PutBinaryS64(ScmUVector *uv, int off, ScmObj v, ScmSymbol *e);
 extern void Scm_PutBinaryF16(ScmUVector *uv, int off, ScmObj v, ScmSymbol *e);
 extern void Scm_PutBinaryF32(ScmUVector *uv, int off, ScmObj v, ScmSymbol *e);
 extern void Scm_PutBinaryF64(ScmUVector *uv, int off, ScmObj v, ScmSymbol *e);
+
+extern void   Scm_BinaryWrite(ScmObj obj, ScmPort *oport);
+extern ScmObj Scm_BinaryRead(ScmPort *iport);
+extern ScmObj Scm_BinaryEncode(ScmObj obj);
+extern ScmObj Scm_BinaryDecode(ScmUVector *v);
@@ -0,0 +1,1091 @@
+/*
+ * serialize.c - Binary serialization of Scheme objects
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <gauche/extend.h>
+#include <gauche/class.h>
+#include <gauche/bignum.h>
+#include "binary.h"
+
+/*
+ * Format
+ *
+ *   Each serialized object is a frame:
+ *
+ *     <magic:3> <version:1> <flags:1> <length:uint> <body:length>
+ *
+ *   Flags record the byte order of the writer (bit 0-1) and the native
+ *   character encoding (bit 2-4).  Fixed-size binary data (flonums and
+ *   uvector elements) are written in the writer's byte order; the reader
+ *   swaps them if necessary.  Strings are written in the internal
+ *   encoding, so the reader must have the same native encoding.
+ *
+ *   <uint> is an unsigned LEB128 integer, and <sint> is a zigzag-encoded
+ *   <uint>.  The body is a single <obj>:
+ *
+ *     <obj> : TAG_NIL | TAG_FALSE | TAG_TRUE | TAG_EOF | TAG_UNDEFINED
+ *           | TAG_FIXNUM <sint>
+ *           | TAG_BIGNUM <sign:1> <nbytes:uint> <magnitude, LSB first>
+ *           | TAG_FLONUM <double:8>
+ *           | TAG_RATNUM <obj> <obj>
+ *           | TAG_COMPNUM <double:8> <double:8>
+ *           | TAG_CHAR <uint>
+ *           | TAG_STRING <flags:1> <size:uint> <bytes>
+ *           | TAG_SYMBOL <size:uint> <bytes>
+ *           | TAG_USYMBOL <size:uint> <bytes>      ; uninterned
+ *           | TAG_KEYWORD <size:uint> <bytes>
+ *           | TAG_LIST <n:uint> <obj>{n} <obj>     ; n pairs, then the cdr
+ *           | TAG_VECTOR <n:uint> <obj>{n}
+ *           | TAG_UVECTOR <type:1> <n:uint> <elements>
+ *           | TAG_HASH_TABLE <type:1> <n:uint> (<obj> <obj>){n}
+ *           | TAG_INSTANCE <obj> <obj>*            ; class descriptor, slots
+ *           | TAG_UNBOUND                          ; unbound slot
+ *           | TAG_DEF <obj>
+ *           | TAG_REF <index:uint>
+ *
+ *   TAG_DEF gives the following object the next index (starting from 0),
+ *   and TAG_REF refers to it.  The writer scans the object first to
+ *   find out the objects referred to more than once, and only those
+ *   are given an index, as write/ss does.  Symbols and keywords are
+ *   always given an index at their first appearance, so each name is
+ *   written only once.
+ *
+ *   The class descriptor of an instance is a vector
+ *   #(<module-name> <class-name> <slot-name> ...), followed by the values
+ *   of the listed slots.  The descriptor is shared among the instances
+ *   of the same class.  On reading, the class is looked up by its name
+ *   in the named module; slots that no longer exist are ignored.
+ */
+
+#define MAGIC0    0xc7
+#define MAGIC1    'G'
+#define MAGIC2    'B'
+#define VERSION   1
+
+enum {
+    TAG_NIL = 0x00,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_EOF,
+    TAG_UNDEFINED,
+    TAG_UNBOUND,
+
+    TAG_FIXNUM = 0x10,
+    TAG_BIGNUM,
+    TAG_FLONUM,
+    TAG_RATNUM,
+    TAG_COMPNUM,
+
+    TAG_CHAR = 0x20,
+    TAG_STRING,
+    TAG_SYMBOL,
+    TAG_USYMBOL,
+    TAG_KEYWORD,
+
+    TAG_LIST = 0x30,
+    TAG_VECTOR,
+    TAG_UVECTOR,
+    TAG_HASH_TABLE,
+    TAG_INSTANCE,
+
+    TAG_DEF = 0x40,
+    TAG_REF
+};
+
+/* byte order */
+enum {
+    ORDER_LE = 0,
+    ORDER_BE = 1,
+    ORDER_ARM_LE = 2            /* little endian, but double is
+                                   word-swapped */
+};
+
+#if defined(DOUBLE_ARMENDIAN)
+#define NATIVE_ORDER  ORDER_ARM_LE
+#elif WORDS_BIGENDIAN
+#define NATIVE_ORDER  ORDER_BE
+#else
+#define NATIVE_ORDER  ORDER_LE
+#endif
+
+#if   defined(GAUCHE_CHAR_ENCODING_EUC_JP)
+#define NATIVE_CES  1
+#elif defined(GAUCHE_CHAR_ENCODING_UTF_8)
+#define NATIVE_CES  2
+#elif defined(GAUCHE_CHAR_ENCODING_SJIS)
+#define NATIVE_CES  3
+#else
+#define NATIVE_CES  0
+#endif
+
+#define NATIVE_FLAGS  (NATIVE_ORDER | (NATIVE_CES << 2))
+
+/* Writer and reader recurse on the components of a compound object,
+   except the cdr of a list and the last element of a vector, which are
+   handled by looping.  MAX_DEPTH limits the depth of that recursion, so
+   that a deep structure or broken data can't overflow the C stack.
+   Both sides count the depth the same way, so the data we write can
+   always be read back. */
+#define MAX_DEPTH  4096
+
+/* In the scan pass, a table entry for a shareable object has SEEN_ONCE
+   or SEEN_SHARED. */
+#define SEEN_ONCE    1
+#define SEEN_SHARED  2
+
+static ScmClass *uvector_classes[] = {
+    SCM_CLASS_S8VECTOR,  SCM_CLASS_U8VECTOR,
+    SCM_CLASS_S16VECTOR, SCM_CLASS_U16VECTOR,
+    SCM_CLASS_S32VECTOR, SCM_CLASS_U32VECTOR,
+    SCM_CLASS_S64VECTOR, SCM_CLASS_U64VECTOR,
+    SCM_CLASS_F16VECTOR, SCM_CLASS_F32VECTOR,
+    SCM_CLASS_F64VECTOR
+};
+
+#define NUM_UVECTOR_TYPES  (int)(sizeof(uvector_classes)/sizeof(ScmClass*))
+
+/* Only instances of Scheme-defined classes (including records) are
+   serialized; other objects have hidden C-level state. */
+static inline int serializable_instance_p(ScmObj obj)
+{
+    return SCM_CLASS_CATEGORY(Scm_ClassOf(obj)) == SCM_CLASS_SCHEME;
+}
+
+/*===========================================================
+ * Writer
+ */
+
+typedef struct class_desc_rec {
+    u_long index;               /* index of the descriptor vector */
+    int nslots;
+    int *slots;                 /* instance slot numbers */
+} class_desc;
+
+typedef struct {
+    u_char *buf;
+    size_t size;
+    size_t capa;
+    ScmHashCore seen;           /* scan pass: obj -> SEEN_* */
+    ScmHashCore defs;           /* obj -> index+1 */
+    ScmHashCore classes;        /* class -> class_desc* */
+    u_long ndefs;
+    int depth;                  /* see MAX_DEPTH */
+} encoder;
+
+static void enc_grow(encoder *e, size_t need)
+{
+    size_t ncapa = e->capa;
+    while (ncapa < e->size + need) ncapa *= 2;
+    u_char *nbuf = SCM_NEW_ATOMIC2(u_char*, ncapa);
+    memcpy(nbuf, e->buf, e->size);
+    e->buf = nbuf;
+    e->capa = ncapa;
+}
+
+static inline void emit_byte(encoder *e, int b)
+{
+    if (e->size >= e->capa) enc_grow(e, 1);
+    e->buf[e->size++] = (u_char)b;
+}
+
+static inline void emit_bytes(encoder *e, const void *p, size_t n)
+{
+    if (e->size + n > e->capa) enc_grow(e, n);
+    memcpy(e->buf + e->size, p, n);
+    e->size += n;
+}
+
+static inline void emit_uint(encoder *e, ScmUInt64 v)
+{
+    if (e->size + 10 > e->capa) enc_grow(e, 10);
+    while (v >= 0x80) {
+        e->buf[e->size++] = (u_char)(v | 0x80);
+        v >>= 7;
+    }
+    e->buf[e->size++] = (u_char)v;
+}
+
+static inline void emit_sint(encoder *e, ScmInt64 v)
+{
+    emit_uint(e, ((ScmUInt64)v << 1) ^ (ScmUInt64)(v >> 63));
+}
+
+static inline void emit_double(encoder *e, double d)
+{
+    emit_bytes(e, &d, sizeof(double));
+}
+
+static inline void emit_string_body(encoder *e, ScmString *s)
+{
+    u_int size;
+    const char *body = Scm_GetStringContent(s, &size, NULL, NULL);
+    emit_uint(e, size);
+    emit_bytes(e, body, size);
+}
+
+static int shareable_p(ScmObj obj)
+{
+    return (SCM_PAIRP(obj) || SCM_VECTORP(obj) || SCM_STRINGP(obj)
+            || SCM_UVECTORP(obj) || SCM_HASH_TABLE_P(obj)
+            || (SCM_PTRP(obj) && !SCM_FLONUMP(obj)
+                && serializable_instance_p(obj)));
+}
+
+static inline int shared_p(encoder *e, ScmObj obj)
+{
+    ScmDictEntry *ent = Scm_HashCoreSearch(&e->seen, (intptr_t)obj,
+                                           SCM_DICT_GET);
+    return (ent && ent->value == SEEN_SHARED);
+}
+
+/* Pass 1: find out shared objects.  We use an explicit stack, for
+   the structure can be very deep (e.g. a long list). */
+static void scan(encoder *e, ScmObj obj)
+{
+    size_t sp = 0, stack_size = 256;
+    ScmObj *stack = SCM_NEW_ARRAY(ScmObj, stack_size);
+
+#define PUSH(o)                                                         \
+    do {                                                                \
+        if (sp >= stack_size) {                                         \
+            ScmObj *nstack = SCM_NEW_ARRAY(ScmObj, stack_size*2);       \
+            memcpy(nstack, stack, sizeof(ScmObj)*stack_size);           \
+            stack = nstack;                                             \
+            stack_size *= 2;                                            \
+        }                                                               \
+        stack[sp++] = (o);                                              \
+    } while (0)
+
+    PUSH(obj);
+    while (sp > 0) {
+        obj = stack[--sp];
+        if (SCM_RATNUMP(obj)) {
+            continue;
+        }
+        if (!shareable_p(obj)) continue;
+        ScmDictEntry *ent = Scm_HashCoreSearch(&e->seen, (intptr_t)obj,
+                                               SCM_DICT_CREATE);
+        if (ent->value) {
+            ent->value = SEEN_SHARED;
+            continue;
+        }
+        ent->value = SEEN_ONCE;
+
+        if (SCM_PAIRP(obj)) {
+            PUSH(SCM_CDR(obj));
+            PUSH(SCM_CAR(obj));
+        } else if (SCM_VECTORP(obj)) {
+            for (ScmSmallInt i = SCM_VECTOR_SIZE(obj)-1; i >= 0; i--) {
+                PUSH(SCM_VECTOR_ELEMENT(obj, i));
+            }
+        } else if (SCM_HASH_TABLE_P(obj)) {
+            ScmHashIter iter;
+            ScmDictEntry *de;
+            Scm_HashIterInit(&iter, SCM_HASH_TABLE_CORE(obj));
+            while ((de = Scm_HashIterNext(&iter)) != NULL) {
+                PUSH(SCM_DICT_KEY(de));
+                PUSH(SCM_DICT_VALUE(de));
+            }
+        } else if (!SCM_STRINGP(obj) && !SCM_UVECTORP(obj)) {
+            /* instance */
+            ScmClass *k = Scm_ClassOf(obj);
+            for (int i = 0; i < k->numInstanceSlots; i++) {
+                PUSH(Scm_InstanceSlotRef(obj, i));
+            }
+        }
+    }
+#undef PUSH
+}
+
+static void emit_obj(encoder *e, ScmObj obj);
+
+/* Emits a component of a compound object. */
+static void emit_sub(encoder *e, ScmObj obj)
+{
+    if (++e->depth > MAX_DEPTH) {
+        Scm_Error("binary-write: object is nested too deeply "
+                  "(more than %d levels)", MAX_DEPTH);
+    }
+    emit_obj(e, obj);
+    e->depth--;
+}
+
+/* Emits the descriptor of the class of instance OBJ, and returns it. */
+static class_desc *emit_class_desc(encoder *e, ScmClass *k)
+{
+    ScmDictEntry *ent = Scm_HashCoreSearch(&e->classes, (intptr_t)k,
+                                           SCM_DICT_CREATE);
+    if (ent->value) {
+        class_desc *cd = (class_desc*)ent->value;
+        emit_byte(e, TAG_REF);
+        emit_uint(e, cd->index);
+        return cd;
+    }
+
+    ScmObj mod = SCM_FALSE, names = SCM_NIL, lp;
+    if (SCM_PAIRP(k->modules) && SCM_MODULEP(SCM_CAR(k->modules))) {
+        mod = SCM_MODULE(SCM_CAR(k->modules))->name;
+    }
+    if (!SCM_SYMBOLP(mod) || !SCM_SYMBOLP(k->name)) {
+        Scm_Error("binary-write: can't serialize an instance of "
+                  "anonymous class %S", k);
+    }
+
+    class_desc *cd = SCM_NEW(class_desc);
+    cd->index = e->ndefs++;
+    cd->nslots = 0;
+    cd->slots = SCM_NEW_ATOMIC_ARRAY(int, Scm_Length(k->accessors)+1);
+    SCM_FOR_EACH(lp, k->accessors) {
+        ScmSlotAccessor *sa = SCM_SLOT_ACCESSOR(SCM_CDAR(lp));
+        if (sa->getter == NULL && sa->slotNumber >= 0) {
+            cd->slots[cd->nslots++] = sa->slotNumber;
+            names = Scm_Cons(SCM_CAAR(lp), names);
+        }
+    }
+    ent->value = (intptr_t)cd;
+
+    emit_byte(e, TAG_DEF);
+    emit_byte(e, TAG_VECTOR);
+    emit_uint(e, cd->nslots + 2);
+    /* The reader counts the depth of the elements as of a vector. */
+    SCM_FOR_EACH(lp, Scm_Cons(mod, Scm_Cons(k->name, Scm_ReverseX(names)))) {
+        if (SCM_PAIRP(SCM_CDR(lp))) emit_sub(e, SCM_CAR(lp));
+        else emit_obj(e, SCM_CAR(lp));
+    }
+    return cd;
+}
+
+/* Symbols and keywords are always defined at the first occurrence.
+   Returns TRUE if OBJ is already emitted and we emitted a reference. */
+static int emit_name_ref(encoder *e, ScmObj obj)
+{
+    ScmDictEntry *ent = Scm_HashCoreSearch(&e->defs, (intptr_t)obj,
+                                           SCM_DICT_CREATE);
+    if (ent->value) {
+        emit_byte(e, TAG_REF);
+        emit_uint(e, ent->value - 1);
+        return TRUE;
+    }
+    ent->value = ++e->ndefs;
+    emit_byte(e, TAG_DEF);
+    return FALSE;
+}
+
+/* Pass 2.  The cdr of a list and the last element of a vector are
+   handled by looping, so that a long list doesn't consume C stack. */
+static void emit_obj(encoder *e, ScmObj obj)
+{
+    for (;;) {
+        if (SCM_NULLP(obj))  { emit_byte(e, TAG_NIL); return; }
+        if (SCM_FALSEP(obj)) { emit_byte(e, TAG_FALSE); return; }
+        if (SCM_TRUEP(obj))  { emit_byte(e, TAG_TRUE); return; }
+        if (SCM_EOFP(obj))   { emit_byte(e, TAG_EOF); return; }
+        if (SCM_UNDEFINEDP(obj)) { emit_byte(e, TAG_UNDEFINED); return; }
+        if (SCM_UNBOUNDP(obj))   { emit_byte(e, TAG_UNBOUND); return; }
+        if (SCM_INTP(obj)) {
+            emit_byte(e, TAG_FIXNUM);
+            emit_sint(e, SCM_INT_VALUE(obj));
+            return;
+        }
+        if (SCM_CHARP(obj)) {
+            emit_byte(e, TAG_CHAR);
+            emit_uint(e, SCM_CHAR_VALUE(obj));
+            return;
+        }
+        if (SCM_FLONUMP(obj)) {
+            emit_byte(e, TAG_FLONUM);
+            emit_double(e, SCM_FLONUM_VALUE(obj));
+            return;
+        }
+        if (SCM_BIGNUMP(obj)) {
+            ScmBignum *b = SCM_BIGNUM(obj);
+            int nbytes = SCM_BIGNUM_SIZE(b) * sizeof(u_long);
+            /* drop leading zero bytes */
+            while (nbytes > 0) {
+                u_long w = b->values[(nbytes-1)/sizeof(u_long)];
+                if ((w >> (((nbytes-1)%sizeof(u_long))*8)) & 0xff) break;
+                nbytes--;
+            }
+            emit_byte(e, TAG_BIGNUM);
+            emit_byte(e, SCM_BIGNUM_SIGN(b) < 0);
+            emit_uint(e, nbytes);
+            for (int i = 0; i < nbytes; i++) {
+                u_long w = b->values[i/sizeof(u_long)];
+                emit_byte(e, (w >> ((i%sizeof(u_long))*8)) & 0xff);
+            }
+            return;
+        }
+        if (SCM_RATNUMP(obj)) {
+            emit_byte(e, TAG_RATNUM);
+            emit_sub(e, SCM_RATNUM_NUMER(obj));
+            emit_sub(e, SCM_RATNUM_DENOM(obj));
+            return;
+        }
+        if (SCM_COMPNUMP(obj)) {
+            emit_byte(e, TAG_COMPNUM);
+            emit_double(e, SCM_COMPNUM_REAL(obj));
+            emit_double(e, SCM_COMPNUM_IMAG(obj));
+            return;
+        }
+        if (SCM_SYMBOLP(obj)) {
+            if (emit_name_ref(e, obj)) return;
+            emit_byte(e, SCM_SYMBOL_INTERNED(obj)? TAG_SYMBOL : TAG_USYMBOL);
+            emit_string_body(e, SCM_SYMBOL_NAME(obj));
+            return;
+        }
+        if (SCM_KEYWORDP(obj)) {
+            if (emit_name_ref(e, obj)) return;
+            emit_byte(e, TAG_KEYWORD);
+            emit_string_body(e, SCM_KEYWORD_NAME(obj));
+            return;
+        }
+
+        if (!shareable_p(obj)) {
+            Scm_Error("binary-write: can't serialize object: %S", obj);
+        }
+        if (shared_p(e, obj)) {
+            ScmDictEntry *ent = Scm_HashCoreSearch(&e->defs, (intptr_t)obj,
+                                                   SCM_DICT_CREATE);
+            if (ent->value) {
+                emit_byte(e, TAG_REF);
+                emit_uint(e, ent->value - 1);
+                return;
+            }
+            ent->value = ++e->ndefs;
+            emit_byte(e, TAG_DEF);
+        }
+
+        if (SCM_PAIRP(obj)) {
+            /* A run of pairs up to the next shared one */
+            u_long n = 1;
+            ScmObj p = SCM_CDR(obj);
+            while (SCM_PAIRP(p) && !shared_p(e, p)) {
+                n++;
+                p = SCM_CDR(p);
+            }
+            emit_byte(e, TAG_LIST);
+            emit_uint(e, n);
+            for (p = obj; n > 0; n--, p = SCM_CDR(p)) {
+                emit_sub(e, SCM_CAR(p));
+            }
+            obj = p;
+            continue;
+        }
+        if (SCM_VECTORP(obj)) {
+            ScmSmallInt n = SCM_VECTOR_SIZE(obj);
+            emit_byte(e, TAG_VECTOR);
+            emit_uint(e, n);
+            if (n == 0) return;
+            for (ScmSmallInt i = 0; i < n-1; i++) {
+                emit_sub(e, SCM_VECTOR_ELEMENT(obj, i));
+            }
+            obj = SCM_VECTOR_ELEMENT(obj, n-1);
+            continue;
+        }
+        if (SCM_STRINGP(obj)) {
+            emit_byte(e, TAG_STRING);
+            emit_byte(e, SCM_STRING_INCOMPLETE_P(obj)? 1 : 0);
+            emit_string_body(e, SCM_STRING(obj));
+            return;
+        }
+        if (SCM_UVECTORP(obj)) {
+            int type = Scm_UVectorType(Scm_ClassOf(obj));
+            if (type < 0) {
+                Scm_Error("binary-write: can't serialize object: %S", obj);
+            }
+            emit_byte(e, TAG_UVECTOR);
+            emit_byte(e, type);
+            emit_uint(e, SCM_UVECTOR_SIZE(obj));
+            emit_bytes(e, SCM_UVECTOR_ELEMENTS(obj),
+                       Scm_UVectorSizeInBytes(SCM_UVECTOR(obj)));
+            return;
+        }
+        if (SCM_HASH_TABLE_P(obj)) {
+            ScmHashTable *ht = SCM_HASH_TABLE(obj);
+            ScmHashIter iter;
+            ScmDictEntry *de;
+            if (ht->type != SCM_HASH_EQ && ht->type != SCM_HASH_EQV
+                && ht->type != SCM_HASH_EQUAL && ht->type != SCM_HASH_STRING) {
+                Scm_Error("binary-write: can't serialize a hash table "
+                          "with a custom comparator: %S", obj);
+            }
+            emit_byte(e, TAG_HASH_TABLE);
+            emit_byte(e, ht->type);
+            emit_uint(e, Scm_HashCoreNumEntries(SCM_HASH_TABLE_CORE(ht)));
+            Scm_HashIterInit(&iter, SCM_HASH_TABLE_CORE(ht));
+            while ((de = Scm_HashIterNext(&iter)) != NULL) {
+                emit_sub(e, SCM_DICT_KEY(de));
+                emit_sub(e, SCM_DICT_VALUE(de));
+            }
+            return;
+        }
+        /* instance */
+        emit_byte(e, TAG_INSTANCE);
+        class_desc *cd = emit_class_desc(e, Scm_ClassOf(obj));
+        for (int i = 0; i < cd->nslots; i++) {
+            emit_sub(e, Scm_InstanceSlotRef(obj, cd->slots[i]));
+        }
+        return;
+    }
+}
+
+/* Serialize OBJ into a frame.  Returns the frame and sets its size
+   in *psize. */
+static u_char *encode(ScmObj obj, size_t *psize)
+{
+    encoder e;
+    e.capa = 256;
+    e.size = 0;
+    e.buf = SCM_NEW_ATOMIC2(u_char*, e.capa);
+    e.ndefs = 0;
+    e.depth = 0;
+    Scm_HashCoreInitSimple(&e.seen, SCM_HASH_EQ, 0, NULL);
+    Scm_HashCoreInitSimple(&e.defs, SCM_HASH_EQ, 0, NULL);
+    Scm_HashCoreInitSimple(&e.classes, SCM_HASH_EQ, 0, NULL);
+
+    scan(&e, obj);
+    emit_obj(&e, obj);
+
+    /* Prepend the header, now that we know the body length. */
+    u_char head[16];
+    size_t hsize = 0;
+    head[hsize++] = MAGIC0;
+    head[hsize++] = MAGIC1;
+    head[hsize++] = MAGIC2;
+    head[hsize++] = VERSION;
+    head[hsize++] = NATIVE_FLAGS;
+    for (size_t v = e.size; ; v >>= 7) {
+        if (v < 0x80) { head[hsize++] = (u_char)v; break; }
+        head[hsize++] = (u_char)(v | 0x80);
+    }
+
+    u_char *frame = SCM_NEW_ATOMIC2(u_char*, hsize + e.size);
+    memcpy(frame, head, hsize);
+    memcpy(frame + hsize, e.buf, e.size);
+    *psize = hsize + e.size;
+    return frame;
+}
+
+/*===========================================================
+ * Reader
+ */
+
+typedef struct {
+    ScmClass *klass;
+    int nslots;
+    int *slots;                 /* slot number, or -1 if the slot
+                                   doesn't exist in the current class */
+} class_info;
+
+typedef struct {
+    const u_char *p;
+    const u_char *end;
+    int order;                  /* byte order of the writer */
+    ScmObj *defs;
+    u_long ndefs;
+    u_long defs_size;
+    ScmHashCore classes;        /* descriptor -> class_info* */
+    int depth;                  /* see MAX_DEPTH */
+} decoder;
+
+static void broken(void)
+{
+    Scm_Error("binary-read: broken serialized data");
+}
+
+static inline int fetch_byte(decoder *d)
+{
+    if (d->p >= d->end) broken();
+    return *d->p++;
+}
+
+static inline const u_char *fetch_bytes(decoder *d, ScmUInt64 n)
+{
+    if ((ScmUInt64)(d->end - d->p) < n) broken();
+    const u_char *r = d->p;
+    d->p += n;
+    return r;
+}
+
+static inline ScmUInt64 fetch_uint(decoder *d)
+{
+    ScmUInt64 v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int b = fetch_byte(d);
+        v |= (ScmUInt64)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    broken();
+    return 0;                   /* dummy */
+}
+
+static inline ScmInt64 fetch_sint(decoder *d)
+{
+    ScmUInt64 v = fetch_uint(d);
+    return (ScmInt64)(v >> 1) ^ -(ScmInt64)(v & 1);
+}
+
+/* Swap bytes of a fixed-size datum in the writer's byte order.
+   Double needs special care for ARM's mixed endian. */
+static void swap_elements(u_char *p, size_t nelts, int eltsize,
+                          int from, int doublep)
+{
+    int to = NATIVE_ORDER;
+    if (from == to) return;
+    for (size_t i = 0; i < nelts; i++, p += eltsize) {
+        u_char t;
+        if (doublep && (from == ORDER_ARM_LE || to == ORDER_ARM_LE)) {
+            /* convert to LE, then to the native order */
+            if (from == ORDER_BE) {
+                for (int j = 0; j < 4; j++) { t=p[j]; p[j]=p[7-j]; p[7-j]=t; }
+            } else if (from == ORDER_ARM_LE) {
+                for (int j = 0; j < 4; j++) { t=p[j]; p[j]=p[j+4]; p[j+4]=t; }
+            }
+            if (to == ORDER_BE) {
+                for (int j = 0; j < 4; j++) { t=p[j]; p[j]=p[7-j]; p[7-j]=t; }
+            } else if (to == ORDER_ARM_LE) {
+                for (int j = 0; j < 4; j++) { t=p[j]; p[j]=p[j+4]; p[j+4]=t; }
+            }
+        } else if ((from == ORDER_BE) != (to == ORDER_BE)) {
+            for (int j = 0; j < eltsize/2; j++) {
+                t = p[j]; p[j] = p[eltsize-1-j]; p[eltsize-1-j] = t;
+            }
+        }
+    }
+}
+
+static inline double fetch_double(decoder *d)
+{
+    u_char buf[sizeof(double)];
+    double v;
+    memcpy(buf, fetch_bytes(d, sizeof(double)), sizeof(double));
+    swap_elements(buf, 1, sizeof(double), d->order, TRUE);
+    memcpy(&v, buf, sizeof(double));
+    return v;
+}
+
+static inline ScmString *fetch_string_body(decoder *d, int flags)
+{
+    ScmUInt64 size = fetch_uint(d);
+    const u_char *body = fetch_bytes(d, size);
+    return SCM_STRING(Scm_MakeString((const char*)body, (ScmSmallInt)size,
+                                     -1, flags|SCM_STRING_COPYING));
+}
+
+static u_long reserve_def(decoder *d)
+{
+    if (d->ndefs >= d->defs_size) {
+        u_long nsize = d->defs_size * 2;
+        ScmObj *ndefs = SCM_NEW_ARRAY(ScmObj, nsize);
+        memcpy(ndefs, d->defs, sizeof(ScmObj) * d->ndefs);
+        d->defs = ndefs;
+        d->defs_size = nsize;
+    }
+    d->defs[d->ndefs] = SCM_UNBOUND;
+    return d->ndefs++;
+}
+
+static ScmObj fetch_obj(decoder *d);
+
+/* Reads a component of a compound object. */
+static ScmObj fetch_sub(decoder *d)
+{
+    if (++d->depth > MAX_DEPTH) {
+        Scm_Error("binary-read: serialized data is nested too deeply "
+                  "(more than %d levels)", MAX_DEPTH);
+    }
+    ScmObj r = fetch_obj(d);
+    d->depth--;
+    return r;
+}
+
+static class_info *resolve_class(decoder *d, ScmObj desc)
+{
+    ScmDictEntry *ent = Scm_HashCoreSearch(&d->classes, (intptr_t)desc,
+                                           SCM_DICT_CREATE);
+    if (ent->value) return (class_info*)ent->value;
+
+    if (!SCM_VECTORP(desc) || SCM_VECTOR_SIZE(desc) < 2
+        || !SCM_SYMBOLP(SCM_VECTOR_ELEMENT(desc, 0))
+        || !SCM_SYMBOLP(SCM_VECTOR_ELEMENT(desc, 1))) {
+        broken();
+    }
+    ScmObj modname = SCM_VECTOR_ELEMENT(desc, 0);
+    ScmObj cname = SCM_VECTOR_ELEMENT(desc, 1);
+    ScmModule *mod = Scm_FindModule(SCM_SYMBOL(modname),
+                                    SCM_FIND_MODULE_QUIET);
+    if (mod == NULL) {
+        Scm_Error("binary-read: module %S for class %S not found",
+                  modname, cname);
+    }
+    ScmObj k = Scm_GlobalVariableRef(mod, SCM_SYMBOL(cname), 0);
+    if (!SCM_CLASSP(k)) {
+        Scm_Error("binary-read: class %S not found in module %S",
+                  cname, modname);
+    }
+    /* Builtin and abstract classes don't have a generic allocator, and
+       their instances can't be filled slot by slot. */
+    if (SCM_CLASS_CATEGORY(k) != SCM_CLASS_SCHEME) {
+        Scm_Error("binary-read: instances of class %S can't be "
+                  "deserialized", k);
+    }
+
+    class_info *ci = SCM_NEW(class_info);
+    ci->klass = SCM_CLASS(k);
+    ci->nslots = (int)SCM_VECTOR_SIZE(desc) - 2;
+    ci->slots = SCM_NEW_ATOMIC_ARRAY(int, ci->nslots);
+    for (int i = 0; i < ci->nslots; i++) {
+        ScmObj p = Scm_Assq(SCM_VECTOR_ELEMENT(desc, i+2), ci->klass->accessors);
+        ci->slots[i] = -1;
+        if (SCM_PAIRP(p)) {
+            ScmSlotAccessor *sa = SCM_SLOT_ACCESSOR(SCM_CDR(p));
+            if (sa->getter == NULL && sa->slotNumber >= 0) {
+                ci->slots[i] = sa->slotNumber;
+            }
+        }
+    }
+    ent->value = (intptr_t)ci;
+    return ci;
+}
+
+/* Reads one object.  If the object is preceded by TAG_DEF, it is
+   registered before its components are read, so that they can refer
+   to it.  The cdr of a list and the last element of a vector are
+   handled by looping; LOC points to where the object being read goes. */
+static ScmObj fetch_obj(decoder *d)
+{
+    ScmObj result = SCM_NIL, *loc = &result;
+
+#define DEFINE(obj) \
+    do { if (defp) d->defs[defidx] = (obj); } while (0)
+#define RETURN(obj) \
+    do { *loc = (obj); return result; } while (0)
+
+    for (;;) {
+        int tag = fetch_byte(d), defp = FALSE;
+        u_long defidx = 0;
+
+        if (tag == TAG_DEF) {
+            defp = TRUE;
+            defidx = reserve_def(d);
+            tag = fetch_byte(d);
+        }
+
+        switch (tag) {
+        case TAG_NIL:   RETURN(SCM_NIL);
+        case TAG_FALSE: RETURN(SCM_FALSE);
+        case TAG_TRUE:  RETURN(SCM_TRUE);
+        case TAG_EOF:   RETURN(SCM_EOF);
+        case TAG_UNDEFINED: RETURN(SCM_UNDEFINED);
+        case TAG_UNBOUND:   RETURN(SCM_UNBOUND);
+        case TAG_FIXNUM:
+            RETURN(Scm_MakeInteger64(fetch_sint(d)));
+        case TAG_BIGNUM: {
+            int neg = fetch_byte(d);
+            ScmUInt64 nbytes = fetch_uint(d);
+            const u_char *bytes = fetch_bytes(d, nbytes);
+            int nwords = (int)((nbytes + sizeof(u_long) - 1)/sizeof(u_long));
+            if (nwords == 0) RETURN(SCM_MAKE_INT(0));
+            u_long *words = SCM_NEW_ATOMIC_ARRAY(u_long, nwords);
+            memset(words, 0, nwords * sizeof(u_long));
+            for (ScmUInt64 i = 0; i < nbytes; i++) {
+                words[i/sizeof(u_long)] |=
+                    (u_long)bytes[i] << ((i%sizeof(u_long))*8);
+            }
+            ScmObj b = Scm_MakeBignumFromUIArray(neg? -1 : 1, words, nwords);
+            RETURN(Scm_NormalizeBignum(SCM_BIGNUM(b)));
+        }
+        case TAG_FLONUM:
+            RETURN(Scm_MakeFlonum(fetch_double(d)));
+        case TAG_RATNUM: {
+            ScmObj numer = fetch_sub(d);
+            ScmObj denom = fetch_sub(d);
+            if (!SCM_INTEGERP(numer) || !SCM_INTEGERP(denom)) broken();
+            RETURN(Scm_MakeRational(numer, denom));
+        }
+        case TAG_COMPNUM: {
+            double re = fetch_double(d);
+            double im = fetch_double(d);
+            RETURN(Scm_MakeComplex(re, im));
+        }
+        case TAG_CHAR: {
+            ScmUInt64 c = fetch_uint(d);
+            if (c > SCM_CHAR_MAX) broken();
+            RETURN(SCM_MAKE_CHAR((ScmChar)c));
+        }
+        case TAG_STRING: {
+            int flags = fetch_byte(d)? SCM_STRING_INCOMPLETE : 0;
+            ScmObj s = SCM_OBJ(fetch_string_body(d, flags));
+            DEFINE(s);
+            RETURN(s);
+        }
+        case TAG_SYMBOL:
+        case TAG_USYMBOL: {
+            ScmString *name = fetch_string_body(d, 0);
+            ScmObj s = Scm_MakeSymbol(name, tag == TAG_SYMBOL);
+            DEFINE(s);
+            RETURN(s);
+        }
+        case TAG_KEYWORD: {
+            ScmObj s = Scm_MakeKeyword(fetch_string_body(d, 0));
+            DEFINE(s);
+            RETURN(s);
+        }
+        case TAG_REF: {
+            ScmUInt64 idx = fetch_uint(d);
+            if (idx >= d->ndefs || SCM_UNBOUNDP(d->defs[idx])) broken();
+            RETURN(d->defs[idx]);
+        }
+        case TAG_LIST: {
+            ScmUInt64 n = fetch_uint(d);
+            if (n == 0) broken();
+            ScmObj head = Scm_Cons(SCM_FALSE, SCM_NIL), p = head;
+            DEFINE(head);
+            *loc = head;
+            SCM_SET_CAR(p, fetch_sub(d));
+            for (ScmUInt64 i = 1; i < n; i++) {
+                ScmObj q = Scm_Cons(SCM_FALSE, SCM_NIL);
+                SCM_SET_CDR(p, q);
+                p = q;
+                SCM_SET_CAR(p, fetch_sub(d));
+            }
+            loc = &SCM_PAIR(p)->cdr;
+            continue;           /* read the cdr */
+        }
+        case TAG_VECTOR: {
+            ScmUInt64 n = fetch_uint(d);
+            if (n > (ScmUInt64)(d->end - d->p)) broken();
+            ScmObj v = Scm_MakeVector((ScmSmallInt)n, SCM_FALSE);
+            DEFINE(v);
+            if (n == 0) RETURN(v);
+            *loc = v;
+            for (ScmUInt64 i = 0; i < n-1; i++) {
+                SCM_VECTOR_ELEMENT(v, i) = fetch_sub(d);
+            }
+            loc = &SCM_VECTOR_ELEMENT(v, n-1);
+            continue;           /* read the last element */
+        }
+        case TAG_UVECTOR: {
+            int type = fetch_byte(d);
+            if (type >= NUM_UVECTOR_TYPES) broken();
+            ScmClass *k = uvector_classes[type];
+            int eltsize = Scm_UVectorElementSize(k);
+            ScmUInt64 n = fetch_uint(d);
+            if (n > (ScmUInt64)(d->end - d->p) / eltsize) broken();
+            const u_char *src = fetch_bytes(d, n * eltsize);
+            u_char *elts = SCM_NEW_ATOMIC2(u_char*, n * eltsize + 1);
+            memcpy(elts, src, n * eltsize);
+            swap_elements(elts, n, eltsize, d->order,
+                          type == SCM_UVECTOR_F64);
+            ScmObj v = Scm_MakeUVector(k, (ScmSmallInt)n, elts);
+            DEFINE(v);
+            RETURN(v);
+        }
+        case TAG_HASH_TABLE: {
+            int type = fetch_byte(d);
+            if (type != SCM_HASH_EQ && type != SCM_HASH_EQV
+                && type != SCM_HASH_EQUAL && type != SCM_HASH_STRING) {
+                broken();
+            }
+            ScmUInt64 n = fetch_uint(d);
+            if (n > (ScmUInt64)(d->end - d->p)) broken();
+            ScmObj h = Scm_MakeHashTableSimple(type, (int)n);
+            DEFINE(h);
+            for (ScmUInt64 i = 0; i < n; i++) {
+                ScmObj key = fetch_sub(d);
+                ScmObj val = fetch_sub(d);
+                Scm_HashTableSet(SCM_HASH_TABLE(h), key, val, 0);
+            }
+            RETURN(h);
+        }
+        case TAG_INSTANCE: {
+            /* The descriptor is at the same depth as the instance; see
+               emit_class_desc. */
+            class_info *ci = resolve_class(d, fetch_obj(d));
+            ScmClass *k = ci->klass;
+            ScmObj obj = k->allocate(k, SCM_NIL);
+            DEFINE(obj);
+            for (int i = 0; i < ci->nslots; i++) {
+                ScmObj val = fetch_sub(d);
+                if (ci->slots[i] >= 0 && !SCM_UNBOUNDP(val)) {
+                    Scm_InstanceSlotSet(obj, ci->slots[i], val);
+                }
+            }
+            RETURN(obj);
+        }
+        default:
+            broken();
+        }
+    }
+#undef DEFINE
+#undef RETURN
+}
+
+static ScmObj decode(const u_char *body, size_t size, int order)
+{
+    decoder d;
+    d.p = body;
+    d.end = body + size;
+    d.order = order;
+    d.defs_size = 64;
+    d.defs = SCM_NEW_ARRAY(ScmObj, d.defs_size);
+    d.ndefs = 0;
+    d.depth = 0;
+    Scm_HashCoreInitSimple(&d.classes, SCM_HASH_EQ, 0, NULL);
+
+    ScmObj r = fetch_obj(&d);
+    if (d.p != d.end) broken();
+    return r;
+}
+
+/* Check the header (except the length) and returns the writer's
+   byte order. */
+static int check_header(const u_char *h)
+{
+    if (h[0] != MAGIC0 || h[1] != MAGIC1 || h[2] != MAGIC2) {
+        Scm_Error("binary-read: not a serialized object");
+    }
+    if (h[3] != VERSION) {
+        Scm_Error("binary-read: unsupported format version: %d", h[3]);
+    }
+    if (((h[4] >> 2) & 7) != NATIVE_CES) {
+        Scm_Error("binary-read: serialized data has different "
+                  "character encoding from the native one");
+    }
+    if ((h[4] & 3) > ORDER_ARM_LE) broken();
+    return h[4] & 3;
+}
+
+#define HEADER_SIZE  5
+#define READ_CHUNK_SIZE  65536
+
+/*===========================================================
+ * API
+ */
+
+void Scm_BinaryWrite(ScmObj obj, ScmPort *oport)
+{
+    size_t size;
+    u_char *frame = encode(obj, &size);
+    if (!oport) oport = SCM_CUROUT;
+    Scm_Putz((const char*)frame, size, oport);
+}
+
+ScmObj Scm_BinaryRead(ScmPort *iport)
+{
+    u_char head[HEADER_SIZE];
+    int n = 0;
+
+    if (!iport) iport = SCM_CURIN;
+    while (n < HEADER_SIZE) {
+        int r = Scm_Getz((char*)head + n, HEADER_SIZE - n, iport);
+        if (r <= 0) {
+            if (n == 0) return SCM_EOF;
+            broken();
+        }
+        n += r;
+    }
+    int order = check_header(head);
+
+    ScmUInt64 size = 0;
+    for (int shift = 0; ; shift += 7) {
+        int b = Scm_Getb(iport);
+        if (b == EOF || shift >= 64) broken();
+        size |= (ScmUInt64)(b & 0x7f) << shift;
+        if (!(b & 0x80)) break;
+    }
+    if (size > (ScmUInt64)SIZE_MAX) broken();
+
+    /* The length comes from the input, so we don't trust it for the
+       allocation; the buffer grows as the data actually arrives. */
+    size_t bufsize = (size < READ_CHUNK_SIZE)? (size_t)size : READ_CHUNK_SIZE;
+    u_char *body = SCM_NEW_ATOMIC2(u_char*, bufsize + 1);
+    for (size_t nread = 0; nread < size; ) {
+        if (nread == bufsize) {
+            size_t nsize = ((size_t)size - bufsize > bufsize)
+                ? bufsize * 2 : (size_t)size;
+            u_char *nbody = SCM_NEW_ATOMIC2(u_char*, nsize + 1);
+            memcpy(nbody, body, nread);
+            body = nbody;
+            bufsize = nsize;
+        }
+        size_t chunk = bufsize - nread;
+        if (chunk > READ_CHUNK_SIZE) chunk = READ_CHUNK_SIZE;
+        int r = Scm_Getz((char*)body + nread, (int)chunk, iport);
+        if (r <= 0) broken();
+        nread += r;
+    }
+    return decode(body, (size_t)size, order);
+}
+
+ScmObj Scm_BinaryEncode(ScmObj obj)
+{
+    size_t size;
+    u_char *frame = encode(obj, &size);
+    return Scm_MakeUVector(SCM_CLASS_U8VECTOR, (ScmSmallInt)size, frame);
+}
+
+ScmObj Scm_BinaryDecode(ScmUVector *v)
+{
+    if (!SCM_U8VECTORP(v)) {
+        Scm_Error("u8vector required, but got: %S", v);
+    }
+    const u_char *p = SCM_U8VECTOR_ELEMENTS(v);
+    size_t len = SCM_U8VECTOR_SIZE(v);
+    if (len < HEADER_SIZE) broken();
+    int order = check_header(p);
+
+    ScmUInt64 size = 0;
+    size_t i = HEADER_SIZE;
+    for (int shift = 0; ; shift += 7, i++) {
+        if (i >= len || shift >= 64) broken();
+        size |= (ScmUInt64)(p[i] & 0x7f) << shift;
+        if (!(p[i] & 0x80)) break;
+    }
+    i++;
+    if (size != (ScmUInt64)(len - i)) broken();
+    return decode(p + i, (size_t)size, order);
+}
+
+/*
+ * Init
+ */
+extern void Scm_Init_serializelib(ScmModule *mod);
+
+SCM_EXTENSION_ENTRY void Scm_Init_binary__serialize(void)
+{
+    ScmModule *mod = SCM_FIND_MODULE("binary.serialize",
+                                     SCM_FIND_MODULE_CREATE);
+    SCM_INIT_EXTENSION(binary__serialize);
+    Scm_Init_serializelib(mod);
+}
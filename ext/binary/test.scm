@@ -943,4 +943,159 @@
                   \x01\x01\x01\x01\
                   \x01\x01\x01\x01"))
 
+;;----------------------------------------------------------
+(test-section "binary.serialize")
+
+(use binary.serialize)
+(test-module 'binary.serialize)
+
+(define (binary-roundtrip obj)
+  (binary-decode (binary-encode obj)))
+
+(let ()
+  (define (t obj)
+    (test* (format "roundtrip ~s" obj) obj (binary-roundtrip obj)))
+  (t '())
+  (t #t)
+  (t #f)
+  (t 0)
+  (t -1)
+  (t (greatest-fixnum))
+  (t (least-fixnum))
+  (t (expt 2 100))
+  (t (- (expt 3 200)))
+  (t 1.5)
+  (t -0.0)
+  (t 2/3)
+  (t -7/1000000000000000000000)
+  (t 1.0+2.0i)
+  (t #\a)
+  (t #\x3bb)
+  (t "")
+  (t "abc")
+  (t 'foo)
+  (t :bar)
+  (t '(1 2 . 3))
+  (t '(a (b "c" #(d 1.0)) :e))
+  (t '#())
+  (t '#u8(0 1 255))
+  (t '#s16(-1 2 -32768))
+  (t '#u64(0 18446744073709551615))
+  (t '#f64(1.0 -2.5 1e300))
+  (t '#f32(1.0 0.5)))
+
+(test* "roundtrip incomplete string" #*"\xff\x00"
+       (binary-roundtrip #*"\xff\x00"))
+(test* "roundtrip uninterned symbol" '(#f "g")
+       (let1 s (binary-roundtrip (string->uninterned-symbol "g"))
+         (list (symbol-interned? s) (symbol->string s))))
+(test* "roundtrip eof" #t (eof-object? (binary-roundtrip (eof-object))))
+
+(test* "sharing" '(#t #f)
+       (let* ([s (string-copy "abc")]
+              [r (binary-roundtrip (list s s (string-copy "abc")))])
+         (list (eq? (car r) (cadr r)) (eq? (car r) (caddr r)))))
+(test* "shared tail" '(#t (1 2 3 4))
+       (let* ([tail (list 3 4)]
+              [r (binary-roundtrip (list (list* 1 2 tail) tail))])
+         (list (eq? (cddr (car r)) (cadr r)) (car r))))
+(test* "circular list" '(1 2 1 2 1)
+       (let* ([x (list 1 2)])
+         (set-cdr! (cdr x) x)
+         (take (binary-roundtrip x) 5)))
+(test* "circular vector" #t
+       (let1 v (make-vector 2 #f)
+         (vector-set! v 0 v)
+         (let1 r (binary-roundtrip v)
+           (eq? r (vector-ref r 0)))))
+(test* "long list" 100000
+       (length (binary-roundtrip (iota 100000))))
+(test* "deep vector chain" 100000
+       (let loop ([v (binary-roundtrip
+                      (fold (^[i v] (vector i v)) '#() (iota 100000)))]
+                  [n 0])
+         (if (zero? (vector-length v)) n (loop (vector-ref v 1) (+ n 1)))))
+(test* "too deep to write" (test-error)
+       (binary-encode (fold (^[_ x] (list x)) '() (iota 5000))))
+;; Hand-crafted data of 5000 nested lists, ((((...))))
+(test* "too deep to read" (test-error)
+       (let* ([n 5000]
+              [body (u8vector-append
+                     (apply u8vector (concatenate (make-list n '(#x30 1))))
+                     (make-u8vector (+ n 1) 0))]
+              [len (u8vector-length body)])
+         (binary-decode
+          (u8vector-append (u8vector-copy (binary-encode '()) 0 5)
+                           (u8vector (logior #x80 (logand len #x7f))
+                                     (ash len -7))
+                           body))))
+
+(test* "hash table" '(eqv? 3 (1 a "x"))
+       (let1 h (make-hash-table 'eqv?)
+         (hash-table-put! h 1 'a)
+         (hash-table-put! h 'b "x")
+         (hash-table-put! h 2.0 '(1 a "x"))
+         (let1 r (binary-roundtrip h)
+           (list (hash-table-type r)
+                 (hash-table-num-entries r)
+                 (hash-table-get r 2.0)))))
+(test* "hash table (string)" "bar"
+       (let1 h (make-hash-table 'string=?)
+         (hash-table-put! h "foo" "bar")
+         (hash-table-get (binary-roundtrip h) "foo")))
+
+(define-class <serialize-point> ()
+  ((x :init-keyword :x)
+   (y :init-keyword :y)
+   (z :allocation :virtual :slot-ref (^_ 'virtual) :slot-set! (^(_ v) v))))
+(define-record-type serialize-rec (make-serialize-rec a b) serialize-rec?
+  (a serialize-rec-a)
+  (b serialize-rec-b))
+
+(test* "instance" '(1 (2 3) #t)
+       (let* ([p (make <serialize-point> :x 1 :y '(2 3))]
+              [r (binary-roundtrip (list p p))])
+         (list (slot-ref (car r) 'x) (slot-ref (car r) 'y)
+               (eq? (car r) (cadr r)))))
+(test* "instance with unbound slot" #f
+       (slot-bound? (binary-roundtrip (make <serialize-point> :x 1)) 'y))
+(test* "record" '(#t a "b")
+       (let1 r (binary-roundtrip (make-serialize-rec 'a "b"))
+         (list (serialize-rec? r) (serialize-rec-a r) (serialize-rec-b r))))
+
+(test* "unserializable" (test-error)
+       (binary-encode (list car)))
+(test* "broken data" (test-error)
+       (let1 v (binary-encode '(1 2 3))
+         (binary-decode (u8vector-copy v 0 (- (u8vector-length v) 1)))))
+
+;; Hand-crafted frames.  LEN is the length field in bytes.
+(define (serialize-frame len body)
+  (u8vector-append (u8vector-copy (binary-encode '()) 0 5) len body))
+
+(test* "char out of range" (test-error)
+       (binary-decode (serialize-frame '#u8(5) '#u8(#x20 #x80 #x80 #x80 #x08))))
+(test* "too long frame" (test-error)
+       (call-with-input-string
+           (u8vector->string
+            (serialize-frame '#u8(#x80 #x80 #x80 #x80 #x80 #x20) '#u8(0)))
+         binary-read))
+(define-class <serialize-builtin> () ((x :init-keyword :x)))
+(let1 v (binary-encode (make <serialize-builtin> :x 1))
+  (set! <serialize-builtin> <string>)
+  (test* "instance of builtin class" (test-error) (binary-decode v)))
+
+(test* "binary-write/binary-read" '((a 1) "b" #(c) #t)
+       (receive (objs eofp)
+           (call-with-input-string
+               (call-with-output-string
+                 (^p (binary-write '(a 1) p)
+                     (binary-write "b" p)
+                     (binary-write '#(c) p)))
+             (^p (let* ([a (binary-read p)]
+                        [b (binary-read p)]
+                        [c (binary-read p)])
+                   (values (list a b c) (eof-object? (binary-read p))))))
+         (append objs (list eofp))))
+
 (test-end)
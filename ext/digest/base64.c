@@ -0,0 +1,360 @@
+/*
+ * base64.c - Base64 codec
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base64.h"
+
+/* RFC 2045 section 6.8 and RFC 3548 (url-safe alphabet).
+ *
+ * The behavior is the same as the former Scheme implementation:
+ * the decoder skips characters outside the alphabet and stops at the
+ * first pad character, and the encoder inserts a newline after every
+ * line-width characters, including the pad characters.
+ *
+ * Groups of 4 digits that have no intervening characters are decoded
+ * by a fast path that converts them with one table lookup each and
+ * checks all of them at once; the same goes for 3-byte groups in the
+ * encoder when no line break falls inside the group.
+ */
+
+static const char standard_encode[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=";
+static const char url_safe_encode[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_=";
+
+static const signed char standard_decode[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+static const signed char url_safe_decode[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, 63,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+#define PAD_INDEX  64
+#define CHUNK_SIZE 8192
+
+/*
+ * Encoder
+ */
+
+void Scm_Base64EncoderInit(ScmBase64Encoder *e, int lineWidth, int urlSafe)
+{
+    e->table = urlSafe? url_safe_encode : standard_encode;
+    e->maxcol = (lineWidth > 0)? lineWidth - 1 : -1;
+    e->col = 0;
+    e->nleft = 0;
+}
+
+/* Upper bound of the output size of encoding LEN more bytes and
+   finishing. */
+size_t Scm_Base64EncodeBound(ScmBase64Encoder *e, size_t len)
+{
+    size_t nchars = (len / 3 + 2) * 4;
+    return (e->maxcol >= 0)? nchars * 2 : nchars;
+}
+
+static inline void encode_group(const u_char *s, char *d, const char *t)
+{
+    u_int v = ((u_int)s[0] << 16) | ((u_int)s[1] << 8) | s[2];
+    d[0] = t[v >> 18];
+    d[1] = t[(v >> 12) & 0x3f];
+    d[2] = t[(v >> 6) & 0x3f];
+    d[3] = t[v & 0x3f];
+}
+
+/* Emits a digit, followed by a newline if it hits the line width */
+static inline char *emit(ScmBase64Encoder *e, char *d, int index)
+{
+    *d++ = e->table[index];
+    if (e->maxcol >= 0) {
+        if (e->col == e->maxcol) {
+            *d++ = '\n';
+            e->col = 0;
+        } else {
+            e->col++;
+        }
+    }
+    return d;
+}
+
+static inline char *emit_group(ScmBase64Encoder *e, char *d, const u_char *s)
+{
+    if (e->maxcol < 0 || e->col + 4 <= e->maxcol) {
+        encode_group(s, d, e->table);
+        if (e->maxcol >= 0) e->col += 4;
+        return d + 4;
+    } else {
+        u_int v = ((u_int)s[0] << 16) | ((u_int)s[1] << 8) | s[2];
+        d = emit(e, d, v >> 18);
+        d = emit(e, d, (v >> 12) & 0x3f);
+        d = emit(e, d, (v >> 6) & 0x3f);
+        return emit(e, d, v & 0x3f);
+    }
+}
+
+/* Encodes LEN bytes from SRC into DST, which must have room of
+   Scm_Base64EncodeBound(e, len).  Returns the number of chars written. */
+size_t Scm_Base64Encode(ScmBase64Encoder *e, const u_char *src, size_t len,
+                        char *dst)
+{
+    char *d = dst;
+
+    if (e->nleft > 0) {
+        u_char grp[3];
+        int n = e->nleft;
+        memcpy(grp, e->left, n);
+        while (n < 3 && len > 0) { grp[n++] = *src++; len--; }
+        if (n < 3) {
+            memcpy(e->left, grp, n);
+            e->nleft = n;
+            return 0;
+        }
+        d = emit_group(e, d, grp);
+        e->nleft = 0;
+    }
+
+    if (e->maxcol < 0) {
+        const char *t = e->table;
+        for (; len >= 12; src += 12, len -= 12, d += 16) {
+            encode_group(src,   d,    t);
+            encode_group(src+3, d+4,  t);
+            encode_group(src+6, d+8,  t);
+            encode_group(src+9, d+12, t);
+        }
+    }
+    for (; len >= 3; src += 3, len -= 3) {
+        d = emit_group(e, d, src);
+    }
+
+    memcpy(e->left, src, len);
+    e->nleft = (int)len;
+    return d - dst;
+}
+
+/* Flushes the pending bytes with padding.  DST needs 8 bytes. */
+size_t Scm_Base64EncodeFinish(ScmBase64Encoder *e, char *dst)
+{
+    char *d = dst;
+    u_char *s = e->left;
+    switch (e->nleft) {
+    case 1:
+        d = emit(e, d, s[0] >> 2);
+        d = emit(e, d, (s[0] & 0x03) << 4);
+        d = emit(e, d, PAD_INDEX);
+        d = emit(e, d, PAD_INDEX);
+        break;
+    case 2:
+        d = emit(e, d, s[0] >> 2);
+        d = emit(e, d, ((s[0] & 0x03) << 4) | (s[1] >> 4));
+        d = emit(e, d, (s[1] & 0x0f) << 2);
+        d = emit(e, d, PAD_INDEX);
+        break;
+    }
+    e->nleft = 0;
+    return d - dst;
+}
+
+/*
+ * Decoder
+ */
+
+void Scm_Base64DecoderInit(ScmBase64Decoder *d, int urlSafe)
+{
+    d->table = urlSafe? url_safe_decode : standard_decode;
+    d->ndigits = 0;
+    d->bits = 0;
+    d->done = FALSE;
+}
+
+/* Decodes LEN chars from SRC into DST, which must have room of
+   LEN*3/4+3 bytes.  Returns the number of bytes written. */
+size_t Scm_Base64Decode(ScmBase64Decoder *d, const char *src, size_t len,
+                        u_char *dst)
+{
+    const u_char *s = (const u_char*)src, *end = s + len;
+    const signed char *t = d->table;
+    u_char *o = dst;
+
+    if (d->done) return 0;
+    for (;;) {
+        if (d->ndigits == 0) {
+            while (end - s >= 4) {
+                int a = t[s[0]], b = t[s[1]], c = t[s[2]], x = t[s[3]];
+                if ((a | b | c | x) < 0) break;
+                u_int v = (a << 18) | (b << 12) | (c << 6) | x;
+                o[0] = (u_char)(v >> 16);
+                o[1] = (u_char)(v >> 8);
+                o[2] = (u_char)v;
+                o += 3;
+                s += 4;
+            }
+        }
+        if (s >= end) break;
+
+        int ch = *s++;
+        if (ch == '=') {
+            d->done = TRUE;
+            break;
+        }
+        int v = t[ch];
+        if (v < 0) continue;
+        switch (d->ndigits) {
+        case 0:
+            d->bits = v;
+            d->ndigits = 1;
+            break;
+        case 1:
+            *o++ = (u_char)((d->bits << 2) | (v >> 4));
+            d->bits = v & 0x0f;
+            d->ndigits = 2;
+            break;
+        case 2:
+            *o++ = (u_char)((d->bits << 4) | (v >> 2));
+            d->bits = v & 0x03;
+            d->ndigits = 3;
+            break;
+        default:
+            *o++ = (u_char)((d->bits << 6) | v);
+            d->ndigits = 0;
+            break;
+        }
+    }
+    return o - dst;
+}
+
+/*
+ * Interface to Scheme objects
+ */
+
+/* Returns an encoded string. */
+ScmObj Scm_Base64EncodeBytes(const u_char *src, size_t len,
+                             int lineWidth, int urlSafe)
+{
+    ScmBase64Encoder e;
+    Scm_Base64EncoderInit(&e, lineWidth, urlSafe);
+    char *buf = SCM_NEW_ATOMIC2(char*, Scm_Base64EncodeBound(&e, len) + 1);
+    size_t n = Scm_Base64Encode(&e, src, len, buf);
+    n += Scm_Base64EncodeFinish(&e, buf + n);
+    buf[n] = '\0';
+    return Scm_MakeString(buf, n, n, 0);
+}
+
+/* Returns a decoded u8vector if BYTEVECTORP, or a string otherwise.
+   The string is incomplete if the decoded octets aren't valid as
+   the native encoding. */
+ScmObj Scm_Base64DecodeBytes(const char *src, size_t len,
+                             int urlSafe, int bytevectorp)
+{
+    ScmBase64Decoder d;
+    Scm_Base64DecoderInit(&d, urlSafe);
+    u_char *buf = SCM_NEW_ATOMIC2(u_char*, len / 4 * 3 + 4);
+    size_t n = Scm_Base64Decode(&d, src, len, buf);
+    if (bytevectorp) {
+        return Scm_MakeUVector(SCM_CLASS_U8VECTOR, n, buf);
+    } else {
+        buf[n] = '\0';
+        return Scm_MakeString((char*)buf, n, -1, 0);
+    }
+}
+
+void Scm_Base64EncodePort(ScmPort *in, ScmPort *out,
+                          int lineWidth, int urlSafe)
+{
+    ScmBase64Encoder e;
+    Scm_Base64EncoderInit(&e, lineWidth, urlSafe);
+    u_char *ibuf = SCM_NEW_ATOMIC2(u_char*, CHUNK_SIZE);
+    char *obuf = SCM_NEW_ATOMIC2(char*, Scm_Base64EncodeBound(&e, CHUNK_SIZE));
+
+    for (;;) {
+        int r = Scm_Getz((char*)ibuf, CHUNK_SIZE, in);
+        if (r <= 0) break;
+        size_t n = Scm_Base64Encode(&e, ibuf, r, obuf);
+        if (n > 0) Scm_Putz(obuf, (int)n, out);
+    }
+    size_t n = Scm_Base64EncodeFinish(&e, obuf);
+    if (n > 0) Scm_Putz(obuf, (int)n, out);
+}
+
+void Scm_Base64DecodePort(ScmPort *in, ScmPort *out, int urlSafe)
+{
+    ScmBase64Decoder d;
+    Scm_Base64DecoderInit(&d, urlSafe);
+    char *ibuf = SCM_NEW_ATOMIC2(char*, CHUNK_SIZE);
+    u_char *obuf = SCM_NEW_ATOMIC2(u_char*, CHUNK_SIZE / 4 * 3 + 4);
+
+    /* We stop reading right after the pad character, as the Scheme
+       version did, so that the caller can read what follows the encoded
+       data from IN.  Since we can't push back the bytes read past it,
+       the input is read byte by byte and decoded by the chunk. */
+    while (!d.done) {
+        int r = 0;
+        while (r < CHUNK_SIZE) {
+            int b = Scm_Getb(in);
+            if (b == EOF) break;
+            ibuf[r++] = (char)b;
+            if (b == '=') break;
+        }
+        if (r == 0) break;
+        size_t n = Scm_Base64Decode(&d, ibuf, r, obuf);
+        if (n > 0) Scm_Putz((const char*)obuf, (int)n, out);
+    }
+}
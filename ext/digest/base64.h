@@ -0,0 +1,78 @@
+/*
+ * base64.h - Base64 codec
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_RFC_BASE64_H
+#define GAUCHE_RFC_BASE64_H
+
+#include <gauche.h>
+
+/* Streaming encoder.  Input bytes that don't fill a 3-byte group are
+   kept in the encoder until more input comes or it is finished. */
+typedef struct ScmBase64EncoderRec {
+    const char *table;          /* 64 digits followed by the pad char */
+    int maxcol;                 /* column after which a newline is
+                                   inserted; -1 for no line breaks */
+    int col;
+    int nleft;                  /* # of pending bytes (0..2) */
+    u_char left[2];
+} ScmBase64Encoder;
+
+/* Streaming decoder.  Characters outside the alphabet are skipped,
+   and decoding stops at the first pad character. */
+typedef struct ScmBase64DecoderRec {
+    const signed char *table;   /* char code -> digit, or -1 */
+    int ndigits;                /* # of digits in the current group */
+    u_int bits;                 /* remaining bits of the current group */
+    int done;                   /* pad char has been seen */
+} ScmBase64Decoder;
+
+extern void   Scm_Base64EncoderInit(ScmBase64Encoder *e, int lineWidth,
+                                    int urlSafe);
+extern size_t Scm_Base64EncodeBound(ScmBase64Encoder *e, size_t len);
+extern size_t Scm_Base64Encode(ScmBase64Encoder *e, const u_char *src,
+                               size_t len, char *dst);
+extern size_t Scm_Base64EncodeFinish(ScmBase64Encoder *e, char *dst);
+
+extern void   Scm_Base64DecoderInit(ScmBase64Decoder *d, int urlSafe);
+extern size_t Scm_Base64Decode(ScmBase64Decoder *d, const char *src,
+                               size_t len, u_char *dst);
+
+extern ScmObj Scm_Base64EncodeBytes(const u_char *src, size_t len,
+                                    int lineWidth, int urlSafe);
+extern ScmObj Scm_Base64DecodeBytes(const char *src, size_t len,
+                                    int urlSafe, int bytevectorp);
+extern void   Scm_Base64EncodePort(ScmPort *in, ScmPort *out,
+                                   int lineWidth, int urlSafe);
+extern void   Scm_Base64DecodePort(ScmPort *in, ScmPort *out, int urlSafe);
+
+#endif /*GAUCHE_RFC_BASE64_H*/
@@ -0,0 +1,94 @@
+;;;
+;;; base64.scm - base64 encoding/decoding routine
+;;;
+;;;   Copyright (c) 2000-2014  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; Implements Base64 encoding/decoding routine
+;; Ref: RFC2045 section 6.8  <http://www.rfc-editor.org/rfc/rfc2045.txt>
+;; and RFC3548 <http://www.rfc-editor.org/rfc/rfc3548.txt>
+
+;; The codec is in base64.c.  The encoder reads the input port in blocks.
+;; The decoder reads it byte by byte, so that it doesn't consume anything
+;; after the pad character, but decodes and writes in blocks.
+
+(define-module rfc.base64
+  (use gauche.uvector)
+  (export base64-encode base64-encode-string base64-encode-bytevector
+          base64-decode base64-decode-string base64-decode-bytevector))
+(select-module rfc.base64)
+
+(define (base64-decode :key (url-safe #f))
+  (%base64-decode-port (current-input-port) (current-output-port) url-safe))
+
+(define (base64-decode-string string :key (url-safe #f))
+  (%base64-decode string url-safe #f))
+
+;; Returns the decoded octets as a u8vector.
+(define (base64-decode-bytevector string :key (url-safe #f))
+  (%base64-decode string url-safe #t))
+
+(define (base64-encode :key (line-width 76) (url-safe #f))
+  (%base64-encode-port (current-input-port) (current-output-port)
+                       (or line-width 0) url-safe))
+
+(define (base64-encode-string string :key (line-width 76) (url-safe #f))
+  (%base64-encode string (or line-width 0) url-safe))
+
+(define (base64-encode-bytevector u8vector :key (line-width 76) (url-safe #f))
+  (%base64-encode u8vector (or line-width 0) url-safe))
+
+;;;
+;;; Low-level bindings
+;;;
+
+(inline-stub
+ "#include \"base64.h\""
+ "#include \"octets.h\""
+
+ (define-cproc %base64-encode (data line-width::<int> url-safe::<boolean>)
+   (let* ([size::size_t 0] [p::(const char*) (get_octets data (& size))])
+     (result (Scm_Base64EncodeBytes (cast (const u_char*) p) size
+                                    line-width url-safe))))
+
+ (define-cproc %base64-decode (data url-safe::<boolean> bytevector::<boolean>)
+   (let* ([size::size_t 0] [p::(const char*) (get_octets data (& size))])
+     (result (Scm_Base64DecodeBytes p size url-safe bytevector))))
+
+ (define-cproc %base64-encode-port (in::<input-port> out::<output-port>
+                                    line-width::<int> url-safe::<boolean>)
+   ::<void>
+   (Scm_Base64EncodePort in out line-width url-safe))
+
+ (define-cproc %base64-decode-port (in::<input-port> out::<output-port>
+                                    url-safe::<boolean>)
+   ::<void>
+   (Scm_Base64DecodePort in out url-safe))
+ )
@@ -0,0 +1,55 @@
+/*
+ * octets.h - Access to the octets of a string or a u8vector
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GAUCHE_RFC_OCTETS_H
+#define GAUCHE_RFC_OCTETS_H
+
+#include <gauche.h>
+
+/* Returns the octets of DATA, a string or a u8vector, and sets its
+   size in *SIZE.  Shared by the codec stubs. */
+static inline const char *get_octets(ScmObj data, size_t *size)
+{
+    if (SCM_U8VECTORP(data)) {
+        *size = SCM_U8VECTOR_SIZE(SCM_U8VECTOR(data));
+        return (const char*)SCM_UVECTOR_ELEMENTS(SCM_U8VECTOR(data));
+    }
+    if (SCM_STRINGP(data)) {
+        const ScmStringBody *b = SCM_STRING_BODY(data);
+        *size = SCM_STRING_BODY_SIZE(b);
+        return SCM_STRING_BODY_START(b);
+    }
+    SCM_TYPE_ERROR(data, "u8vector or string");
+    return NULL;                /* dummy */
+}
+
+#endif /*GAUCHE_RFC_OCTETS_H*/
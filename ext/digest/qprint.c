@@ -0,0 +1,273 @@
+/*
+ * qprint.c - Quoted-printable codec
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "qprint.h"
+
+/* RFC 2045 section 6.7.
+ *
+ * The behavior is the same as the former Scheme implementation.  Both
+ * the encoder and the decoder work on a buffer and may need to look
+ * ahead a few bytes (e.g. CR LF, or "=" followed by whitespace and
+ * a line break).  If such a sequence is cut at the end of the buffer
+ * and more input may come (FINAL is false), they stop before it and
+ * report how many bytes are consumed; the caller passes the rest
+ * again with the next input.
+ *
+ * Runs of octets that need no conversion are copied at once.
+ */
+
+#define CHUNK_SIZE 8192
+
+/* Octets that the encoder passes through.  We escape '?' as well,
+   for it interferes the header field encoding defined in RFC2047. */
+static inline int literal_p(u_char c)
+{
+    return ((0x20 < c && c < 0x3d) || c == 0x3e || (0x3f < c && c < 0x7f));
+}
+
+static inline int hex_value(u_char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+/*
+ * Encoder
+ */
+
+/* The minimum line width is 4, since one encoded octet and one soft
+   line break requires 4 characters. */
+void Scm_QPEncoderInit(ScmQPEncoder *e, int lineWidth, int binary)
+{
+    e->limit = (lineWidth >= 4)? lineWidth - 3 : -1;
+    e->lcnt = 0;
+    e->binary = binary;
+}
+
+/* DST must have room of SCM_QP_ENCODE_BOUND(len) chars.  Returns the
+   number of chars written. */
+size_t Scm_QPEncode(ScmQPEncoder *e, const u_char *src, size_t len,
+                    int final, char *dst, size_t *consumed)
+{
+    const u_char *s = src, *end = src + len;
+    char *d = dst;
+
+    while (s < end) {
+        if (e->limit >= 0 && e->lcnt >= e->limit) {
+            *d++ = '='; *d++ = '\r'; *d++ = '\n';
+            e->lcnt = 0;
+            continue;
+        }
+        u_char c = *s;
+        if (literal_p(c)) {
+            /* copy a run of literal octets up to the line limit */
+            const u_char *p = s + 1;
+            const u_char *lim = end;
+            if (e->limit >= 0 && (size_t)(e->limit - e->lcnt) < (size_t)(end - s)) {
+                lim = s + (e->limit - e->lcnt);
+            }
+            while (p < lim && literal_p(*p)) p++;
+            memcpy(d, s, p - s);
+            d += p - s;
+            e->lcnt += (int)(p - s);
+            s = p;
+        } else if (e->binary && (c == '\n' || c == '\r')) {
+            *d++ = '='; *d++ = '0'; *d++ = hex_digits[c];
+            e->lcnt += 1;
+            s++;
+        } else if (c == '\r') {
+            if (s + 1 >= end && !final) break;
+            s += (s + 1 < end && s[1] == '\n')? 2 : 1;
+            *d++ = '\r'; *d++ = '\n';
+            e->lcnt = 0;
+        } else if (c == '\n') {
+            *d++ = '\r'; *d++ = '\n';
+            e->lcnt = 0;
+            s++;
+        } else {
+            *d++ = '='; *d++ = hex_digits[c >> 4]; *d++ = hex_digits[c & 0x0f];
+            e->lcnt += 3;
+            s++;
+        }
+    }
+    *consumed = s - src;
+    return d - dst;
+}
+
+/*
+ * Decoder
+ */
+
+/* DST must have room of LEN bytes.  Returns the number of bytes
+   written. */
+size_t Scm_QPDecode(const char *src, size_t len, int final,
+                    u_char *dst, size_t *consumed)
+{
+    const u_char *s = (const u_char*)src, *end = s + len;
+    u_char *o = dst;
+
+#define NEED(p)  do { if ((p) >= end) { if (!final) goto out; s = end; goto out; } } while (0)
+
+    while (s < end) {
+        const u_char *q = memchr(s, '=', end - s);
+        if (q == NULL) q = end;
+        memcpy(o, s, q - s);
+        o += q - s;
+        s = q;
+        if (s >= end) break;
+
+        /* s points to '=' */
+        NEED(s + 1);
+        u_char c1 = s[1];
+        if (c1 == '\n') {       /* soft line break */
+            s += 2;
+        } else if (c1 == '\r') {
+            NEED(s + 2);
+            s += (s[2] == '\n')? 3 : 2;
+        } else if (c1 == ' ' || c1 == '\t') {
+            /* soft line break if only whitespaces follow */
+            const u_char *p = s + 2;
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            NEED(p);
+            if (*p == '\n') {
+                s = p + 1;
+            } else if (*p == '\r') {
+                NEED(p + 1);
+                s = (p[1] == '\n')? p + 2 : p + 1;
+            } else {
+                memcpy(o, s, p - s);
+                o += p - s;
+                s = p;
+            }
+        } else if (hex_value(c1) >= 0) {
+            if (s + 2 >= end) {
+                if (!final) break;
+                *o++ = '='; *o++ = c1;
+                s = end;
+                break;
+            }
+            int h2 = hex_value(s[2]);
+            if (h2 >= 0) {
+                *o++ = (u_char)(hex_value(c1) * 16 + h2);
+                s += 3;
+            } else {
+                *o++ = '='; *o++ = c1;
+                s += 2;
+            }
+        } else {
+            *o++ = '=';
+            s++;
+        }
+    }
+#undef NEED
+  out:
+    *consumed = s - (const u_char*)src;
+    return o - dst;
+}
+
+/*
+ * Interface to Scheme objects
+ */
+
+ScmObj Scm_QPEncodeBytes(const u_char *src, size_t len,
+                         int lineWidth, int binary)
+{
+    ScmQPEncoder e;
+    size_t consumed;
+    Scm_QPEncoderInit(&e, lineWidth, binary);
+    char *buf = SCM_NEW_ATOMIC2(char*, SCM_QP_ENCODE_BOUND(len) + 1);
+    size_t n = Scm_QPEncode(&e, src, len, TRUE, buf, &consumed);
+    buf[n] = '\0';
+    return Scm_MakeString(buf, n, n, 0);
+}
+
+/* Returns a decoded u8vector if BYTEVECTORP, or a string otherwise. */
+ScmObj Scm_QPDecodeBytes(const char *src, size_t len, int bytevectorp)
+{
+    size_t consumed;
+    u_char *buf = SCM_NEW_ATOMIC2(u_char*, len + 1);
+    size_t n = Scm_QPDecode(src, len, TRUE, buf, &consumed);
+    if (bytevectorp) {
+        return Scm_MakeUVector(SCM_CLASS_U8VECTOR, n, buf);
+    } else {
+        buf[n] = '\0';
+        return Scm_MakeString((char*)buf, n, -1, 0);
+    }
+}
+
+/* Common driver for ports.  Unconsumed bytes are carried over to
+   the next round. */
+#define PORT_LOOP(obound, convert)                                      \
+    do {                                                                \
+        size_t cap = CHUNK_SIZE, have = 0;                              \
+        char *ibuf = SCM_NEW_ATOMIC2(char*, cap);                       \
+        char *obuf = SCM_NEW_ATOMIC2(char*, obound(cap));               \
+        for (;;) {                                                      \
+            if (have == cap) {                                          \
+                char *nbuf = SCM_NEW_ATOMIC2(char*, cap*2);             \
+                memcpy(nbuf, ibuf, have);                               \
+                ibuf = nbuf;                                            \
+                cap *= 2;                                               \
+                obuf = SCM_NEW_ATOMIC2(char*, obound(cap));             \
+            }                                                           \
+            int r = Scm_Getz(ibuf + have, (int)(cap - have), in);       \
+            int final = (r <= 0);                                       \
+            if (r > 0) have += r;                                       \
+            size_t consumed;                                            \
+            size_t n = convert;                                         \
+            if (n > 0) Scm_Putz(obuf, (int)n, out);                     \
+            memmove(ibuf, ibuf + consumed, have - consumed);            \
+            have -= consumed;                                           \
+            if (final) break;                                           \
+        }                                                               \
+    } while (0)
+
+#define DECODE_BOUND(len)  (len)
+
+void Scm_QPEncodePort(ScmPort *in, ScmPort *out, int lineWidth, int binary)
+{
+    ScmQPEncoder e;
+    Scm_QPEncoderInit(&e, lineWidth, binary);
+    PORT_LOOP(SCM_QP_ENCODE_BOUND,
+              Scm_QPEncode(&e, (u_char*)ibuf, have, final, obuf, &consumed));
+}
+
+void Scm_QPDecodePort(ScmPort *in, ScmPort *out)
+{
+    PORT_LOOP(DECODE_BOUND,
+              Scm_QPDecode(ibuf, have, final, (u_char*)obuf, &consumed));
+}
@@ -0,0 +1,62 @@
+/*
+ * qprint.h - Quoted-printable codec
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_RFC_QPRINT_H
+#define GAUCHE_RFC_QPRINT_H
+
+#include <gauche.h>
+
+typedef struct ScmQPEncoderRec {
+    int limit;                  /* # of chars before a soft line break;
+                                   -1 for no line breaks */
+    int lcnt;                   /* chars in the current line */
+    int binary;                 /* encode CR and LF as well */
+} ScmQPEncoder;
+
+extern void   Scm_QPEncoderInit(ScmQPEncoder *e, int lineWidth, int binary);
+extern size_t Scm_QPEncode(ScmQPEncoder *e, const u_char *src, size_t len,
+                           int final, char *dst, size_t *consumed);
+extern size_t Scm_QPDecode(const char *src, size_t len, int final,
+                           u_char *dst, size_t *consumed);
+
+#define SCM_QP_ENCODE_BOUND(len)  ((len)*6 + 3)
+
+extern ScmObj Scm_QPEncodeBytes(const u_char *src, size_t len,
+                                int lineWidth, int binary);
+extern ScmObj Scm_QPDecodeBytes(const char *src, size_t len,
+                                int bytevectorp);
+extern void   Scm_QPEncodePort(ScmPort *in, ScmPort *out,
+                               int lineWidth, int binary);
+extern void   Scm_QPDecodePort(ScmPort *in, ScmPort *out);
+
+#endif /*GAUCHE_RFC_QPRINT_H*/
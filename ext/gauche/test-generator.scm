@@ -136,6 +136,78 @@
   (test-generate '(0 1 2 3 4 5 6 7 8 9)
                  (generate
                   (^[yield] (let loop ([i 0]) (yield i) (loop (+ i 1))))))
+
+  (define (grange n) (generate (^[yield] (dotimes [i n] (yield i)))))
+  (test-generate '((0 . 0) (1 . 1) (2 . 2)) (gmap cons (grange 3) (grange 3)))
+  (test-generate '(0 10 20)
+                 (generate (^[yield]
+                             (let1 g (grange 3)
+                               (let loop ([v (g)])
+                                 (unless (eof-object? v)
+                                   (yield (* v 10))
+                                   (loop (g))))))))
+  ;; non-tail recursion deep enough to overflow the stack segment
+  (test-generate '(deep)
+                 (generate (^[yield]
+                             (let loop ([n 0])
+                               (if (= n 100000)
+                                 (yield 'deep)
+                                 (begin (loop (+ n 1)) #f))))))
+  (test* "generate (many)" 4950
+         (let loop ([i 0] [sum 0])
+           (if (= i 100)
+             sum
+             (loop (+ i 1) (+ sum (generator-fold + 0 (grange i)))))))
+
+  (test* "generate (error)" '(1 (error "boom") eof)
+         (let1 g (generate (^[yield] (yield 1) (error "boom")))
+           (list (g)
+                 (guard (e [(error? e) `(error ,(condition-message e))]) (g))
+                 (if (eof-object? (g)) 'eof 'not-eof))))
+  (test-generate '(1 caught)
+                 (generate (^[yield]
+                             (guard (e [(symbol? e) (yield 'caught)])
+                               (yield 1)
+                               (raise 'oops)))))
+  (test* "generate (dynamic-wind)" '((1 2) (in out))
+         (let* ([log '()]
+                [g (generate (^[yield]
+                               (dynamic-wind
+                                 (^[] (push! log 'in))
+                                 (^[] (yield 1) (yield 2))
+                                 (^[] (push! log 'out)))))])
+           (list (generator->list g) (reverse log))))
+  (test* "generate (yield outside)" (test-error)
+         (let1 y #f
+           (generator->list (generate (^[yield] (set! y yield))))
+           (y 1)))
+  (test* "generate (escape)" '(1 (out) eof (error "boom"))
+         (let* ([log '()]
+                [break #f]
+                [g (generate (^[yield]
+                               (dynamic-wind
+                                 (^[] #f)
+                                 (^[] (break 1) (yield 2))
+                                 (^[] (push! log 'out)))))]
+                [v (let/cc k (set! break k) (g))])
+           (list v
+                 (reverse log)
+                 (if (eof-object? (g)) 'eof 'not-eof)
+                 (guard (e [(error? e) `(error ,(condition-message e))])
+                   (error "boom")))))
+  (test* "generate (escape from inside)" '(2 eof)
+         (let* ([k #f]
+                [g (generate (^[yield] (yield 1) (k 2) (yield 3)))]
+                [v (let/cc k0 (set! k k0) (g) (g) 'not-escaped)])
+           (list v (if (eof-object? (g)) 'eof 'not-eof))))
+  (test* "generate (escape from nested)" '(inner eof eof)
+         (let* ([k #f]
+                [inner (generate (^[yield] (k 'inner) (yield 'no)))]
+                [outer (generate (^[yield] (yield (inner))))]
+                [v (let/cc k0 (set! k k0) (outer))])
+           (list v
+                 (if (eof-object? (outer)) 'eof 'not-eof)
+                 (if (eof-object? (inner)) 'eof 'not-eof))))
   )
 
 ;; test x->generator <collection>.  this needs to be tested after
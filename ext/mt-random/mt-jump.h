@@ -0,0 +1,125 @@
+/*
+ * mt-jump.h - jump polynomial for MT19937
+ *
+ * This file is included only from mt-random.c.
+ *
+ * The table holds the coefficients of the polynomial
+ *
+ *     x^(2^128) mod P(x)
+ *
+ * where P(x) is the characteristic polynomial (of degree 19937) of the
+ * MT19937 state transition.  Bit i of the table (bit (i%32) of word i/32)
+ * is the coefficient of x^i.  P(x) was obtained by Berlekamp-Massey
+ * algorithm from the output sequence, and the remainder was computed
+ * by 128 times of squaring modulo P(x).  See Scm_MTJump for how it
+ * is used.
+ */
+
+#define MT_JUMP_POLY_BITS  19937
+
+static const ScmUInt32 mt_jump_poly[N] = {
+    0x72de3963U, 0xb5709ec4U, 0x88279bb6U, 0xa823f8e5U, 0x26d83e59U, 0x041f2259U,
+    0xe7fdbb15U, 0x8b521777U, 0x48b5e756U, 0xbf2812d5U, 0xe4b0adb9U, 0x0b4849aaU,
+    0x3e928b83U, 0xe96d39ceU, 0xaf6131d3U, 0x09eaf2e8U, 0x33548456U, 0xc1814c7bU,
+    0x893a7c83U, 0xfebd07bcU, 0x01bd8267U, 0x5147dcbfU, 0xe2a67de6U, 0x9afef574U,
+    0xb8334d09U, 0xf0d3decaU, 0x5561fd58U, 0xd884703bU, 0xef5c803bU, 0xb39b8f42U,
+    0x20dfb761U, 0xd61cfed3U, 0xcf5f3e5bU, 0x47416177U, 0x8e8442e9U, 0x8ea9cfabU,
+    0x585d0ec0U, 0x60ddf78dU, 0x2c9b8528U, 0xf0f7d60eU, 0xb2bb3bfcU, 0xca3ee37dU,
+    0x81c9e659U, 0x870ed969U, 0x9573a0deU, 0xce524851U, 0x77683b94U, 0x73cda5edU,
+    0x56bcfcbcU, 0xf43b956cU, 0x1f91de14U, 0xbf04b400U, 0x9438c481U, 0x1d859831U,
+    0xca6ae0a2U, 0x9d97aed5U, 0x9e464218U, 0xe75c9519U, 0x253c5486U, 0xcd43455cU,
+    0x73b5ccd8U, 0x7f8282d4U, 0xc8cacd44U, 0x192ddf99U, 0xd6be8546U, 0x5288b589U,
+    0xb4f26ca7U, 0x9819557fU, 0x200570ebU, 0x03e73d28U, 0x264acc04U, 0x78a114c9U,
+    0x95f0fb7bU, 0x42eee897U, 0xabcc80c2U, 0x67e751e8U, 0x1330cc85U, 0x140e87efU,
+    0x913b9a96U, 0xd3f8525eU, 0x3ee3d205U, 0x1ba1158fU, 0x2c4cdb89U, 0x1f6aa87dU,
+    0x9b5e9a3aU, 0x878b3223U, 0xa498c3edU, 0xa48c7778U, 0x974ac066U, 0x1d08f055U,
+    0xc8a08242U, 0xd6de80e9U, 0xa1cf0b40U, 0x2892ce4cU, 0x842731c7U, 0x604168aeU,
+    0xdd23ee6dU, 0xbecff8b2U, 0xdfac7287U, 0xa4369751U, 0xba8bc89dU, 0x4a5840d9U,
+    0xa7a58582U, 0xf53bdbedU, 0xcfba4997U, 0xa4149d1cU, 0xd5c66fc3U, 0xf2c72905U,
+    0xce68ad39U, 0xae4d8e96U, 0xf213a9b5U, 0xc588f396U, 0x9d6116bbU, 0x2c618d4eU,
+    0xb34420d1U, 0xebfb61f3U, 0x3b702ed7U, 0xcbdca6f2U, 0x7cb78166U, 0xbe283395U,
+    0x03a2436aU, 0x20c0d096U, 0xe190aa6fU, 0xbf49b815U, 0x49d78dc3U, 0x9b45b903U,
+    0x0aa4c4c8U, 0x67eb90e3U, 0xf32b13f0U, 0x7f5ceab1U, 0xccc48294U, 0x641eaedbU,
+    0x6d6aafb6U, 0x80b55358U, 0x72b55832U, 0xf1fa779aU, 0x3b60af74U, 0x8992aefdU,
+    0x4fa609f2U, 0x28359472U, 0x61e7aaf1U, 0x527dc1a9U, 0x834e8087U, 0xbcad693fU,
+    0xc9ca3bf6U, 0x95171796U, 0x9f41164aU, 0xb7d36775U, 0xcf20cf3bU, 0x5c77677bU,
+    0xf4765b01U, 0x47dfd69fU, 0xd90d6e15U, 0xd708247fU, 0x5fe95113U, 0xad799628U,
+    0xc627f9f2U, 0xfcfb0ce2U, 0x0f2441ceU, 0x4b003380U, 0x72161100U, 0x50fa780bU,
+    0x1f72b11aU, 0xb71ca8b7U, 0xffab42fdU, 0x5475baceU, 0x91c28b39U, 0x356eef78U,
+    0x1441c9c3U, 0xdc80086dU, 0x96c47491U, 0xb5c30ec9U, 0xa254e42dU, 0xa9321addU,
+    0x963a3612U, 0xc30bee5bU, 0x635c75c7U, 0xdf141323U, 0x38308f58U, 0x8926e38fU,
+    0x71b69592U, 0x897754d8U, 0x3cddde5eU, 0x5bc06174U, 0xad520904U, 0xbebb80a7U,
+    0x5cc284d4U, 0xd91d5d33U, 0x8c6ba748U, 0x11090e41U, 0x33bb9929U, 0x462cffbcU,
+    0xc42a508eU, 0xefc68605U, 0x602a3a14U, 0x230e6cd9U, 0x26c6f9f4U, 0x49b8eb31U,
+    0x51bd358fU, 0x7c49e7a4U, 0x47b592cbU, 0x1910bb39U, 0x3ced6a5bU, 0xad0ca518U,
+    0x93461dcbU, 0xd98ca579U, 0x9526948eU, 0xecc5cb65U, 0xfd1a431bU, 0x0bddc87dU,
+    0x5d694024U, 0x7d9820acU, 0xffeb5538U, 0x716c1ae1U, 0x13cffb2fU, 0x04f8ed86U,
+    0xd777f039U, 0x1b32eb97U, 0x87c1a95fU, 0x893da4eeU, 0xc235f16cU, 0x965118d4U,
+    0xe87994baU, 0xf99023e2U, 0xbb8c4545U, 0x891268a5U, 0xe7cf46b4U, 0x4d163861U,
+    0x0b2c5681U, 0xca688c0eU, 0x36702e5fU, 0xb86346b5U, 0x55e311bbU, 0x72a60137U,
+    0x142fdc5cU, 0x47d10e13U, 0xa34ce0cbU, 0xac088c30U, 0x8f9503feU, 0x4d79a2e8U,
+    0x937670c7U, 0x02b4c095U, 0x20f8f5e0U, 0x080533c0U, 0x81fe8f32U, 0xab1d0c25U,
+    0x048f776dU, 0xb601bb28U, 0x96004a47U, 0xf8b8e16eU, 0x6862af7bU, 0x4a9fa042U,
+    0xb0b6f662U, 0x54384ad4U, 0xa350c0eeU, 0x81670a57U, 0x26061dc1U, 0x3a2c2820U,
+    0xb575f899U, 0xb9749667U, 0x738dfc2aU, 0xaa853838U, 0x00ccc442U, 0xa53a92a4U,
+    0xcfaf5a3eU, 0xbdc8cfa2U, 0x09884265U, 0x529fee9dU, 0xa4d7f84fU, 0x966c709eU,
+    0x4c80bc42U, 0xd14265d4U, 0xf5ebe7f3U, 0xb23c2aedU, 0x804523f1U, 0xb7d47c42U,
+    0xa7cb0aa9U, 0x73370568U, 0x06d90ac5U, 0x66158a1eU, 0x9805c7adU, 0xc4a3898cU,
+    0x7890addeU, 0x7fc53690U, 0x85c39b20U, 0xc5427e08U, 0xc0c864f8U, 0x2fba05edU,
+    0xc365017aU, 0x210ad2bfU, 0x8ffb95eaU, 0x609ca003U, 0x8e6c4f72U, 0x84e663c4U,
+    0x3c110562U, 0x753c1ca8U, 0x8700b723U, 0x48642afcU, 0x14ac952cU, 0xcef1123eU,
+    0xed84973cU, 0xf075b8b8U, 0x0ceac5c9U, 0xf00a255aU, 0xdfcd487cU, 0x7e77e0daU,
+    0x8be5750cU, 0x0071cb97U, 0x560827feU, 0x28c4386fU, 0xaf4049f0U, 0xbf6b3ad6U,
+    0xa911aaddU, 0x2e3006d1U, 0x5eb5bb74U, 0x2e8489f9U, 0xc36fb83dU, 0x84278164U,
+    0x82302b47U, 0x61e0e6beU, 0x0422260eU, 0x11b59c56U, 0xe4f20c9cU, 0x9cd5ecaaU,
+    0xf866e2daU, 0x9bc72523U, 0x52c41667U, 0x816f533cU, 0x47a3235eU, 0xa0dbff9eU,
+    0x0c62a756U, 0xea9ca5a3U, 0xde0761a6U, 0xc51267e9U, 0x3eed2af6U, 0xf28b8866U,
+    0x695ed01fU, 0xfd769663U, 0x9065af4eU, 0xbc47fcdfU, 0xdfca6259U, 0x424e389cU,
+    0x166c2c1bU, 0xbb03335eU, 0x2a73a1a1U, 0xc4be33ddU, 0xe690d058U, 0x45746bc2U,
+    0x94b43407U, 0x07d38d7fU, 0x60854fb3U, 0x74b851e4U, 0xdb3d2ac2U, 0xd99df507U,
+    0x86d3323bU, 0x5d6c254cU, 0x82bfac22U, 0xb4dd3032U, 0xb27e023bU, 0xb7261a5fU,
+    0x34fe8179U, 0x40f361bfU, 0x6c9e7858U, 0xe716500eU, 0x65873b06U, 0x35c6ee0bU,
+    0xfb2864e7U, 0xe4c5d4fcU, 0x281901c6U, 0x858ee284U, 0xe5fca3cdU, 0x44803a65U,
+    0xf850f7f6U, 0xf9f41e41U, 0x65eb5539U, 0x87cbf3c9U, 0xbe2f8074U, 0xae056412U,
+    0x3c5cb955U, 0xd8fe916fU, 0xaec289dfU, 0xd18ccb5eU, 0x0eef81bfU, 0x446157f2U,
+    0x4690364aU, 0xde982175U, 0xc1597ea0U, 0xd094591bU, 0xb1ed3e17U, 0x79676e7aU,
+    0xc495ebc1U, 0xa283bdf6U, 0x648c3570U, 0x6a06b25cU, 0x398b0580U, 0x0deb138cU,
+    0xe51108edU, 0x4e3d096aU, 0x1dda7416U, 0xafde012bU, 0x722f0317U, 0xcb001892U,
+    0x23875cf7U, 0x82d756d2U, 0xc99114deU, 0x2091ce44U, 0xd24757b4U, 0x8a944ef9U,
+    0x8594145aU, 0xedf8f12bU, 0x998c4affU, 0xf30c0ce9U, 0x9ce601a0U, 0xba657a58U,
+    0x36a851ddU, 0x94e6ec8dU, 0xed46b938U, 0x86ada470U, 0x409b507dU, 0x46c714b9U,
+    0x05c862a8U, 0xb628043eU, 0x7ac4a188U, 0x8d763a8cU, 0x0adc18b6U, 0x7f5ba797U,
+    0x69073599U, 0x5db4bc6bU, 0x444d59d3U, 0x3d087e22U, 0xe9c04e89U, 0x61466f51U,
+    0x548aa4e6U, 0x151fd405U, 0x91555389U, 0x60905661U, 0x5e8d5619U, 0x3e3c8561U,
+    0x39c6b81cU, 0x2491156cU, 0xfc2fd4a6U, 0x17b4d42cU, 0x82c9bcf9U, 0x2bd704cfU,
+    0x7b2568ecU, 0x05403240U, 0x5d2268d9U, 0x7e037b6bU, 0xd86bec7aU, 0x231f10e7U,
+    0xba016830U, 0x964f8501U, 0xa3b7321fU, 0x9873c321U, 0x350ac2ddU, 0xa5a250e1U,
+    0x26578385U, 0xc738d247U, 0x012541caU, 0xcd33873cU, 0xc5907f19U, 0xd0cdc82cU,
+    0x5c2b540aU, 0x5656cca4U, 0x1f887dd1U, 0xa3d987b8U, 0x83e7fe48U, 0x06a28478U,
+    0x945682dbU, 0x465f2df8U, 0x9b494ce1U, 0xfac8ffbcU, 0x598f39cdU, 0xb12ac825U,
+    0xfa99231bU, 0x3e5c217eU, 0x3b2d8ba2U, 0xe550fdbaU, 0x8e510006U, 0x846a6733U,
+    0x3e573194U, 0xee48a926U, 0x5ccd36bdU, 0x41c394c8U, 0x10a79620U, 0xa19b67f2U,
+    0x8b3fd2a6U, 0x8a285c06U, 0x3a1797d9U, 0x3637050aU, 0x63dfca07U, 0x7295647eU,
+    0x7a7b3bbaU, 0xbe8e7601U, 0xea660549U, 0x3c1e511aU, 0xc7a1931aU, 0x06c40c25U,
+    0x3796cf70U, 0x7d188664U, 0xccd9fa38U, 0xb9f70031U, 0x601e2c75U, 0x87fe9735U,
+    0xf8cd68b0U, 0xef645dd6U, 0x7d05b323U, 0x535d7138U, 0x5c02f47fU, 0x90327a26U,
+    0x63ecd3b2U, 0xabd5ea25U, 0x01624325U, 0x302c1641U, 0xdbfbeb93U, 0x1cdfa6bcU,
+    0x866519a2U, 0xb15987edU, 0x113296f1U, 0x0c31ec84U, 0x232a35b2U, 0xb4132090U,
+    0x92d0c3c5U, 0x535172e3U, 0x095ffccbU, 0xfc24a0a9U, 0x932c038eU, 0x2546326eU,
+    0xccc15e47U, 0x1bbafc54U, 0x3cf2a838U, 0xa8486630U, 0x1057e025U, 0x8405b4aeU,
+    0xda36738dU, 0x1eec4c73U, 0x88b30f90U, 0x4f9ff104U, 0x85eea780U, 0x6eab7da8U,
+    0x40d9fdbeU, 0x6fe9593dU, 0x3c850d3cU, 0x65606c0cU, 0xb078a231U, 0x70308a34U,
+    0x635af9bdU, 0x6d9a7cbeU, 0xed73ee32U, 0x63660519U, 0x1701dd8dU, 0x0e62955fU,
+    0x180db0e9U, 0x9cb66a13U, 0xd3c2cd3eU, 0x78fb88aaU, 0x85fdbe48U, 0xa2859c52U,
+    0x9579f8f8U, 0x902ffd41U, 0x4b7c6a7bU, 0x1f5e048aU, 0x8e262d89U, 0x706d2495U,
+    0xebbbd878U, 0x816d7f42U, 0x88cdfbf1U, 0x3e6cc58aU, 0x754a64abU, 0xaa7dfafdU,
+    0xe98d0a02U, 0xb63cd2f7U, 0x38c8c85cU, 0x72c5b57fU, 0xb97f2b0aU, 0xe479da34U,
+    0x553e33f7U, 0x7c86232aU, 0xb35cc8f8U, 0xedc6266dU, 0xca67e7feU, 0x14b7f688U,
+    0x072d997bU, 0xb3d3d66fU, 0x528c6a42U, 0x121005b9U, 0x0df2b622U, 0x87d31f39U,
+    0x12ce5fd4U, 0xedaedb37U, 0x49dec2f4U, 0x8e53ff25U, 0xe79e435aU, 0x764041aaU,
+    0x29a3ee70U, 0xb359bd5eU, 0x5aa2b047U, 0x303acd04U, 0xb82a2d07U, 0x165795c2U,
+    0xa64ab733U, 0x950faac1U, 0xdfa2861fU, 0xff195e03U, 0x8cd6e865U, 0x5eb360ecU,
+    0x639cb063U, 0x19e1a74dU, 0x7ec12528U, 0x775c20d6U, 0xa44c4ddfU, 0x08722d7fU,
+    0xb0c92d32U, 0x83d145bcU, 0x3b2207e8U, 0x73da60e4U, 0xa13d0929U, 0x962813b9U,
+    0x738f420bU, 0xeb6572d6U, 0x151a52caU, 0x80a4a0efU, 0x23eee457U, 0x00000000U
+};
@@ -132,46 +132,48 @@ void Scm_MTInitByArray(ScmMersenneTwister *mt,
     mt->mt[0] = 0x80000000UL; /* MSB is 1; assuring non-zero initial array */
 }
 
-/* generates a random number on [0,0xffffffff]-interval */
-unsigned long Scm_MTGenrandU32(ScmMersenneTwister *mt)
+static const unsigned long mag01[2]={0x0UL, MATRIX_A};
+/* mag01[x] = x * MATRIX_A  for x=0,1 */
+
+/* generate N words at one time */
+static void next_block(ScmMersenneTwister *mt)
 {
     unsigned long y;
-    int mti = mt->mti;
-    static unsigned long mag01[2]={0x0UL, MATRIX_A};
-    /* mag01[x] = x * MATRIX_A  for x=0,1 */
-
-    if (mti >= N) { /* generate N words at one time */
-        int kk;
+    int kk;
 
-        if (mti == N+1)   /* if Scm_MTInitByUI() has not been called, */
-            Scm_MTInitByUI(mt, 5489UL); /* a default initial seed is used */
-
-        for (kk=0;kk<N-M;kk++) {
-            y = (mt->mt[kk]&UPPER_MASK)|(mt->mt[kk+1]&LOWER_MASK);
-            mt->mt[kk] = mt->mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
-        }
-        for (;kk<N-1;kk++) {
-            y = (mt->mt[kk]&UPPER_MASK)|(mt->mt[kk+1]&LOWER_MASK);
-            mt->mt[kk] = mt->mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
-        }
-        y = (mt->mt[N-1]&UPPER_MASK)|(mt->mt[0]&LOWER_MASK);
-        mt->mt[N-1] = mt->mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
+    if (mt->mti == N+1)   /* if Scm_MTInitByUI() has not been called, */
+        Scm_MTInitByUI(mt, 5489UL); /* a default initial seed is used */
 
-        mti = 0;
+    for (kk=0;kk<N-M;kk++) {
+        y = (mt->mt[kk]&UPPER_MASK)|(mt->mt[kk+1]&LOWER_MASK);
+        mt->mt[kk] = mt->mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
     }
+    for (;kk<N-1;kk++) {
+        y = (mt->mt[kk]&UPPER_MASK)|(mt->mt[kk+1]&LOWER_MASK);
+        mt->mt[kk] = mt->mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
+    }
+    y = (mt->mt[N-1]&UPPER_MASK)|(mt->mt[0]&LOWER_MASK);
+    mt->mt[N-1] = mt->mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
 
-    y = mt->mt[mti++];
+    mt->mti = 0;
+}
 
-    /* Tempering */
+static inline unsigned long temper(unsigned long y)
+{
     y ^= (y >> 11);
     y ^= (y << 7) & 0x9d2c5680UL;
     y ^= (y << 15) & 0xefc60000UL;
     y ^= (y >> 18);
-
-    mt->mti = mti;
     return y;
 }
 
+/* generates a random number on [0,0xffffffff]-interval */
+unsigned long Scm_MTGenrandU32(ScmMersenneTwister *mt)
+{
+    if (mt->mti >= N) next_block(mt);
+    return temper(mt->mt[mt->mti++]);
+}
+
 /* generates a random number on (0,1) or [0,1) -real-interval */
 float Scm_MTGenrandF32(ScmMersenneTwister *mt, int exclude0)
 {
@@ -196,6 +198,130 @@ double Scm_MTGenrandF64(ScmMersenneTwister *mt, int exclude0)
     return r;
 }
 
+/*
+ * Bulk generation
+ *
+ * These produce exactly the same sequence as calling the one-by-one
+ * routines repeatedly, but temper and convert a whole block of the
+ * state at once, so the function call and the check for the end of
+ * the state are paid once per block instead of once per number.
+ */
+
+/* fills BUF with N random numbers on [0,0xffffffff]-interval */
+void Scm_MTFillU32(ScmMersenneTwister *mt, ScmUInt32 *buf, long n)
+{
+    while (n > 0) {
+        if (mt->mti >= N) next_block(mt);
+        long k = N - mt->mti;
+        if (k > n) k = n;
+        const unsigned long *s = mt->mt + mt->mti;
+        for (long i=0; i<k; i++) buf[i] = (ScmUInt32)temper(s[i]);
+        mt->mti += k;
+        buf += k;
+        n -= k;
+    }
+}
+
+#define FILL_CHUNK 256
+
+/* fills BUF with N random numbers on (0,1) or [0,1) */
+void Scm_MTFillF32(ScmMersenneTwister *mt, float *buf, long n, int exclude0)
+{
+    ScmUInt32 tmp[FILL_CHUNK];
+    while (n > 0) {
+        long k = (n < FILL_CHUNK)? n : FILL_CHUNK, j = k;
+        Scm_MTFillU32(mt, tmp, k);
+        for (long i=0; i<k; i++) {
+            buf[i] = (float)(tmp[i]*(1.0/4294967296.0));
+        }
+        if (exclude0) {
+            /* Skipping 0.0 is equivalent to trying another one. */
+            j = 0;
+            for (long i=0; i<k; i++) {
+                if (buf[i] != 0.0) buf[j++] = buf[i];
+            }
+        }
+        buf += j;
+        n -= j;
+    }
+}
+
+/* fills BUF with N random numbers on (0,1) or [0,1) with 53-bit
+   resolution */
+void Scm_MTFillF64(ScmMersenneTwister *mt, double *buf, long n, int exclude0)
+{
+    ScmUInt32 tmp[FILL_CHUNK*2];
+    while (n > 0) {
+        long k = (n < FILL_CHUNK)? n : FILL_CHUNK, j = k;
+        Scm_MTFillU32(mt, tmp, k*2);
+        for (long i=0; i<k; i++) {
+            unsigned long a = tmp[i*2]>>5, b = tmp[i*2+1]>>6;
+            buf[i] = (a*67108864.0+b)*(1.0/9007199254740992.0);
+        }
+        if (exclude0) {
+            j = 0;
+            for (long i=0; i<k; i++) {
+                if (buf[i] != 0.0) buf[j++] = buf[i];
+            }
+        }
+        buf += j;
+        n -= j;
+    }
+}
+
+/*
+ * Jump ahead
+ *
+ * Advances the state by 2^128 steps, using the method described in
+ * H. Haramoto, M. Matsumoto, T. Nishimura, F. Panneton, P. L'Ecuyer,
+ * "Efficient jump ahead for F2-linear random number generators",
+ * INFORMS Journal on Computing, 20(3), 2008.
+ *
+ * With the jump polynomial J(x) = x^(2^128) mod P(x) = sum c_i x^i,
+ * the state after the jump is sum c_i S_i, where S_i is the state
+ * after i steps.  We view the state as a sliding window of the last
+ * N words of the recurrence and advance it one word at a time.
+ * Substreams obtained by successive jumps don't overlap unless one
+ * draws more than 2^128 numbers from one of them.
+ */
+#include "mt-jump.h"
+
+void Scm_MTJump(ScmMersenneTwister *mt)
+{
+    unsigned long st[N], acc[N], y;
+    int pos = 0;
+
+    if (mt->mti == N+1) Scm_MTInitByUI(mt, 5489UL);
+    memcpy(st, mt->mt, sizeof(st));
+    memset(acc, 0, sizeof(acc));
+
+    for (int i=0; i<MT_JUMP_POLY_BITS; i++) {
+        if (mt_jump_poly[i/32] & (1UL<<(i%32))) {
+            /* acc += the window, aligned at the oldest word */
+            int k;
+            for (k=0; k<N-pos; k++) acc[k] ^= st[pos+k];
+            for (; k<N; k++)        acc[k] ^= st[k-(N-pos)];
+        }
+        /* advance the window by one word */
+        int p1 = (pos+1 < N)? pos+1 : 0;
+        int pm = (pos+M < N)? pos+M : pos+M-N;
+        y = (st[pos]&UPPER_MASK)|(st[p1]&LOWER_MASK);
+        st[pos] = st[pm] ^ (y >> 1) ^ mag01[y & 0x1UL];
+        pos = p1;
+    }
+
+    /* The lower bits of the oldest word don't affect the recurrence,
+       so they are not determined by the above.  They may be output,
+       though, so we recover them from the newest word by inverting
+       the recurrence. */
+    y = acc[N-1] ^ acc[M-1];
+    if (y & UPPER_MASK) y = ((y ^ MATRIX_A) << 1) | 1;
+    else                y = y << 1;
+    acc[0] = (acc[0] & UPPER_MASK) | (y & LOWER_MASK);
+
+    memcpy(mt->mt, acc, sizeof(acc));
+}
+
 /*
  * Generic integer routine for [0, n-1], 0 < n <= 2^32
  */
@@ -78,3 +78,11 @@ extern unsigned long Scm_MTGenrandU32(ScmMersenneTwister *);
 extern float         Scm_MTGenrandF32(ScmMersenneTwister *, int);
 extern double        Scm_MTGenrandF64(ScmMersenneTwister *, int);
 extern ScmObj        Scm_MTGenrandInt(ScmMersenneTwister *mt, ScmObj n);
+
+extern void Scm_MTFillU32(ScmMersenneTwister *mt, ScmUInt32 *buf, long n);
+extern void Scm_MTFillF32(ScmMersenneTwister *mt, float *buf, long n,
+                          int exclude0);
+extern void Scm_MTFillF64(ScmMersenneTwister *mt, double *buf, long n,
+                          int exclude0);
+
+extern void Scm_MTJump(ScmMersenneTwister *mt);
@@ -42,7 +42,9 @@
           mt-random-integer
           mt-random-fill-u32vector!
           mt-random-fill-f32vector!
-          mt-random-fill-f64vector!)
+          mt-random-fill-f64vector!
+          mt-random-jump!
+          mt-random-streams)
   )
 (select-module math.mt-random)
 
@@ -67,3 +69,18 @@
           (quotient r q)
           (loop (%get-nword-random-int mt siz)))))))
 
+
+;; Returns a list of N generators whose sequences don't overlap for
+;; 2^128 draws.  The first one has the same state as MT; each of the
+;; rest is jumped 2^128 steps ahead of the previous one.  MT itself
+;; is not modified.
+(define (mt-random-streams mt n)
+  (let loop ([i 0] [state (mt-random-get-state mt)] [r '()])
+    (if (= i n)
+      (reverse r)
+      (let1 m (make <mersenne-twister>)
+        (mt-random-set-state! m state)
+        (let1 next (make <mersenne-twister>)
+          (mt-random-set-state! next state)
+          (mt-random-jump! next)
+          (loop (+ i 1) (mt-random-get-state next) (cons m r)))))))
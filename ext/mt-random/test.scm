@@ -110,6 +110,40 @@
                      (make-random-sequence <list> 100 (^[] (mt-random-real m2)))
                      ))))
 
+(test "long fill" #t
+      (^[] (let ([m0 (make <mersenne-twister> :seed 3)]
+                 [m1 (make <mersenne-twister> :seed 3)])
+             (mt-random-real m0) (mt-random-real m1) ; misalign blocks
+             (and (equal? (make-random-sequence <f64vector> 1000
+                                                (^[] (mt-random-real m0)))
+                          (rlet1 v (make-f64vector 1000 0)
+                            (mt-random-fill-f64vector! m1 v)))
+                  (equal? (make-random-sequence <u32vector> 2000
+                                                (^[] (mt-random-integer m0 (expt 2 32))))
+                          (rlet1 v (make-u32vector 2000 0)
+                            (mt-random-fill-u32vector! m1 v)))))))
+
+(test* "jump" '(3209552506 2866236092 1327417704 3840544924 3489456308)
+       (let1 m (make <mersenne-twister> :seed 7)
+         (mt-random-jump! m)
+         (list-tabulate 5 (^_ (mt-random-integer m (expt 2 32))))))
+
+(test* "jump twice" #t
+       (let ([m0 (make <mersenne-twister> :seed 7)]
+             [m1 (make <mersenne-twister> :seed 7)])
+         (mt-random-jump! m0 2)
+         (mt-random-jump! m1)
+         (mt-random-jump! m1)
+         (equal? (mt-random-get-state m0) (mt-random-get-state m1))))
+
+(test* "streams" '(#t #t #t)
+       (let* ([m (make <mersenne-twister> :seed 7)]
+              [ss (mt-random-streams m 3)]
+              [xs (map (^s (mt-random-integer s (expt 2 32))) ss)])
+         (list (= (car xs) (mt-random-integer m (expt 2 32)))
+               (= (cadr xs) 3209552506)
+               (= (length (delete-duplicates xs)) 3))))
+
 ;;-------------------------------------------------------------------
 ;; srfi-27 is built on top of mt-random, so we test it here.
 (test-section "srfi-27")
@@ -34,6 +34,11 @@
 #ifndef GAUCHE_NET_H
 #define GAUCHE_NET_H
 
+/* glibc declares recvmmsg(2) and sendmmsg(2) only with _GNU_SOURCE. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <sys/types.h>
 #include <gauche.h>
 #include <errno.h>
@@ -234,6 +239,8 @@ extern ScmObj Scm_SocketShutdown(ScmSocket *s, int how);
 extern ScmObj Scm_SocketClose(ScmSocket *s);
 
 extern ScmObj Scm_SocketInputPort(ScmSocket *s, int buffered);
+extern ScmObj Scm_SocketInputPortWithSize(ScmSocket *s, int buffered,
+                                          int bufsize);
 extern ScmObj Scm_SocketOutputPort(ScmSocket *s, int buffered);
 
 extern ScmObj Scm_SocketBind(ScmSocket *s, ScmSockAddr *addr);
@@ -252,6 +259,13 @@ extern ScmObj Scm_SocketRecvX(ScmSocket *s, ScmUVector *buf, int flags);
 extern ScmObj Scm_SocketRecvFrom(ScmSocket *s, int bytes, int flags);
 extern ScmObj Scm_SocketRecvFromX(ScmSocket *s, ScmUVector *buf,
                                   ScmObj addrs, int flags);
+extern ScmObj Scm_SocketRecvMsg(ScmSocket *s, int bytes, int controlbytes,
+                                int flags);
+extern ScmObj Scm_SocketRecvMMsg(ScmSocket *s, ScmVector *bufs,
+                                 ScmUVector *sizes, ScmObj addrs, int flags);
+extern ScmObj Scm_SocketSendMMsg(ScmSocket *s, ScmVector *msgs,
+                                 ScmObj addrs, int flags);
+extern ScmObj Scm_SocketRecvV(ScmSocket *s, ScmVector *bufs, int flags);
 
 extern ScmObj Scm_SocketBuildMsg(ScmSockAddr *name, ScmVector *iov,
                                  ScmObj control, int flags,
@@ -169,7 +169,44 @@ static void sockport_err(ScmSocket *sock, const char *io)
 }
 
 
+#if !GAUCHE_WINDOWS
+/* Callbacks for the socket input port with its own buffer size.
+   They are the same as the file port's, except that we use recv(2)
+   so that a datagram is read as a whole. */
+static int sockport_filler(ScmPort *p, int cnt)
+{
+    int r;
+    int fd = (int)(intptr_t)p->src.buf.data;
+    SCM_SYSCALL(r, recv(fd, p->src.buf.end, cnt, 0));
+    if (r < 0) {
+        p->error = TRUE;
+        Scm_SysError("recv(2) failed on %S", p);
+    }
+    return r;
+}
+
+static int sockport_ready(ScmPort *p)
+{
+    return Scm_FdReady((int)(intptr_t)p->src.buf.data, SCM_PORT_INPUT);
+}
+
+static int sockport_filenum(ScmPort *p)
+{
+    return (int)(intptr_t)p->src.buf.data;
+}
+#endif /*!GAUCHE_WINDOWS*/
+
 ScmObj Scm_SocketInputPort(ScmSocket *sock, int buffering)
+{
+    return Scm_SocketInputPortWithSize(sock, buffering, 0);
+}
+
+/* If BUFSIZE is positive, the port gets a buffer of that size.  With
+   a datagram socket, each fill of the buffer reads one datagram, so
+   the buffer should be as large as the largest datagram expected.
+   The buffer size is ignored on Windows. */
+ScmObj Scm_SocketInputPortWithSize(ScmSocket *sock, int buffering,
+                                   int bufsize)
 {
     if (sock->inPort == NULL) {
         int infd;
@@ -190,6 +227,26 @@ ScmObj Scm_SocketInputPort(ScmSocket *sock, int buffering)
            pointer to the socket. */
         ScmObj sockname = SCM_LIST2(SCM_MAKE_STR("socket input"),
                                     SCM_OBJ(sock));
+#if !GAUCHE_WINDOWS
+        if (bufsize > 0) {
+            ScmPortBuffer bufrec;
+            bufrec.buffer = NULL;
+            bufrec.size = bufsize;
+            bufrec.mode = buffering;
+            bufrec.filler = sockport_filler;
+            bufrec.flusher = NULL;
+            bufrec.closer = NULL;
+            bufrec.ready = sockport_ready;
+            bufrec.filenum = sockport_filenum;
+            bufrec.seeker = NULL;
+            bufrec.data = (void*)(intptr_t)infd;
+            sock->inPort = SCM_PORT(Scm_MakeBufferedPort(SCM_CLASS_PORT,
+                                                         sockname,
+                                                         SCM_PORT_INPUT,
+                                                         FALSE, &bufrec));
+            return SCM_OBJ(sock->inPort);
+        }
+#endif /*!GAUCHE_WINDOWS*/
         sock->inPort = SCM_PORT(Scm_MakePortWithFd(sockname, SCM_PORT_INPUT,
                                                    infd, buffering, FALSE));
     }
@@ -438,6 +495,56 @@ ScmObj Scm_SocketRecvFrom(ScmSocket *sock, int bytes, int flags)
                        Scm_MakeSockAddr(NULL, (struct sockaddr*)&from, fromlen));
 }
 
+/* Receives a message with ancillary data.  Returns the message as
+   an incomplete string, and a list of control messages in the form
+   ((level type u8vector) ...), the same form socket-buildmsg takes.
+   CONTROLBYTES is the maximum size of the ancillary data (without
+   cmsg headers); if it is zero, ancillary data is discarded. */
+ScmObj Scm_SocketRecvMsg(ScmSocket *sock, int bytes, int controlbytes,
+                         int flags)
+{
+#if !GAUCHE_WINDOWS
+    int r;
+    struct msghdr msg;
+    struct iovec iov;
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+
+    CLOSE_CHECK(sock->fd, "recv from", sock);
+    if (bytes < 0) Scm_Error("bytes must be nonnegative, but got %d", bytes);
+    if (controlbytes < 0) {
+        Scm_Error("controlbytes must be nonnegative, but got %d",
+                  controlbytes);
+    }
+    char *buf = SCM_NEW_ATOMIC2(char*, bytes);
+    iov.iov_base = buf;
+    iov.iov_len = bytes;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (controlbytes > 0) {
+        msg.msg_controllen = CMSG_SPACE(controlbytes);
+        msg.msg_control = SCM_NEW_ATOMIC2(char*, msg.msg_controllen);
+    }
+    SCM_SYSCALL(r, recvmsg(sock->fd, &msg, flags));
+    if (r < 0) Scm_SysError("recvmsg(2) failed");
+
+    if (msg.msg_controllen > 0) {
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL;
+             c = CMSG_NXTHDR(&msg, c)) {
+            ScmSmallInt len = c->cmsg_len - CMSG_LEN(0);
+            ScmObj data = Scm_MakeU8VectorFromArray(len, CMSG_DATA(c));
+            SCM_APPEND1(h, t, SCM_LIST3(SCM_MAKE_INT(c->cmsg_level),
+                                        SCM_MAKE_INT(c->cmsg_type),
+                                        data));
+        }
+    }
+    return Scm_Values2(Scm_MakeString(buf, r, r, SCM_STRING_INCOMPLETE), h);
+#else  /*GAUCHE_WINDOWS*/
+    Scm_Error("recvmsg is not implemented on this platform.");
+    return SCM_UNDEFINED;       /* dummy */
+#endif /*GAUCHE_WINDOWS*/
+}
+
 /* ADDRS is a list of socket addresses; if 'from' address type matches
    one of them, it is used to store the information so that we can avoid
    allocation.  If no addresses match the incoming type, and ADDRS is
@@ -478,6 +585,205 @@ ScmObj Scm_SocketRecvFromX(ScmSocket *sock, ScmUVector *buf,
     return Scm_Values2(Scm_MakeInteger(r), addr);
 }
 
+/*
+ * Batched datagram I/O
+ *
+ *  Scm_SocketRecvMMsg receives up to N datagrams into the uvectors in
+ *  BUFS (a vector) at once, where N is the length of BUFS, and stores
+ *  the size of each one into the s32vector SIZES.  If ADDRS is a vector,
+ *  the sender's address of each datagram goes to the corresponding
+ *  element; the sockaddr there is overwritten if it is of the same
+ *  family, or replaced by a new one otherwise.  Returns the number of
+ *  datagrams received.
+ *
+ *  Scm_SocketSendMMsg sends each element of MSGS (a vector of uvectors
+ *  and/or strings) as a datagram, to the corresponding sockaddr in ADDRS
+ *  if it is a vector.  Returns the number of datagrams sent.
+ *
+ *  Without recvmmsg(2)/sendmmsg(2), we fall back to recvfrom(2), which
+ *  receives one datagram per call, and a loop of send(2)/sendto(2).
+ */
+
+/* Returns the number of messages.  When SENDING, ADDRS must contain
+   socket addresses. */
+static ScmSmallInt check_mmsg_args(ScmVector *v, ScmObj addrs, int sending)
+{
+    ScmSmallInt n = SCM_VECTOR_SIZE(v);
+    if (SCM_VECTORP(addrs)) {
+        if (SCM_VECTOR_SIZE(addrs) < n) {
+            Scm_Error("address vector too short for %ld messages: %S",
+                      n, addrs);
+        }
+        for (ScmSmallInt i = 0; sending && i < n; i++) {
+            ScmObj a = SCM_VECTOR_ELEMENT(addrs, i);
+            if (!Scm_SockAddrP(a)) {
+                Scm_TypeError("address", "socket address", a);
+            }
+        }
+    } else if (!SCM_FALSEP(addrs)) {
+        Scm_TypeError("addrs", "vector or #f", addrs);
+    }
+    return n;
+}
+
+static void store_mmsg_addr(ScmObj addrs, ScmSmallInt i,
+                            struct sockaddr_storage *from, socklen_t fromlen)
+{
+    ScmObj a = SCM_VECTOR_ELEMENT(addrs, i);
+    if (Scm_SockAddrP(a) && SCM_SOCKADDR_FAMILY(a) == from->ss_family) {
+        memcpy(&SCM_SOCKADDR(a)->addr, from, SCM_SOCKADDR(a)->addrlen);
+    } else {
+        SCM_VECTOR_ELEMENT(addrs, i) =
+            Scm_MakeSockAddr(NULL, (struct sockaddr*)from, fromlen);
+    }
+}
+
+ScmObj Scm_SocketRecvMMsg(ScmSocket *sock, ScmVector *bufs,
+                          ScmUVector *sizes, ScmObj addrs, int flags)
+{
+    int r;
+    u_int size;
+    CLOSE_CHECK(sock->fd, "recv from", sock);
+    if (!SCM_S32VECTORP(sizes)) {
+        Scm_TypeError("sizes", "s32vector", SCM_OBJ(sizes));
+    }
+    if (SCM_UVECTOR_IMMUTABLE_P(sizes)) {
+        Scm_Error("attempted to use an immutable uniform vector as a buffer");
+    }
+    ScmSmallInt n = check_mmsg_args(bufs, addrs, FALSE);
+    if (SCM_UVECTOR_SIZE(sizes) < n) {
+        Scm_Error("size vector too short for %ld buffers: %S", n, sizes);
+    }
+    if (n == 0) return SCM_MAKE_INT(0);
+    ScmInt32 *szv = SCM_S32VECTOR_ELEMENTS(sizes);
+    int withaddr = SCM_VECTORP(addrs);
+
+#if defined(HAVE_RECVMMSG)
+    struct mmsghdr *msgs = SCM_NEW_ATOMIC_ARRAY(struct mmsghdr, n);
+    struct iovec *iov = SCM_NEW_ATOMIC_ARRAY(struct iovec, n);
+    struct sockaddr_storage *from = NULL;
+    if (withaddr) from = SCM_NEW_ATOMIC_ARRAY(struct sockaddr_storage, n);
+    memset(msgs, 0, sizeof(struct mmsghdr)*n);
+    for (ScmSmallInt i = 0; i < n; i++) {
+        ScmObj b = SCM_VECTOR_ELEMENT(bufs, i);
+        if (!SCM_UVECTORP(b)) Scm_TypeError("buffer", "uniform vector", b);
+        iov[i].iov_base = get_message_buffer(SCM_UVECTOR(b), &size);
+        iov[i].iov_len = size;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (withaddr) {
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        }
+    }
+    SCM_SYSCALL(r, recvmmsg(sock->fd, msgs, (unsigned int)n, flags, NULL));
+    if (r < 0) Scm_SysError("recvmmsg(2) failed");
+    for (int i = 0; i < r; i++) {
+        szv[i] = (ScmInt32)msgs[i].msg_len;
+        if (withaddr) {
+            store_mmsg_addr(addrs, i, &from[i], msgs[i].msg_hdr.msg_namelen);
+        }
+    }
+    return SCM_MAKE_INT(r);
+#else  /*!HAVE_RECVMMSG*/
+    struct sockaddr_storage from;
+    socklen_t fromlen = sizeof(from);
+    ScmObj b = SCM_VECTOR_ELEMENT(bufs, 0);
+    if (!SCM_UVECTORP(b)) Scm_TypeError("buffer", "uniform vector", b);
+    char *z = get_message_buffer(SCM_UVECTOR(b), &size);
+    SCM_SYSCALL(r, recvfrom(sock->fd, z, size, flags,
+                            (struct sockaddr*)&from, &fromlen));
+    if (r < 0) Scm_SysError("recvfrom(2) failed");
+    szv[0] = r;
+    if (withaddr) store_mmsg_addr(addrs, 0, &from, fromlen);
+    return SCM_MAKE_INT(1);
+#endif /*!HAVE_RECVMMSG*/
+}
+
+ScmObj Scm_SocketSendMMsg(ScmSocket *sock, ScmVector *msgs, ScmObj addrs,
+                          int flags)
+{
+    int r;
+    u_int size;
+    CLOSE_CHECK(sock->fd, "send to", sock);
+    ScmSmallInt n = check_mmsg_args(msgs, addrs, TRUE);
+    if (n == 0) return SCM_MAKE_INT(0);
+    int withaddr = SCM_VECTORP(addrs);
+
+#if defined(HAVE_SENDMMSG)
+    struct mmsghdr *hdrs = SCM_NEW_ATOMIC_ARRAY(struct mmsghdr, n);
+    struct iovec *iov = SCM_NEW_ATOMIC_ARRAY(struct iovec, n);
+    memset(hdrs, 0, sizeof(struct mmsghdr)*n);
+    for (ScmSmallInt i = 0; i < n; i++) {
+        iov[i].iov_base =
+            (char*)get_message_body(SCM_VECTOR_ELEMENT(msgs, i), &size);
+        iov[i].iov_len = size;
+        hdrs[i].msg_hdr.msg_iov = &iov[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+        if (withaddr) {
+            ScmObj a = SCM_VECTOR_ELEMENT(addrs, i);
+            hdrs[i].msg_hdr.msg_name = &SCM_SOCKADDR(a)->addr;
+            hdrs[i].msg_hdr.msg_namelen = SCM_SOCKADDR(a)->addrlen;
+        }
+    }
+    SCM_SYSCALL(r, sendmmsg(sock->fd, hdrs, (unsigned int)n, flags));
+    if (r < 0) Scm_SysError("sendmmsg(2) failed");
+    return SCM_MAKE_INT(r);
+#else  /*!HAVE_SENDMMSG*/
+    ScmSmallInt i;
+    for (i = 0; i < n; i++) {
+        const char *cmsg = get_message_body(SCM_VECTOR_ELEMENT(msgs, i),
+                                            &size);
+        if (withaddr) {
+            ScmObj a = SCM_VECTOR_ELEMENT(addrs, i);
+            SCM_SYSCALL(r, sendto(sock->fd, cmsg, size, flags,
+                                  &SCM_SOCKADDR(a)->addr,
+                                  SCM_SOCKADDR(a)->addrlen));
+        } else {
+            SCM_SYSCALL(r, send(sock->fd, cmsg, size, flags));
+        }
+        if (r < 0) {
+            /* Like sendmmsg(2), an error after some messages are sent
+               isn't reported. */
+            if (i > 0) break;
+            Scm_SysError("%s failed", withaddr? "sendto(2)" : "send(2)");
+        }
+    }
+    return SCM_MAKE_INT(i);
+#endif /*!HAVE_SENDMMSG*/
+}
+
+/* Scatter read.  BUFS is a vector of uvectors, which are filled in
+   order by a single recvmsg(2).  Use uvector-alias to read into slices
+   of a larger buffer.  Returns the total number of bytes read. */
+ScmObj Scm_SocketRecvV(ScmSocket *sock, ScmVector *bufs, int flags)
+{
+#if !GAUCHE_WINDOWS
+    int r;
+    u_int size;
+    struct msghdr msg;
+
+    CLOSE_CHECK(sock->fd, "recv from", sock);
+    ScmSmallInt n = SCM_VECTOR_SIZE(bufs);
+    struct iovec *iov = SCM_NEW_ATOMIC_ARRAY(struct iovec, n);
+    for (ScmSmallInt i = 0; i < n; i++) {
+        ScmObj b = SCM_VECTOR_ELEMENT(bufs, i);
+        if (!SCM_UVECTORP(b)) Scm_TypeError("buffer", "uniform vector", b);
+        iov[i].iov_base = get_message_buffer(SCM_UVECTOR(b), &size);
+        iov[i].iov_len = size;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = n;
+    SCM_SYSCALL(r, recvmsg(sock->fd, &msg, flags));
+    if (r < 0) Scm_SysError("recvmsg(2) failed");
+    return Scm_MakeInteger(r);
+#else  /*GAUCHE_WINDOWS*/
+    Scm_Error("scatter read is not implemented on this platform.");
+    return SCM_UNDEFINED;       /* dummy */
+#endif /*GAUCHE_WINDOWS*/
+}
+
 /* Low level message builder */
 ScmObj Scm_SocketBuildMsg(ScmSockAddr *name, ScmVector *iov,
                           ScmObj control, int flags,
@@ -47,6 +47,8 @@
           socket-getsockname socket-getpeername socket-ioctl
           socket-send socket-sendto socket-sendmsg socket-buildmsg
           socket-recv socket-recv! socket-recvfrom socket-recvfrom!
+          socket-recvmsg socket-recvmmsg! socket-sendmmsg socket-recvv!
+          socket-take-input-buffer!
           <sockaddr> <sockaddr-in> <sockaddr-un> make-sockaddrs
           sockaddr-name sockaddr-family sockaddr-addr sockaddr-port
           make-client-socket make-server-socket make-server-sockets
@@ -67,6 +69,7 @@
 (export-if-defined
  IPPROTO_IP IPPROTO_ICMP IPPROTO_TCP
  IPPROTO_UDP IPPROTO_IPV6 IPPROTO_ICMPV6 SOL_SOCKET SOMAXCONN
+ SCM_RIGHTS SCM_CREDENTIALS
  SO_ACCEPTCONN SO_BINDTODEVICE SO_BROADCAST SO_DEBUG
  SO_DONTROUTE SO_ERROR SO_KEEPALIVE SO_LINGER SO_OOBINLINE
  SO_PASSCRED SO_PEERCRED SO_PRIORITY SO_RCVBUF SO_RCVLOWAT
@@ -79,7 +82,7 @@
  IP_ROUTER_ALERT IP_MULTICAST_TTL IP_MULTICAST_LOOP
  IP_ADD_MEMBERSHIP IP_DROP_MEMBERSHIP IP_MULTICAST_IF
  MSG_CTRUNC MSG_DONTROUTE MSG_EOR MSG_OOB MSG_PEEK MSG_TRUNC
- MSG_WAITALL)
+ MSG_WAITALL MSG_WAITFORONE MSG_DONTWAIT)
 
 ;; Netdevice control.  OS specific.
 (export-if-defined
@@ -570,6 +570,144 @@
        (test* "udp sendmsg w/o sendbuf" '(#t #t) (xtest #f)))))]
  [else #f])
 
+;; batched, scatter and zero-copy receive
+(cond-expand
+ [(and (not gauche.os.cygwin)
+       (not gauche.os.windows))
+  (with-sr-udp
+   (^[s-sock s-addr r-sock r-addr]
+     (let ([data  `#("abc" ,(u8vector 1 2) "defgh")]
+           [bufs  (vector (make-u8vector 16) (make-u8vector 16)
+                          (make-u8vector 16))]
+           [sizes (make-s32vector 3 -1)]
+           [from  (make <sockaddr-in>)])
+       (test* "socket-sendmmsg" 3
+              (socket-sendmmsg s-sock data (make-vector 3 s-addr)))
+       ;; NB: Without recvmmsg(2), only one datagram is received.
+       (test* "socket-recvmmsg!" '(#t #t #t)
+              (let1 n (socket-recvmmsg! r-sock bufs sizes
+                                        (vector from #f #f))
+                (list (<= 1 n 3)
+                      (every (^i (equal? (uvector-alias
+                                          <u8vector> (vector-ref bufs i)
+                                          0 (s32vector-ref sizes i))
+                                         (let1 d (vector-ref data i)
+                                           (if (string? d)
+                                             (string->u8vector d)
+                                             d))))
+                             (iota n))
+                      (= (sockaddr-port from)
+                         (sockaddr-port (socket-getsockname s-sock)))))))))
+
+  (with-sr-udp
+   (^[s-sock s-addr r-sock r-addr]
+     (let* ([buf (make-u8vector 16 0)]
+            [iov (vector (uvector-alias <u8vector> buf 0 6)
+                         (uvector-alias <u8vector> buf 8 16))])
+       (test* "socket-recvv!" '(13 "header" "payload")
+              (begin
+                (socket-sendto s-sock "headerpayload" s-addr)
+                (list (socket-recvv! r-sock iov)
+                      (u8vector->string buf 0 6)
+                      (u8vector->string buf 8 15)))))))
+
+  (with-sr-udp
+   (^[s-sock s-addr r-sock r-addr]
+     (let1 in (socket-input-port r-sock :buffer-size 64)
+       (socket-sendto s-sock "first" s-addr)
+       (socket-sendto s-sock "second!" s-addr)
+       (socket-sendto s-sock "third" s-addr)
+       (test* "socket-take-input-buffer!" '("first" "second!")
+              (map (^_ (u8vector->string (socket-take-input-buffer! r-sock)))
+                   '(1 2)))
+       (test* "socket-take-input-buffer! after peek" "third"
+              (begin
+                (peek-byte in)
+                (u8vector->string (socket-take-input-buffer! r-sock)))))))
+
+  ;; Data filling at least half of the buffer is handed over as is,
+  ;; and the port goes on with a fresh buffer.
+  (with-sr-udp
+   (^[s-sock s-addr r-sock r-addr]
+     (socket-input-port r-sock :buffer-size 16)
+     (socket-sendto s-sock "0123456789" s-addr)
+     (socket-sendto s-sock "abcdefghijklmnop" s-addr)
+     (socket-sendto s-sock "xyz" s-addr)
+     (test* "socket-take-input-buffer! (large data)"
+            '("0123456789" "abcdefghijklmnop" "xyz")
+            (map (^_ (u8vector->string (socket-take-input-buffer! r-sock)))
+                 '(1 2 3)))))]
+ [else #f])
+
+;; passing file descriptors
+(cond-expand
+ [(and (not gauche.os.cygwin)
+       (not gauche.os.windows))
+  (sys-unlink "sockr.o")
+  (let* ([server (make-server-socket 'unix "sockr.o")]
+         [client (make-client-socket 'unix "sockr.o")]
+         [conn   (socket-accept server)])
+    (receive (in out) (sys-pipe)
+      (socket-sendmsg client
+                      (socket-buildmsg #f '#("x")
+                                       `((,SOL_SOCKET ,SCM_RIGHTS
+                                          ,(uvector-alias
+                                            <u8vector>
+                                            (s32vector (port-file-number out)))))
+                                       0))
+      (test* "socket-recvmsg with SCM_RIGHTS" '("x" "hello")
+             (receive (data control) (socket-recvmsg conn 16 4)
+               (let* ([c  (car control)]
+                      [fd (s32vector-ref (uvector-alias <s32vector> (caddr c))
+                                         0)]
+                      [p  (open-output-fd-port fd :owner? #t)])
+                 (display "hello\n" p)
+                 (close-port p)
+                 (close-port out)
+                 (list data (read-line in)))))
+      (close-port in))
+    (for-each socket-close (list conn client server)))
+  (sys-unlink "sockr.o")
+
+  (use gauche.forkserver)
+  (test-module 'gauche.forkserver)
+
+  (sys-unlink "forks.o")
+  (let1 pid (sys-fork)
+    (when (= pid 0)
+      (forkserver-start "forks.o"
+                        (^[args]
+                          (cond [(equal? args '("exit")) (exit 5)]
+                                [(equal? args '("env"))
+                                 (if (equal? (sys-getenv "FORKSERVER_TEST")
+                                             "yes")
+                                   1
+                                   0)]
+                                [else (string->number (car args))])))
+      (sys-exit 0))
+    (let loop ([n 0])
+      (unless (or (file-exists? "forks.o") (> n 100))
+        (sys-nanosleep #e1e7)
+        (loop (+ n 1))))
+    (test* "forkserver-run" 3 (forkserver-run "forks.o" '("3")))
+    (test* "forkserver-run (exit)" 5 (forkserver-run "forks.o" '("exit")))
+    (test* "forkserver-run (environment)" 1
+           (begin
+             (sys-setenv "FORKSERVER_TEST" "yes" #t)
+             (forkserver-run "forks.o" '("env"))))
+    ;; A client that goes away before sending its request must not
+    ;; take down the server.
+    (test* "forkserver survives early disconnect" '(#t 4)
+           (begin
+             (socket-close (make-client-socket 'unix "forks.o"))
+             (sys-nanosleep #e2e8)
+             (list (file-exists? "forks.o")
+                   (forkserver-run "forks.o" '("4")))))
+    (sys-kill pid SIGTERM)
+    (sys-waitpid pid))
+  (sys-unlink "forks.o")]
+ [else #f])
+
 ;;-----------------------------------------------------------------
 (test-section "srfi-106")
 
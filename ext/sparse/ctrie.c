@@ -53,27 +53,6 @@ void CompactTrieInit(CompactTrie *t)
 /*
  * Nodes
  */
-#define KEY2INDEX(key, level) (((key)>>((level)*TRIE_SHIFT)) & TRIE_MASK)
-
-#define NODE_HAS_ARC(node, ind)     SCM_BITS_TEST_IN_WORD(node->emap, (ind))
-#define NODE_ARC_SET(node, ind)     SCM_BITS_SET_IN_WORD(node->emap, (ind))
-#define NODE_ARC_RESET(node, ind)   SCM_BITS_RESET_IN_WORD(node->emap, (ind))
-#define NODE_EMPTY_P(node)          (node->emap == NULL)
-#define NODE_NCHILDREN(node)        Scm__CountBitsInWord(node->emap)
-
-#define NODE_ARC_IS_LEAF(node, ind) SCM_BITS_TEST_IN_WORD(node->lmap, (ind))
-#define NODE_LEAF_SET(node, ind)    SCM_BITS_SET_IN_WORD(node->lmap, (ind))
-#define NODE_LEAF_RESET(node, ind)  SCM_BITS_RESET_IN_WORD(node->lmap, (ind))
-
-#define NODE_INDEX2OFF(node, ind)    Scm__CountBitsBelow(node->emap, (ind))
-
-#define NODE_ENTRY(node, off)        ((node)->entries[(off)])
-
-#if SIZEOF_LONG == 4
-#define KEY_MASK(key) /* empty */
-#else
-#define KEY_MASK(key) (key &= ((1UL<<32)-1))
-#endif
 
 /* When extending the node, we increase the number of entries by this
    number instead of increasing every word, to avoid too frequent
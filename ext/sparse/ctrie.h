@@ -78,6 +78,30 @@ typedef struct NodeRec {
     void    *entries[2];        /* variable length; 2 is the minimum entries */
 } Node;
 
+/* Node accessors.  They are also used by the persistent variant
+   of the trie (ptrie.h), whose node shares the bitmap layout. */
+#define KEY2INDEX(key, level) (((key)>>((level)*TRIE_SHIFT)) & TRIE_MASK)
+
+#define NODE_HAS_ARC(node, ind)     SCM_BITS_TEST_IN_WORD(node->emap, (ind))
+#define NODE_ARC_SET(node, ind)     SCM_BITS_SET_IN_WORD(node->emap, (ind))
+#define NODE_ARC_RESET(node, ind)   SCM_BITS_RESET_IN_WORD(node->emap, (ind))
+#define NODE_EMPTY_P(node)          (node->emap == NULL)
+#define NODE_NCHILDREN(node)        Scm__CountBitsInWord(node->emap)
+
+#define NODE_ARC_IS_LEAF(node, ind) SCM_BITS_TEST_IN_WORD(node->lmap, (ind))
+#define NODE_LEAF_SET(node, ind)    SCM_BITS_SET_IN_WORD(node->lmap, (ind))
+#define NODE_LEAF_RESET(node, ind)  SCM_BITS_RESET_IN_WORD(node->lmap, (ind))
+
+#define NODE_INDEX2OFF(node, ind)    Scm__CountBitsBelow(node->emap, (ind))
+
+#define NODE_ENTRY(node, off)        ((node)->entries[(off)])
+
+#if SIZEOF_LONG == 4
+#define KEY_MASK(key) /* empty */
+#else
+#define KEY_MASK(key) (key &= ((1UL<<32)-1))
+#endif
+
 /* We split key into two words; a well distributed keys are hard to
    distinguish from pointers by our conserative GC, and sometimes lead
    to poor GC performance when we have very large table.  */
@@ -0,0 +1,595 @@
+/*
+ * imap.c - Immutable maps and vectors
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "imap.h"
+
+/* A fresh token for a transient.  It is only used for its identity;
+   nodes stamped with it keep it alive, so the address is never reused
+   while those nodes exist. */
+static void *new_edit_token(void)
+{
+    return SCM_NEW_ATOMIC(char);
+}
+
+/*===================================================================
+ * Immutable map
+ */
+
+typedef struct MLeafRec {
+    Leaf   hdr;
+    ScmObj key;
+    ScmObj value;
+    ScmObj chain;               /* alist of other entries with the same
+                                   hash value */
+} MLeaf;
+
+static MLeaf *make_mleaf(u_long hv, ScmObj key, ScmObj value, ScmObj chain)
+{
+    MLeaf *z = SCM_NEW(MLeaf);
+    PTrieLeafSetKey(&z->hdr, hv);
+    z->key = key;
+    z->value = value;
+    z->chain = chain;
+    return z;
+}
+
+static u_long string_hash(ScmObj key)
+{
+    if (!SCM_STRINGP(key)) {
+        Scm_Error("immutable string map got non-string key: %S", key);
+    }
+    return Scm_HashString(SCM_STRING(key), 0);
+}
+
+static int string_cmp(ScmObj a, ScmObj b)
+{
+    if (!SCM_STRINGP(a)) {
+        Scm_Error("immutable string map got non-string key: %S", a);
+    }
+    if (!SCM_STRINGP(b)) {
+        Scm_Error("immutable string map got non-string key: %S", b);
+    }
+    return Scm_StringEqual(SCM_STRING(a), SCM_STRING(b));
+}
+
+static int map_compare(ScmObj x, ScmObj y, int equalp);
+
+SCM_DEFINE_BUILTIN_CLASS(Scm_ImmutableMapClass,
+                         NULL, map_compare, NULL, NULL,
+                         SCM_CLASS_DICTIONARY_CPL);
+SCM_DEFINE_BUILTIN_CLASS(Scm_TransientMapClass,
+                         NULL, NULL, NULL, NULL,
+                         SCM_CLASS_DICTIONARY_CPL);
+
+ScmObj MakeImmutableMap(ScmHashType type)
+{
+    ImmutableMap *m = SCM_NEW(ImmutableMap);
+    SCM_SET_CLASS(m, SCM_CLASS_IMMUTABLE_MAP);
+    m->root = NULL;
+    m->numEntries = 0;
+    m->type = type;
+    m->edit = NULL;
+
+    switch (type) {
+    case SCM_HASH_EQ:
+        m->hashfn = Scm_EqHash;
+        m->cmpfn = Scm_EqP;
+        break;
+    case SCM_HASH_EQV:
+        m->hashfn = Scm_EqvHash;
+        m->cmpfn = Scm_EqvP;
+        break;
+    case SCM_HASH_EQUAL:
+        m->hashfn = Scm_Hash;
+        m->cmpfn = Scm_EqualP;
+        break;
+    case SCM_HASH_STRING:
+        m->hashfn = string_hash;
+        m->cmpfn = string_cmp;
+        break;
+    default:
+        Scm_Error("invalid hash type (%d) for an immutable map", type);
+    }
+    return SCM_OBJ(m);
+}
+
+static ImmutableMap *map_clone(ImmutableMap *m, ScmClass *klass, void *edit)
+{
+    ImmutableMap *d = SCM_NEW(ImmutableMap);
+    memcpy(d, m, sizeof(ImmutableMap));
+    SCM_SET_CLASS(d, klass);
+    d->edit = edit;
+    return d;
+}
+
+/* Returns (key . value) in CHAIN, or #f */
+static ScmObj chain_find(ImmutableMap *m, ScmObj chain, ScmObj key)
+{
+    ScmObj cp;
+    SCM_FOR_EACH(cp, chain) {
+        if (m->cmpfn(key, SCM_CAAR(cp))) return SCM_CAR(cp);
+    }
+    return SCM_FALSE;
+}
+
+/* Returns a copy of CHAIN without the entry of KEY.  The chain may be
+   shared by other maps, so we never modify it. */
+static ScmObj chain_remove(ImmutableMap *m, ScmObj chain, ScmObj key)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL, cp;
+    SCM_FOR_EACH(cp, chain) {
+        if (m->cmpfn(key, SCM_CAAR(cp))) {
+            if (SCM_NULLP(h)) return SCM_CDR(cp);
+            SCM_SET_CDR(t, SCM_CDR(cp));
+            return h;
+        }
+        SCM_APPEND1(h, t, SCM_CAR(cp));
+    }
+    return chain;
+}
+
+ScmObj ImmutableMapRef(ImmutableMap *m, ScmObj key, ScmObj fallback)
+{
+    MLeaf *z = (MLeaf*)PTrieGet(m->root, m->hashfn(key));
+    if (z != NULL) {
+        if (m->cmpfn(key, z->key)) return z->value;
+        ScmObj p = chain_find(m, z->chain, key);
+        if (SCM_PAIRP(p)) return SCM_CDR(p);
+    }
+    return fallback;
+}
+
+/* Common body of put and delete.  They update M according to its edit
+   token; for the persistent operations, M is a fresh clone. */
+static void map_put(ImmutableMap *m, ScmObj key, ScmObj value)
+{
+    u_long hv = m->hashfn(key);
+    MLeaf *z = (MLeaf*)PTrieGet(m->root, hv);
+    MLeaf *n;
+
+    if (z == NULL) {
+        n = make_mleaf(hv, key, value, SCM_NIL);
+        m->numEntries++;
+    } else if (m->cmpfn(key, z->key)) {
+        if (SCM_EQ(value, z->value)) return;
+        n = make_mleaf(hv, z->key, value, z->chain);
+    } else {
+        ScmObj p = chain_find(m, z->chain, key);
+        if (SCM_FALSEP(p)) {
+            n = make_mleaf(hv, z->key, z->value,
+                           Scm_Acons(key, value, z->chain));
+            m->numEntries++;
+        } else {
+            if (SCM_EQ(value, SCM_CDR(p))) return;
+            n = make_mleaf(hv, z->key, z->value,
+                           Scm_Acons(SCM_CAR(p), value,
+                                     chain_remove(m, z->chain, key)));
+        }
+    }
+    m->root = PTrieAdd(m->root, (Leaf*)n, m->edit);
+}
+
+/* Returns the value of the deleted entry, or SCM_UNBOUND. */
+static ScmObj map_delete(ImmutableMap *m, ScmObj key)
+{
+    u_long hv = m->hashfn(key);
+    MLeaf *z = (MLeaf*)PTrieGet(m->root, hv);
+    ScmObj r;
+
+    if (z == NULL) return SCM_UNBOUND;
+    if (m->cmpfn(key, z->key)) {
+        r = z->value;
+        if (SCM_NULLP(z->chain)) {
+            Leaf *d = NULL;
+            m->root = PTrieDelete(m->root, hv, m->edit, &d);
+        } else {
+            ScmObj p = SCM_CAR(z->chain);
+            MLeaf *n = make_mleaf(hv, SCM_CAR(p), SCM_CDR(p),
+                                  SCM_CDR(z->chain));
+            m->root = PTrieAdd(m->root, (Leaf*)n, m->edit);
+        }
+    } else {
+        ScmObj p = chain_find(m, z->chain, key);
+        if (SCM_FALSEP(p)) return SCM_UNBOUND;
+        r = SCM_CDR(p);
+        MLeaf *n = make_mleaf(hv, z->key, z->value,
+                              chain_remove(m, z->chain, key));
+        m->root = PTrieAdd(m->root, (Leaf*)n, m->edit);
+    }
+    m->numEntries--;
+    return r;
+}
+
+ScmObj ImmutableMapPut(ImmutableMap *m, ScmObj key, ScmObj value)
+{
+    ImmutableMap *d = map_clone(m, SCM_CLASS_IMMUTABLE_MAP, NULL);
+    map_put(d, key, value);
+    if (d->root == m->root) return SCM_OBJ(m);
+    return SCM_OBJ(d);
+}
+
+ScmObj ImmutableMapDelete(ImmutableMap *m, ScmObj key)
+{
+    ImmutableMap *d = map_clone(m, SCM_CLASS_IMMUTABLE_MAP, NULL);
+    if (SCM_UNBOUNDP(map_delete(d, key))) return SCM_OBJ(m);
+    return SCM_OBJ(d);
+}
+
+/*
+ * Merge
+ */
+
+typedef struct map_merge_rec {
+    ImmutableMap *m;
+    ScmObj proc;                /* #f, or called with key, val-a, val-b */
+    u_long common;              /* number of keys in both maps */
+} map_merge;
+
+static Leaf *merge_leaves(Leaf *a, Leaf *b, void *data)
+{
+    map_merge *mm = (map_merge*)data;
+    MLeaf *x = (MLeaf*)a, *y = (MLeaf*)b;
+    int procp = !SCM_FALSEP(mm->proc);
+
+    if (x == y && !procp) {
+        mm->common += 1 + Scm_Length(x->chain);
+        return a;
+    }
+
+    /* Fresh alist of X's entries, to which we merge Y's. */
+    ScmObj es = Scm_Acons(x->key, x->value, SCM_NIL), cp;
+    SCM_FOR_EACH(cp, x->chain) {
+        es = Scm_Acons(SCM_CAAR(cp), SCM_CDAR(cp), es);
+    }
+    int nx = Scm_Length(es), nfound = 0;
+    ScmObj ys = Scm_Acons(y->key, y->value, y->chain);
+    SCM_FOR_EACH(cp, ys) {
+        ScmObj p = chain_find(mm->m, es, SCM_CAAR(cp));
+        if (SCM_FALSEP(p)) {
+            es = Scm_Cons(SCM_CAR(cp), es);
+        } else {
+            nfound++;
+            if (procp) {
+                SCM_SET_CDR(p, Scm_ApplyRec3(mm->proc, SCM_CAR(p),
+                                             SCM_CDR(p), SCM_CDAR(cp)));
+            } else {
+                SCM_SET_CDR(p, SCM_CDAR(cp));
+            }
+        }
+    }
+    mm->common += nfound;
+    /* If every entry of X is overridden by Y, Y can be used as is. */
+    if (!procp && nfound == nx) return b;
+    return (Leaf*)make_mleaf(LEAF_KEY(a), SCM_CAAR(es), SCM_CDAR(es),
+                             SCM_CDR(es));
+}
+
+ScmObj ImmutableMapMerge(ImmutableMap *a, ImmutableMap *b, ScmObj proc)
+{
+    if (a->type != b->type) {
+        Scm_Error("can't merge immutable maps of different types: %S and %S",
+                  SCM_OBJ(a), SCM_OBJ(b));
+    }
+    if (a->root == NULL) return SCM_OBJ(b);
+    if (b->root == NULL) return SCM_OBJ(a);
+
+    map_merge mm;
+    mm.m = a;
+    mm.proc = proc;
+    mm.common = 0;
+    PNode *root = PTrieMerge(a->root, b->root, merge_leaves, &mm);
+    if (root == b->root) return SCM_OBJ(b);
+    if (root == a->root) return SCM_OBJ(a);
+    ImmutableMap *d = map_clone(a, SCM_CLASS_IMMUTABLE_MAP, NULL);
+    d->root = root;
+    d->numEntries = a->numEntries + b->numEntries - mm.common;
+    return SCM_OBJ(d);
+}
+
+/*
+ * Equality
+ */
+
+static int map_leaf_equal(Leaf *a, Leaf *b, void *data)
+{
+    ImmutableMap *m = (ImmutableMap*)data;
+    MLeaf *x = (MLeaf*)a, *y = (MLeaf*)b;
+    if (Scm_Length(x->chain) != Scm_Length(y->chain)) return FALSE;
+
+    ScmObj ys = Scm_Acons(y->key, y->value, y->chain);
+    ScmObj p = chain_find(m, ys, x->key), cp;
+    if (SCM_FALSEP(p) || !Scm_EqualP(x->value, SCM_CDR(p))) return FALSE;
+    SCM_FOR_EACH(cp, x->chain) {
+        p = chain_find(m, ys, SCM_CAAR(cp));
+        if (SCM_FALSEP(p) || !Scm_EqualP(SCM_CDAR(cp), SCM_CDR(p))) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static int map_compare(ScmObj x, ScmObj y, int equalp)
+{
+    if (!equalp) {
+        Scm_Error("cannot compare immutable maps: %S and %S", x, y);
+    }
+    ImmutableMap *a = IMMUTABLE_MAP(x), *b = IMMUTABLE_MAP(y);
+    if (a->type != b->type || a->numEntries != b->numEntries) return -1;
+    return PTrieEqual(a->root, b->root, map_leaf_equal, a)? 0 : -1;
+}
+
+/*
+ * Transient map
+ */
+
+static void check_transient(ScmObj obj, void *edit)
+{
+    if (edit == NULL) {
+        Scm_Error("transient object is already made persistent: %S", obj);
+    }
+}
+
+ScmObj ImmutableMapTransient(ImmutableMap *m)
+{
+    return SCM_OBJ(map_clone(m, SCM_CLASS_TRANSIENT_MAP, new_edit_token()));
+}
+
+void TransientMapPut(ImmutableMap *t, ScmObj key, ScmObj value)
+{
+    check_transient(SCM_OBJ(t), t->edit);
+    map_put(t, key, value);
+}
+
+ScmObj TransientMapDelete(ImmutableMap *t, ScmObj key)
+{
+    check_transient(SCM_OBJ(t), t->edit);
+    return map_delete(t, key);
+}
+
+ScmObj TransientMapPersistent(ImmutableMap *t)
+{
+    check_transient(SCM_OBJ(t), t->edit);
+    ImmutableMap *m = map_clone(t, SCM_CLASS_IMMUTABLE_MAP, NULL);
+    t->edit = NULL;
+    return SCM_OBJ(m);
+}
+
+/*
+ * Iterator
+ */
+
+void ImmutableMapIterInit(ImmutableMapIter *it, ImmutableMap *m)
+{
+    PTrieIterInit(&it->ptit, m->root);
+    it->chain = SCM_NIL;
+    it->end = FALSE;
+}
+
+/* returns (key . value) or #f */
+ScmObj ImmutableMapIterNext(ImmutableMapIter *it)
+{
+    if (it->end) return SCM_FALSE;
+    if (SCM_PAIRP(it->chain)) {
+        ScmObj p = SCM_CAR(it->chain);
+        it->chain = SCM_CDR(it->chain);
+        return p;
+    }
+    MLeaf *z = (MLeaf*)PTrieIterNext(&it->ptit);
+    if (z == NULL) { it->end = TRUE; return SCM_FALSE; }
+    it->chain = z->chain;
+    return Scm_Cons(z->key, z->value);
+}
+
+/*===================================================================
+ * Immutable vector
+ */
+
+typedef struct VLeafRec {
+    Leaf   hdr;
+    ScmObj value;
+} VLeaf;
+
+static VLeaf *make_vleaf(u_long index, ScmObj value)
+{
+    VLeaf *z = SCM_NEW(VLeaf);
+    PTrieLeafSetKey(&z->hdr, index);
+    z->value = value;
+    return z;
+}
+
+static int vector_compare(ScmObj x, ScmObj y, int equalp);
+
+SCM_DEFINE_BUILTIN_CLASS(Scm_ImmutableVectorClass,
+                         NULL, vector_compare, NULL, NULL,
+                         SCM_CLASS_DEFAULT_CPL);
+SCM_DEFINE_BUILTIN_CLASS(Scm_TransientVectorClass,
+                         NULL, NULL, NULL, NULL,
+                         SCM_CLASS_DEFAULT_CPL);
+
+ScmObj MakeImmutableVector(void)
+{
+    ImmutableVector *v = SCM_NEW(ImmutableVector);
+    SCM_SET_CLASS(v, SCM_CLASS_IMMUTABLE_VECTOR);
+    v->root = NULL;
+    v->size = 0;
+    v->edit = NULL;
+    return SCM_OBJ(v);
+}
+
+static ImmutableVector *vector_clone(ImmutableVector *v, ScmClass *klass,
+                                     void *edit)
+{
+    ImmutableVector *d = SCM_NEW(ImmutableVector);
+    memcpy(d, v, sizeof(ImmutableVector));
+    SCM_SET_CLASS(d, klass);
+    d->edit = edit;
+    return d;
+}
+
+ScmObj ImmutableVectorRef(ImmutableVector *v, u_long index, ScmObj fallback)
+{
+    if (index >= v->size) return fallback;
+    VLeaf *z = (VLeaf*)PTrieGet(v->root, index);
+    SCM_ASSERT(z != NULL);
+    return z->value;
+}
+
+/* INDEX may be equal to the size, in which case VALUE is appended. */
+static void vector_set(ImmutableVector *v, u_long index, ScmObj value)
+{
+    if (index > v->size) {
+        Scm_Error("index out of range: %lu", index);
+    }
+    if (index == v->size) {
+        if (v->size == IMMUTABLE_VECTOR_MAX_SIZE) {
+            Scm_Error("immutable vector is full: %S", SCM_OBJ(v));
+        }
+        v->size++;
+    } else {
+        VLeaf *z = (VLeaf*)PTrieGet(v->root, index);
+        if (SCM_EQ(z->value, value)) return;
+    }
+    v->root = PTrieAdd(v->root, (Leaf*)make_vleaf(index, value), v->edit);
+}
+
+static ScmObj vector_pop(ImmutableVector *v)
+{
+    Leaf *d = NULL;
+    if (v->size == 0) {
+        Scm_Error("immutable vector is empty: %S", SCM_OBJ(v));
+    }
+    v->root = PTrieDelete(v->root, v->size-1, v->edit, &d);
+    v->size--;
+    SCM_ASSERT(d != NULL);
+    return ((VLeaf*)d)->value;
+}
+
+ScmObj ImmutableVectorSet(ImmutableVector *v, u_long index, ScmObj value)
+{
+    ImmutableVector *d = vector_clone(v, SCM_CLASS_IMMUTABLE_VECTOR, NULL);
+    vector_set(d, index, value);
+    if (d->root == v->root) return SCM_OBJ(v);
+    return SCM_OBJ(d);
+}
+
+ScmObj ImmutableVectorPush(ImmutableVector *v, ScmObj value)
+{
+    return ImmutableVectorSet(v, v->size, value);
+}
+
+ScmObj ImmutableVectorPop(ImmutableVector *v)
+{
+    ImmutableVector *d = vector_clone(v, SCM_CLASS_IMMUTABLE_VECTOR, NULL);
+    vector_pop(d);
+    return SCM_OBJ(d);
+}
+
+/* Returns elements in order.  Walking the indices is O(n log n), but
+   the trie is shallow; it is at most 3 levels for 32K elements. */
+ScmObj ImmutableVectorToList(ImmutableVector *v)
+{
+    ScmObj r = SCM_NIL;
+    for (u_long i = v->size; i > 0; i--) {
+        VLeaf *z = (VLeaf*)PTrieGet(v->root, i-1);
+        SCM_ASSERT(z != NULL);
+        r = Scm_Cons(z->value, r);
+    }
+    return r;
+}
+
+static int vector_leaf_equal(Leaf *a, Leaf *b, void *data)
+{
+    return Scm_EqualP(((VLeaf*)a)->value, ((VLeaf*)b)->value);
+}
+
+static int vector_compare(ScmObj x, ScmObj y, int equalp)
+{
+    if (!equalp) {
+        Scm_Error("cannot compare immutable vectors: %S and %S", x, y);
+    }
+    ImmutableVector *a = IMMUTABLE_VECTOR(x), *b = IMMUTABLE_VECTOR(y);
+    if (a->size != b->size) return -1;
+    return PTrieEqual(a->root, b->root, vector_leaf_equal, NULL)? 0 : -1;
+}
+
+/*
+ * Transient vector
+ */
+
+ScmObj ImmutableVectorTransient(ImmutableVector *v)
+{
+    return SCM_OBJ(vector_clone(v, SCM_CLASS_TRANSIENT_VECTOR,
+                                new_edit_token()));
+}
+
+void TransientVectorSet(ImmutableVector *t, u_long index, ScmObj value)
+{
+    check_transient(SCM_OBJ(t), t->edit);
+    vector_set(t, index, value);
+}
+
+void TransientVectorPush(ImmutableVector *t, ScmObj value)
+{
+    check_transient(SCM_OBJ(t), t->edit);
+    vector_set(t, t->size, value);
+}
+
+ScmObj TransientVectorPop(ImmutableVector *t)
+{
+    check_transient(SCM_OBJ(t), t->edit);
+    return vector_pop(t);
+}
+
+ScmObj TransientVectorPersistent(ImmutableVector *t)
+{
+    check_transient(SCM_OBJ(t), t->edit);
+    ImmutableVector *v = vector_clone(t, SCM_CLASS_IMMUTABLE_VECTOR, NULL);
+    t->edit = NULL;
+    return SCM_OBJ(v);
+}
+
+/*===================================================================
+ * Initialization
+ */
+
+void Scm_Init_imap(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_ImmutableMapClass, "<immutable-map>",
+                        mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_TransientMapClass, "<transient-map>",
+                        mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_ImmutableVectorClass, "<immutable-vector>",
+                        mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_TransientVectorClass, "<transient-vector>",
+                        mod, NULL, 0);
+}
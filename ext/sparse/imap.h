@@ -0,0 +1,138 @@
+/*
+ * imap.h - Immutable maps and vectors
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_IMAP_H
+#define GAUCHE_IMAP_H
+
+#include <gauche.h>
+#include <gauche/extend.h>
+
+#if defined(EXTSPARSE_EXPORTS)
+#define LIBGAUCHE_EXT_BODY
+#endif
+#include <gauche/extern.h>      /* redefine SCM_EXTERN */
+
+#include "ptrie.h"
+
+/* Immutable map is a hash map on top of PTrie; the hash value of a key
+ * is used as the key of the trie, and colliding entries are chained
+ * in a leaf, as in SparseTable.
+ *
+ * Transient map shares the same structure.  It is a mutable builder
+ * created from an immutable map, which updates the trie in place with
+ * its own edit token.  Calling TransientMapPersistent turns its content
+ * into an immutable map in O(1), and invalidates the transient map.
+ */
+
+typedef struct ImmutableMapRec {
+    SCM_HEADER;
+    PNode      *root;
+    u_long      numEntries;
+    ScmHashType type;
+    u_long      (*hashfn)(ScmObj key);
+    int         (*cmpfn)(ScmObj a, ScmObj b);
+    void       *edit;           /* transient map only.  NULL if invalidated */
+} ImmutableMap;
+
+SCM_CLASS_DECL(Scm_ImmutableMapClass);
+SCM_CLASS_DECL(Scm_TransientMapClass);
+#define SCM_CLASS_IMMUTABLE_MAP  (&Scm_ImmutableMapClass)
+#define SCM_CLASS_TRANSIENT_MAP  (&Scm_TransientMapClass)
+#define IMMUTABLE_MAP(obj)       ((ImmutableMap*)(obj))
+#define IMMUTABLE_MAP_P(obj)     SCM_XTYPEP(obj, SCM_CLASS_IMMUTABLE_MAP)
+#define TRANSIENT_MAP_P(obj)     SCM_XTYPEP(obj, SCM_CLASS_TRANSIENT_MAP)
+
+extern ScmObj MakeImmutableMap(ScmHashType type);
+extern ScmObj ImmutableMapRef(ImmutableMap *m, ScmObj key, ScmObj fallback);
+extern ScmObj ImmutableMapPut(ImmutableMap *m, ScmObj key, ScmObj value);
+extern ScmObj ImmutableMapDelete(ImmutableMap *m, ScmObj key);
+extern ScmObj ImmutableMapMerge(ImmutableMap *a, ImmutableMap *b,
+                                ScmObj proc);
+extern ScmObj ImmutableMapTransient(ImmutableMap *m);
+
+extern void   TransientMapPut(ImmutableMap *t, ScmObj key, ScmObj value);
+extern ScmObj TransientMapDelete(ImmutableMap *t, ScmObj key);
+extern ScmObj TransientMapPersistent(ImmutableMap *t);
+
+/* Iterator */
+typedef struct ImmutableMapIterRec {
+    PTrieIter ptit;
+    ScmObj chain;
+    int end;
+} ImmutableMapIter;
+
+extern void   ImmutableMapIterInit(ImmutableMapIter *it, ImmutableMap *m);
+extern ScmObj ImmutableMapIterNext(ImmutableMapIter *it);
+
+/* Immutable vector is indexed by integers from 0 to size-1, which are
+ * directly used as the keys of the trie.  Like the map, it has
+ * a transient counterpart.
+ */
+
+typedef struct ImmutableVectorRec {
+    SCM_HEADER;
+    PNode      *root;
+    u_long      size;
+    void       *edit;           /* transient vector only */
+} ImmutableVector;
+
+SCM_CLASS_DECL(Scm_ImmutableVectorClass);
+SCM_CLASS_DECL(Scm_TransientVectorClass);
+#define SCM_CLASS_IMMUTABLE_VECTOR  (&Scm_ImmutableVectorClass)
+#define SCM_CLASS_TRANSIENT_VECTOR  (&Scm_TransientVectorClass)
+#define IMMUTABLE_VECTOR(obj)       ((ImmutableVector*)(obj))
+#define IMMUTABLE_VECTOR_P(obj)     SCM_XTYPEP(obj, SCM_CLASS_IMMUTABLE_VECTOR)
+#define TRANSIENT_VECTOR_P(obj)     SCM_XTYPEP(obj, SCM_CLASS_TRANSIENT_VECTOR)
+
+/* The maximum number of elements */
+#define IMMUTABLE_VECTOR_MAX_SIZE   0xffffffffUL
+
+extern ScmObj MakeImmutableVector(void);
+extern ScmObj ImmutableVectorRef(ImmutableVector *v, u_long index,
+                                 ScmObj fallback);
+extern ScmObj ImmutableVectorSet(ImmutableVector *v, u_long index,
+                                 ScmObj value);
+extern ScmObj ImmutableVectorPush(ImmutableVector *v, ScmObj value);
+extern ScmObj ImmutableVectorPop(ImmutableVector *v);
+extern ScmObj ImmutableVectorTransient(ImmutableVector *v);
+extern ScmObj ImmutableVectorToList(ImmutableVector *v);
+
+extern void   TransientVectorSet(ImmutableVector *t, u_long index,
+                                 ScmObj value);
+extern void   TransientVectorPush(ImmutableVector *t, ScmObj value);
+extern ScmObj TransientVectorPop(ImmutableVector *t);
+extern ScmObj TransientVectorPersistent(ImmutableVector *t);
+
+extern void   Scm_Init_imap(ScmModule *mod);
+
+#endif /*GAUCHE_IMAP_H*/
@@ -0,0 +1,306 @@
+;;;
+;;; util.immutable - persistent maps and vectors
+;;;
+;;;   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; Immutable maps and vectors, implemented as persistent compact tries
+;; (see ptrie.h).  Updates return a new object sharing most of the structure
+;; with the original.  Transient maps and vectors are mutable builders
+;; that perform a batch of updates without copying.
+
+(define-module util.immutable
+  (use gauche.dictionary)
+  (export <immutable-map> <transient-map>
+          make-immutable-map alist->immutable-map immutable-map?
+          immutable-map-size immutable-map-ref immutable-map-exists?
+          immutable-map-put immutable-map-delete immutable-map-update
+          immutable-map-merge immutable-map-fold immutable-map-for-each
+          immutable-map-map immutable-map-keys immutable-map-values
+          immutable-map->alist
+          immutable-map-transient transient-map-size transient-map-ref
+          transient-map-exists? transient-map-put! transient-map-delete!
+          transient-map-update! transient-map-persistent!
+
+          <immutable-vector> <transient-vector>
+          make-immutable-vector immutable-vector list->immutable-vector
+          vector->immutable-vector immutable-vector?
+          immutable-vector-length immutable-vector-ref immutable-vector-set
+          immutable-vector-push immutable-vector-pop
+          immutable-vector->list immutable-vector->vector
+          immutable-vector-fold immutable-vector-for-each
+          immutable-vector-map
+          immutable-vector-transient transient-vector-length
+          transient-vector-ref transient-vector-set! transient-vector-push!
+          transient-vector-pop! transient-vector-persistent!
+          ))
+(select-module util.immutable)
+
+(inline-stub
+ "#include \"imap.h\""
+
+ (initcode "Scm_Init_imap(Scm_CurrentModule());")
+
+ (define-type <immutable-map> "ImmutableMap*" "immutable map"
+   "IMMUTABLE_MAP_P" "IMMUTABLE_MAP")
+ (define-type <transient-map> "ImmutableMap*" "transient map"
+   "TRANSIENT_MAP_P" "IMMUTABLE_MAP")
+ (define-type <immutable-vector> "ImmutableVector*" "immutable vector"
+   "IMMUTABLE_VECTOR_P" "IMMUTABLE_VECTOR")
+ (define-type <transient-vector> "ImmutableVector*" "transient vector"
+   "TRANSIENT_VECTOR_P" "IMMUTABLE_VECTOR")
+ )
+
+;;===============================================================
+;; Immutable maps
+;;
+
+(inline-stub
+ (define-cproc make-immutable-map (:optional (type 'eq?))
+   (let* ([t::ScmHashType SCM_HASH_EQ])
+     (cond
+      [(SCM_EQ type 'eq?)      (set! t SCM_HASH_EQ)]
+      [(SCM_EQ type 'eqv?)     (set! t SCM_HASH_EQV)]
+      [(SCM_EQ type 'equal?)   (set! t SCM_HASH_EQUAL)]
+      [(SCM_EQ type 'string=?) (set! t SCM_HASH_STRING)]
+      [else (Scm_Error "unsupported immutable-map hash type: %S" type)])
+     (result (MakeImmutableMap t))))
+
+ (define-cproc immutable-map? (obj) ::<boolean> IMMUTABLE_MAP_P)
+
+ (define-cproc immutable-map-size (m::<immutable-map>) ::<ulong>
+   (result (-> m numEntries)))
+
+ (define-cproc immutable-map-ref (m::<immutable-map> key :optional fallback)
+   (let* ([r (ImmutableMapRef m key fallback)])
+     (when (SCM_UNBOUNDP r)
+       (Scm_Error "%S doesn't have an entry for key %S" (SCM_OBJ m) key))
+     (result r)))
+
+ (define-cproc immutable-map-exists? (m::<immutable-map> key) ::<boolean>
+   (result (not (SCM_UNBOUNDP (ImmutableMapRef m key SCM_UNBOUND)))))
+
+ (define-cproc immutable-map-put (m::<immutable-map> key value)
+   ImmutableMapPut)
+
+ (define-cproc immutable-map-delete (m::<immutable-map> key)
+   ImmutableMapDelete)
+
+ (define-cproc immutable-map-merge (a::<immutable-map> b::<immutable-map>
+                                    :optional (proc #f))
+   ImmutableMapMerge)
+
+ (define-cproc immutable-map-transient (m::<immutable-map>)
+   ImmutableMapTransient)
+
+ (define-cproc transient-map-size (t::<transient-map>) ::<ulong>
+   (result (-> t numEntries)))
+
+ (define-cproc transient-map-ref (t::<transient-map> key :optional fallback)
+   (setter transient-map-put!)
+   (let* ([r (ImmutableMapRef t key fallback)])
+     (when (SCM_UNBOUNDP r)
+       (Scm_Error "%S doesn't have an entry for key %S" (SCM_OBJ t) key))
+     (result r)))
+
+ (define-cproc transient-map-exists? (t::<transient-map> key) ::<boolean>
+   (result (not (SCM_UNBOUNDP (ImmutableMapRef t key SCM_UNBOUND)))))
+
+ (define-cproc transient-map-put! (t::<transient-map> key value) ::<void>
+   TransientMapPut)
+
+ (define-cproc transient-map-delete! (t::<transient-map> key) ::<boolean>
+   (result (not (SCM_UNBOUNDP (TransientMapDelete t key)))))
+
+ (define-cproc transient-map-persistent! (t::<transient-map>)
+   TransientMapPersistent)
+
+ (define-cfn immutable-map-iter (args::ScmObj* nargs::int data::void*) :static
+   (let* ([iter::ImmutableMapIter* (cast ImmutableMapIter* data)]
+          [r (ImmutableMapIterNext iter)]
+          [eofval (aref args 0)])
+     (if (SCM_FALSEP r)
+       (return (values eofval eofval))
+       (return (values (SCM_CAR r) (SCM_CDR r))))))
+
+ ;; M may be an immutable map or a transient map.
+ (define-cproc %immutable-map-iter (m)
+   (unless (or (IMMUTABLE_MAP_P m) (TRANSIENT_MAP_P m))
+     (SCM_TYPE_ERROR m "immutable or transient map"))
+   (let* ([iter::ImmutableMapIter* (SCM_NEW ImmutableMapIter)])
+     (ImmutableMapIterInit iter (IMMUTABLE_MAP m))
+     (result (Scm_MakeSubr immutable-map-iter iter 1 0
+                           '"immutable-map-iterator"))))
+ )
+
+(define (alist->immutable-map alist :optional (type 'eq?))
+  (let1 t (immutable-map-transient (make-immutable-map type))
+    (dolist [p alist] (transient-map-put! t (car p) (cdr p)))
+    (transient-map-persistent! t)))
+
+(define (immutable-map-update m key proc . fallback)
+  (immutable-map-put m key (proc (apply immutable-map-ref m key fallback))))
+
+(define (transient-map-update! t key proc . fallback)
+  (rlet1 v (proc (apply transient-map-ref t key fallback))
+    (transient-map-put! t key v)))
+
+(define (immutable-map-fold m proc seed)
+  (let ([iter (%immutable-map-iter m)]
+        [end  (list #f)])
+    (let loop ([seed seed])
+      (receive (key val) (iter end)
+        (if (eq? key end)
+          seed
+          (loop (proc key val seed)))))))
+
+(define (immutable-map-map m proc)
+  (immutable-map-fold m (^[k v s] (cons (proc k v) s)) '()))
+(define (immutable-map-for-each m proc)
+  (immutable-map-fold m (^[k v _] (proc k v)) #f))
+(define (immutable-map-keys m)
+  (immutable-map-fold m (^[k v s] (cons k s)) '()))
+(define (immutable-map-values m)
+  (immutable-map-fold m (^[k v s] (cons v s)) '()))
+(define (immutable-map->alist m)
+  (immutable-map-fold m acons '()))
+
+;;===============================================================
+;; Immutable vectors
+;;
+
+(inline-stub
+ (define-cproc %make-immutable-vector () MakeImmutableVector)
+
+ (define-cproc immutable-vector? (obj) ::<boolean> IMMUTABLE_VECTOR_P)
+
+ (define-cproc immutable-vector-length (v::<immutable-vector>) ::<ulong>
+   (result (-> v size)))
+
+ (define-cproc immutable-vector-ref (v::<immutable-vector> index::<ulong>
+                                     :optional fallback)
+   (let* ([r (ImmutableVectorRef v index fallback)])
+     (when (SCM_UNBOUNDP r)
+       (Scm_Error "index out of range: %lu" index))
+     (result r)))
+
+ (define-cproc immutable-vector-set (v::<immutable-vector> index::<ulong>
+                                     value)
+   ImmutableVectorSet)
+
+ (define-cproc immutable-vector-push (v::<immutable-vector> value)
+   ImmutableVectorPush)
+
+ (define-cproc immutable-vector-pop (v::<immutable-vector>)
+   ImmutableVectorPop)
+
+ (define-cproc immutable-vector->list (v::<immutable-vector>)
+   ImmutableVectorToList)
+
+ (define-cproc immutable-vector-transient (v::<immutable-vector>)
+   ImmutableVectorTransient)
+
+ (define-cproc transient-vector-length (t::<transient-vector>) ::<ulong>
+   (result (-> t size)))
+
+ (define-cproc transient-vector-ref (t::<transient-vector> index::<ulong>
+                                     :optional fallback)
+   (setter transient-vector-set!)
+   (let* ([r (ImmutableVectorRef t index fallback)])
+     (when (SCM_UNBOUNDP r)
+       (Scm_Error "index out of range: %lu" index))
+     (result r)))
+
+ (define-cproc transient-vector-set! (t::<transient-vector> index::<ulong>
+                                      value) ::<void>
+   TransientVectorSet)
+
+ (define-cproc transient-vector-push! (t::<transient-vector> value) ::<void>
+   TransientVectorPush)
+
+ (define-cproc transient-vector-pop! (t::<transient-vector>)
+   TransientVectorPop)
+
+ (define-cproc transient-vector-persistent! (t::<transient-vector>)
+   TransientVectorPersistent)
+ )
+
+(define (list->immutable-vector lis)
+  (let1 t (immutable-vector-transient (%make-immutable-vector))
+    (dolist [x lis] (transient-vector-push! t x))
+    (transient-vector-persistent! t)))
+
+(define (immutable-vector . elts) (list->immutable-vector elts))
+
+(define (vector->immutable-vector vec)
+  (let1 t (immutable-vector-transient (%make-immutable-vector))
+    (vector-for-each (cut transient-vector-push! t <>) vec)
+    (transient-vector-persistent! t)))
+
+(define (make-immutable-vector :optional (size 0) (fill (undefined)))
+  (let1 t (immutable-vector-transient (%make-immutable-vector))
+    (dotimes [i size] (transient-vector-push! t fill))
+    (transient-vector-persistent! t)))
+
+(define (immutable-vector->vector v)
+  (list->vector (immutable-vector->list v)))
+
+(define (immutable-vector-fold v proc seed)
+  (fold proc seed (immutable-vector->list v)))
+(define (immutable-vector-for-each v proc)
+  (for-each proc (immutable-vector->list v)))
+(define (immutable-vector-map v proc)
+  (list->immutable-vector (map proc (immutable-vector->list v))))
+
+;;===============================================================
+;; dictionary protocol
+;;
+
+(define-dict-interface <immutable-map>
+  :get       immutable-map-ref
+  :exists?   immutable-map-exists?
+  :fold      immutable-map-fold
+  :for-each  immutable-map-for-each
+  :map       immutable-map-map
+  :keys      immutable-map-keys
+  :values    immutable-map-values)
+
+(define-dict-interface <transient-map>
+  :get       transient-map-ref
+  :put!      transient-map-put!
+  :delete!   transient-map-delete!
+  :exists?   transient-map-exists?
+  :fold      immutable-map-fold
+  :for-each  immutable-map-for-each
+  :map       immutable-map-map
+  :keys      immutable-map-keys
+  :values    immutable-map-values
+  :update!   transient-map-update!)
@@ -0,0 +1,419 @@
+/*
+ * ptrie.c - Persistent Compact Trie
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ptrie.h"
+
+/*
+ * Nodes
+ */
+
+/* Node allocation is rounded up to even entries, as CompactTrie does.
+   A node that belongs to the current batch can be extended in place
+   if it has a room, that is, if it has odd number of entries. */
+#define NODE_SIZE_INCR 2
+
+#define NODE_EDITABLE(node, edit)  ((edit) != NULL && (node)->edit == (edit))
+
+static PNode *pnode_alloc(int nentry, void *edit)
+{
+    int nalloc = (nentry+NODE_SIZE_INCR-1)&(~(NODE_SIZE_INCR-1));
+    if (nalloc < 2) nalloc = 2;
+    /* SCM_NEW2 returns zero cleared chunk. */
+    PNode *n = SCM_NEW2(PNode*, sizeof(PNode) + sizeof(void*)*(nalloc-2));
+    n->edit = edit;
+    return n;
+}
+
+/* Returns a node that is safe to modify under EDIT. */
+static PNode *pnode_editable(PNode *n, void *edit)
+{
+    if (NODE_EDITABLE(n, edit)) return n;
+    int size = NODE_NCHILDREN(n);
+    PNode *m = pnode_alloc(size, edit);
+    m->emap = n->emap;
+    m->lmap = n->lmap;
+    memcpy(m->entries, n->entries, size*sizeof(void*));
+    return m;
+}
+
+/* Add a new arc IND to N. */
+static PNode *pnode_insert(PNode *n, u_long ind, void *entry, int leafp,
+                           void *edit)
+{
+    int size = NODE_NCHILDREN(n);
+    int pt = NODE_INDEX2OFF(n, ind);
+    PNode *m;
+
+    if (NODE_EDITABLE(n, edit) && (size&(NODE_SIZE_INCR-1))) {
+        m = n;
+        memmove(m->entries+pt+1, m->entries+pt, (size-pt)*sizeof(void*));
+    } else {
+        m = pnode_alloc(size+1, edit);
+        m->emap = n->emap;
+        m->lmap = n->lmap;
+        memcpy(m->entries, n->entries, pt*sizeof(void*));
+        memcpy(m->entries+pt+1, n->entries+pt, (size-pt)*sizeof(void*));
+    }
+    NODE_ARC_SET(m, ind);
+    if (leafp) NODE_LEAF_SET(m, ind);
+    NODE_ENTRY(m, pt) = entry;
+    return m;
+}
+
+/* Replace the entry of existing arc IND of N. */
+static PNode *pnode_replace(PNode *n, u_long ind, void *entry, int leafp,
+                            void *edit)
+{
+    PNode *m = pnode_editable(n, edit);
+    NODE_ENTRY(m, NODE_INDEX2OFF(m, ind)) = entry;
+    if (leafp) NODE_LEAF_SET(m, ind);
+    else       NODE_LEAF_RESET(m, ind);
+    return m;
+}
+
+/* Remove the arc IND from N. */
+static PNode *pnode_remove(PNode *n, u_long ind, void *edit)
+{
+    int size = NODE_NCHILDREN(n);
+    int pt = NODE_INDEX2OFF(n, ind);
+    PNode *m;
+
+    if (NODE_EDITABLE(n, edit)) {
+        m = n;
+        memmove(m->entries+pt, m->entries+pt+1, (size-pt-1)*sizeof(void*));
+        m->entries[size-1] = NULL;
+    } else {
+        m = pnode_alloc(size-1, edit);
+        m->emap = n->emap;
+        m->lmap = n->lmap;
+        memcpy(m->entries, n->entries, pt*sizeof(void*));
+        memcpy(m->entries+pt, n->entries+pt+1, (size-pt-1)*sizeof(void*));
+    }
+    NODE_ARC_RESET(m, ind);
+    NODE_LEAF_RESET(m, ind);
+    return m;
+}
+
+/* Create a subtrie at LEVEL that contains two leaves with different keys. */
+static PNode *make_pair(Leaf *a, Leaf *b, int level, void *edit)
+{
+    u_long ia = KEY2INDEX(LEAF_KEY(a), level);
+    u_long ib = KEY2INDEX(LEAF_KEY(b), level);
+    PNode *m = pnode_alloc(2, edit);
+
+    if (ia == ib) {
+        NODE_ARC_SET(m, ia);
+        NODE_ENTRY(m, 0) = make_pair(a, b, level+1, edit);
+    } else {
+        NODE_ARC_SET(m, ia);
+        NODE_ARC_SET(m, ib);
+        NODE_LEAF_SET(m, ia);
+        NODE_LEAF_SET(m, ib);
+        NODE_ENTRY(m, 0) = (ia < ib)? a : b;
+        NODE_ENTRY(m, 1) = (ia < ib)? b : a;
+    }
+    return m;
+}
+
+/*
+ * Search
+ */
+Leaf *PTrieGet(PNode *n, u_long key)
+{
+    KEY_MASK(key);
+    for (int level = 0; n != NULL; level++) {
+        u_long ind = KEY2INDEX(key, level);
+        if (!NODE_HAS_ARC(n, ind)) return NULL;
+        void *e = NODE_ENTRY(n, NODE_INDEX2OFF(n, ind));
+        if (NODE_ARC_IS_LEAF(n, ind)) {
+            if (LEAF_KEY((Leaf*)e) == key) return (Leaf*)e;
+            else return NULL;
+        }
+        n = (PNode*)e;
+    }
+    return NULL;
+}
+
+/*
+ * Add or replace
+ */
+static PNode *add_rec(PNode *n, Leaf *leaf, u_long key, int level,
+                      void *edit)
+{
+    u_long ind = KEY2INDEX(key, level);
+
+    if (!NODE_HAS_ARC(n, ind)) {
+        return pnode_insert(n, ind, leaf, TRUE, edit);
+    }
+    void *e = NODE_ENTRY(n, NODE_INDEX2OFF(n, ind));
+    if (NODE_ARC_IS_LEAF(n, ind)) {
+        Leaf *l0 = (Leaf*)e;
+        if (l0 == leaf) return n;
+        if (LEAF_KEY(l0) == key) return pnode_replace(n, ind, leaf, TRUE, edit);
+        return pnode_replace(n, ind, make_pair(l0, leaf, level+1, edit),
+                             FALSE, edit);
+    } else {
+        PNode *c = add_rec((PNode*)e, leaf, key, level+1, edit);
+        if (c == (PNode*)e) return n;
+        return pnode_replace(n, ind, c, FALSE, edit);
+    }
+}
+
+/* Returns a trie that has LEAF in addition to the leaves in ROOT.
+   If ROOT has a leaf with the same key, it is replaced. */
+PNode *PTrieAdd(PNode *root, Leaf *leaf, void *edit)
+{
+    if (root == NULL) root = pnode_alloc(1, edit);
+    return add_rec(root, leaf, LEAF_KEY(leaf), 0, edit);
+}
+
+/*
+ * Delete
+ */
+
+/* Returns N itself if nothing is changed (or N is modified in place),
+   a new node, or NULL if N is the root and it becomes empty.  If the
+   deletion leaves a non-root node with only one leaf, the leaf is
+   returned and *PULLED is set, so that the parent replaces the node
+   with the leaf; it keeps the shape canonical.  */
+static void *del_rec(PNode *n, u_long key, int level, void *edit,
+                     Leaf **deleted, int *pulled)
+{
+    u_long ind = KEY2INDEX(key, level);
+
+    if (!NODE_HAS_ARC(n, ind)) return n;
+    void *e = NODE_ENTRY(n, NODE_INDEX2OFF(n, ind));
+    int size = NODE_NCHILDREN(n);
+
+    if (NODE_ARC_IS_LEAF(n, ind)) {
+        if (LEAF_KEY((Leaf*)e) != key) return n;
+        *deleted = (Leaf*)e;
+        if (size == 1) {
+            /* this only happens when N is root. */
+            SCM_ASSERT(level == 0);
+            return NULL;
+        }
+        if (size == 2 && level > 0) {
+            u_long rest = n->emap & ~(1UL<<ind);
+            if (n->lmap & rest) {
+                *pulled = TRUE;
+                return NODE_ENTRY(n, (NODE_INDEX2OFF(n, ind) == 0)? 1 : 0);
+            }
+        }
+        return pnode_remove(n, ind, edit);
+    } else {
+        int cpulled = FALSE;
+        void *c = del_rec((PNode*)e, key, level+1, edit, deleted, &cpulled);
+        if (c == e) return n;
+        if (cpulled && size == 1 && level > 0) {
+            *pulled = TRUE;
+            return c;
+        }
+        return pnode_replace(n, ind, c, cpulled, edit);
+    }
+}
+
+/* Returns a trie without the leaf of KEY.  If such a leaf exists,
+   it is stored in *DELETED; otherwise, *DELETED is untouched. */
+PNode *PTrieDelete(PNode *root, u_long key, void *edit, Leaf **deleted)
+{
+    int pulled = FALSE;
+    KEY_MASK(key);
+    if (root == NULL) return NULL;
+    return (PNode*)del_rec(root, key, 0, edit, deleted, &pulled);
+}
+
+/*
+ * Merge
+ */
+
+/* Merges two entries of the same index, each of which may be a node
+   at LEVEL or a leaf.  Whenever the result is the same as either one
+   of the inputs, the input is returned as is, so that the parts
+   shared by both tries aren't copied. */
+static void *merge_rec(void *a, int aleaf, void *b, int bleaf, int level,
+                       Leaf *(*merger)(Leaf*, Leaf*, void*), void *data,
+                       int *rleaf)
+{
+    if (aleaf && bleaf) {
+        Leaf *la = (Leaf*)a, *lb = (Leaf*)b;
+        if (LEAF_KEY(la) == LEAF_KEY(lb)) {
+            *rleaf = TRUE;
+            return merger(la, lb, data);
+        }
+        *rleaf = FALSE;
+        return make_pair(la, lb, level, NULL);
+    }
+
+    /* At least one of them is a node.  Treat a leaf as a node with
+       one arc; the result is always a canonical node, since the other
+       one has more than one arc or a single child node. */
+    PNode tmp;
+    PNode *na, *nb;
+    if (aleaf) {
+        u_long ind = KEY2INDEX(LEAF_KEY((Leaf*)a), level);
+        tmp.emap = tmp.lmap = (1UL<<ind);
+        tmp.entries[0] = a;
+        na = &tmp;
+    } else {
+        na = (PNode*)a;
+    }
+    if (bleaf) {
+        u_long ind = KEY2INDEX(LEAF_KEY((Leaf*)b), level);
+        tmp.emap = tmp.lmap = (1UL<<ind);
+        tmp.entries[0] = b;
+        nb = &tmp;
+    } else {
+        nb = (PNode*)b;
+    }
+
+    u_long emap = na->emap | nb->emap;
+    u_long lmap = 0;
+    void  *entries[MAX_NODE_SIZE];
+    int    sameA = (na->emap == emap), sameB = (nb->emap == emap);
+    int    off = 0, offa = 0, offb = 0;
+
+    for (int i=0; i<MAX_NODE_SIZE; i++) {
+        int ina = NODE_HAS_ARC(na, i), inb = NODE_HAS_ARC(nb, i);
+        if (ina && inb) {
+            void *ea = NODE_ENTRY(na, offa), *eb = NODE_ENTRY(nb, offb);
+            int  la = NODE_ARC_IS_LEAF(na, i), lb = NODE_ARC_IS_LEAF(nb, i);
+            int  r = FALSE;
+            void *e = merge_rec(ea, la, eb, lb, level+1, merger, data, &r);
+            if (e != ea || r != la) sameA = FALSE;
+            if (e != eb || r != lb) sameB = FALSE;
+            if (r) lmap |= (1UL<<i);
+            entries[off++] = e;
+            offa++; offb++;
+        } else if (ina) {
+            if (NODE_ARC_IS_LEAF(na, i)) lmap |= (1UL<<i);
+            entries[off++] = NODE_ENTRY(na, offa++);
+        } else if (inb) {
+            if (NODE_ARC_IS_LEAF(nb, i)) lmap |= (1UL<<i);
+            entries[off++] = NODE_ENTRY(nb, offb++);
+        }
+    }
+
+    *rleaf = FALSE;
+    if (sameB && !bleaf) return nb;
+    if (sameA && !aleaf) return na;
+    PNode *m = pnode_alloc(off, NULL);
+    m->emap = emap;
+    m->lmap = lmap;
+    memcpy(m->entries, entries, off*sizeof(void*));
+    return m;
+}
+
+/* Returns a trie that contains leaves of both A and B.  For the leaves
+   with the same key, MERGER is called with the leaf from A and the one
+   from B, and its result is used.  MERGER may be called with the same
+   leaf if A and B share it. */
+PNode *PTrieMerge(PNode *a, PNode *b,
+                  Leaf *(*merger)(Leaf*, Leaf*, void*),
+                  void *data)
+{
+    int r;
+    if (a == NULL) return b;
+    if (b == NULL) return a;
+    return (PNode*)merge_rec(a, FALSE, b, FALSE, 0, merger, data, &r);
+}
+
+/*
+ * Equality
+ */
+
+/* Since the shape is canonical, tries with the same set of keys have
+   the same bitmaps at every node.  LEAFEQ is called for every pair of
+   distinct leaves with the same key. */
+static int equal_rec(PNode *a, PNode *b,
+                     int (*leafeq)(Leaf*, Leaf*, void*), void *data)
+{
+    if (a == b) return TRUE;
+    if (a->emap != b->emap || a->lmap != b->lmap) return FALSE;
+    int size = NODE_NCHILDREN(a);
+    for (int i=0, off=0; i<MAX_NODE_SIZE && off<size; i++) {
+        if (!NODE_HAS_ARC(a, i)) continue;
+        void *ea = NODE_ENTRY(a, off), *eb = NODE_ENTRY(b, off);
+        off++;
+        if (ea == eb) continue;
+        if (NODE_ARC_IS_LEAF(a, i)) {
+            if (LEAF_KEY((Leaf*)ea) != LEAF_KEY((Leaf*)eb)) return FALSE;
+            if (!leafeq((Leaf*)ea, (Leaf*)eb, data)) return FALSE;
+        } else {
+            if (!equal_rec((PNode*)ea, (PNode*)eb, leafeq, data)) return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+int PTrieEqual(PNode *a, PNode *b,
+               int (*leafeq)(Leaf*, Leaf*, void*), void *data)
+{
+    if (a == NULL || b == NULL) return (a == b);
+    return equal_rec(a, b, leafeq, data);
+}
+
+/*
+ * Iterator
+ */
+void PTrieIterInit(PTrieIter *it, PNode *root)
+{
+    if (root == NULL) {
+        it->depth = -1;
+    } else {
+        it->depth = 0;
+        it->nodes[0] = root;
+        it->index[0] = 0;
+    }
+}
+
+Leaf *PTrieIterNext(PTrieIter *it)
+{
+    while (it->depth >= 0) {
+        PNode *n = it->nodes[it->depth];
+        int i = it->index[it->depth];
+        while (i < MAX_NODE_SIZE && !NODE_HAS_ARC(n, i)) i++;
+        if (i == MAX_NODE_SIZE) {
+            it->depth--;
+            continue;
+        }
+        it->index[it->depth] = i+1;
+        void *e = NODE_ENTRY(n, NODE_INDEX2OFF(n, i));
+        if (NODE_ARC_IS_LEAF(n, i)) return (Leaf*)e;
+        it->depth++;
+        SCM_ASSERT(it->depth < PTRIE_MAX_DEPTH);
+        it->nodes[it->depth] = (PNode*)e;
+        it->index[it->depth] = 0;
+    }
+    return NULL;
+}
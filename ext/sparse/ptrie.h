@@ -0,0 +1,102 @@
+/*
+ * ptrie.h - Persistent Compact Trie
+ *
+ *   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_PTRIE_H
+#define GAUCHE_PTRIE_H
+
+#include "ctrie.h"
+
+/* PTrie is a persistent (immutable) variant of CompactTrie.  It uses
+ * the same 32-way bitmap-compressed nodes and the same Leaf header,
+ * but operations never modify existing nodes; instead, they copy the
+ * path from the root to the modified leaf and return a new root,
+ * sharing the rest of the structure with the original trie.
+ *
+ * A trie is represented by its root node; NULL is an empty trie.
+ * Leaves are also treated as immutable; to change the content of a
+ * leaf, the application creates a new one and adds it, which replaces
+ * the leaf with the same key.
+ *
+ * For batch updates, a caller can pass an EDIT token, an arbitrary
+ * unique pointer.  Nodes created during operations with a token
+ * remember it, and subsequent operations with the same token modify
+ * those nodes in place, instead of copying them again.  Once the
+ * batch is done, the caller just discards the token; nodes stamped
+ * with it are never modified again, since no one passes the token.
+ * Passing NULL as the token gives pure persistent operations.
+ *
+ * The shape of the trie is canonical: every leaf is placed at the
+ * shallowest level where its key prefix is unique, regardless of the
+ * order of insertions and deletions.  So two tries with the same set
+ * of keys have the same shape, which allows PTrieEqual and PTrieMerge
+ * to walk two tries in parallel and to skip shared subtrees.
+ */
+
+typedef struct PNodeRec {
+    u_long   emap;              /* bitmap: 1 = has child */
+    u_long   lmap;              /* bitmap: 1 = child is leaf */
+    void    *edit;              /* token of the batch that owns this node */
+    void    *entries[2];        /* variable length; 2 is the minimum entries */
+} PNode;
+
+/* The deepest level of the trie for 32bit keys */
+#define PTRIE_MAX_DEPTH  ((32+TRIE_SHIFT-1)/TRIE_SHIFT)
+
+static inline void PTrieLeafSetKey(Leaf *l, u_long key)
+{
+    l->key0 = key & 0xffff;
+    l->key1 = (key>>16) & 0xffff;
+}
+
+extern Leaf  *PTrieGet(PNode *root, u_long key);
+extern PNode *PTrieAdd(PNode *root, Leaf *leaf, void *edit);
+extern PNode *PTrieDelete(PNode *root, u_long key, void *edit,
+                          Leaf **deleted);
+extern PNode *PTrieMerge(PNode *a, PNode *b,
+                         Leaf *(*merger)(Leaf*, Leaf*, void*),
+                         void *data);
+extern int    PTrieEqual(PNode *a, PNode *b,
+                         int (*leafeq)(Leaf*, Leaf*, void*),
+                         void *data);
+
+/* Iterator.  The order of leaves is unspecified. */
+typedef struct PTrieIterRec {
+    PNode *nodes[PTRIE_MAX_DEPTH];
+    int    index[PTRIE_MAX_DEPTH];
+    int    depth;               /* -1 when exhausted */
+} PTrieIter;
+
+extern void  PTrieIterInit(PTrieIter *it, PNode *root);
+extern Leaf *PTrieIterNext(PTrieIter *it);
+
+#endif /*GAUCHE_PTRIE_H*/
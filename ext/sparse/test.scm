@@ -227,4 +227,122 @@
            (begin (sparse-table-delete! u '(1 . 0)) (vals u)))
     ))
 
+;;---------------------------------------------------------------
+(test-section "util.immutable")
+(use util.immutable)
+(test-module 'util.immutable)
+
+(let* ([m0 (make-immutable-map 'eqv?)]
+       [m1 (immutable-map-put m0 1 'a)]
+       [m2 (immutable-map-put m1 2 'b)]
+       [m3 (immutable-map-delete m2 1)])
+  (test* "immutable-map basic" '(0 1 2 1)
+         (map immutable-map-size (list m0 m1 m2 m3)))
+  (test* "immutable-map ref" '(a b #f b)
+         (list (immutable-map-ref m2 1) (immutable-map-ref m2 2)
+               (immutable-map-ref m3 1 #f) (immutable-map-ref m3 2)))
+  (test* "immutable-map ref nokey" (test-error) (immutable-map-ref m0 1))
+  (test* "immutable-map persistence" '(#f a)
+         (list (immutable-map-exists? m0 1) (immutable-map-ref m1 1)))
+  (test* "immutable-map no-op update" #t
+         (and (eq? m2 (immutable-map-put m2 1 'a))
+              (eq? m2 (immutable-map-delete m2 3))))
+  (test* "immutable-map-update" '(a (z . a))
+         (let1 m (immutable-map-update m2 1 (cut cons 'z <>))
+           (list (immutable-map-ref m2 1) (immutable-map-ref m 1))))
+  (test* "immutable-map equal?" '(#t #f)
+         (list (equal? m3 (immutable-map-put m0 2 'b))
+               (equal? m2 m3)))
+  (test* "immutable-map dict" '((1 . a) (2 . b))
+         (sort (dict->alist m2) (^[a b] (< (car a) (car b))))))
+
+(let ([ks (hash-table-keys *data-set*)]
+      [t (immutable-map-transient (make-immutable-map 'eqv?))])
+  (test* "transient-map many put!" *data-set-size*
+         (begin (hash-table-for-each *data-set* (cut transient-map-put! t <> <>))
+                (transient-map-size t)))
+  (let1 m (transient-map-persistent! t)
+    (test* "transient-map persistent!" #t
+           (every (^k (= (immutable-map-ref m k) (* k k))) ks))
+    (test* "transient-map after persistent!" (test-error)
+           (transient-map-put! t 0 0))
+    (let1 m2 (fold (^[k m] (immutable-map-delete m k)) m (take ks 100))
+      (test* "immutable-map many delete" (- *data-set-size* 100)
+             (immutable-map-size m2))
+      (test* "immutable-map sharing" *data-set-size*
+             (immutable-map-size m))
+      (test* "immutable-map equal? rebuild" #t
+             (equal? m (alist->immutable-map (hash-table->alist *data-set*)
+                                             'eqv?)))
+      (test* "immutable-map-merge" `(,*data-set-size* #t)
+             (let1 mm (immutable-map-merge m2 m)
+               (list (immutable-map-size mm) (equal? mm m))))
+      (test* "immutable-map-merge with proc" (- *data-set-size* 100)
+             (let1 mm (immutable-map-merge m m2 (^[k a b] (- a b)))
+               (count zero? (immutable-map-values mm)))))))
+
+(let ([m (alist->immutable-map '(("a" . 1) ("b" . 2)) 'string=?)]
+      [n (alist->immutable-map '(("b" . 20) ("c" . 30)) 'string=?)])
+  (test* "immutable-map-merge string=?" '(("a" . 1) ("b" . 22) ("c" . 30))
+         (sort (immutable-map->alist
+                (immutable-map-merge m n (^[k a b] (+ a b))))
+               (^[a b] (string<? (car a) (car b)))))
+  (test* "immutable-map-merge type mismatch" (test-error)
+         (immutable-map-merge m (make-immutable-map 'eq?))))
+
+;; keys with the same hash value (see sparse-table tests above)
+(let* ([keys '((0 . 5) (1 . 0) #(0 5) #(1 0))]
+       [m (alist->immutable-map (map cons keys '(a b c d)) 'equal?)])
+  (define (vals m) (map (cut immutable-map-ref m <> #f) keys))
+  (test* "immutable-map key conflicts" '(a b c d) (vals m))
+  (test* "immutable-map key conflicts delete" '((#f b #f d) (a b c d))
+         (let1 m2 (immutable-map-delete (immutable-map-delete m '#(0 5))
+                                        '(0 . 5))
+           (list (vals m2) (vals m))))
+  (test* "immutable-map key conflicts equal?" #t
+         (equal? m (alist->immutable-map (reverse (map cons keys '(a b c d)))
+                                         'equal?))))
+
+(let* ([v0 (immutable-vector 'a 'b 'c)]
+       [v1 (immutable-vector-set v0 1 'x)]
+       [v2 (immutable-vector-push v1 'd)]
+       [v3 (immutable-vector-pop v0)])
+  (test* "immutable-vector" '((a b c) (a x c) (a x c d) (a b))
+         (map immutable-vector->list (list v0 v1 v2 v3)))
+  (test* "immutable-vector-ref" '(c #f)
+         (list (immutable-vector-ref v0 2) (immutable-vector-ref v3 2 #f)))
+  (test* "immutable-vector-ref out of range" (test-error)
+         (immutable-vector-ref v0 3))
+  (test* "immutable-vector-set out of range" (test-error)
+         (immutable-vector-set v0 4 'z))
+  (test* "immutable-vector-pop empty" (test-error)
+         (immutable-vector-pop (immutable-vector)))
+  (test* "immutable-vector equal?" '(#t #f)
+         (list (equal? v3 (immutable-vector 'a 'b)) (equal? v0 v1)))
+  (test* "immutable-vector-map" '#((a) (x) (c) (d))
+         (immutable-vector->vector (immutable-vector-map v2 list))))
+
+(let* ([n 40000]
+       [v (list->immutable-vector (iota n))])
+  (test* "immutable-vector large" `(,n 0 ,(- n 1) ,(/ (* n (- n 1)) 2))
+         (list (immutable-vector-length v)
+               (immutable-vector-ref v 0)
+               (immutable-vector-ref v (- n 1))
+               (immutable-vector-fold v + 0)))
+  (test* "transient-vector" `(,(- n 2) -1 ,(- n 1))
+         (let1 t (immutable-vector-transient v)
+           (transient-vector-set! t 5 -1)
+           (transient-vector-pop! t)
+           (transient-vector-pop! t)
+           (let1 w (transient-vector-persistent! t)
+             (list (immutable-vector-length w)
+                   (immutable-vector-ref w 5)
+                   (immutable-vector-ref v (- n 1))))))
+  (test* "immutable-vector pop all" 0
+         (immutable-vector-length
+          (let loop ([v v])
+            (if (zero? (immutable-vector-length v))
+              v
+              (loop (immutable-vector-pop v)))))))
+
 (test-end)
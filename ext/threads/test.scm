@@ -58,6 +58,27 @@
     (thread-join! (ref threads (- n 1)))))
 (test* "thread-join!" 1346269 (mt-fib 31))
 
+;; The VM stack grows as needed, so deep recursion works in a thread
+;; with a small initial stack.
+(let ()
+  (define (deep n) (if (= n 0) '() (cons n (deep (- n 1)))))
+  (define (run thunk)
+    (thread-join! (thread-start! (make-thread thunk #f 1024))))
+  (test* "make-thread with stack-size" 100000
+         (run (^[] (length (deep 100000)))))
+  ;; reenter a continuation captured over several stack segments
+  (test* "make-thread with stack-size (call/cc)" '(3 50000)
+         (run (^[] (let* ([k #f]
+                          [n 0]
+                          [r (let loop ([i 50000])
+                               (if (= i 0)
+                                 (call/cc (^c (set! k c) 0))
+                                 (+ 1 (loop (- i 1)))))])
+                     (inc! n)
+                     (if (< n 3) (k 0) (list n r))))))
+  (test* "make-thread with bad stack-size" (test-error)
+         (make-thread (^[] #f) #f -1)))
+
 (let ()
   (define (thread-sleep-test x)
     (test* (format "thread-sleep! ~s" x) #t
@@ -529,6 +550,33 @@
            (for-each thread-join! ts)
            count)))
 
+;;---------------------------------------------------------------------
+(test-section "concurrent interning")
+
+;; Many threads intern overlapping sets of fresh names (enough to make
+;; the symbol table grow); they must agree on the identity of symbols.
+(let* ([n 20000]
+       [names (list->vector
+               (map (^i (format "concurrent-intern-test-~d" i)) (iota n)))]
+       [name-of (^[k i] (vector-ref names (modulo (* i (+ k 1)) n)))]
+       [ts (map (^k (make-thread
+                     (^[] (map (^i (string->symbol (name-of k i))) (iota n)))))
+                (iota 8))])
+  (for-each thread-start! ts)
+  (let1 rs (map thread-join! ts)
+    (test* "symbols interned concurrently" #t
+           (every (^[k r]
+                    (every (^[i s] (eq? s (string->symbol (name-of k i))))
+                           (iota n) r))
+                  (iota 8) rs)))
+  (test* "keywords interned concurrently" #t
+         (let1 ks (map (^_ (make-thread
+                            (^[] (map make-keyword (vector->list names)))))
+                       (iota 4))
+           (for-each thread-start! ks)
+           (let1 kss (map thread-join! ks)
+             (every (cut every eq? (car kss) <>) (cdr kss))))))
+
 ;;---------------------------------------------------------------------
 (test-section "threads and lazy sequences")
 
@@ -650,5 +698,73 @@
            (let1 r (list (dequeue/wait! qq) (dequeue/wait! qq))
              (list* r0 r1 r)))))
 
-(test-end)
+;;---------------------------------------------------------------------
+(test-section "asynchronous logging")
+
+(use gauche.logger)
+
+(define (async-log-test-file)
+  (when (file-exists? "test.o") (sys-unlink "test.o"))
+  "test.o")
+
+(test* "async drain" (map number->string (iota 500))
+       (let1 drain (make <log-drain> :path (async-log-test-file)
+                         :prefix "" :async #t :batch-size 16)
+         (dotimes [i 500] (log-format drain "~a" i))
+         (log-drain-flush drain)
+         (begin0 (call-with-input-file "test.o" port->string-list)
+                 (log-drain-close drain))))
+
+(test* "async drain, multiple writers" (iota 400)
+       (let* ([drain (make <log-drain> :path (async-log-test-file)
+                           :prefix "" :async #t :queue-size 8)]
+              [ts (map (^k (thread-start!
+                            (make-thread
+                             (^[] (dotimes [i 100]
+                                    (log-format drain "~a" (+ (* k 100) i)))))))
+                       (iota 4))])
+         (for-each thread-join! ts)
+         (log-drain-close drain)
+         (sort (map string->number
+                    (call-with-input-file "test.o" port->string-list)))))
+
+(test* "async drain, write error" 10
+       (let1 drain (make <log-drain> :path "no/such/directory/test.o"
+                         :async #t :overflow 'drop)
+         (dotimes [i 10] (log-format drain "~a" i))
+         (log-drain-close drain)
+         (slot-ref drain 'dropped-count)))
+
+(test* "async drain, after close" '("a" "b")
+       (let1 drain (make <log-drain> :path (async-log-test-file)
+                         :prefix "" :async #t)
+         (log-format drain "a")
+         (log-drain-close drain)
+         (log-format drain "b")
+         (call-with-input-file "test.o" port->string-list)))
+
+(test* "async drain, close while logging" (iota 400)
+       (let* ([drain (make <log-drain> :path (async-log-test-file)
+                           :prefix "" :async #t :queue-size 4)]
+              [ts (map (^k (thread-start!
+                            (make-thread
+                             (^[] (dotimes [i 100]
+                                    (log-format drain "~a" (+ (* k 100) i)))))))
+                       (iota 4))])
+         (log-drain-close drain)
+         (for-each thread-join! ts)
+         (sort (map string->number
+                    (call-with-input-file "test.o" port->string-list)))))
+
+(test* "async drain, close twice" '("a")
+       (let1 drain (make <log-drain> :path (async-log-test-file)
+                         :prefix "" :async #t)
+         (log-format drain "a")
+         (log-drain-close drain)
+         (log-drain-close drain)
+         (log-drain-flush drain)
+         (call-with-input-file "test.o" port->string-list)))
 
+(when (file-exists? "test.o") (sys-unlink "test.o"))
+
+(test-end)
@@ -61,15 +61,26 @@ static SCM_DEFINE_STRING_CONST(thread_error_handler_NAME, "thread-error-handler"
 static SCM_DEFINE_SUBR(thread_error_handler_STUB, 1, 0, SCM_OBJ(&thread_error_handler_NAME), thread_error_handler, NULL, NULL);
 
 /* Creation.  In the "NEW" state, a VM is allocated but actual thread
-   is not created. */
+   is not created.  STACKSIZE is the size of the initial VM stack segment
+   in words; 0 for the default. */
 ScmObj Scm_MakeThread(ScmProcedure *thunk, ScmObj name)
+{
+    return Scm_MakeThreadWithStackSize(thunk, name, 0);
+}
+
+ScmObj Scm_MakeThreadWithStackSize(ScmProcedure *thunk, ScmObj name,
+                                   long stackSize)
 {
     ScmVM *current = Scm_VM();
 
     if (SCM_PROCEDURE_REQUIRED(thunk) != 0) {
         Scm_Error("thunk required, but got %S", thunk);
     }
-    ScmVM *vm = Scm_NewVM(current, name);
+    if (stackSize < 0) {
+        Scm_Error("stack size must be a nonnegative integer, but got %ld",
+                  stackSize);
+    }
+    ScmVM *vm = Scm_NewVMWithStackSize(current, name, stackSize);
     vm->thunk = thunk;
     vm->defaultEscapeHandler = SCM_OBJ(&thread_error_handler_STUB);
     return SCM_OBJ(vm);
@@ -44,6 +44,8 @@
  */
 
 extern ScmObj Scm_MakeThread(ScmProcedure *thunk, ScmObj name);
+extern ScmObj Scm_MakeThreadWithStackSize(ScmProcedure *thunk, ScmObj name,
+                                          long stackSize);
 extern ScmObj Scm_ThreadStart(ScmVM *vm);
 extern ScmObj Scm_ThreadJoin(ScmVM *vm, ScmObj timeout, ScmObj timeoutval);
 extern ScmObj Scm_ThreadStop(ScmVM *vm, ScmObj timeout, ScmObj timeoutval);
@@ -109,8 +109,9 @@
      [else (Scm_Error "[internal] thread state has invalid value: %d"
                       (-> vm state))]))
 
- (define-cproc make-thread (thunk::<procedure> :optional (name #f))
-   Scm_MakeThread)
+ (define-cproc make-thread (thunk::<procedure> :optional (name #f)
+                                             (stack-size::<fixnum> 0))
+   Scm_MakeThreadWithStackSize)
 
  (define-cproc thread-start! (vm::<thread>) Scm_ThreadStart)
 
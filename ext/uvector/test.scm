@@ -746,6 +746,35 @@
 (flonum-arith-test-generate f32)
 (flonum-arith-test-generate f64)
 
+;; long vectors are processed in chunks; make sure an overflow in
+;; a later chunk is handled as well as in the first one.
+(let ([v0 (make-u8vector 1000 100)]
+      [v1 (make-u8vector 1000 100)])
+  (u8vector-set! v1 700 200)
+  (test* "u8vector-add (long, overflow)" (test-error)
+         (u8vector-add v0 v1))
+  (test* "u8vector-add (long, clamp)" '(200 255 200)
+         (let1 r (u8vector-add v0 v1 'both)
+           (map (cut u8vector-ref r <>) '(0 700 999))))
+  (test* "u8vector-add! (long, clamp)" '(200 255 200)
+         (begin (u8vector-add! v1 v0 'both)
+                (map (cut u8vector-ref v1 <>) '(0 700 999))))
+  (test* "u8vector-mul (long, const)" '(#t 200)
+         (let1 r (u8vector-mul v0 2)
+           (list (every (cut = <> 200) (u8vector->list r))
+                 (u8vector-ref r 999))))
+  (test* "u8vector-sub (long, const, underflow)" '(0 0)
+         (let1 r (u8vector-sub v0 101 'low)
+           (list (u8vector-ref r 0) (u8vector-ref r 999)))))
+(let ([v0 (list->s32vector (iota 1000 -500))])
+  (test* "s32vector-mul (long)" (map (^x (* x x)) (iota 1000 -500))
+         (s32vector->list (s32vector-mul v0 v0)))
+  (test* "s32vector-mul (long, overflow)" (test-error)
+         (s32vector-mul v0 #x1000000)))
+(let ([v0 (list->f64vector (map inexact (iota 1000)))])
+  (test* "f64vector-div (long)" (map (^x (/ x 4.0)) (iota 1000))
+         (f64vector->list (f64vector-div v0 4.0))))
+
 ;;-------------------------------------------------------------------
 (test-section "bitwise operations")
 
@@ -817,6 +846,10 @@
                    #x55aa55aa5a5a5a5a
                    #x9696696988778877)
 
+(test* "u8vector-and (list)" '#u8(1 0 3) (u8vector-and '#u8(1 2 3) '(1 1 7)))
+(test* "s16vector-xor (vector)" '#s16(0 3 -1)
+       (s16vector-xor '#s16(1 2 -3) '#(1 1 2)))
+
 ;;-------------------------------------------------------------------
 (test-section "dot product")
 
@@ -991,6 +1024,25 @@
 (dotprod-test-generate f64 #f64(32767 -32767 32767 -32767 32767)
                        #f64(32767 -32767 32767 -32767 32767))
 
+;; longer vectors
+(define (long-dotprod-test tag l0 l1 list-> dot)
+  (test* (format #f "~svector-dot (long)" tag)
+         (fold (^[e0 e1 sum] (+ sum (* e0 e1))) 0 l0 l1)
+         (dot (list-> l0) (list-> l1))))
+
+(let1 l (map (^i (if (odd? i) #x-80000000 #x7fffffff)) (iota 1000))
+  (long-dotprod-test 's32 l l list->s32vector s32vector-dot)
+  (long-dotprod-test 's32 l (reverse l) list->s32vector s32vector-dot))
+(let1 l (map (^i (- #xffffffff i)) (iota 1000))
+  (long-dotprod-test 'u32 l l list->u32vector u32vector-dot))
+(let1 l (map (^i (- #x7fff (* i 13))) (iota 1000))
+  (long-dotprod-test 's16 l (reverse l) list->s16vector s16vector-dot))
+(let1 l (map (^i (* i 0.25)) (iota 1001))
+  (long-dotprod-test 'f64 l l list->f64vector f64vector-dot))
+;; flonum products are added sequentially
+(test* "f64vector-dot (order)" 1.0
+       (f64vector-dot '#f64(1e16 1.0 -1e16 1.0) '#f64(1.0 1.0 1.0 1.0)))
+
 ;;-------------------------------------------------------------------
 (test-section "range-check")
 
@@ -1295,6 +1347,252 @@
 (clamp-test-generate u64 #u64(127 0 4 200 255)
                      #u64(3 3 3 3 3) #u64(199 199 199 199 199))
 
+;;-------------------------------------------------------------------
+(test-section "sorting and searching")
+
+;; N samples scattered over [MIN, MAX], including repeated values.
+(define (uvtest-nums min max n)
+  (map (^i (+ min (modulo (* i 7919) (+ (- max min) 1)))) (iota n)))
+
+(define (uvsort-test tag list-> ->list sort sort! bsearch partition! nth! nums)
+  (let* ([exp (sort nums)]
+         [n (length nums)]
+         [src (list-> nums)])
+    (test* #"~|tag|vector-sort (~n)" exp (->list (sort src)))
+    (test* #"~|tag|vector-sort (~n) - source intact" nums (->list src))
+    (test* #"~|tag|vector-sort! (~n)" exp (->list (sort! (list-> nums))))
+    (test* #"~|tag|vector-sort! (~n) - range"
+           (append (take nums 1) (sort (drop-right (cdr nums) 1))
+                   (last-pair nums))
+           (->list (sort! (list-> nums) 1 (- n 1))))
+    (test* #"~|tag|vector-binary-search (~n)"
+           (map (^x (list-index (cut = <> x) exp)) exp)
+           (let1 v (list-> exp)
+             (map (cut bsearch v <>) exp)))
+    (test* #"~|tag|vector-binary-search (~n) - missing" '(#f #f)
+           (let1 v (list-> exp)
+             (list (bsearch v (+ (last exp) 1)) (bsearch v 1000000))))
+    (let1 pivot (list-ref exp (quotient n 2))
+      (test* #"~|tag|vector-partition! (~n)"
+             (list (count (cut < <> pivot) nums) #t #t)
+             (let* ([v (list-> nums)]
+                    [k (partition! v pivot)]
+                    [l (->list v)])
+               (list k
+                     (every (cut < <> pivot) (take l k))
+                     (every (cut >= <> pivot) (drop l k))))))
+    (test* #"~|tag|vector-nth-element! (~n)" exp
+           (map (^k (nth! (list-> nums) k)) (iota n)))
+    ))
+
+;; 20 elements go through insertion sort and introsort, 300 elements
+;; through radix sort for integers and f16.
+(dolist [n '(20 300)]
+  (uvsort-test 's8 list->s8vector s8vector->list
+               s8vector-sort s8vector-sort! s8vector-binary-search
+               s8vector-partition! s8vector-nth-element!
+               (uvtest-nums -128 127 n))
+  (uvsort-test 'u8 list->u8vector u8vector->list
+               u8vector-sort u8vector-sort! u8vector-binary-search
+               u8vector-partition! u8vector-nth-element!
+               (uvtest-nums 0 255 n))
+  (uvsort-test 's16 list->s16vector s16vector->list
+               s16vector-sort s16vector-sort! s16vector-binary-search
+               s16vector-partition! s16vector-nth-element!
+               (uvtest-nums -32768 32767 n))
+  (uvsort-test 'u16 list->u16vector u16vector->list
+               u16vector-sort u16vector-sort! u16vector-binary-search
+               u16vector-partition! u16vector-nth-element!
+               (uvtest-nums 0 65535 n))
+  (uvsort-test 's32 list->s32vector s32vector->list
+               s32vector-sort s32vector-sort! s32vector-binary-search
+               s32vector-partition! s32vector-nth-element!
+               (uvtest-nums #x-80000000 #x7fffffff n))
+  (uvsort-test 'u32 list->u32vector u32vector->list
+               u32vector-sort u32vector-sort! u32vector-binary-search
+               u32vector-partition! u32vector-nth-element!
+               (uvtest-nums 0 #xffffffff n))
+  (uvsort-test 's64 list->s64vector s64vector->list
+               s64vector-sort s64vector-sort! s64vector-binary-search
+               s64vector-partition! s64vector-nth-element!
+               (uvtest-nums #x-8000000000000000 #x7fffffffffffffff n))
+  (uvsort-test 'u64 list->u64vector u64vector->list
+               u64vector-sort u64vector-sort! u64vector-binary-search
+               u64vector-partition! u64vector-nth-element!
+               (uvtest-nums 0 #xffffffffffffffff n))
+  (uvsort-test 'f16 list->f16vector f16vector->list
+               f16vector-sort f16vector-sort! f16vector-binary-search
+               f16vector-partition! f16vector-nth-element!
+               (map inexact (uvtest-nums -1000 1000 n)))
+  (uvsort-test 'f32 list->f32vector f32vector->list
+               f32vector-sort f32vector-sort! f32vector-binary-search
+               f32vector-partition! f32vector-nth-element!
+               (map inexact (uvtest-nums -100000 100000 n)))
+  (uvsort-test 'f64 list->f64vector f64vector->list
+               f64vector-sort f64vector-sort! f64vector-binary-search
+               f64vector-partition! f64vector-nth-element!
+               (map inexact (uvtest-nums -100000 100000 n))))
+
+;; NaNs go after all the other numbers.  NUMS has a NaN at index 0 and
+;; every fifth index after it.
+(define (uvsort-nan-test tag list-> ->list sort! partition! nth! nums)
+  (let* ([exp (sort (remove nan? nums))]
+         [n (length nums)]
+         [k (length exp)])
+    (test* #"~|tag|vector-sort! (NaN, ~n)" (list exp (- n k))
+           (let1 l (->list (sort! (list-> nums)))
+             (list (take l k) (count nan? (drop l k)))))
+    (test* #"~|tag|vector-sort! (NaN, ~n) - range" (list #t exp)
+           (let1 l (->list (sort! (list-> nums) 1))
+             (list (nan? (car l)) (take (cdr l) k))))
+    (test* #"~|tag|vector-partition! (NaN, ~n)"
+           (list (count (cut < <> 0) exp) #t)
+           (let* ([v (list-> nums)]
+                  [i (partition! v 0)])
+             (list i (every (^x (not (< x 0))) (drop (->list v) i)))))
+    (test* #"~|tag|vector-nth-element! (NaN, ~n)" exp
+           (map (^i (nth! (list-> nums) i)) (iota k)))
+    (test* #"~|tag|vector-nth-element! (NaN, ~n) - last" #t
+           (nan? (nth! (list-> nums) (- n 1))))
+    ))
+
+(define (nan-samples min max n)
+  (map (^[i x] (if (zero? (modulo i 5)) +nan.0 x))
+       (iota n) (map inexact (uvtest-nums min max n))))
+
+(dolist [n '(21 301)]
+  (uvsort-nan-test 'f16 list->f16vector f16vector->list f16vector-sort!
+                   f16vector-partition! f16vector-nth-element!
+                   (nan-samples -1000 1000 n))
+  (uvsort-nan-test 'f32 list->f32vector f32vector->list f32vector-sort!
+                   f32vector-partition! f32vector-nth-element!
+                   (nan-samples -100000 100000 n))
+  (uvsort-nan-test 'f64 list->f64vector f64vector->list f64vector-sort!
+                   f64vector-partition! f64vector-nth-element!
+                   (nan-samples -100000 100000 n)))
+
+(test* "f64vector-sort (NaN)" '(-1.0 0.5 2.0 #t #t)
+       (let1 l (f64vector->list
+                (f64vector-sort '#f64(2.0 +nan.0 -1.0 +nan.0 0.5)))
+         (append (take l 3) (map nan? (drop l 3)))))
+(test* "f32vector-sort (NaN)" '(-1.0 0.5 2.0 #t #t)
+       (let1 l (f32vector->list
+                (f32vector-sort '#f32(+nan.0 2.0 -1.0 +nan.0 0.5)))
+         (append (take l 3) (map nan? (drop l 3)))))
+(test* "f16vector-sort (NaN)" '(-1.0 0.5 2.0 #t)
+       (let1 l (f16vector->list (f16vector-sort '#f16(+nan.0 2.0 -1.0 0.5)))
+         (append (take l 3) (map nan? (drop l 3)))))
+(test* "f64vector-sort (all NaN)" '(#t #t #t)
+       (map nan? (f64vector->list
+                  (f64vector-sort '#f64(+nan.0 +nan.0 +nan.0)))))
+(test* "u8vector-partition! (out of range)" '(0 3)
+       (list (u8vector-partition! (u8vector 3 1 2) -1)
+             (u8vector-partition! (u8vector 3 1 2) 256)))
+(test* "u8vector-nth-element! (out of range)" (test-error)
+       (u8vector-nth-element! (u8vector 3 1 2) 3))
+;;-------------------------------------------------------------------
+(test-section "reductions")
+
+(define (uvreduce-test tag list-> vsum vmin vmax vmean nums)
+  (let ([v (list-> nums)]
+        [n (length nums)])
+    (test* #"~|tag|vector-sum (~n)" (apply + nums) (vsum v))
+    (test* #"~|tag|vector-min (~n)" (apply min nums) (vmin v))
+    (test* #"~|tag|vector-max (~n)" (apply max nums) (vmax v))
+    (test* #"~|tag|vector-mean (~n)" (/ (apply + nums) n) (vmean v))
+    (test* #"~|tag|vector-sum (~n) - range" (apply + (take (cdr nums) 3))
+           (vsum v 1 4))
+    (test* #"~|tag|vector-min (~n) - range" (apply min (drop nums 2))
+           (vmin v 2))
+    (test* #"~|tag|vector-max (~n) - range" (apply max (take nums 5))
+           (vmax v 0 5))
+    ))
+
+(dolist [n '(7 1001)]
+  (uvreduce-test 's8 list->s8vector s8vector-sum s8vector-min
+                 s8vector-max s8vector-mean (uvtest-nums -128 127 n))
+  (uvreduce-test 'u8 list->u8vector u8vector-sum u8vector-min
+                 u8vector-max u8vector-mean (uvtest-nums 0 255 n))
+  (uvreduce-test 's16 list->s16vector s16vector-sum s16vector-min
+                 s16vector-max s16vector-mean (uvtest-nums -32768 32767 n))
+  (uvreduce-test 'u16 list->u16vector u16vector-sum u16vector-min
+                 u16vector-max u16vector-mean (uvtest-nums 0 65535 n))
+  (uvreduce-test 's32 list->s32vector s32vector-sum s32vector-min
+                 s32vector-max s32vector-mean
+                 (uvtest-nums #x-80000000 #x7fffffff n))
+  (uvreduce-test 'u32 list->u32vector u32vector-sum u32vector-min
+                 u32vector-max u32vector-mean
+                 (uvtest-nums 0 #xffffffff n))
+  (uvreduce-test 's64 list->s64vector s64vector-sum s64vector-min
+                 s64vector-max s64vector-mean
+                 (uvtest-nums #x-8000000000000000 #x7fffffffffffffff n))
+  (uvreduce-test 'u64 list->u64vector u64vector-sum u64vector-min
+                 u64vector-max u64vector-mean
+                 (uvtest-nums 0 #xffffffffffffffff n))
+  (uvreduce-test 'f16 list->f16vector f16vector-sum f16vector-min
+                 f16vector-max f16vector-mean
+                 (map inexact (uvtest-nums -1000 1000 n)))
+  (uvreduce-test 'f32 list->f32vector f32vector-sum f32vector-min
+                 f32vector-max f32vector-mean
+                 (map inexact (uvtest-nums -100000 100000 n)))
+  (uvreduce-test 'f64 list->f64vector f64vector-sum f64vector-min
+                 f64vector-max f64vector-mean
+                 (map inexact (uvtest-nums -100000 100000 n))))
+
+;; Flonum sums are taken four elements at a time; lengths 1 to 9 cover
+;; every length of the remainder loop.  The extreme element is placed
+;; last so that min and max have to look at it.
+(define (uvreduce-tail-test tag list-> vsum vmin vmax)
+  (dolist [n (iota 9 1)]
+    (let ([up (list-> (iota n 1))]
+          [down (list-> (reverse (iota n 1)))])
+      (test* #"~|tag|vector-sum (length ~n)" (* n (+ n 1) 1/2)
+             (exact (vsum up)))
+      (test* #"~|tag|vector-sum (length ~n) - range" (* (- n 1) (+ n 2) 1/2)
+             (exact (vsum up 1)))
+      (test* #"~|tag|vector-min (length ~n)" 1 (exact (vmin down)))
+      (test* #"~|tag|vector-max (length ~n)" n (exact (vmax up))))))
+
+(uvreduce-tail-test 'u8 list->u8vector u8vector-sum u8vector-min u8vector-max)
+(uvreduce-tail-test 's64 list->s64vector s64vector-sum s64vector-min
+                    s64vector-max)
+(uvreduce-tail-test 'f16 (^l (list->f16vector (map inexact l)))
+                    f16vector-sum f16vector-min f16vector-max)
+(uvreduce-tail-test 'f32 (^l (list->f32vector (map inexact l)))
+                    f32vector-sum f32vector-min f32vector-max)
+(uvreduce-tail-test 'f64 (^l (list->f64vector (map inexact l)))
+                    f64vector-sum f64vector-min f64vector-max)
+
+;; 64bit sums spill into bignums and come back.
+(test* "s64vector-sum (overflow)" (* 3 (- (expt 2 63) 1))
+       (s64vector-sum (make-s64vector 3 (- (expt 2 63) 1))))
+(test* "s64vector-sum (negative overflow)" (* 5 (- (expt 2 63)))
+       (s64vector-sum (make-s64vector 5 (- (expt 2 63)))))
+(test* "s64vector-sum (overflow and back)" -2
+       (s64vector-sum (s64vector #x7fffffffffffffff #x7fffffffffffffff
+                                 #x-8000000000000000 #x-8000000000000000)))
+(test* "u64vector-sum (overflow)" (* 7 (- (expt 2 64) 1))
+       (u64vector-sum (make-u64vector 7 (- (expt 2 64) 1))))
+(test* "u64vector-mean (overflow)" (- (expt 2 64) 1)
+       (u64vector-mean (make-u64vector 5 (- (expt 2 64) 1))))
+(test* "u32vector-sum (large)" (* 1001 #xffffffff)
+       (u32vector-sum (make-u32vector 1001 #xffffffff)))
+(test* "u8vector-mean" 3/2 (u8vector-mean '#u8(1 2)))
+(test* "f64vector-min (NaN)" '(#t #t)
+       (list (nan? (f64vector-min '#f64(1.0 +nan.0 -1.0)))
+             (nan? (f64vector-max '#f64(1.0 +nan.0 -1.0)))))
+(test* "f32vector-min (NaN)" '(#t #t)
+       (list (nan? (f32vector-min '#f32(1.0 -1.0 2.0 -2.0 +nan.0)))
+             (nan? (f32vector-max '#f32(1.0 -1.0 2.0 -2.0 +nan.0)))))
+(test* "f16vector-min (NaN)" '(#t #t)
+       (list (nan? (f16vector-min '#f16(+nan.0 1.0 -1.0)))
+             (nan? (f16vector-max '#f16(+nan.0 1.0 -1.0)))))
+(test* "f64vector-sum (NaN)" #t
+       (nan? (f64vector-sum '#f64(1.0 2.0 3.0 4.0 +nan.0))))
+(test* "u8vector-min (empty)" (test-error) (u8vector-min '#u8()))
+(test* "u8vector-sum (empty)" 0 (u8vector-sum '#u8()))
+
+
 ;;-------------------------------------------------------------------
 (test-section "block i/o")
 
@@ -423,3 +423,63 @@
       (unless (memq tag '(s8 u8))
         (for-each (cute substitute <> `((SWAPB  ,SWAPB) ,@rule))
                   *tmpl-swapb*)))))
+
+(define (generate-sortop)
+  (dolist [rule (make-rules)]
+    (let* ([t   (getval rule 't)]
+           [tag (string->symbol t)])
+      (define (RADIXP)
+        (case tag
+          [(s64 u64) "!SCM_EMULATE_INT64"]
+          [(f32 f64) "0"]
+          [else "1"]))
+      (define (FLOATP)
+        (if (memq tag '(f16 f32 f64)) "1" "0"))
+      (define (ktype)
+        (if (memq tag '(s64 u64)) "ScmUInt64" "ScmUInt32"))
+      ;; order-preserving unsigned key of element
+      (define (KEY x)
+        (case tag
+          [(s8)  #"(ScmUInt32)(u_char)(~x ^ 0x80)"]
+          [(s16) #"(ScmUInt32)(u_short)(~x ^ 0x8000)"]
+          [(s32) #"(ScmUInt32)~x ^ 0x80000000U"]
+          [(s64) #"(ScmUInt64)~x ^ ((ScmUInt64)1 << 63)"]
+          [(u8 u16 u32 u64) #"~x"]
+          [(f16) #"(SCM_HALF_FLOAT_SIGN_BIT(~x)? (ScmUInt32)(u_short)~~~x : (ScmUInt32)(~x | 0x8000U))"]
+          [else "0"]))
+      (define (LT a b)
+        (case tag
+          [(s64 u64) #"INT64LT(~|a|, ~|b|)"]
+          [(f16) #"(~|t|_key(~|a|) < ~|t|_key(~|b|))"]
+          [else #"(~a < ~b)"]))
+      (define (ISNAN x)
+        (case tag
+          [(f16) #"SCM_HALF_FLOAT_IS_NAN(~x)"]
+          [(f32 f64) #"(~x != ~x)"]
+          [else "0"]))
+      (define (GETKEY dst src oor)
+        (case tag
+          [(s8)  #"~dst = Scm_GetInteger8Clamp(~src, SCM_CLAMP_NONE, &~oor)"]
+          [(u8)  #"~dst = Scm_GetIntegerU8Clamp(~src, SCM_CLAMP_NONE, &~oor)"]
+          [(s16) #"~dst = Scm_GetInteger16Clamp(~src, SCM_CLAMP_NONE, &~oor)"]
+          [(u16) #"~dst = Scm_GetIntegerU16Clamp(~src, SCM_CLAMP_NONE, &~oor)"]
+          [(s32) #"~dst = Scm_GetInteger32Clamp(~src, SCM_CLAMP_NONE, &~oor)"]
+          [(u32) #"~dst = Scm_GetIntegerU32Clamp(~src, SCM_CLAMP_NONE, &~oor)"]
+          [(s64) #"~dst = Scm_GetInteger64Clamp(~src, SCM_CLAMP_NONE, &~oor)"]
+          [(u64) #"~dst = Scm_GetIntegerU64Clamp(~src, SCM_CLAMP_NONE, &~oor)"]
+          [(f16) #"~dst = Scm_DoubleToHalf(Scm_GetDouble(~src))"]
+          [(f32) #"~dst = (float)Scm_GetDouble(~src)"]
+          [(f64) #"~dst = Scm_GetDouble(~src)"]))
+      (for-each (cute substitute <> `((RADIXP ,RADIXP)
+                                      (FLOATP ,FLOATP)
+                                      (ktype  ,(ktype))
+                                      (KEY    ,KEY)
+                                      (LT     ,LT)
+                                      (ISNAN  ,ISNAN)
+                                      (GETKEY ,GETKEY)
+                                      ,@rule))
+                *tmpl-sortop*))))
+
+(define (generate-reduceop)
+  (dolist [rule (make-rules)]
+    (for-each (cut substitute <> rule) *tmpl-reduceop*)))
@@ -0,0 +1,387 @@
+;;;
+;;; control.fiber - lightweight cooperative threads
+;;;
+;;;   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; Fibers are cooperative threads implemented with continuations.
+;; run-fibers starts a scheduler with one or more carriers; each carrier
+;; is a Gauche thread that runs its fibers one at a time, and switches
+;; to another when the running one would block.
+;;
+;; - A fiber is bound to the carrier it first runs on, since a
+;;   continuation can't be resumed on another VM.  New fibers are
+;;   distributed to carriers round-robin.
+;; - A fiber parks itself by capturing its continuation and jumping back
+;;   to the carrier loop.  The carrier waits on the fds parked fibers are
+;;   interested in by poll(2), along with a pipe to be woken up by
+;;   other carriers.  We avoid select(2), which can't handle fds beyond
+;;   FD_SETSIZE.  Each wait still scans all the waiting fds, though.
+;; - Blocking input operations exported from this module check whether
+;;   the port has data (Scm_FdReady) before reading, and park the fiber
+;;   if it doesn't.  They shadow the builtin ones in modules that use
+;;   control.fiber, so plain sequential code becomes fiber-friendly.
+;;   Outside of fibers they behave just like the builtins.
+;; - Since a switch is a continuation jump, a fiber can't park while
+;;   it's in a callback from C code.
+
+(define-module control.fiber
+  (use srfi-1)
+  (use gauche.threads)
+  (use gauche.net)
+  (use util.queue)
+  (export <fiber> run-fibers spawn-fiber current-fiber fiber?
+          fiber-name fiber-done? fiber-join fiber-yield fiber-sleep
+          fiber-wait-readable fiber-wait-writable
+
+          ;; fiber-aware versions of the builtins
+          read-line read-char peek-char read-byte peek-byte
+          read-block read socket-accept))
+(select-module control.fiber)
+
+(define %line-ready? (with-module gauche.internal %line-ready?))
+(define %poll-fds (with-module gauche.internal %poll-fds))
+
+;; Builtins we shadow
+(define %read-line   (with-module gauche read-line))
+(define %read-char   (with-module gauche read-char))
+(define %peek-char   (with-module gauche peek-char))
+(define %read-byte   (with-module gauche read-byte))
+(define %peek-byte   (with-module gauche peek-byte))
+(define %read-block  (with-module gauche read-block))
+(define %read        (with-module gauche read))
+(define %socket-accept (with-module gauche.net socket-accept))
+
+;;;
+;;; Structures
+;;;
+
+;; Shared by the carriers started by one run-fibers.
+(define-class <fiber-scheduler> ()
+  ((carriers :init-value #())           ; vector of <fiber-carrier>
+   (live     :init-value 0)             ; # of unfinished fibers
+   (next     :init-value 0)             ; for round-robin assignment
+   (mutex    :init-form (make-mutex))   ; protects above and fiber states
+   ))
+
+(define-class <fiber-carrier> ()
+  ((scheduler :init-keyword :scheduler)
+   (runq      :init-form (make-mtqueue)) ; fibers ready to run
+   (waiting   :init-form (make-hash-table 'eqv?)) ; fd -> ((fiber . flag) ...)
+   (sleepers  :init-value '())          ; ((wake-time . fiber) ...), sorted
+   (wake-in   :init-keyword :wake-in)   ; self pipe to interrupt select
+   (wake-out  :init-keyword :wake-out)
+   (woken     :init-value #f)           ; #t if wake-out has been written
+   (current   :init-value #f)           ; running fiber
+   (return-k  :init-value #f)           ; continuation back to the loop
+   ))
+
+(define-class <fiber> ()
+  ((name      :init-keyword :name :init-value #f)
+   (thunk     :init-keyword :thunk)
+   (carrier   :init-keyword :carrier)
+   (k         :init-value #f)           ; continuation to resume
+   (done      :init-value #f)
+   (result    :init-value '())          ; list of values
+   (exception :init-value #f)
+   (joiners   :init-value '())          ; fibers waiting for us
+   ))
+
+(define-method write-object ((f <fiber>) port)
+  (format port "#<fiber ~s~a>" (~ f'name) (if (~ f'done) " done" "")))
+
+(define (fiber? obj) (is-a? obj <fiber>))
+(define (fiber-name f) (~ f'name))
+(define (fiber-done? f) (~ f'done))
+
+;; The carrier running in this thread, if any.
+(define %current-carrier (make-parameter #f))
+
+(define (current-fiber)
+  (and-let* ([c (%current-carrier)]) (~ c'current)))
+
+(define (now)
+  (receive (sec usec) (sys-gettimeofday) (+ sec (/. usec 1000000))))
+
+;;;
+;;; Switching
+;;;
+
+;; Saves the continuation of the current fiber and returns to the carrier
+;; loop.  Returns when somebody schedules the fiber again.
+(define (park! c)
+  (call/cc (^k (set! (~ (~ c'current)'k) k)
+               ((~ c'return-k) #f))))
+
+(define (run-fiber! c f)
+  (call/cc
+   (^[ret]
+     (set! (~ c'return-k) ret)
+     (set! (~ c'current) f)
+     (if-let1 k (~ f'k)
+       (begin (set! (~ f'k) #f) (k #t))
+       (fiber-main c f))))
+  (set! (~ c'current) #f))
+
+(define (fiber-main c f)
+  (guard (e [else (set! (~ f'exception) e)])
+    (set! (~ f'result) (values->list ((~ f'thunk)))))
+  (finish-fiber! f)
+  ;; Fibers never migrate, so C is still our carrier.  Its return-k is
+  ;; updated every time we're resumed.
+  ((~ c'return-k) #f))
+
+;; Makes F runnable.  Can be called from any carrier.
+(define (schedule! f)
+  (let1 c (~ f'carrier)
+    (enqueue! (~ c'runq) f)
+    (unless (eq? c (%current-carrier))
+      (wake-carrier! c))))
+
+(define (wake-carrier! c)
+  (when (with-locking-mutex (~ c'scheduler'mutex)
+          (^[] (and (not (~ c'woken)) (set! (~ c'woken) #t) #t)))
+    (write-byte 0 (~ c'wake-out))
+    (flush (~ c'wake-out))))
+
+(define (finish-fiber! f)
+  (let1 s (~ f'carrier'scheduler)
+    (receive (joiners last?)
+        (with-locking-mutex (~ s'mutex)
+          (^[] (set! (~ f'done) #t)
+               (dec! (~ s'live))
+               (values (~ f'joiners) (zero? (~ s'live)))))
+      (set! (~ f'joiners) '())
+      (for-each schedule! joiners)
+      (when last?
+        (vector-for-each (^c (unless (eq? c (%current-carrier))
+                               (wake-carrier! c)))
+                         (~ s'carriers))))))
+
+;;;
+;;; Carrier loop
+;;;
+
+(define (make-carrier s)
+  (receive (in out) (sys-pipe)
+    (make <fiber-carrier> :scheduler s :wake-in in :wake-out out)))
+
+(define (run-carrier c)
+  (parameterize ([%current-carrier c])
+    (let loop ()
+      ;; Fibers that yield are run in the next round, after polling.
+      (dotimes [n (queue-length (~ c'runq))]
+        (and-let* ([f (dequeue! (~ c'runq) #f)])
+          (run-fiber! c f)))
+      (unless (zero? (~ c'scheduler'live))
+        (wait-events! c)
+        (loop)))))
+
+(define (wait-events! c)
+  (define timeout
+    (cond [(not (queue-empty? (~ c'runq))) 0]
+          [(pair? (~ c'sleepers))
+           (max 0 (round->exact (* (- (car (car (~ c'sleepers))) (now))
+                                   1000000)))]
+          [(and (zero? (hash-table-num-entries (~ c'waiting)))
+                (= (vector-length (~ c'scheduler'carriers)) 1))
+           (error "run-fibers: deadlock; all fibers are waiting for \
+                   each other")]
+          [else #f]))
+  (define (fds-for flag)
+    (hash-table-fold (~ c'waiting)
+                     (^[fd ws acc]
+                       (if (any (^w (eq? (cdr w) flag)) ws) (cons fd acc) acc))
+                     '()))
+  (define (wake! fd flag)
+    (and-let* ([all (hash-table-get (~ c'waiting) fd #f)])
+      (receive (ready waiting) (partition (^w (eq? (cdr w) flag)) all)
+        (if (null? waiting)
+          (hash-table-delete! (~ c'waiting) fd)
+          (hash-table-put! (~ c'waiting) fd waiting))
+        (dolist [w ready] (enqueue! (~ c'runq) (car w))))))
+  (let1 wake-fd (port-file-number (~ c'wake-in))
+    (receive (rs ws) (%poll-fds (cons wake-fd (fds-for 'r)) (fds-for 'w)
+                                timeout)
+      (when (memv wake-fd rs)
+        (with-locking-mutex (~ c'scheduler'mutex)
+          (^[] (set! (~ c'woken) #f)))
+        (let loop () ; drain
+          (when (byte-ready? (~ c'wake-in))
+            (%read-byte (~ c'wake-in))
+            (loop))))
+      (dolist [fd rs] (wake! fd 'r))
+      (dolist [fd ws] (wake! fd 'w))))
+  (let1 t (now)
+    (let loop ()
+      (when (and (pair? (~ c'sleepers))
+                 (<= (car (car (~ c'sleepers))) t))
+        (enqueue! (~ c'runq) (cdr (pop! (~ c'sleepers))))
+        (loop)))))
+
+;;;
+;;; API
+;;;
+
+(define (run-fibers thunk :key (carriers 1))
+  (when (%current-carrier)
+    (error "run-fibers can't be nested"))
+  (let* ([s (make <fiber-scheduler>)]
+         [ncs (if (eq? (gauche-thread-type) 'none) 1 (max carriers 1))]
+         [cs (list-tabulate ncs (^_ (make-carrier s)))]
+         [main (make <fiber> :thunk thunk :carrier (car cs) :name 'main)])
+    (set! (~ s'carriers) (list->vector cs))
+    (set! (~ s'live) 1)
+    (enqueue! (~ (car cs)'runq) main)
+    (unwind-protect
+        (let1 ts (map (^c (thread-start! (make-thread (cut run-carrier c))))
+                      (cdr cs))
+          (run-carrier (car cs))
+          (for-each thread-join! ts))
+      (dolist [c cs]
+        (close-port (~ c'wake-in))
+        (close-port (~ c'wake-out))))
+    (if (~ main'exception)
+      (raise (~ main'exception))
+      (apply values (~ main'result)))))
+
+(define (spawn-fiber thunk :key (name #f))
+  (let* ([c (or (%current-carrier)
+                (error "spawn-fiber must be called within run-fibers"))]
+         [s (~ c'scheduler)]
+         [target (with-locking-mutex (~ s'mutex)
+                   (^[] (inc! (~ s'live))
+                        (rlet1 t (vector-ref (~ s'carriers) (~ s'next))
+                          (set! (~ s'next)
+                                (modulo (+ (~ s'next) 1)
+                                        (vector-length (~ s'carriers)))))))]
+         [f (make <fiber> :thunk thunk :name name :carrier target)])
+    (schedule! f)
+    f))
+
+;; Waits for F to finish and returns its results.  If F raised
+;; an exception, it is reraised.
+(define (fiber-join f)
+  (let1 c (%current-carrier)
+    (let loop ()
+      (cond
+       [(with-locking-mutex (~ f'carrier'scheduler'mutex)
+          (^[] (or (~ f'done)
+                   (begin (when (and c (~ c'current))
+                            (push! (~ f'joiners) (~ c'current)))
+                          #f))))
+        (if (~ f'exception)
+          (raise (~ f'exception))
+          (apply values (~ f'result)))]
+       [(and c (~ c'current)) (park! c) (loop)]
+       [else (error "fiber-join: can't wait outside of fibers:" f)]))))
+
+(define (fiber-yield)
+  (and-let* ([c (%current-carrier)]
+             [f (~ c'current)])
+    (enqueue! (~ c'runq) f)
+    (park! c))
+  (undefined))
+
+(define (fiber-sleep seconds)
+  (if-let1 f (current-fiber)
+    (let ([c (%current-carrier)]
+          [t (+ (now) seconds)])
+      (set! (~ c'sleepers)
+            (receive (before after) (span (^e (<= (car e) t)) (~ c'sleepers))
+              (append before (acons t f after))))
+      (park! c))
+    (sys-nanosleep (round->exact (* seconds 1e9))))
+  (undefined))
+
+(define (fiber-wait-readable port-or-fd) (wait-fd port-or-fd 'r))
+(define (fiber-wait-writable port-or-fd) (wait-fd port-or-fd 'w))
+
+(define (wait-fd port-or-fd flag)
+  (and-let* ([f (current-fiber)]
+             [c (%current-carrier)]
+             [fd (cond [(integer? port-or-fd) port-or-fd]
+                       [(port? port-or-fd) (port-file-number port-or-fd)]
+                       [(is-a? port-or-fd <socket>) (socket-fd port-or-fd)]
+                       [else (error "port, socket or fd required, but got:"
+                                    port-or-fd)])])
+    (hash-table-push! (~ c'waiting) fd (cons f flag))
+    (park! c))
+  (undefined))
+
+;;;
+;;; Fiber-aware input
+;;;
+
+;; Parks the current fiber until (READY? PORT) returns true.  Ports
+;; without fd (e.g. string ports) are always ready.
+(define (wait-input ready? port)
+  (when (current-fiber)
+    (let loop ()
+      (unless (or (ready? port) (not (port-file-number port)))
+        (fiber-wait-readable port)
+        (loop)))))
+
+(define (read-line :optional (port (current-input-port)) (allowbytestr #f))
+  (wait-input %line-ready? port)
+  (%read-line port allowbytestr))
+
+(define (read-char :optional (port (current-input-port)))
+  (wait-input char-ready? port)
+  (%read-char port))
+
+(define (peek-char :optional (port (current-input-port)))
+  (wait-input char-ready? port)
+  (%peek-char port))
+
+(define (read-byte :optional (port (current-input-port)))
+  (wait-input byte-ready? port)
+  (%read-byte port))
+
+(define (peek-byte :optional (port (current-input-port)))
+  (wait-input byte-ready? port)
+  (%peek-byte port))
+
+;; This returns what's available once some data arrives, as the builtin
+;; does on ports with :modest buffering (e.g. sockets).
+(define (read-block bytes :optional (port (current-input-port)))
+  (wait-input byte-ready? port)
+  (%read-block bytes port))
+
+;; Waits only for the first byte; a datum that spans packets may block.
+(define (read :optional (port (current-input-port)))
+  (wait-input byte-ready? port)
+  (%read port))
+
+(define (socket-accept sock)
+  (when (current-fiber)
+    (fiber-wait-readable (socket-fd sock)))
+  (%socket-accept sock))
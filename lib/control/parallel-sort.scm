@@ -0,0 +1,109 @@
+;;;
+;;; control.parallel-sort - sorting with multiple threads
+;;;
+;;;   Copyright (c) 2014  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; The vector is split into chunks, each of which is sorted by
+;; its own thread with the native stable sort.  Then adjacent chunks
+;; are merged pairwise, again in parallel, until one run remains.
+;; Since every step is stable, so is the whole sort.
+
+(define-module control.parallel-sort
+  (use gauche.threads)
+  (export parallel-sort parallel-sort!))
+(select-module control.parallel-sort)
+
+(define %vector-stable-sort-range!
+  (with-module gauche.internal %vector-stable-sort-range!))
+(define %vector-merge-range!
+  (with-module gauche.internal %vector-merge-range!))
+
+;; Below this size we don't bother to spawn threads.
+(define-constant *default-threshold* 10000)
+(define-constant *default-threads* 4)
+
+;; Run thunks in parallel; the last one is run in the calling thread.
+;; The other threads are joined even if the last thunk raises, so that
+;; no worker keeps touching the vector after we return.  If a worker
+;; raised, thread-join! re-raises it as <uncaught-exception>.
+(define (run-parallel thunks)
+  (let* ([ts (map (^t (thread-start! (make-thread t))) (drop-right thunks 1))])
+    (unwind-protect ((last thunks))
+      (dolist [t ts] (guard (e [else #f]) (thread-join! t))))
+    (dolist [t ts] (thread-join! t))))
+
+(define (%parallel-sort-vector! vec less threads threshold)
+  (let* ([n (vector-length vec)]
+         [k (if (< n threshold) 1 (max 1 (min threads (quotient n 2))))])
+    (if (= k 1)
+      (%vector-stable-sort-range! vec 0 n less)
+      ;; bounds: list of k+1 split points
+      (let1 bounds (map (^i (quotient (* n i) k)) (iota (+ k 1)))
+        (run-parallel (map (^[s e] (^[] (%vector-stable-sort-range!
+                                         vec s e less)))
+                           bounds (cdr bounds)))
+        (let loop ([bounds bounds])
+          (unless (null? (cddr bounds))
+            (let merge ([bs bounds] [thunks '()] [next '()])
+              (cond
+               [(null? (cdr bs)) (run-parallel (reverse thunks))
+                                 (loop (reverse (cons (car bs) next)))]
+               [(null? (cddr bs)) ; odd run out
+                (merge (cdr bs) thunks (cons (car bs) next))]
+               [else
+                (let ([s (car bs)] [m (cadr bs)] [e (caddr bs)])
+                  (merge (cddr bs)
+                         (cons (^[] (%vector-merge-range! vec s m e less))
+                               thunks)
+                         (cons s next)))]))))))
+    vec))
+
+(define (parallel-sort! seq :optional (less? #f)
+                        :key (threads *default-threads*)
+                             (threshold *default-threshold*))
+  (cond [(vector? seq) (%parallel-sort-vector! seq less? threads threshold)]
+        [(list? seq)
+         (let1 v (%parallel-sort-vector! (list->vector seq) less?
+                                         threads threshold)
+           (do ([p seq (cdr p)] [i 0 (+ i 1)])
+               [(null? p) seq]
+             (set-car! p (vector-ref v i))))]
+        [else (error "list or vector required, but got:" seq)]))
+
+(define (parallel-sort seq :optional (less? #f)
+                       :key (threads *default-threads*)
+                            (threshold *default-threshold*))
+  (cond [(vector? seq)
+         (%parallel-sort-vector! (vector-copy seq) less? threads threshold)]
+        [(list? seq)
+         (vector->list (%parallel-sort-vector! (list->vector seq) less?
+                                               threads threshold))]
+        [else (error "list or vector required, but got:" seq)]))
@@ -61,6 +61,7 @@
    ;; the rest of slots are private
    (pool         :init-keyword :pool :init-value '()) ; [Thread]
    (size         :init-keyword :size :init-value 2)
+   (stack-size   :init-keyword :stack-size :init-value 0) ; VM stack words
    (job-queue    :init-form (make-mtqueue)) ; Queue (Bool . Job)
    (max-backlog  :allocation :propagated
                  :propagate '(job-queue max-length)
@@ -69,15 +70,17 @@
    )
   :metaclass <propagate-meta>)
 
-(define (make-thread-pool size :key (max-backlog #f))
-  (make <thread-pool> :size size :max-backlog max-backlog))
+(define (make-thread-pool size :key (max-backlog #f) (stack-size 0))
+  (make <thread-pool> :size size :max-backlog max-backlog
+        :stack-size stack-size))
 
 (define-method initialize ((pool <thread-pool>) initargs)
   (next-method)
   (set! (~ pool'pool)
         (list-tabulate (~ pool'size)
                        (lambda (_)
-                         (thread-start! (make-thread (cut worker pool)))))))
+                         (thread-start! (make-thread (cut worker pool) #f
+                                                    (~ pool'stack-size)))))))
 
 (define (thread-pool-results pool)    (~ pool'result-queue))
 (define (thread-pool-shut-down? pool) (~ pool'shut-down))
@@ -43,6 +43,7 @@
   (use gauche.sequence)
   
   (export make-random-data-state random-data-seed with-random-data-seed
+          make-random-data-states with-random-data-state
 
           integers$ integers-between$ fixnums chars$ booleans
           int8s uint8s int16s uint16s int32s uint32s int64s uint64s
@@ -82,6 +83,18 @@
     (parameterize ([%random-data-state st])
       (thunk))))
 
+;; API
+;; Returns a list of N states sharing SEED, whose sequences don't overlap.
+;; Give each thread its own one with with-random-data-state.
+(define (make-random-data-states seed n)
+  (map (cut cons seed <>)
+       (mt-random-streams (make <mersenne-twister> :seed seed) n)))
+
+;; API
+(define (with-random-data-state state thunk)
+  (parameterize ([%random-data-state state])
+    (thunk)))
+
 (define (%rand-int n) (mt-random-integer (cdr (%random-data-state)) n))
 (define (%rand-real0) (mt-random-real0 (cdr (%random-data-state))))
 (define (%rand-real)  (mt-random-real (cdr (%random-data-state))))
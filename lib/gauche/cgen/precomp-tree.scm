@@ -0,0 +1,197 @@
+;;;
+;;; gauche.cgen.precomp-tree - Precompile a library tree in parallel
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; This module drives precompilation of all the Scheme files in
+;; a library directory.  Each file foo/bar.scm becomes its own
+;; extension: OUTPUT-DIR/foo--bar.c and OUTPUT-DIR/foo/bar.sci.
+;;
+;; Files are compiled by separate precomp processes, up to JOBS of them
+;; at a time.  A file is compiled after the files in the tree it
+;; depends on, which we find from use, require, import and extend
+;; forms.  A file whose output is newer than itself and all the files
+;; it depends on, directly or indirectly, isn't compiled again.
+
+(define-module gauche.cgen.precomp-tree
+  (use srfi-1)
+  (use srfi-13)
+  (use gauche.process)
+  (use file.util)
+  (use util.match)
+  (export cgen-precompile-tree))
+(select-module gauche.cgen.precomp-tree)
+
+;; Keyword arguments:
+;;
+;; output-dir : Where to put generated *.c and *.sci files.
+;; jobs :       Maximum number of precomp processes to run at once.
+;; precomp :    Command line to run precomp, as a list of strings,
+;;              e.g. ("gosh" "/usr/share/gauche/0.9.4/lib/precomp").
+;;              LIBDIR is added to the load path of each process.
+;; predef-syms : Passed to each precomp process by -D.
+;; force :      If true, compile all the files regardless of timestamps.
+;;
+;; Returns #t if all the files are compiled successfully, #f otherwise.
+
+(define (cgen-precompile-tree libdir
+                              :key (output-dir ".")
+                                   (jobs 1)
+                                   (precomp '("gosh" "precomp"))
+                                   (predef-syms '())
+                                   (force #f))
+  (let* ([srcs  (tree-sources libdir)]
+         [graph (map (^s (cons s (source-dependencies libdir s srcs))) srcs)]
+         [stale (if force
+                  srcs
+                  (stale-sources libdir output-dir graph))])
+    (run-jobs (filter-map (^p (and (member (car p) stale) p)) graph)
+              jobs
+              (^[src]
+                (let ([out.c (build-path output-dir (output-c-name src))]
+                      [out.sci (build-path output-dir
+                                           (path-swap-extension src "sci"))])
+                  (make-directory* (sys-dirname out.sci))
+                  (print "precompiling " src)
+                  (run-process `(,(car precomp) "-I" ,libdir ,@(cdr precomp)
+                                 "-e" "-o" ,out.c "-i" ,out.sci
+                                 ,@(append-map (^s `("-D" ,s)) predef-syms)
+                                 ,(build-path libdir src))))))))
+
+;; foo/bar.scm -> foo--bar.c; the same naming as cgen-precompile-multi.
+(define (output-c-name src)
+  (regexp-replace-all #/[\/\\]/ (path-swap-extension src "c") "--"))
+
+;; Returns the list of *.scm files under LIBDIR, relative to LIBDIR.
+(define (tree-sources libdir)
+  (let1 prefix (string-append (sys-normalize-pathname libdir :canonicalize #t)
+                              "/")
+    (sort (directory-fold libdir
+                          (^[path seed]
+                            (if (equal? (path-extension path) "scm")
+                              (cons (string-drop (sys-normalize-pathname
+                                                  path :canonicalize #t)
+                                                 (string-length prefix))
+                                    seed)
+                              seed))
+                          '()))))
+
+;;----------------------------------------------------------------
+;; Dependency graph
+;;
+
+;; Returns the list of files in SRCS that SRC depends on.
+;; We only look at toplevel forms and the bodies of define-module and
+;; define-library.  If we hit something we can't read, e.g. srfi-10
+;; read-time constructors, we stop there; dependencies usually
+;; appear at the beginning of the file.
+(define (source-dependencies libdir src srcs)
+  (define (lib->file name)
+    (let1 f (string-append name ".scm")
+      (and (member f srcs) (not (equal? f src)) f)))
+  (define (import-set->file spec)
+    (match spec
+      [((or 'only 'except 'prefix 'rename) set . _) (import-set->file set)]
+      [(? symbol?) (lib->file (module-name->path spec))]
+      [((? (^x (or (symbol? x) (integer? x)))) ...)
+       (lib->file (string-join (map x->string spec) "/"))]
+      [_ #f]))
+  (define (form-deps form)
+    (match form
+      [('define-module _ . body) (append-map form-deps body)]
+      [('define-library _ . decls) (append-map form-deps decls)]
+      [('use mod . _) (cond [(import-set->file mod) => list] [else '()])]
+      [('extend . mods) (filter-map import-set->file mods)]
+      [('import . specs) (filter-map import-set->file specs)]
+      [('require (? string? path)) (cond [(lib->file path) => list]
+                                         [else '()])]
+      [_ '()]))
+  (delete-duplicates
+   (call-with-input-file (build-path libdir src)
+     (^[in]
+       (let loop ([deps '()])
+         (let1 form (guard (e [else (eof-object)]) (read in))
+           (if (eof-object? form)
+             (reverse deps)
+             (loop (append (reverse (form-deps form)) deps)))))))))
+
+;; Returns the list of sources whose output is older than the source
+;; itself or any of the sources it depends on, directly or indirectly.
+(define (stale-sources libdir output-dir graph)
+  (define newest (make-hash-table 'equal?))
+  (define (newest-mtime src)
+    (or (hash-table-get newest src #f)
+        (begin
+          ;; Set a tentative value first to stop at cycles.
+          (hash-table-put! newest src (file-mtime (build-path libdir src)))
+          (rlet1 t (fold (^[dep t] (max t (newest-mtime dep)))
+                         (hash-table-get newest src)
+                         (cdr (assoc src graph)))
+            (hash-table-put! newest src t)))))
+  (filter (^[node]
+            (let1 out.c (build-path output-dir (output-c-name (car node)))
+              (or (not (file-exists? out.c))
+                  (< (file-mtime out.c) (newest-mtime (car node))))))
+          (map car graph)))
+
+;;----------------------------------------------------------------
+;; Scheduler
+;;
+
+;; NODES is a list of (src dep ...).  START is called with a src
+;; and returns a <process>.  A node is started once none of its deps
+;; is waiting or running; deps not in NODES are regarded as done.
+;; After a failure we don't start new jobs, but wait for the running ones.
+(define (run-jobs nodes jobs start)
+  (define (ready? node pending running)
+    (every (^d (not (or (assoc d pending) (rassoc d running))))
+           (cdr node)))
+  (let loop ([pending nodes] [running '()] [ok #t])
+    (cond
+     [(and ok (< (length running) jobs)
+           (find (cut ready? <> pending running) pending))
+      => (^[node]
+           (loop (delete node pending eq?)
+                 (acons (start (car node)) (car node) running)
+                 ok))]
+     [(pair? running)
+      (let* ([p (process-wait-any)]
+             [src (cdr (assq p running))]
+             [status (process-exit-status p)]
+             [success (and (sys-wait-exited? status)
+                           (zero? (sys-wait-exit-status status)))])
+        (unless success
+          (format (current-error-port) "precompiling ~a failed\n" src))
+        (loop pending (alist-delete p running eq?) (and ok success)))]
+     [(and ok (pair? pending))
+      (error "circular dependency among:" (map car pending))]
+     [else ok])))
@@ -0,0 +1,166 @@
+;;;
+;;; gauche.forkserver - serve requests from a preloaded process
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; Loading a large program takes a while, most of which is spent on
+;; reading and initializing modules.  A fork server pays that cost once:
+;; it loads everything, then listens on a unix-domain socket and forks
+;; a child for each client.  The child shares the initialized heap
+;; with the server copy-on-write, so it starts running immediately.
+;;
+;; The client passes its stdin, stdout and stderr to the server with
+;; SCM_RIGHTS, followed by the request datum (args cwd environ).
+;; The child installs them, runs the handler, and writes back the
+;; exit status.
+
+(define-module gauche.forkserver
+  (use gauche.net)
+  (use gauche.uvector)
+  (export forkserver-start forkserver-run))
+(select-module gauche.forkserver)
+
+;; Status we report when the handler throws an error; same as gosh.
+(define-constant *error-status* 70)
+
+;; fds passed by the client, as a single SCM_RIGHTS message.
+(define (pack-fds fds)
+  (uvector-alias <u8vector> (list->s32vector fds)))
+
+(define (unpack-fds control)
+  (append-map (^c (if (and (eqv? (car c) SOL_SOCKET)
+                           (eqv? (cadr c) SCM_RIGHTS))
+                    (s32vector->list (uvector-alias <s32vector> (caddr c)))
+                    '()))
+              control))
+
+;;
+;; Server side
+;;
+
+(define (forkserver-start path proc :key (backlog SOMAXCONN))
+  (when (file-exists? path) (sys-unlink path))
+  (let1 server (make-server-socket 'unix path :backlog backlog)
+    (unwind-protect
+        (let loop ()
+          (let1 conn (socket-accept server)
+            (when (= (sys-fork) 0)
+              ;; The child must never unwind into the cleanup below,
+              ;; which would remove the live server's socket.
+              (sys-exit (guard (e [else (report-error e) *error-status*])
+                          (socket-close server)
+                          (serve-request conn proc))))
+            (socket-close conn)
+            (reap-children)
+            (loop)))
+      (socket-close server)
+      (sys-unlink path))))
+
+(define (reap-children)
+  (guard (e [(and (condition-has-type? e <system-error>)
+                 (eqv? (condition-ref e 'errno) ECHILD))
+             #f])
+    (let loop ()
+      (receive (pid status) (sys-waitpid -1 :nohang #t)
+        (when (> pid 0) (loop))))))
+
+;; Runs in the child.  Returns the exit status.
+(define (serve-request conn proc)
+  (receive (_ control) (socket-recvmsg conn 1 (* 3 4))
+    (let1 fds (unpack-fds control)
+      (unless (= (length fds) 3)
+        (error "forkserver: client didn't pass stdio:" fds))
+      (redirect-stdio fds)))
+  (apply (^[args cwd env]
+           (sys-chdir cwd)
+           (replace-environment env)
+           (rlet1 status (run-handler proc args)
+             (flush-all-ports)
+             (let1 out (socket-output-port conn)
+               (write status out)
+               (flush out))))
+         (read (socket-input-port conn))))
+
+(define (redirect-stdio fds)
+  (for-each (^[fd port]
+              (let1 p (if (input-port? port)
+                        (open-input-fd-port fd :owner? #t)
+                        (open-output-fd-port fd :owner? #t))
+                (port-fd-dup! port p)
+                (close-port p)))
+            fds
+            (list (standard-input-port)
+                  (standard-output-port)
+                  (standard-error-port))))
+
+(define (replace-environment env)
+  (dolist [p (sys-environ->alist)]
+    (unless (assoc (car p) env) (sys-unsetenv (car p))))
+  (dolist [p env]
+    (sys-setenv (car p) (cdr p) #t)))
+
+;; PROC may call exit; we catch it so that the status reaches the client.
+(define (run-handler proc args)
+  (let/cc return
+    (exit-handler (^[code fmt args]
+                    (when fmt
+                      (apply format (standard-error-port) fmt args)
+                      (newline (standard-error-port)))
+                    (return code)))
+    (guard (e [else (report-error e) *error-status*])
+      (with-ports (standard-input-port)
+                  (standard-output-port)
+                  (standard-error-port)
+        (^[] (let1 r (proc args)
+               (if (exact-integer? r) r 0)))))))
+
+;;
+;; Client side
+;;
+
+(define (forkserver-run path args)
+  (let1 sock (make-client-socket 'unix path)
+    (unwind-protect
+        (begin
+          (socket-sendmsg sock
+                          (socket-buildmsg #f (vector "F")
+                                           `((,SOL_SOCKET ,SCM_RIGHTS
+                                              ,(pack-fds '(0 1 2))))
+                                           0))
+          (let1 out (socket-output-port sock)
+            (write (list args (sys-getcwd) (sys-environ->alist)) out)
+            (flush out))
+          (let1 status (read (socket-input-port sock))
+            (if (exact-integer? status)
+              status
+              (error "forkserver: connection closed without status:" path))))
+      (socket-close sock))))
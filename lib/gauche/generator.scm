@@ -34,7 +34,6 @@
 (define-module gauche.generator
   (use srfi-1)
   (use gauche.sequence)
-  (use gauche.partcont)
   (use util.match)
   (export list->generator vector->generator reverse-vector->generator
           string->generator
@@ -455,12 +454,20 @@
                  (begin (set! found? #t) v))))))))
 
 ;; generate :: ((a -> ()) -> ()) -> Generator a
+;; PROC runs in a native coroutine, which has its own VM stack segment,
+;; so switching between PROC and the consumer doesn't copy frames.
+(define %make-coroutine (with-module gauche.internal %make-coroutine))
+(define %coroutine-resume (with-module gauche.internal %coroutine-resume))
+(define %coroutine-yield (with-module gauche.internal %coroutine-yield))
+(define %coroutine-done? (with-module gauche.internal %coroutine-done?))
+
 (define (generate proc)
-  (define (cont)
-    (reset (proc (^[value] (shift k (set! cont k) value)))
-           (set! cont null-generator)
-           (eof-object)))
-  (^[] (cont)))
+  (define co
+    (%make-coroutine (^[] (proc (^[value] (%coroutine-yield co value))))))
+  (^[] (if (%coroutine-done? co)
+         (eof-object)
+         (let1 v (%coroutine-resume co)
+           (if (%coroutine-done? co) (eof-object) v)))))
 
 ;; grxmatch :: (Regexp, Generator Char) -> Generator RegMatch
 ;;          |  (Regexp, String) -> Generator RegMatch
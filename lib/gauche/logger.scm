@@ -41,12 +41,19 @@
   (export <log-drain>
           log-open
           log-format
-          log-default-drain)
+          log-default-drain
+          log-drain-flush
+          log-drain-close)
   )
 (select-module gauche.logger)
 
 (autoload gauche.syslog sys-openlog sys-syslog LOG_PID LOG_INFO LOG_USER)
 (autoload file.util file-mtime<?)
+(autoload gauche.threads make-thread thread-start! thread-join!
+                         make-mutex with-locking-mutex
+                         atom atom-ref atomic-update!)
+(autoload util.queue make-mtqueue enqueue/wait! dequeue/wait! dequeue!
+                     queue-push/wait!)
 
 ;; <log-drain> class
 (define-class <log-drain> ()
@@ -64,6 +71,20 @@
    (syslog-option   :init-keyword :syslog-option)
    (syslog-facility :init-keyword :syslog-facility)
    (syslog-priority :init-keyword :syslog-priority)
+   ;; The following parameters are used for asynchronous logging.
+   (async :init-keyword :async :initform #f)
+   (queue-size :init-keyword :queue-size :initform 1024)
+   (batch-size :init-keyword :batch-size :initform 256)
+   (overflow :init-keyword :overflow :initform 'block)
+   (dropped-count :allocation :virtual
+                  :slot-ref (^[drain] (if-let1 a (slot-ref drain '%dropped)
+                                        (atom-ref a)
+                                        0)))
+   (%queue :init-value #f)
+   (%thread :init-value #f)
+   (%dropped :init-value #f)
+   (%lock :init-value #f)
+   (%closed :init-value #f)
    ))
 
 (define log-default-drain
@@ -83,7 +104,9 @@
     (sys-openlog (slot-ref self 'program-name)
                  (slot-ref self 'syslog-option)
                  (slot-ref self 'syslog-facility))
-    ))
+    )
+  (when (and (slot-ref self 'async) (slot-ref self 'path))
+    (start-log-writer self)))
 
 ;; prefix spec
 ;;   ~T   current time as "MMM DD hh:mm:ss" where MMM is abbrev month.
@@ -225,6 +248,98 @@
                        (call-with-output-string proc))]
           [else #f])))
 
+;; Asynchronous logging
+;;   An async drain has a bounded queue of formatted records and a
+;;   writer thread.  The writer takes as many records as available (up
+;;   to batch-size) and writes them with one open/lock/write of the log
+;;   file.  Control requests (flush and close) are sent through the same
+;;   queue as a pair (command . gate), so that they're processed after
+;;   all the records enqueued before them.  The writer answers through
+;;   the gate, a zero-length mtqueue.
+;;
+;;   Enqueueing is done while holding %lock, and log-drain-close sets
+;;   %closed under the same lock before it sends the close request.
+;;   So no record nor request can be enqueued after the close request;
+;;   once %closed is set, log-format writes synchronously and other
+;;   requests are no-ops.  Pending records are written at exit.
+
+(define (start-log-writer drain)
+  (let1 q (make-mtqueue :max-length (slot-ref drain 'queue-size))
+    (slot-set! drain '%queue q)
+    (slot-set! drain '%dropped (atom 0))
+    (slot-set! drain '%lock (make-mutex))
+    (slot-set! drain '%thread
+               (thread-start! (make-thread (^[] (log-writer drain q))
+                                           'log-writer)))
+    ((with-module gauche.internal %add-cleanup-handler)
+     (^[] (log-drain-close drain)))))
+
+(define (log-writer drain q)
+  (define batch-size (slot-ref drain 'batch-size))
+  (define (answer item) (enqueue/wait! (cdr item) #t))
+  (let loop ()
+    (let collect ([item (dequeue/wait! q)] [recs '()] [n 0])
+      (cond [(string? item)
+             (let ([recs (cons item recs)] [n (+ n 1)])
+               (if-let1 next (and (< n batch-size) (dequeue! q #f))
+                 (collect next recs n)
+                 (begin (write-batch drain recs n) (loop))))]
+            [(eq? (car item) 'close)
+             ;; The drain is already closed, so nothing can be enqueued
+             ;; from now on; write whatever is left, just in case.
+             (let drain-rest ([recs recs] [n n])
+               (let1 next (dequeue! q #f)
+                 (cond [(string? next) (drain-rest (cons next recs) (+ n 1))]
+                       [next (answer next) (drain-rest recs n)]
+                       [else (write-batch drain recs n)])))
+             (answer item)]
+            [else
+             (write-batch drain recs n)
+             (answer item)
+             (loop)]))))
+
+;; RECS is a list of records in reverse order.
+(define (write-batch drain recs n)
+  (unless (null? recs)
+    (guard (e [else (atomic-update! (slot-ref drain '%dropped) (cut + <> n))])
+      (if (eq? (slot-ref drain 'path) 'syslog)
+        (dolist [r (reverse recs)]
+          (with-log-output drain (^p (display r p))))
+        (let1 str (string-concatenate-reverse recs)
+          (with-log-output drain (^p (display str p))))))))
+
+(define (enqueue-record drain str)
+  (define q (slot-ref drain '%queue))
+  (define (drop!) (atomic-update! (slot-ref drain '%dropped) (cut + <> 1)))
+  (let1 policy (slot-ref drain 'overflow)
+    (case policy
+      [(block) (enqueue/wait! q str)]
+      [(drop)  (unless (enqueue/wait! q str 0 #f) (drop!))]
+      [(drop-oldest)
+       (let loop ()
+         (unless (enqueue/wait! q str 0 #f)
+           (let1 old (dequeue! q #f)
+             (cond [(string? old) (drop!) (loop)]
+                   [(not old) (loop)]
+                   ;; Don't discard a control request; put it back and wait.
+                   [else (queue-push/wait! q old) (enqueue/wait! q str)]))))]
+      [else
+       (if (real? policy)
+         (unless (enqueue/wait! q str policy #f) (drop!))
+         (error "invalid overflow policy of <log-drain>:" policy))])))
+
+(define (send-log-request drain cmd)
+  (and-let* ([lock (slot-ref drain '%lock)]
+             [gate (make-mtqueue :max-length 0)]
+             [sent (with-locking-mutex lock
+                     (^[] (and (not (slot-ref drain '%closed))
+                               (begin
+                                 (when (eq? cmd 'close)
+                                   (slot-set! drain '%closed #t))
+                                 (enqueue/wait! (slot-ref drain '%queue)
+                                                (cons cmd gate))))))])
+    (dequeue/wait! gate)))
+
 ;; External APIs
 ;; log-format "fmtstr" arg ...
 ;; log-format drain "fmtstr" arg ...
@@ -241,7 +356,26 @@
                                   (list* prefix data "\n" rest)))
                               '()
                  $ string-split (apply format #f fmt args) #\newline)])
-    (with-log-output drain (^p (display str p)))))
+    (unless (and-let* ([lock (slot-ref drain '%lock)])
+              (with-locking-mutex lock
+                (^[] (and (not (slot-ref drain '%closed))
+                          (begin (enqueue-record drain str) #t)))))
+      (with-log-output drain (^p (display str p))))))
+
+;; log-drain-flush drain
+;;   Waits until all records logged so far are written.
+;; log-drain-close drain
+;;   Flushes, then stops the writer thread.  The drain falls back to
+;;   synchronous logging.  Closing a closed drain does nothing.
+
+(define (log-drain-flush :optional (drain (log-default-drain)))
+  (send-log-request drain 'flush)
+  (undefined))
+
+(define (log-drain-close :optional (drain (log-default-drain)))
+  (when (send-log-request drain 'close)
+    (thread-join! (slot-ref drain '%thread)))
+  (undefined))
 
 ;; log-open path &keyword :program-name :prefix
 
@@ -92,11 +92,66 @@
                        (hash-table-put! saves sym value))
                      (loop (cdr preds)))))))))
         ;; reload
-        (load (module-name->path module-name))
-        ;; restore any remembered data
-        (hash-table-for-each
-         saves
-         (^[sym value] (eval `(set! ,sym (quote ,value)) mod)))))))
+        (let1 dependents (forget-inline-dependents mod)
+          (parameterize ([reloading (cons module-name (reloading))])
+            (load (module-name->path module-name))
+            ;; restore any remembered data
+            (hash-table-for-each
+             saves
+             (^[sym value] (eval `(set! ,sym (quote ,value)) mod)))
+            (reload-inline-dependents dependents)))))))
+
+;; Modules compiled with -finline-exports may have inlined procedures
+;; of the module being reloaded.  We reload them as well, so that they
+;; see the new definitions.  RELOADING keeps the modules being reloaded,
+;; to avoid looping when modules inlined each other's procedures.
+(define reloading (make-parameter '()))
+
+;; The rules reload-modified-modules is working with, if any.  Dependents
+;; are reloaded with the rules for them, as if they were reloaded by
+;; themselves.
+(define current-rules (make-parameter #f))
+
+(define %forget-inline-dependents!
+  (with-module gauche.internal %forget-inline-dependents!))
+
+(define (forget-inline-dependents mod)
+  (delete-duplicates
+   (hash-table-fold (module-table mod)
+                    (^[sym gloc r]
+                      (append (%forget-inline-dependents! mod sym) r))
+                    '())
+   eq?))
+
+(define (rules-for name)
+  (let1 s (symbol->string name)
+    (cond [(find (^r (rxmatch (module-glob-pattern->regexp
+                               (symbol->string (car r)))
+                              s))
+                 (or (current-rules) (module-reload-rules)))
+           => cdr]
+          [else '()])))
+
+;; Only modules loaded from a file can be reloaded.  The user module,
+;; modules created by eval and modules loaded by path are left as they
+;; are; they keep the old inlined code, so we warn.
+(define (reload-inline-dependents mods)
+  (dolist [m mods]
+    (let1 name (module-name m)
+      (cond
+       [(memq name (reloading))]
+       [(and (symbol? name)
+             (not (memq name '(user gauche gauche.internal)))
+             (find-in-path (string-append (module-name->path name) ".scm")
+                           *load-path*))
+        (when (reload-verbose)
+          (format #t "reloading ~S, which inlined redefined procedures\n"
+                  name))
+        (apply reload name (rules-for name))]
+       [else
+        (warn "module ~S inlined procedures redefined by reload, but it \
+               can't be reloaded; it keeps using the old definitions"
+              (or name m))]))))
 
 ;; procedure reload-modified-modules &optional <reload-rules>
 ;;   Reloads modules that are modified after this module is loaded.
@@ -129,7 +184,10 @@
                (when (reload-verbose)
                  (format #t "reloading: ~S\n" name))
                (hash-table-put! mod-times name now)
-               (reload name rule))))
+               (parameterize ([current-rules (if (pair? rl)
+                                               (car rl)
+                                               (module-reload-rules))])
+                 (reload name rule)))))
          (all-modules))))))
 
 
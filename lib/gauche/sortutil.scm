@@ -27,6 +27,8 @@
 
 (define %sort  (with-module gauche.internal %sort))
 (define %sort! (with-module gauche.internal %sort!))
+(define %stable-sort  (with-module gauche.internal %stable-sort))
+(define %stable-sort! (with-module gauche.internal %stable-sort!))
 
 (define (default-less? x y)
   (< (compare x y) 0))
@@ -124,10 +126,15 @@
                a)))]))
 
 ;;; (sort! sequence :optional less? key)
-;;; sorts the list or vector sequence destructively.  It uses a version
-;;; of merge-sort invented, to the best of my knowledge, by David H. D.
-;;; Warren, and first used in the DEC-10 Prolog system.  R. A. O'Keefe
-;;; adapted it to work destructively in Scheme.
+;;; sorts the list or vector sequence destructively.  The stable versions
+;;; use a natural merge sort implemented in C (Scm_StableSortArray),
+;;; which works directly on vectors and takes advantage of presorted
+;;; runs in the input.
+
+;; Returns the comparison procedure passed to the C routines.
+;; We pass #f for the default, so that they can call Scm_Compare directly.
+(define (%less-proc less?)
+  (if (eq? less? default-less?) #f less?))
 
 (define (sort! seq . args)
   (if (and (or (pair? seq) (vector? seq)) (null? args))
@@ -135,39 +142,12 @@
     (apply stable-sort! seq args)))
 
 (define (stable-sort! seq :optional (less? default-less?) (key identity))
-  (if (not (memq key `(,identity ,values)))
-    (stable-sort-by! seq key less?)
-    (letrec ([step (^n (cond [(> n 2) (let* ([j (ash n -1)]
-                                             [a (step j)]
-                                             [k (- n j)]
-                                             [b (step k)])
-                                        (merge! a b less?))]
-                             [(= n 2) (let ([x (car seq)]
-                                            [y (cadr seq)]
-                                            [p seq])
-                                        (set! seq (cddr seq))
-                                        (when (less? y x)
-                                          (set-car! p y)
-                                          (set-car! (cdr p) x))
-                                        (set-cdr! (cdr p) '())
-                                        p)]
-                             [(= n 1) (let ([p seq])
-                                        (set! seq (cdr seq))
-                                        (set-cdr! p '())
-                                        p)]
-                             [else '()]))])
-      (cond [(null? seq) seq]
-            [(pair? seq) (step (length seq))]
-            [(vector? seq)
-             (let ([n (vector-length seq)]
-                   [vector seq])
-               (set! seq (vector->list seq))
-               (do ([p (step n) (cdr p)]
-                    [i 0 (+ i 1)])
-                   [(null? p) vector]
-                 (vector-set! vector i (car p))))]
-            [(is-a? seq <sequence>) (generic-sort! seq less?)]
-            [else (error "sequence required, but got:" seq)]))))
+  (cond [(not (memq key `(,identity ,values)))
+         (stable-sort-by! seq key less?)]
+        [(null? seq) seq]
+        [(or (pair? seq) (vector? seq)) (%stable-sort! seq (%less-proc less?))]
+        [(is-a? seq <sequence>) (generic-sort! seq less?)]
+        [else (error "sequence required, but got:" seq)]))
 
 ;;; (sort sequence less?)
 ;;; sorts a vector or list non-destructively.  It does this by sorting a
@@ -181,9 +161,7 @@
 (define (stable-sort seq :optional (less? default-less?) (key identity))
   (if (memq key `(,identity ,values))
     (cond [(null? seq) seq]
-          [(pair? seq) (sort! (list-copy seq) less?)]
-          [(vector? seq)
-           (list->vector (sort! (vector->list seq) less?))]
+          [(or (pair? seq) (vector? seq)) (%stable-sort seq (%less-proc less?))]
           [(is-a? seq <sequence>) (generic-sort seq less?)]
           [else (error "sequence required, but got:" seq)])
     (stable-sort-by seq key less?)))
@@ -204,7 +182,9 @@
             $ stable-sort (map (^e (cons e (key e))) seq)
             $ %make-cmp less?)]
         [(vector? seq)
-         (list->vector (sort-by (vector->list seq) key less?))]
+         ($ vector-map car
+            $ %stable-sort! (vector-map (^e (cons e (key e))) seq)
+            $ %make-cmp less?)]
         [(is-a? seq <sequence>) (generic-sort-by seq key less?)]
         [else (error "sequence required, but got:" seq)]))
 
@@ -41,20 +41,25 @@
 
 (define %string-split-by-char
   (with-module gauche.internal %string-split-by-char))
+(define %regexp-split
+  (with-module gauche.internal %regexp-split))
 
 ;; Generic string-split
 ;;   splitter can be a character, a char-set, a string, or a regexp.
 (define (string-split string splitter :optional (limit #f))
   (unless (or (not limit) (and (integer? limit) (>= limit 0)))
     (error "limit argument must be a nonnegative integer or #f, but got" limit))
-  (if (char? splitter)
+  (cond
+   [(char? splitter)
     ;; In order to make 0.9.4 build with 0.9.3, we need to adjust
     ;; arguments to %string-split-by-char.  After 0.9.4 release
     ;; we can just call 3-arg %string-split-by-char.
     (if limit
       (%string-split-by-char string splitter limit)
-      (%string-split-by-char string splitter))
-    (%string-split string (%string-split-scanner splitter) (or limit -1))))
+      (%string-split-by-char string splitter))]
+   [(regexp? splitter) (%regexp-split splitter string (or limit -1))]
+   [else
+    (%string-split string (%string-split-scanner splitter) (or limit -1))]))
 
 ;; aux fns
 (define (%string-split-scanner splitter)
@@ -67,13 +72,6 @@
         [(char-set? splitter)
          (%string-split-scanner-each-char
           (cut char-set-contains? splitter <>))]
-        [(regexp? splitter)
-         (^s (cond [(rxmatch splitter s)
-                    => (^m (let ([before (m 'before)]
-                                 [after  (m 'after)])
-                             (when (string=? s after) (null-splitter))
-                             (values before after)))]
-                   [else (values s #f)]))]
         [else ;; assume splitter is a predicate
          (%string-split-scanner-each-char splitter)]))
 
@@ -59,8 +59,10 @@
   (use util.match)
   (use util.list)
   (use text.tree)
+  (use gauche.threads)
   (export <http-error>
           http-user-agent make-http-connection reset-http-connection
+          make-http-connection-pool http-connection-pool-close!
           http-compose-query http-compose-form-data
 
           http-proxy http-request
@@ -70,6 +72,7 @@
           http-file-sender http-multipart-sender
 
           http-get http-head http-post http-put http-delete
+          http-pipeline http-request-all
           http-default-auth-handler
           http-default-redirect-handler
 
@@ -85,7 +88,8 @@
           mime-compose-parameters
           mime-parse-content-type)
 (autoload rfc.tls
-          make-tls tls-connect tls-input-port tls-output-port tls-close)
+          make-tls tls-connect tls-input-port tls-output-port tls-close
+          tls-destroy)
 
 (autoload file.util file-size find-file-in-paths null-device)
 
@@ -198,6 +202,9 @@
 ;;             the sender needs to call BODY-SINK with argument 0.
 ;;
 ;;   host    - the host name passed to the 'host' header field.
+;;   pool    - an <http-connection-pool>.  If given, the socket is taken
+;;             from the pool and returned to it after the request,
+;;             as long as the server allows it to be reused.
 ;;   secure  - if true, using secure connection (via gauche.tls).
 ;;   auth-user, auth-password, auth-handler - authentication parameters.
 ;;   request-encoding - when http-* is to construct request-uri and/or
@@ -230,13 +237,14 @@
                            extra-headers
                            (user-agent (http-user-agent))
                            (secure #f)
+                           pool
                            (receiver (http-string-receiver))
                            (sender #f)
                            ((:request-encoding enc) (gauche-character-encoding))
                       :allow-other-keys opts)
 
   (define conn (ensure-connection server auth-handler auth-user auth-password
-                                  proxy secure extra-headers))
+                                  proxy secure extra-headers pool))
   (define redirector (if no-redirect
                        #f
                        (case redirect-handler
@@ -244,11 +252,11 @@
                          [(#f) #f]
                          [else => identity])))
   (define options `(:user-agent ,user-agent ,@(http-auth-headers conn) ,@opts))
-  (define no-body-replies '("204" "304"))
+  ;; set to #t when the reply allows us to reuse the socket.
+  (define keep-alive #f)
 
   (define (get-body iport method code headers receiver)
-    (and (not (eq? method 'HEAD))
-         (not (member code no-body-replies))
+    (and (reply-has-body? method code)
          (receive-body iport code headers receiver)))
 
   ;; final touch of request headers
@@ -274,7 +282,8 @@
   ;;   (redirect-to <method> <location>)
   (define (request-response in out method uri host sender)
     (send-request out method uri sender (req-headers host) enc)
-    (receive (code rep-headers) (receive-header in)
+    (receive (code rep-headers version) (receive-header in)
+      (set! keep-alive (keep-alive-reply? method code rep-headers version))
       (if-let1 consider-redirect (and (string-prefix? "3" code) redirector)
         ;; we retrieve body as string, not using caller-provided receiver
         (let* ([body (get-body in method code rep-headers
@@ -301,7 +310,8 @@
       (let1 result
           (with-connection
            conn
-           (^[i o] (request-response i o method uri host sender)))
+           (^[i o] (request-response i o method uri host sender))
+           (^[] keep-alive))
         (match result
           [('reply code rep-headers body) (values code rep-headers body)]
           [('redirect-to method location)
@@ -455,6 +465,121 @@
 (define (http-delete server request-uri . options)
   (apply %http-request-adaptor 'DELETE server request-uri #f options))
 
+;;
+;; Pipelining
+;;
+
+;; Sends all REQUESTS over one socket without waiting for replies, then
+;; reads the replies in order.  Each request is (METHOD REQUEST-URI
+;; HEADER VALUE ...), where METHOD must be GET or HEAD; other methods
+;; aren't safe to pipeline, since they can't be retried if the server
+;; drops the connection in the middle.  If the server closes the
+;; connection before replying all of them, the rest are sent again over
+;; a new socket.  Redirections are not followed.
+;; Returns a list of (CODE HEADERS BODY), in the order of REQUESTS.
+(define (http-pipeline server requests
+                       :key (host #f)
+                            auth-handler
+                            auth-user
+                            auth-password
+                            (proxy (http-proxy))
+                            extra-headers
+                            (user-agent (http-user-agent))
+                            (secure #f)
+                            pool
+                            (receiver (http-string-receiver))
+                            ((:request-encoding enc) (gauche-character-encoding)))
+  (define conn (ensure-connection server auth-handler auth-user auth-password
+                                  proxy secure extra-headers pool))
+  (define keep-alive #f)
+
+  (define (send-1 out req)
+    (match req
+      [((and (or 'GET 'HEAD) method) request-uri . hdrs)
+       (receive (host uri)
+           (consider-proxy conn (or host (~ conn'server))
+                           (ensure-request-uri request-uri enc))
+         (send-request out method uri #f
+                       `(:host ,host :user-agent ,user-agent
+                         ,@(http-auth-headers conn) ,@hdrs)
+                       enc))]
+      [_ (error "http-pipeline: request must be (GET|HEAD request-uri \
+                 header value ...), but got:" req)]))
+
+  ;; Returns the replies we've got; may be shorter than REQS if
+  ;; the server closes the connection.
+  (define (pipeline in out reqs)
+    (for-each (cut send-1 out <>) reqs)
+    (let loop ([reqs reqs] [r '()])
+      (if (null? reqs)
+        (reverse r)
+        (receive (code headers version)
+            (if (null? r)
+              (receive-header in)
+              (guard (e [(<http-error> e) (values #f #f #f)])
+                (receive-header in)))
+          (if (not code)
+            (begin (set! keep-alive #f) (reverse r))
+            (let* ([method (caar reqs)]
+                   [body (and (reply-has-body? method code)
+                              (receive-body in code headers receiver))]
+                   [r (cons (list code headers body) r)])
+              (set! keep-alive (keep-alive-reply? method code headers version))
+              (if keep-alive
+                (loop (cdr reqs) r)
+                (reverse r))))))))
+
+  (let loop ([reqs requests] [results '()])
+    (if (null? reqs)
+      (reverse results)
+      (let1 rs (with-connection conn (^[i o] (pipeline i o reqs))
+                                (^[] keep-alive))
+        (loop (drop reqs (length rs)) (append-reverse rs results))))))
+
+;;
+;; Concurrent requests
+;;
+
+;; Runs REQUESTS concurrently by at most CONCURRENCY threads, sharing
+;; sockets through POOL.  Each request is a list of arguments to
+;; http-request, i.e. (METHOD SERVER REQUEST-URI KEY VALUE ...).
+;; If POOL is omitted, a temporary pool is created and closed afterwards.
+;; Returns a list of results in the order of REQUESTS, each of which is
+;; (CODE HEADERS BODY), or a condition if the request raised one.
+(define (http-request-all requests :key (pool #f) (concurrency 8))
+  (define p (or pool (make-http-connection-pool :max-per-host concurrency)))
+  (define reqs (list->vector requests))
+  (define results (make-vector (vector-length reqs) #f))
+  (define next 0)
+  (define mutex (make-mutex))
+
+  (define (run-1 i)
+    (vector-set! results i
+                 (guard (e [else e])
+                   (values->list
+                    (match (vector-ref reqs i)
+                      [(method server uri . opts)
+                       (apply http-request method server uri :pool p opts)]
+                      [req (error "http-request-all: bad request:" req)])))))
+  (define (take-next!)
+    (with-locking-mutex mutex
+      (^[] (and (< next (vector-length reqs))
+                (begin0 next (inc! next))))))
+  (define (worker)
+    (let loop ()
+      (and-let* ([i (take-next!)])
+        (run-1 i)
+        (loop))))
+
+  (unwind-protect
+      (if (eq? (gauche-thread-type) 'none)
+        (worker)
+        (let1 ts (list-tabulate (min concurrency (vector-length reqs))
+                                (^_ (thread-start! (make-thread worker))))
+          (for-each thread-join! ts)))
+    (unless pool (http-connection-pool-close! p)))
+  (vector->list results))
+
 ;; Adaptor to the new API.  Converts :sink and :flusher arguments,
 ;; which are superseded by :receiver arguments.
 (define (%http-request-adaptor method server request-uri body
@@ -501,10 +626,13 @@
    (proxy         :init-keyword :proxy)
    (extra-headers :init-keyword :extra-headers)
    (secure        :init-keyword :secure) ; boolean
+   (pool          :init-keyword :pool :init-value #f)
+                                        ; <http-connection-pool>, if any.
    ))
 
 (define (make-http-connection server :key
                               (persistent #t)
+                              (pool #f)
                               (auth-handler  #f)
                               (auth-user     #f)
                               (auth-password #f)
@@ -512,6 +640,7 @@
                               (extra-headers '()))
   (make <http-connection>
     :persistent persistent
+    :pool pool
     :server server
     :auth-handler (or auth-handler (http-default-auth-handler))
     :auth-user auth-user
@@ -533,6 +662,45 @@
       (set! (~ conn'secure) (equal? proto "https"))))
   conn)
 
+;;==============================================================
+;; HTTP connection pool
+;;
+
+;; A pool keeps idle sockets, keyed by the secure flag and the server
+;; they're connected to (the proxy, if any), so that later requests to
+;; the same server can skip TCP and TLS setup.  It can be shared by
+;; threads.  At most MAX-PER-HOST sockets are opened for each key; if
+;; all of them are in use, a request waits until one is released.
+;; Sockets kept idle longer than IDLE-TIMEOUT seconds are closed.
+
+(define-class <http-connection-pool> ()
+  ;; All slots are private.
+  ((max-per-host :init-keyword :max-per-host)
+   (idle-timeout :init-keyword :idle-timeout)
+   (idle   :init-form (make-hash-table 'equal?)) ; key -> ((time sock tls) ...)
+   (active :init-form (make-hash-table 'equal?)) ; key -> # of open sockets
+   (mutex  :init-form (make-mutex))
+   (cv     :init-form (make-condition-variable))
+   (closed :init-value #f)              ; set by http-connection-pool-close!
+   ))
+
+(define (make-http-connection-pool :key (max-per-host 8) (idle-timeout 30))
+  (make <http-connection-pool>
+    :max-per-host max-per-host
+    :idle-timeout idle-timeout))
+
+;; Closes all idle sockets.  Sockets in use are closed when released.
+(define (http-connection-pool-close! pool)
+  (let1 entries (with-locking-mutex (~ pool'mutex)
+                  (^[] (set! (~ pool'closed) #t)
+                       (rlet1 es (append-map cdr (hash-table->alist (~ pool'idle)))
+                         (hash-table-for-each
+                          (~ pool'idle)
+                          (^[k v] (hash-table-update! (~ pool'active) k
+                                                      (cut - <> (length v)))))
+                         (hash-table-clear! (~ pool'idle)))))
+    (for-each close-pooled-socket entries)))
+
 ;;==============================================================
 ;; query and request body composition
 ;;
@@ -626,7 +794,7 @@
 
 ;; Always returns a connection object.
 (define (ensure-connection server auth-handler auth-user auth-password
-                           proxy secure extra-headers)
+                           proxy secure extra-headers pool)
   (rlet1 conn (cond
                [(is-a? server <http-connection>) server]
                [(string? server) (make-http-connection server :persistent #f)]
@@ -641,7 +809,8 @@
       (check-override auth-password)
       (check-override proxy)
       (check-override extra-headers)
-      (check-override secure))))
+      (check-override secure)
+      (check-override pool))))
 
 (define (reset-http-connection conn)
   (shutdown-socket-connection conn)
@@ -662,19 +831,118 @@
     (socket-close (~ conn'socket))
     (set! (~ conn'socket) #f)))
 
-(define (with-connection conn proc)
-  (unless (~ conn'persistent)
-    (unless (~ conn'socket) (start-socket-connection conn))
-    (when (~ conn'secure) (start-secure-agent conn)))
+(define (connection-ports conn)
+  (if (~ conn'secure)
+    `(,(tls-input-port (~ conn'secure-agent))
+      ,(tls-output-port (~ conn'secure-agent)))
+    `(,(socket-input-port (~ conn'socket))
+      ,(socket-output-port (~ conn'socket)))))
+
+;; REUSABLE? is called after PROC returns normally, and tells whether
+;; the socket can be used for another request.  It only matters when
+;; CONN has a pool.
+(define (with-connection conn proc :optional (reusable? (^[] #f)))
+  (if-let1 pool (~ conn'pool)
+    (with-pooled-connection pool conn proc reusable?)
+    (begin
+      (unless (~ conn'persistent)
+        (unless (~ conn'socket) (start-socket-connection conn))
+        (when (~ conn'secure) (start-secure-agent conn)))
+      (unwind-protect
+          (apply proc (connection-ports conn))
+        (unless (~ conn'persistent)
+          (when (~ conn'secure) (shutdown-secure-agent conn))
+          (shutdown-socket-connection conn))))))
+
+(define (with-pooled-connection pool conn proc reusable?)
+  (define key (pool-key conn))
+  (define done #f)
+  (pool-acquire! pool conn key)
   (unwind-protect
-      (apply proc (if (~ conn'secure)
-                    `(,(tls-input-port (~ conn'secure-agent))
-                      ,(tls-output-port (~ conn'secure-agent)))
-                    `(,(socket-input-port (~ conn'socket))
-                      ,(socket-output-port (~ conn'socket)))))
-    (unless (~ conn'persistent)
-      (when (~ conn'secure) (shutdown-secure-agent conn))
-      (shutdown-socket-connection conn))))
+      (begin0 (apply proc (connection-ports conn))
+        (set! done #t))
+    (pool-release! pool conn key (and done (reusable?)))))
+
+(define (pool-key conn)
+  (let1 server (or (~ conn'proxy) (~ conn'server))
+    (list (and (~ conn'secure) #t)
+          (if (#/:\d+$/ server)
+            server
+            #`",|server|:,(if (~ conn'secure) 443 80)"))))
+
+(define (close-pooled-socket entry)
+  (match-let1 (_ sock tls) entry
+    (when tls
+      (tls-close tls)
+      (tls-destroy tls))
+    (guard (e [(<system-error> e) #f])
+      (socket-shutdown sock))
+    (socket-close sock)))
+
+;; An idle socket shouldn't have anything to read.  If it has, the server
+;; has closed it (or sent something unexpected), so we can't use it.
+(define (idle-socket-usable? sock)
+  (guard (e [else #f])
+    (receive (n r w x) (sys-select (sys-fdset (socket-fd sock)) #f #f 0)
+      (zero? n))))
+
+;; Sets up the socket slots of CONN, either from an idle socket in POOL
+;; or by opening a new one.
+(define (pool-acquire! pool conn key)
+  (define (pick!)
+    ;; returns an idle entry, 'new, or #f to wait.  Also returns a list
+    ;; of expired entries to be closed.
+    (let* ([now (sys-time)]
+           [idle (hash-table-get (~ pool'idle) key '())])
+      (receive (live expired)
+          (partition (^e (< (- now (car e)) (~ pool'idle-timeout))) idle)
+        (hash-table-update! (~ pool'active) key
+                            (cut - <> (length expired)) 0)
+        (hash-table-put! (~ pool'idle) key (if (pair? live) (cdr live) '()))
+        (values (cond [(pair? live) (car live)]
+                      [(< (hash-table-get (~ pool'active) key 0)
+                          (~ pool'max-per-host))
+                       (hash-table-update! (~ pool'active) key (cut + <> 1) 0)
+                       'new]
+                      [else #f])
+                expired))))
+  (define (discard!)
+    (with-locking-mutex (~ pool'mutex)
+      (^[] (hash-table-update! (~ pool'active) key (cut - <> 1) 0)))
+    (condition-variable-signal! (~ pool'cv)))
+
+  (let loop ()
+    (mutex-lock! (~ pool'mutex))
+    (receive (entry expired) (pick!)
+      (if entry
+        (mutex-unlock! (~ pool'mutex))
+        (mutex-unlock! (~ pool'mutex) (~ pool'cv)))
+      (for-each close-pooled-socket expired)
+      (cond [(not entry) (loop)]
+            [(eq? entry 'new)
+             (guard (e [else (discard!) (raise e)])
+               (start-socket-connection conn)
+               (when (~ conn'secure) (start-secure-agent conn)))]
+            [(idle-socket-usable? (cadr entry))
+             (set! (~ conn'socket) (cadr entry))
+             (set! (~ conn'secure-agent) (caddr entry))]
+            [else (close-pooled-socket entry) (discard!) (loop)]))))
+
+;; Takes the socket off CONN and either returns it to POOL or closes it.
+;; Once POOL is closed, sockets are always closed.
+(define (pool-release! pool conn key reuse?)
+  (let1 entry (list (sys-time) (~ conn'socket) (~ conn'secure-agent))
+    (set! (~ conn'socket) #f)
+    (set! (~ conn'secure-agent) #f)
+    (unless (and reuse? (cadr entry)
+                 (with-locking-mutex (~ pool'mutex)
+                   (^[] (and (not (~ pool'closed))
+                             (begin (hash-table-push! (~ pool'idle) key entry)
+                                    #t)))))
+      (when (cadr entry) (close-pooled-socket entry))
+      (with-locking-mutex (~ pool'mutex)
+        (^[] (hash-table-update! (~ pool'active) key (cut - <> 1) 0))))
+    (condition-variable-signal! (~ pool'cv))))
 
 ;; canonicalize uri for the sake of redirection.
 ;; URI is a request-uri given to the API, or the redirect location specified
@@ -736,16 +1004,36 @@
   (flush out))
 
 ;; receive
+;; Returns status code, headers, and http version of the reply.
 (define (receive-header remote)
-  (receive (code reason) (parse-status-line (read-line remote))
-    (values code (rfc822-header->list remote))))
+  (receive (code reason version) (parse-status-line (read-line remote))
+    (values code (rfc822-header->list remote) version)))
 
 (define (parse-status-line line)
   (cond [(eof-object? line)
          (error <http-error> "http reply contains no data")]
-        [(#/\w+\s+(\d\d\d)\s+(.*)/ line) => (^m (values (m 1) (m 2)))]
+        [(#/\w+\s+(\d\d\d)\s+(.*)/ line)
+         => (^m (values (m 1) (m 2)
+                        (cond [(#/^HTTP\/(\S+)/ line) => (cut <> 1)]
+                              [else #f])))]
         [else (error <http-error> "bad reply from server" line)]))
 
+(define (reply-has-body? method code)
+  (and (not (eq? method 'HEAD))
+       (not (member code '("204" "304")))))
+
+;; Whether the socket can be used for the next request after reading
+;; the reply.  The body must be delimited by content-length or chunked
+;; encoding; otherwise it extends to the connection close.
+(define (keep-alive-reply? method code headers version)
+  (and (equal? version "1.1")
+       (not (and-let* ([c (rfc822-header-ref headers "connection")])
+              (#/(?i:\bclose\b)/ c)))
+       (or (not (reply-has-body? method code))
+           (assoc "content-length" headers)
+           (equal? (rfc822-header-ref headers "transfer-encoding") "chunked"))
+       #t))
+
 (define (receive-body remote code headers receiver)
   (let1 total (and-let* ([p (assoc "content-length" headers)])
                 (x->integer (cadr p)))
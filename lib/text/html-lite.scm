@@ -34,22 +34,31 @@
 (define-module text.html-lite
   (use text.tree)
   (use srfi-1)
-  (export html-escape html-escape-string html-doctype)
+  (export html-escape html-escape-string write-html-escaped html-doctype)
   )
 (select-module text.html-lite)
 
 ;; Escaping ---------------------------------------------
+(define %html-escape (with-module gauche.internal %html-escape))
+
+;; Escaping is bytewise, so reading blocks is safe even if a block
+;; boundary splits a multibyte character.
 (define (html-escape)
-  (generator-for-each (^c (case c
-                            [(#\<) (display "&lt;")]
-                            [(#\>) (display "&gt;")]
-                            [(#\&) (display "&amp;")]
-                            [(#\") (display "&quot;")]
-                            [else (display c)]))
-                      read-char))
+  (let ([in (current-input-port)]
+        [out (current-output-port)])
+    (let loop ()
+      (let1 s (read-block 4096 in)
+        (unless (eof-object? s)
+          (%html-escape s out)
+          (loop))))))
 
 (define (html-escape-string string)
-  (with-string-io (x->string string) html-escape))
+  (%html-escape (x->string string) #f))
+
+;; Writes the display representation of OBJ, escaped, without creating
+;; an intermediate string when OBJ is a string.
+(define (write-html-escaped obj :optional (port (current-output-port)))
+  (%html-escape (if (string? obj) obj (x->string obj)) port))
 
 ;; Doctype ----------------------------------------------
 
@@ -106,8 +115,9 @@
                     (get-attr (cddr args) (list* (car args) " " attrs)))
                    (else
                     (get-attr (cddr args)
-                              (list* (format #f "=\"~a\""
-                                             (html-escape-string (x->string (cadr args))))
+                              (list* (list "=\""
+                                           (html-escape-string (cadr args))
+                                           "\"")
                                      (car args)
                                      " "
                                      attrs)))))
@@ -13,11 +13,16 @@
 (define-method write-tree (tree)
   (write-tree tree (current-output-port)))
 
+;; Lists, strings and characters are handled in C without dispatching.
+;; Other objects in the tree go through write-tree, so methods for
+;; user-defined node classes are still honored.
+(define %write-tree (with-module gauche.internal %write-tree))
+
 (define-method write-tree ((tree <list>) out)
-  (let loop ((tree tree))
-    (cond ((null? tree))
-          ((pair? tree) (write-tree (car tree) out) (loop (cdr tree)))
-          (else (write-tree tree out)))))
+  (%write-tree tree out write-tree))
+
+(define-method write-tree ((tree <string>) out)
+  (%write-tree tree out write-tree))
 
 (define-method write-tree ((tree <top>) out)
   (display tree out))
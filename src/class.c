@@ -3268,6 +3268,9 @@ void Scm__InitClass(void)
     CINIT(SCM_CLASS_F32VECTOR,        "<f32vector>");
     CINIT(SCM_CLASS_F64VECTOR,        "<f64vector>");
 
+    /* vm.c */
+    CINIT(SCM_CLASS_COROUTINE,        "<coroutine>");
+
     /* weak.c */
     CINIT(SCM_CLASS_WEAK_VECTOR,      "<weak-vector>");
     CINIT(SCM_CLASS_WEAK_HASH_TABLE,  "<weak-hash-table>");
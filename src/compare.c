@@ -211,7 +211,7 @@ static void sort_q(ScmObj *elts, int lo, int hi, int depth, int limit,
 
 static int cmp_scm(ScmObj x, ScmObj y, ScmObj fn)
 {
-    ScmObj r = Scm_ApplyRec(fn, SCM_LIST2(x, y));
+    ScmObj r = Scm_ApplyRec2(fn, x, y);
     if (SCM_TRUEP(r) || (SCM_INTP(r) && SCM_INT_VALUE(r) < 0))
         return -1;
     else
@@ -236,18 +236,212 @@ void Scm_SortArray(ScmObj *elts, int nelts, ScmObj cmpfn)
     }
 }
 
+/*
+ * Stable sort
+ *
+ * We use a natural merge sort.  First we scan the input for runs, that
+ * is, already ascending or strictly descending (which we reverse in
+ * place) sequences, and extend short runs to a minimum length by binary
+ * insertion sort.  Then adjacent runs are merged, keeping the lengths
+ * of pending runs balanced in the way TimSort does.  For the inputs that
+ * are partially sorted, which are common in practice, it takes much
+ * fewer comparisons than n log n.
+ *
+ * The same caveat for the callback to Scheme comparison function holds
+ * as Scm_SortArray, but we can avoid converting vectors to lists and
+ * back, as we used to do in the Scheme version.
+ */
+
+typedef int (*sort_cmp)(ScmObj, ScmObj, ScmObj);
+
+#define MAX_PENDING_RUNS 64     /* enough for 2^31 elements */
+
+/* Sort elts[lo..hi) by binary insertion, given elts[lo..start) is
+   already sorted. */
+static void sort_binsert(ScmObj *elts, int lo, int start, int hi,
+                         sort_cmp cmp, ScmObj data)
+{
+    for (; start < hi; start++) {
+        ScmObj pivot = elts[start];
+        int l = lo, r = start;
+        while (l < r) {
+            int m = l + (r-l)/2;
+            if (cmp(pivot, elts[m], data) < 0) r = m;
+            else l = m+1;
+        }
+        memmove(elts+l+1, elts+l, (start-l)*sizeof(ScmObj));
+        elts[l] = pivot;
+    }
+}
+
+/* Returns the length of the run beginning at lo.  If the run is
+   strictly descending, it is reversed.  (We can't reverse a
+   non-strictly descending run, for it breaks stability.) */
+static int sort_count_run(ScmObj *elts, int lo, int hi,
+                          sort_cmp cmp, ScmObj data)
+{
+    int r = lo+1;
+    if (r == hi) return 1;
+    if (cmp(elts[r], elts[lo], data) < 0) {
+        for (r++; r < hi && cmp(elts[r], elts[r-1], data) < 0; r++)
+            ;
+        for (int i = lo, j = r-1; i < j; i++, j--) {
+            ScmObj tmp = elts[i]; elts[i] = elts[j]; elts[j] = tmp;
+        }
+    } else {
+        for (r++; r < hi && !(cmp(elts[r], elts[r-1], data) < 0); r++)
+            ;
+    }
+    return r - lo;
+}
+
+/* Merge sorted elts[lo..mid) and elts[mid..hi).  Tmp must have room
+   for the shorter one of the two runs. */
+static void sort_merge(ScmObj *elts, int lo, int mid, int hi, ScmObj *tmp,
+                       sort_cmp cmp, ScmObj data)
+{
+    if (lo == mid || mid == hi) return;
+    /* Already in order?  This makes presorted input cheap. */
+    if (!(cmp(elts[mid], elts[mid-1], data) < 0)) return;
+    /* Elements in the left run that are not greater than elts[mid], and
+       the ones in the right run that are not less than elts[mid-1],
+       are already in place. */
+    int l = lo, r = mid;
+    while (l < r) {
+        int m = l + (r-l)/2;
+        if (cmp(elts[mid], elts[m], data) < 0) r = m;
+        else l = m+1;
+    }
+    lo = l;
+    l = mid; r = hi;
+    while (l < r) {
+        int m = l + (r-l)/2;
+        if (cmp(elts[m], elts[mid-1], data) < 0) l = m+1;
+        else r = m;
+    }
+    hi = l;
+
+    if (mid - lo <= hi - mid) {
+        /* copy the left run and merge forward */
+        int n1 = mid - lo, i = 0, j = mid, k = lo;
+        memcpy(tmp, elts+lo, n1*sizeof(ScmObj));
+        while (i < n1 && j < hi) {
+            if (cmp(elts[j], tmp[i], data) < 0) elts[k++] = elts[j++];
+            else                                elts[k++] = tmp[i++];
+        }
+        while (i < n1) elts[k++] = tmp[i++];
+    } else {
+        /* copy the right run and merge backward */
+        int n2 = hi - mid, i = mid-1, j = n2-1, k = hi-1;
+        memcpy(tmp, elts+mid, n2*sizeof(ScmObj));
+        while (i >= lo && j >= 0) {
+            if (cmp(tmp[j], elts[i], data) < 0) elts[k--] = elts[i--];
+            else                                elts[k--] = tmp[j--];
+        }
+        while (j >= 0) elts[k--] = tmp[j--];
+    }
+}
+
+/* Minimum run length; a number between 16 and 32 such that
+   n/minrun is, or is slightly less than, a power of 2. */
+static int sort_min_run(int n)
+{
+    int r = 0;
+    while (n >= 32) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+static void sort_stable(ScmObj *elts, int nelts, sort_cmp cmp, ScmObj data)
+{
+    int base[MAX_PENDING_RUNS], len[MAX_PENDING_RUNS], nruns = 0;
+    int minrun = sort_min_run(nelts);
+    ScmObj *tmp = SCM_NEW_ARRAY(ScmObj, nelts/2+1);
+
+#define MERGE_AT(k)                                                         \
+    do {                                                                    \
+        sort_merge(elts, base[k], base[k+1], base[k+1]+len[k+1], tmp,       \
+                   cmp, data);                                              \
+        len[k] += len[k+1];                                                 \
+        if ((k) == nruns-3) {                                               \
+            base[k+1] = base[k+2]; len[k+1] = len[k+2];                     \
+        }                                                                   \
+        nruns--;                                                            \
+    } while (0)
+
+    for (int lo = 0; lo < nelts;) {
+        int n = sort_count_run(elts, lo, nelts, cmp, data);
+        if (n < minrun) {
+            int force = (nelts - lo < minrun)? nelts - lo : minrun;
+            sort_binsert(elts, lo, lo+n, lo+force, cmp, data);
+            n = force;
+        }
+        base[nruns] = lo;
+        len[nruns] = n;
+        nruns++;
+        lo += n;
+
+        /* Keep the invariants of pending run lengths, so that we always
+           merge runs of similar length. */
+        while (nruns > 1) {
+            int k = nruns-2;
+            if ((k > 0 && len[k-1] <= len[k] + len[k+1])
+                || (k > 1 && len[k-2] <= len[k-1] + len[k])) {
+                if (len[k-1] < len[k+1]) k--;
+            } else if (len[k] > len[k+1]) {
+                break;
+            }
+            MERGE_AT(k);
+        }
+    }
+    while (nruns > 1) {
+        int k = nruns-2;
+        if (k > 0 && len[k-1] < len[k+1]) k--;
+        MERGE_AT(k);
+    }
+#undef MERGE_AT
+}
+
+void Scm_StableSortArray(ScmObj *elts, int nelts, ScmObj cmpfn)
+{
+    if (nelts <= 1) return;
+    if (SCM_PROCEDUREP(cmpfn)) {
+        sort_stable(elts, nelts, cmp_scm, cmpfn);
+    } else {
+        sort_stable(elts, nelts, cmp_int, NULL);
+    }
+}
+
+/* Merge two sorted subarrays elts[0..mid) and elts[mid..nelts) stably.
+   This allows the callers to sort parts of an array separately, e.g.
+   in parallel, and then combine them. */
+void Scm_MergeArray(ScmObj *elts, int mid, int nelts, ScmObj cmpfn)
+{
+    if (mid <= 0 || mid >= nelts) return;
+    ScmObj *tmp = SCM_NEW_ARRAY(ScmObj, (mid < nelts-mid)? mid : nelts-mid);
+    if (SCM_PROCEDUREP(cmpfn)) {
+        sort_merge(elts, 0, mid, nelts, tmp, cmp_scm, cmpfn);
+    } else {
+        sort_merge(elts, 0, mid, nelts, tmp, cmp_int, NULL);
+    }
+}
+
 /*
  * higher-level fns
  */
 
 #define STATIC_SIZE 32
 
-static ScmObj sort_list_int(ScmObj objs, ScmObj fn, int destructive)
+static ScmObj sort_list_int(ScmObj objs, ScmObj fn, int destructive,
+                            int stable)
 {
     ScmObj starray[STATIC_SIZE];
     int len = STATIC_SIZE;
     ScmObj *array = Scm_ListToArray(objs, &len, starray, TRUE);
-    Scm_SortArray(array, len, fn);
+    if (stable) Scm_StableSortArray(array, len, fn);
+    else        Scm_SortArray(array, len, fn);
     if (destructive) {
         ScmObj cp = objs;
         for (int i=0; i<len; i++, cp = SCM_CDR(cp)) {
@@ -261,12 +455,22 @@ static ScmObj sort_list_int(ScmObj objs, ScmObj fn, int destructive)
 
 ScmObj Scm_SortList(ScmObj objs, ScmObj fn)
 {
-    return sort_list_int(objs, fn, FALSE);
+    return sort_list_int(objs, fn, FALSE, FALSE);
 }
 
 ScmObj Scm_SortListX(ScmObj objs, ScmObj fn)
 {
-    return sort_list_int(objs, fn, TRUE);
+    return sort_list_int(objs, fn, TRUE, FALSE);
+}
+
+ScmObj Scm_StableSortList(ScmObj objs, ScmObj fn)
+{
+    return sort_list_int(objs, fn, FALSE, TRUE);
+}
+
+ScmObj Scm_StableSortListX(ScmObj objs, ScmObj fn)
+{
+    return sort_list_int(objs, fn, TRUE, TRUE);
 }
 
 /*
@@ -1467,6 +1467,12 @@
            (call-syntax-handler gval program cenv)]
           [(inline)
            (pass1/expand-inliner id gval)]
+          [(inline-export)
+           (if (argcount-ok? (cdr program) (slot-ref gval 'required)
+                             (slot-ref gval 'optional))
+             (begin (%record-inline-dependent! id (cenv-module cenv))
+                    (pass1/expand-inliner id gval))
+             (pass1/call program ($gref id) (cdr program) cenv))]
           )
         (pass1/call program ($gref id) (cdr program) cenv))))
 
@@ -1743,6 +1749,7 @@
 (define eager.  (global-id 'eager))
 (define values. (global-id 'values))
 (define begin.  (global-id 'begin))
+(define error.  (global-id 'error))
 
 ;; Definitions ........................................
 
@@ -1786,12 +1793,54 @@
                    oform flags extended? module cenv)]
     [(_ name expr)
      (unless (variable? name) (error "syntax-error:" oform))
-     (let1 cenv (cenv-add-name cenv (variable-name name))
-       ($define oform flags
-                (make-identifier (unwrap-syntax name) module '())
-                (pass1 expr cenv)))]
+     (let* ([sym (unwrap-syntax name)]
+            [iform (pass1 expr (cenv-add-name cenv (variable-name name)))])
+       (pass1/check-inline-dependents module sym)
+       (when (vm-compiler-flag-is-set? SCM_COMPILE_INLINE_EXPORTS)
+         (pass1/mark-exported-inlinable! sym expr iform module))
+       ($define oform flags (make-identifier sym module '()) iform))]
     [_ (error "syntax-error:" oform)]))
 
+;; Cross-module inlining.
+;;   If SCM_COMPILE_INLINE_EXPORTS is set, a small procedure defined by
+;;   plain define and exported from its module gets its packed IForm,
+;;   as define-inline does, but its binding stays an ordinary one.
+;;   Calls from other modules compiled with the flag are inlined (see
+;;   global-call-type), and the calling module is recorded as
+;;   a dependent of the binding.  When the binding is redefined, the
+;;   record is dropped and we warn that the dependents still have the
+;;   old code; gauche.reload reloads them.
+(define (pass1/mark-exported-inlinable! name expr iform module)
+  (when (and (has-tag? iform $LAMBDA)
+             (%exported-binding? module name)
+             (< (iform-count-size-upto iform SMALL_LAMBDA_SIZE)
+                SMALL_LAMBDA_SIZE)
+             ;; Inlining recursive procedure would never end.
+             (not (sexp-refers-to? expr name)))
+    ($lambda-flag-set! iform (pack-iform iform))))
+
+(define (pass1/check-inline-dependents module name)
+  (let1 deps (%forget-inline-dependents! module name)
+    (unless (null? deps)
+      (warn "redefining ~s::~s, which has been inlined into ~s.  \
+             They need to be reloaded to see the change.\n"
+            (module-name module) name (map module-name deps)))))
+
+;; Once a binding is set!, inlining its value is no longer valid,
+;; whether the set! comes from the defining module or elsewhere.
+(define (pass1/check-inline-assignment id)
+  (let1 deps (%forget-inline-export! id)
+    (unless (null? deps)
+      (warn "assigning to ~s, which has been inlined into ~s.  \
+             They need to be reloaded to see the change.\n"
+            (identifier-name id) (map module-name deps)))))
+
+(define (sexp-refers-to? sexp name)
+  (let loop ([x sexp])
+    (cond [(pair? x) (or (loop (car x)) (loop (cdr x)))]
+          [(variable? x) (eq? (unwrap-syntax x) name)]
+          [else #f])))
+
 ;; Inlinable procedure.
 ;;   Inlinable procedure has both properties of a macro and a procedure.
 ;;   It is a bit tricky since the inliner information has to exist
@@ -2629,7 +2678,9 @@
            [val (pass1 expr cenv)])
        (if (lvar? var)
          ($lset var val)
-         ($gset (ensure-identifier var cenv) val)))]
+         (let1 id (ensure-identifier var cenv)
+           (pass1/check-inline-assignment id)
+           ($gset id val))))]
     [_ (error "syntax-error: malformed set!:" form)]))
 
 ;; Begin .....................................................
@@ -3681,7 +3732,7 @@
              [iform. (pass3/rec (reset-lvars iform) label-dic)])
         (if (label-dic-info label-dic)
           (loop iform. (+ count 1))
-          iform.)))))
+          (pass3/infer-numeric-types iform.))))))
 
 (define (pass3-dump iform count)
   (format #t "~78,,,'=a\n" #`"pass3 #,count ")
@@ -4011,6 +4062,378 @@
 ;; Dispatch table.
 (define *pass3-dispatch-table* (generate-dispatch-table pass3))
 
+;;--------------------------------------------------------------
+;; Numeric type inference
+;;
+;;   After the above optimizations settle, we infer the types of
+;;   numeric values with a simple forward analysis, and replace generic
+;;   arithmetic and comparison instructions with the specialized ones
+;;   (FXADD2, FLADD2, FXLT2, ...) when the types of operands are proven.
+;;
+;;   A type is one of the following:
+;;
+;;     flonum     - a flonum.
+;;     (lo . hi)  - a fixnum between the bounds.
+;;     #f         - unknown.
+;;
+;;   The range of fixnum depends on the platform, and the compiled code
+;;   may be run on other platforms.  So a bound is either an integer
+;;   that fits in 30 bits, which is a fixnum everywhere, or relative to
+;;   the limits: (max . k) with k <= 0 means (greatest-fixnum)+k, and
+;;   (min . k) with k >= 0 means (least-fixnum)+k.  We only emit FXADD2
+;;   etc. when the bounds of the result are proven, so they can skip
+;;   overflow check.
+;;
+;;   Types come from constants, operations whose result type is known,
+;;   the initial values of $LET-bound variables, and guards in $IF tests
+;;   such as (fixnum? x) or (< x y).  For a loop (an embedded local
+;;   function reentered by jump calls), we iterate over its body until
+;;   the types of its parameters reach a fixed point, widening the bounds
+;;   that change so that it converges quickly.
+;;
+;;   Only the lvars that are never set! are typed.  The refinements by
+;;   guards depend on the path, so they are dropped when we enter a shared
+;;   $LABEL node or a closure body; ENV has the refinements, and BASE
+;;   doesn't.  CTX is #(rewrite? jumps labels fuel), where JUMPS is an
+;;   alist of an embedding $CALL node and the types of arguments of jump
+;;   calls to it, and LABELS is an alist of visited $LABEL nodes and their
+;;   types.
+;;
+;;   An inner loop iterates to its fixed point on each iteration of
+;;   the outer loop, so the work grows exponentially with the nesting
+;;   depth.  FUEL limits the number of passes over loop bodies for
+;;   a toplevel form; once it runs out, the remaining loops are run
+;;   just once with their parameters untyped.
+
+(define-constant .fx-safe-min. (- (expt 2 29)))
+(define-constant .fx-safe-max. (- (expt 2 29) 1))
+(define-constant .fx-any. '((min . 0) . (max . 0)))
+(define-constant .infer-loop-fuel. 200)
+
+(define (pass3/infer-numeric-types iform)
+  (pass3/infer iform '() '() (vector #t '() '() .infer-loop-fuel.))
+  iform)
+
+;; Bound arithmetic.  Returns #f if the result can't be bounded.
+(define (fxb+ a b)
+  (cond [(and (integer? a) (integer? b))
+         (let1 s (+ a b) (and (<= .fx-safe-min. s .fx-safe-max.) s))]
+        [(integer? a) (fxb+ b a)]
+        [(integer? b) (let1 k (+ (cdr a) b)
+                        (and (if (eq? (car a) 'max) (<= k 0) (>= k 0))
+                             (cons (car a) k)))]
+        [else #f]))
+
+(define (fxb-negate a)
+  (cond [(integer? a) (and (<= .fx-safe-min. (- a) .fx-safe-max.) (- a))]
+        [(eq? (car a) 'max) (cons 'min (- 1 (cdr a)))]
+        [(>= (cdr a) 1) (cons 'max (- 1 (cdr a)))]
+        [else #f]))
+
+;; Returns #t iff a <= b is proven.
+(define (fxb<=? a b)
+  (cond [(integer? a)
+         (cond [(integer? b) (<= a b)]
+               [(eq? (car b) 'max) (<= a (+ .fx-safe-max. (cdr b)))]
+               [else #f])]
+        [(eq? (car a) 'min)
+         (cond [(integer? b) (<= (+ .fx-safe-min. (cdr a)) b)]
+               [(eq? (car b) 'min) (<= (cdr a) (cdr b))]
+               [else (<= (- (cdr a) (cdr b)) (+ (* 2 .fx-safe-max.) 1))])]
+        [else (and (pair? b) (eq? (car b) 'max) (<= (cdr a) (cdr b)))]))
+
+;; Meet and join of bounds.  If we can't order them, any of them is
+;; a valid bound for the meet, and the limit is for the join.
+(define (fxb-min a b) (if (fxb<=? b a) b a))
+(define (fxb-max a b) (if (fxb<=? a b) b a))
+(define (fxb-min/join a b)
+  (cond [(fxb<=? a b) a] [(fxb<=? b a) b] [else '(min . 0)]))
+(define (fxb-max/join a b)
+  (cond [(fxb<=? a b) b] [(fxb<=? b a) a] [else '(max . 0)]))
+
+;; Type operations
+(define (fxtype? t) (pair? t))
+
+(define (fxtype-add a b)
+  (and-let* ([lo (fxb+ (car a) (car b))]
+             [hi (fxb+ (cdr a) (cdr b))])
+    (cons lo hi)))
+
+(define (fxtype-negate a)
+  (and-let* ([lo (fxb-negate (cdr a))]
+             [hi (fxb-negate (car a))])
+    (cons lo hi)))
+
+(define (fxtype-sub a b)
+  (and-let* ([nb (fxtype-negate b)]) (fxtype-add a nb)))
+
+(define (fxtype-mul a b)
+  (and (every integer? (list (car a) (cdr a) (car b) (cdr b)))
+       (let1 ps (list (* (car a) (car b)) (* (car a) (cdr b))
+                      (* (cdr a) (car b)) (* (cdr a) (cdr b)))
+         (and (every (^p (<= .fx-safe-min. p .fx-safe-max.)) ps)
+              (cons (apply min ps) (apply max ps))))))
+
+(define (type-join a b)
+  (cond [(equal? a b) a]
+        [(and (fxtype? a) (fxtype? b))
+         (cons (fxb-min/join (car a) (car b)) (fxb-max/join (cdr a) (cdr b)))]
+        [else #f]))
+
+;; Used in the loop iteration; a bound that has changed goes to the limit.
+(define (type-widen old new)
+  (if (and (fxtype? old) (fxtype? new))
+    (cons (if (equal? (car old) (car new)) (car new) '(min . 0))
+          (if (equal? (cdr old) (cdr new)) (cdr new) '(max . 0)))
+    new))
+
+(define (const-type val)
+  (cond [(and (exact-integer? val) (<= .fx-safe-min. val .fx-safe-max.))
+         (cons val val)]
+        [(flonum? val) 'flonum]
+        [else #f]))
+
+(define (lvar-type lvar env)
+  (and (lvar-immutable? lvar)
+       (cond [(assq lvar env) => cdr] [else #f])))
+
+;; Returns the type of IFORM without traversing it deeply.  Used to
+;; see the operands of a guard.
+(define (pass3/peek-type iform env)
+  (cond [($lref? iform) (lvar-type ($lref-lvar iform) env)]
+        [($const? iform) (const-type ($const-value iform))]
+        [(has-tag? iform $ASM)
+         (receive (t _) (pass3/asm-type (car ($asm-insn iform))
+                                        (imap (cut pass3/peek-type <> env)
+                                              ($asm-args iform)))
+           t)]
+        [else #f]))
+
+;; Given an instruction code and the types of its operands, returns
+;; the result type and the specialized instruction code (or #f).
+(define (pass3/asm-type code types)
+  (define (arg2 fx fx-insn fl-insn mixed?)
+    (let ([a (car types)] [b (cadr types)])
+      (cond [(and (fxtype? a) (fxtype? b))
+             (let1 t (and fx (fx a b)) (values t (and t fx-insn)))]
+            [(and (eq? a 'flonum) (eq? b 'flonum)) (values 'flonum fl-insn)]
+            [(and mixed? (or (eq? a 'flonum) (eq? b 'flonum))
+                  (or (fxtype? a) (fxtype? b)))
+             (values 'flonum #f)]
+            [else (values #f #f)])))
+  (define (inexact-arg2 fl-insn)
+    (let ([a (car types)] [b (cadr types)])
+      (cond [(and (eq? a 'flonum) (eq? b 'flonum)) (values 'flonum fl-insn)]
+            [(and a b) (values 'flonum #f)]
+            [else (values #f #f)])))
+  (define (compare fx-insn)
+    (if (and (fxtype? (car types)) (fxtype? (cadr types)))
+      (values #f fx-insn)
+      (values #f #f)))
+  (case/unquote
+   code
+   [(NUMADD2 FXADD2) (arg2 fxtype-add FXADD2 FLADD2 #t)]
+   [(NUMSUB2 FXSUB2) (arg2 fxtype-sub FXSUB2 FLSUB2 #t)]
+   [(NUMMUL2) (arg2 fxtype-mul #f FLMUL2 #f)]
+   [(NUMDIV2) (arg2 #f #f FLDIV2 #f)]
+   [(NUMIADD2) (inexact-arg2 FLADD2)]
+   [(NUMISUB2) (inexact-arg2 FLSUB2)]
+   [(NUMIMUL2) (inexact-arg2 FLMUL2)]
+   [(NUMIDIV2) (inexact-arg2 FLDIV2)]
+   [(FLADD2 FLSUB2 FLMUL2 FLDIV2) (values 'flonum #f)]
+   [(NEGATE) (let1 a (car types)
+               (cond [(fxtype? a) (values (fxtype-negate a) #f)]
+                     [(eq? a 'flonum) (values 'flonum #f)]
+                     [else (values #f #f)]))]
+   [(NUMEQ2 FXEQ2) (compare FXEQ2)]
+   [(NUMLT2 FXLT2) (compare FXLT2)]
+   [(NUMLE2 FXLE2) (compare FXLE2)]
+   [(NUMGT2 FXGT2) (compare FXGT2)]
+   [(NUMGE2 FXGE2) (compare FXGE2)]
+   [(VEC-LEN LENGTH) (values '(0 . (max . 0)) #f)]
+   [else (values #f #f)]))
+
+;; Returns two envs, for then and else branches of $IF whose test
+;; is TEST.
+(define (pass3/refine-env test env)
+  (define (typable-lref? x)
+    (and ($lref? x) (lvar-immutable? ($lref-lvar x))))
+  (define (refine x t env)
+    (if (and t (typable-lref? x)) (acons ($lref-lvar x) t env) env))
+  ;; x < y (or x <= y if le?)
+  (define (refine-lt x y le? env)
+    (let ([tx (pass3/peek-type x env)] [ty (pass3/peek-type y env)])
+      (if (and (fxtype? tx) (fxtype? ty))
+        (let ([xh (if le? (cdr ty) (fxb+ (cdr ty) -1))]
+              [yl (if le? (car tx) (fxb+ (car tx) 1))])
+          (refine x (cons (car tx) (if xh (fxb-min (cdr tx) xh) (cdr tx)))
+                  (refine y (cons (if yl (fxb-max (car ty) yl) (car ty))
+                                  (cdr ty))
+                          env)))
+        env)))
+  (define (refine-eq x y env)
+    (let ([tx (pass3/peek-type x env)] [ty (pass3/peek-type y env)])
+      (if (and (fxtype? tx) (fxtype? ty))
+        (let1 t (cons (fxb-max (car tx) (car ty)) (fxb-min (cdr tx) (cdr ty)))
+          (refine x t (refine y t env)))
+        env)))
+  (cond
+   [(has-tag? test $ASM)
+    (let ([code (car ($asm-insn test))] [args ($asm-args test)])
+      (define (x) (car args))
+      (define (y) (cadr args))
+      (case/unquote
+       code
+       [(NUMLT2 FXLT2)
+        (values (refine-lt (x) (y) #f env) (refine-lt (y) (x) #t env))]
+       [(NUMLE2 FXLE2)
+        (values (refine-lt (x) (y) #t env) (refine-lt (y) (x) #f env))]
+       [(NUMGT2 FXGT2)
+        (values (refine-lt (y) (x) #f env) (refine-lt (x) (y) #t env))]
+       [(NUMGE2 FXGE2)
+        (values (refine-lt (y) (x) #t env) (refine-lt (x) (y) #f env))]
+       [(NUMEQ2 FXEQ2) (values (refine-eq (x) (y) env) env)]
+       [else (values env env)]))]
+   [(and ($call? test)
+         (has-tag? ($call-proc test) $GREF)
+         (pair? ($call-args test))
+         (null? (cdr ($call-args test)))
+         (typable-lref? (car ($call-args test))))
+    (let ([id ($gref-id ($call-proc test))]
+          [x (car ($call-args test))])
+      (case (pass3/find-type-guard id)
+        [(fixnum) (let1 t (pass3/peek-type x env)
+                    (values (refine x (if (fxtype? t) t .fx-any.) env) env))]
+        [(flonum) (values (refine x 'flonum env) env)]
+        [else (values env env)]))]
+   [else (values env env)]))
+
+;; Predicates that tell the type of the argument in the then branch.
+(define *pass3/type-guards*
+  `((,(global-id 'fixnum?) . fixnum)
+    (,(global-id 'flonum?) . flonum)))
+
+(define (pass3/find-type-guard id)
+  (let loop ([tab *pass3/type-guards*])
+    (cond [(null? tab) #f]
+          [(global-identifier=? id (caar tab)) (cdar tab)]
+          [else (loop (cdr tab))])))
+
+(define-inline (infer-ctx-rewrite? ctx) (vector-ref ctx 0))
+(define-inline (infer-ctx-jumps ctx) (vector-ref ctx 1))
+(define-inline (infer-ctx-labels ctx) (vector-ref ctx 2))
+(define-inline (infer-ctx-fuel ctx) (vector-ref ctx 3))
+
+(define (pass3/infer* iforms env base ctx)
+  (let loop ([iforms iforms] [t #f])
+    (if (null? iforms)
+      t
+      (loop (cdr iforms) (pass3/infer (car iforms) env base ctx)))))
+
+(define (pass3/infer-args iforms env base ctx)
+  (imap (cut pass3/infer <> env base ctx) iforms))
+
+(define/case (pass3/infer iform env base ctx)
+  (iform-tag iform)
+  [($DEFINE) (pass3/infer ($define-expr iform) env base ctx) #f]
+  [($LREF)   (lvar-type ($lref-lvar iform) env)]
+  [($LSET)   (pass3/infer ($lset-expr iform) env base ctx) #f]
+  [($GREF)   #f]
+  [($GSET)   (pass3/infer ($gset-expr iform) env base ctx) #f]
+  [($CONST)  (const-type ($const-value iform))]
+  [($IF)     (pass3/infer ($if-test iform) env base ctx)
+             (receive (then-env else-env) (pass3/refine-env ($if-test iform) env)
+               (let ([t (pass3/infer ($if-then iform) then-env base ctx)]
+                     [e (pass3/infer ($if-else iform) else-env base ctx)])
+                 (and (not ($it? ($if-then iform)))
+                      (not ($it? ($if-else iform)))
+                      (type-join t e))))]
+  [($LET)    (let1 ts (pass3/infer-args ($let-inits iform) env base ctx)
+               (if (eq? ($let-type iform) 'let)
+                 (let loop ([lvars ($let-lvars iform)] [ts ts]
+                            [env env] [base base])
+                   (cond [(null? lvars)
+                          (pass3/infer ($let-body iform) env base ctx)]
+                         [(car ts)
+                          (loop (cdr lvars) (cdr ts)
+                                (acons (car lvars) (car ts) env)
+                                (acons (car lvars) (car ts) base))]
+                         [else (loop (cdr lvars) (cdr ts) env base)]))
+                 (pass3/infer ($let-body iform) env base ctx)))]
+  [($RECEIVE)(pass3/infer ($receive-expr iform) env base ctx)
+             (pass3/infer ($receive-body iform) env base ctx)]
+  [($LAMBDA) (pass3/infer ($lambda-body iform) base base ctx) #f]
+  [($LABEL)  (cond [(assq iform (infer-ctx-labels ctx)) => cdr]
+                   [else
+                    (vector-set! ctx 2 (acons iform #f (infer-ctx-labels ctx)))
+                    (rlet1 t (pass3/infer ($label-body iform) base base ctx)
+                      (vector-set! ctx 2 (acons iform t
+                                                (infer-ctx-labels ctx))))])]
+  [($SEQ)    (pass3/infer* ($seq-body iform) env base ctx)]
+  [($CALL)   (case ($call-flag iform)
+               [(jump) (pass3/infer-jump iform env base ctx) #f]
+               [(embed) (pass3/infer-loop iform env base ctx)]
+               [else (pass3/infer ($call-proc iform) env base ctx)
+                     (pass3/infer-args ($call-args iform) env base ctx)
+                     #f])]
+  [($ASM)    (let1 ts (pass3/infer-args ($asm-args iform) env base ctx)
+               (receive (t code) (pass3/asm-type (car ($asm-insn iform)) ts)
+                 (when (and code (infer-ctx-rewrite? ctx))
+                   ($asm-insn-set! iform `(,code)))
+                 t))]
+  [($PROMISE)(pass3/infer ($promise-expr iform) env base ctx) #f]
+  [($CONS $APPEND $MEMV $EQ? $EQV?)
+             (pass3/infer ($*-arg0 iform) env base ctx)
+             (pass3/infer ($*-arg1 iform) env base ctx)
+             #f]
+  [($VECTOR $LIST $LIST*) (pass3/infer* ($*-args iform) env base ctx) #f]
+  [($LIST->VECTOR) (pass3/infer ($*-arg0 iform) env base ctx) #f]
+  [else #f])
+
+;; Records the types of the arguments of a jump call.
+(define (pass3/infer-jump iform env base ctx)
+  (let ([ts (pass3/infer-args ($call-args iform) env base ctx)]
+        [embed ($call-proc iform)])
+    (and-let* ([p (assq embed (infer-ctx-jumps ctx))])
+      (set-cdr! p (if (cdr p) (map type-join (cdr p) ts) ts)))))
+
+;; An embedded call.  If it is a loop, iterate over the body until
+;; the parameter types settle.  Then the body is run with the mode of
+;; CTX, that is, rewriting instructions if we're in the final run.
+;; If we run out of fuel, we give up typing the parameters.
+(define (pass3/infer-loop iform env base ctx)
+  (let* ([lam ($call-proc iform)]
+         [lvars ($lambda-lvars lam)]
+         [body (if (has-tag? ($lambda-body lam) $LABEL)
+                 ($label-body ($lambda-body lam))
+                 ($lambda-body lam))]
+         [rewrite? (infer-ctx-rewrite? ctx)]
+         [labels (infer-ctx-labels ctx)])
+    (define (bind ts env)
+      (fold (^[lv t env] (if t (acons lv t env) env)) env lvars ts))
+    ;; Returns the result type and the joined types of jump arguments
+    (define (run ts mode)
+      (vector-set! ctx 3 (- (infer-ctx-fuel ctx) 1))
+      (vector-set! ctx 0 mode)
+      (vector-set! ctx 1 (acons iform #f (infer-ctx-jumps ctx)))
+      (vector-set! ctx 2 labels)
+      (let* ([t (pass3/infer body (bind ts env) (bind ts base) ctx)]
+             [jts (cdr (assq iform (infer-ctx-jumps ctx)))])
+        (vector-set! ctx 0 rewrite?)
+        (vector-set! ctx 1 (alist-delete iform (infer-ctx-jumps ctx) eq?))
+        (values t jts)))
+    (define (give-up ts) (run (map (^_ #f) ts) rewrite?) #f)
+    (let1 ts (pass3/infer-args ($call-args iform) env base ctx)
+      (if (<= (infer-ctx-fuel ctx) 0)
+        (give-up ts)
+        (let loop ([ts ts] [count 0])
+          (receive (_ jts) (run ts #f)
+            (let1 ts. (if jts (map type-widen ts (map type-join ts jts)) ts)
+              (cond [(equal? ts. ts) (receive (t _) (run ts rewrite?) t)]
+                    [(and (< count 5) (> (infer-ctx-fuel ctx) 0))
+                     (loop ts. (+ count 1))]
+                    [else (give-up ts)]))))))))
+
 ;;===============================================================
 ;; Pass 4.  Lambda lifting
 ;;
@@ -4417,6 +4840,11 @@
                         ($*-src test) ccb renv ctx)]
          [(eqv? code NUMEQ2)
           (pass5/if-numeq iform (car args) (cadr args)
+                          BNUMNEI LREF-VAL0-BNUMNE BNUMNE
+                          ($*-src test) ccb renv ctx)]
+         [(eqv? code FXEQ2)
+          (pass5/if-numeq iform (car args) (cadr args)
+                          BFXNEI LREF-VAL0-BFXNE BFXNE
                           ($*-src test) ccb renv ctx)]
          [(eqv? code NUMLE2)
           (pass5/if-numcmp iform (car args) (cadr args)
@@ -4430,6 +4858,18 @@
          [(eqv? code NUMGT2)
           (pass5/if-numcmp iform (car args) (cadr args)
                            BNGT ($*-src test) ccb renv ctx)]
+         [(eqv? code FXLE2)
+          (pass5/if-numcmp iform (car args) (cadr args)
+                           BFXNLE ($*-src test) ccb renv ctx)]
+         [(eqv? code FXLT2)
+          (pass5/if-numcmp iform (car args) (cadr args)
+                           BFXNLT ($*-src test) ccb renv ctx)]
+         [(eqv? code FXGE2)
+          (pass5/if-numcmp iform (car args) (cadr args)
+                           BFXNGE ($*-src test) ccb renv ctx)]
+         [(eqv? code FXGT2)
+          (pass5/if-numcmp iform (car args) (cadr args)
+                           BFXNGT ($*-src test) ccb renv ctx)]
          [else
           (pass5/if-final iform test BF 0 0 ($*-src iform) ccb renv ctx)]
          ))]
@@ -4475,40 +4915,44 @@
                       (imax (pass5/rec y ccb renv 'normal/top) depth)
                       info ccb renv ctx))]))
 
-(define (pass5/if-numeq iform x y info ccb renv ctx)
+(define (pass5/if-numeq iform x y insni lref-insn insn info ccb renv ctx)
   (or (and ($const? x)
            (integer-fits-insn-arg? ($const-value x))
-           (pass5/if-final iform y BNUMNEI ($const-value x)
+           (pass5/if-final iform y insni ($const-value x)
                            0
                            info ccb renv ctx))
       (and ($const? y)
            (integer-fits-insn-arg? ($const-value y))
-           (pass5/if-final iform x BNUMNEI ($const-value y)
+           (pass5/if-final iform x insni ($const-value y)
                            0
                            info ccb renv ctx))
       (and ($lref? x)
            (lvar-immutable? ($lref-lvar x))
-           (pass5/if-final iform #f LREF-VAL0-BNUMNE
+           (pass5/if-final iform #f lref-insn
                            (pass5/if-numcmp-lrefarg x renv)
                            (pass5/rec y ccb renv (normal-context ctx))
                            info ccb renv ctx))
       (and ($lref? y)
            (lvar-immutable? ($lref-lvar y))
-           (pass5/if-final iform #f LREF-VAL0-BNUMNE
+           (pass5/if-final iform #f lref-insn
                            (pass5/if-numcmp-lrefarg y renv)
                            (pass5/rec x ccb renv (normal-context ctx))
                            info ccb renv ctx))
       (let1 depth (imax (pass5/rec x ccb renv (normal-context ctx)) 1)
         (compiled-code-emit-PUSH! ccb)
-        (pass5/if-final iform #f BNUMNE 0
+        (pass5/if-final iform #f insn 0
                         (imax (pass5/rec y ccb renv 'normal/top) depth)
                         info ccb renv ctx))))
 
 (define (pass5/if-numcmp iform x y insn info ccb renv ctx)
   (define .fwd. `((,BNLT . ,LREF-VAL0-BNLT) (,BNLE . ,LREF-VAL0-BNLE)
-                  (,BNGT . ,LREF-VAL0-BNGT) (,BNGE . ,LREF-VAL0-BNGE)))
+                  (,BNGT . ,LREF-VAL0-BNGT) (,BNGE . ,LREF-VAL0-BNGE)
+                  (,BFXNLT . ,LREF-VAL0-BFXNLT) (,BFXNLE . ,LREF-VAL0-BFXNLE)
+                  (,BFXNGT . ,LREF-VAL0-BFXNGT) (,BFXNGE . ,LREF-VAL0-BFXNGE)))
   (define .rev. `((,BNLT . ,LREF-VAL0-BNGT) (,BNLE . ,LREF-VAL0-BNGE)
-                  (,BNGT . ,LREF-VAL0-BNLT) (,BNGE . ,LREF-VAL0-BNLE)))
+                  (,BNGT . ,LREF-VAL0-BNLT) (,BNGE . ,LREF-VAL0-BNLE)
+                  (,BFXNLT . ,LREF-VAL0-BFXNGT) (,BFXNLE . ,LREF-VAL0-BFXNGE)
+                  (,BFXNGT . ,LREF-VAL0-BFXNLT) (,BFXNGE . ,LREF-VAL0-BFXNLE)))
   (or (and ($lref? x)
            (lvar-immutable? ($lref-lvar x))
            (pass5/if-final iform #f (cdr (assv insn .fwd.))
@@ -5085,6 +5529,10 @@
       (pass5/asm-nummul2 info (car args) (cadr args) ccb renv ctx)]
      [(NUMDIV2)
       (pass5/asm-numdiv2 info (car args) (cadr args) ccb renv ctx)]
+     [(FXADD2)
+      (pass5/asm-fxadd2 info (car args) (cadr args) ccb renv ctx)]
+     [(FXSUB2)
+      (pass5/asm-fxsub2 info (car args) (cadr args) ccb renv ctx)]
      [(LOGAND LOGIOR LOGXOR)
       (pass5/asm-bitwise info (car insn) (car args) (cadr args) ccb renv ctx)]
      [(VEC-REF)
@@ -5248,6 +5696,24 @@
            (pass5/builtin-onearg info NUMADDI (- ($const-value y)) x))
       (pass5/builtin-twoargs info NUMSUB2 0 x y)))
 
+(define (pass5/asm-fxadd2 info x y ccb renv ctx)
+  (or (and ($const? x)
+           (integer-fits-insn-arg? ($const-value x))
+           (pass5/builtin-onearg info FXADDI ($const-value x) y))
+      (and ($const? y)
+           (integer-fits-insn-arg? ($const-value y))
+           (pass5/builtin-onearg info FXADDI ($const-value y) x))
+      (pass5/builtin-twoargs info FXADD2 0 x y)))
+
+(define (pass5/asm-fxsub2 info x y ccb renv ctx)
+  (or (and ($const? x)
+           (integer-fits-insn-arg? ($const-value x))
+           (pass5/builtin-onearg info FXSUBI ($const-value x) y))
+      (and ($const? y)
+           (integer-fits-insn-arg? ($const-value y))
+           (pass5/builtin-onearg info FXADDI (- ($const-value y)) x))
+      (pass5/builtin-twoargs info FXSUB2 0 x y)))
+
 (define (pass5/asm-nummul2 info x y ccb renv ctx)
   (pass5/builtin-twoargs info NUMMUL2 0 x y))
 
@@ -5740,6 +6206,113 @@
                       ))))))]
       [_ (undefined)])))
 
+;;--------------------------------------------------------
+;; Inlining list iterators
+;;
+
+;; A call of for-each, map or fold with a literal lambda and a single
+;; list is expanded into a loop:
+;;
+;;   (let ([proc (lambda (x) ...)] [lis LIS])
+;;     (let loop ([xs lis] [acc SEED] ...)
+;;       (cond [(pair? xs) (loop (cdr xs) ... (proc (car xs) acc ...) ...)]
+;;             [(null? xs) (DONE acc ...)]
+;;             [else (error "improper list not allowed:" lis)])))
+;;
+;; PROC is called only from within the loop, so Pass 2 embeds the lambda
+;; body there.  Thus no closure is created, and the environment of the
+;; caller doesn't need to be saved in the heap.  Other calls are left
+;; to the procedures.
+
+;; Returns #t if FORM is a lambda expression that takes exactly NARGS
+;; arguments.
+(define (iterator-lambda? form nargs cenv)
+  (match form
+    [(op (? list? formals) . _)
+     (and (or (global-eq? op 'lambda cenv) (global-eq? op '^ cenv))
+          (= (length formals) nargs)
+          (every variable? formals))]
+    [_ #f]))
+
+;; SEEDS are IForms of the initial values of the accumulators.
+;; STEP is called with a procedure to generate a call of PROC, an IForm
+;; of (car xs), a list of IForms of the accumulators, and a procedure
+;; to generate a loop call with new accumulators.  DONE is called with
+;; the IForms of the accumulators.
+(define (pass1/inline-list-loop form proc seeds lis step done cenv)
+  (let* ([tenv (cenv-sans-name cenv)]
+         [proc-iform (pass1 proc tenv)]
+         [lis-iform (pass1 lis tenv)]
+         [p (make-lvar 'proc)]
+         [l (make-lvar 'lis)]
+         [ss (imap (^[_] (make-lvar 'seed)) seeds)]
+         [loop (make-lvar 'loop)]
+         [xs (make-lvar 'xs)]
+         [accs (imap (^[_] (make-lvar 'acc)) seeds)]
+         [body ($if #f ($asm #f `(,PAIRP) `(,($lref xs)))
+                    (step (^ args ($call form ($lref p) args))
+                          ($asm #f `(,CAR) `(,($lref xs)))
+                          (imap $lref accs)
+                          (^[new-accs]
+                            ($call #f ($lref loop)
+                                   (cons ($asm #f `(,CDR) `(,($lref xs)))
+                                         new-accs))))
+                    ($if #f ($asm #f `(,NULLP) `(,($lref xs)))
+                         (apply done (imap $lref accs))
+                         ($call #f ($gref error.)
+                                `(,($const "improper list not allowed:")
+                                  ,($lref l)))))]
+         [lmda ($lambda form 'loop (+ (length accs) 1) 0 (cons xs accs) body)]
+         [lvars `(,p ,@ss ,l)]
+         [inits `(,proc-iform ,@seeds ,lis-iform)])
+    (ifor-each2 (^[lv in] (lvar-initval-set! lv in)) lvars inits)
+    (lvar-initval-set! loop lmda)
+    ;; The arguments are evaluated in order, as in the call.
+    ($let form 'let lvars inits
+          ($let #f 'rec `(,loop) `(,lmda)
+                ($call #f ($lref loop) `(,($lref l) ,@(imap $lref ss)))))))
+
+(define-builtin-inliner for-each
+  (^[form cenv]
+    (match form
+      [(_ proc lis)
+       (if (iterator-lambda? proc 1 cenv)
+         (pass1/inline-list-loop form proc '() lis
+                                 (^[call x accs recur]
+                                   ($seq `(,(call x) ,(recur '()))))
+                                 (^[] ($const-undef))
+                                 cenv)
+         (undefined))]
+      [_ (undefined)])))
+
+(define-builtin-inliner map
+  (^[form cenv]
+    (match form
+      [(_ proc lis)
+       (if (iterator-lambda? proc 1 cenv)
+         (pass1/inline-list-loop form proc `(,($const-nil)) lis
+                                 (^[call x accs recur]
+                                   (recur `(,($asm #f `(,CONS)
+                                                   `(,(call x) ,(car accs))))))
+                                 (^[r] ($asm #f `(,REVERSE) `(,r)))
+                                 cenv)
+         (undefined))]
+      [_ (undefined)])))
+
+(define-builtin-inliner fold
+  (^[form cenv]
+    (match form
+      [(_ proc knil lis)
+       (if (iterator-lambda? proc 2 cenv)
+         (pass1/inline-list-loop form proc
+                                 `(,(pass1 knil (cenv-sans-name cenv))) lis
+                                 (^[call x accs recur]
+                                   (recur `(,(call x (car accs)))))
+                                 (^[acc] acc)
+                                 cenv)
+         (undefined))]
+      [_ (undefined)])))
+
 ;;--------------------------------------------------------
 ;; Customizable inliner interface
 ;;
@@ -5879,6 +6452,17 @@
                      (not (SCM_VM_COMPILER_FLAG_IS_SET
                            (Scm_VM) SCM_COMPILE_NOINLINE_GLOBALS)))
                 (set! SCM_RESULT0 gval SCM_RESULT1 'inline)]
+               [(and (SCM_PROCEDUREP gval)
+                     (SCM_PROCEDURE_INLINER gval)
+                     (SCM_VECTORP (SCM_PROCEDURE_INLINER gval))
+                     (SCM_VM_COMPILER_FLAG_IS_SET
+                      (Scm_VM) SCM_COMPILE_INLINE_EXPORTS)
+                     (not (SCM_VM_COMPILER_FLAG_IS_SET
+                           (Scm_VM) SCM_COMPILE_NOINLINE_GLOBALS))
+                     (not (SCM_EQ (SCM_OBJ (-> gloc module))
+                                  (SCM_VECTOR_ELEMENT cenv 0))))
+                ;; See pass1/mark-exported-inlinable!
+                (set! SCM_RESULT0 gval SCM_RESULT1 'inline-export)]
                [else (goto normal)])
          (.if "defined(RECORD_DEPENDED_MODULES)"
               (begin
@@ -5897,6 +6481,71 @@
      ))
  )
 
+;; Records of cross-module inlining; see pass1/mark-exported-inlinable!.
+;; The table maps a gloc to the list of modules that inlined its value.
+(inline-stub
+ "static ScmObj inline_dependents = SCM_UNDEFINED;"
+ "static ScmInternalMutex inline_dependents_mutex;"
+
+ (initcode
+  "inline_dependents = Scm_MakeHashTableSimple(SCM_HASH_EQ, 0);"
+  "SCM_INTERNAL_MUTEX_INIT(inline_dependents_mutex);")
+
+ (define-cproc %exported-binding? (module::<module> name::<symbol>)
+   ::<boolean>
+   (result (or (-> module exportAll)
+               (not (SCM_FALSEP (Scm_HashTableRef (-> module external)
+                                                  (SCM_OBJ name)
+                                                  SCM_FALSE))))))
+
+ (define-cproc %record-inline-dependent! (id::<identifier> module::<module>)
+   ::<void>
+   (let* ([g::ScmGloc* (Scm_FindBinding (-> id module) (-> id name) 0)])
+     (when g
+       (SCM_INTERNAL_MUTEX_LOCK inline_dependents_mutex)
+       (let* ([tab::ScmHashTable* (SCM_HASH_TABLE inline_dependents)]
+              [mods (Scm_HashTableRef tab (SCM_OBJ g) SCM_NIL)])
+         (when (SCM_FALSEP (Scm_Memq (SCM_OBJ module) mods))
+           (Scm_HashTableSet tab (SCM_OBJ g) (Scm_Cons (SCM_OBJ module) mods)
+                             0)))
+       (SCM_INTERNAL_MUTEX_UNLOCK inline_dependents_mutex))))
+
+ ;; Drops the record of NAME in MODULE, and returns the modules recorded.
+ ;; Called for every toplevel define, so we return quickly if there's
+ ;; no record at all.
+ (define-cproc %forget-inline-dependents! (module::<module> name::<symbol>)
+   (let* ([tab::ScmHashTable* (SCM_HASH_TABLE inline_dependents)]
+          [r SCM_NIL])
+     (when (> (Scm_HashCoreNumEntries (SCM_HASH_TABLE_CORE tab)) 0)
+       (let* ([g::ScmGloc* (Scm_FindBinding module name
+                                            SCM_BINDING_STAY_IN_MODULE)])
+         (when g
+           (SCM_INTERNAL_MUTEX_LOCK inline_dependents_mutex)
+           (set! r (Scm_HashTableRef tab (SCM_OBJ g) SCM_NIL))
+           (unless (SCM_NULLP r) (Scm_HashTableDelete tab (SCM_OBJ g)))
+           (SCM_INTERNAL_MUTEX_UNLOCK inline_dependents_mutex))))
+     (result r)))
+
+ ;; Called when a set! to the binding of ID is compiled.  The value
+ ;; stops being inlined into other modules, and the record is dropped
+ ;; as %forget-inline-dependents! does.  Bindings by define-inline
+ ;; can't be set!, so we leave them alone.
+ (define-cproc %forget-inline-export! (id::<identifier>)
+   (let* ([g::ScmGloc* (Scm_FindBinding (-> id module) (-> id name) 0)]
+          [r SCM_NIL])
+     (when (and g (not (Scm_GlocInlinableP g)))
+       (let* ([v (SCM_GLOC_GET g)])
+         (when (and (SCM_CLOSUREP v)
+                    (SCM_VECTORP (SCM_PROCEDURE_INLINER v)))
+           (set! (SCM_PROCEDURE_INLINER v) SCM_FALSE)))
+       (SCM_INTERNAL_MUTEX_LOCK inline_dependents_mutex)
+       (let* ([tab::ScmHashTable* (SCM_HASH_TABLE inline_dependents)])
+         (set! r (Scm_HashTableRef tab (SCM_OBJ g) SCM_NIL))
+         (unless (SCM_NULLP r) (Scm_HashTableDelete tab (SCM_OBJ g))))
+       (SCM_INTERNAL_MUTEX_UNLOCK inline_dependents_mutex))
+     (result r)))
+ )
+
 ;; (define (id->bound-gloc id)
 ;;   (and-let* ([gloc (find-binding (identifier-module id) (identifier-name id) #f)]
 ;;              [ (gloc-bound? gloc) ])
@@ -6062,6 +6711,7 @@
  (define-enum SCM_COMPILE_NO_LIFTING)
  (define-enum SCM_COMPILE_INCLUDE_VERBOSE)
  (define-enum SCM_COMPILE_ENABLE_CEXPR)
+ (define-enum SCM_COMPILE_INLINE_EXPORTS)
 
  ;; Set/get VM's current module info. (temporary)
  (define-cproc vm-current-module () (result (SCM_OBJ (-> (Scm_VM) module))))
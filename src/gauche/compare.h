@@ -62,6 +62,11 @@ SCM_EXTERN int    Scm_Compare(ScmObj x, ScmObj y);
 SCM_EXTERN void   Scm_SortArray(ScmObj *elts, int nelts, ScmObj cmpfn);
 SCM_EXTERN ScmObj Scm_SortList(ScmObj objs, ScmObj fn);
 SCM_EXTERN ScmObj Scm_SortListX(ScmObj objs, ScmObj fn);
+SCM_EXTERN void   Scm_StableSortArray(ScmObj *elts, int nelts, ScmObj cmpfn);
+SCM_EXTERN void   Scm_MergeArray(ScmObj *elts, int mid, int nelts,
+                                 ScmObj cmpfn);
+SCM_EXTERN ScmObj Scm_StableSortList(ScmObj objs, ScmObj fn);
+SCM_EXTERN ScmObj Scm_StableSortListX(ScmObj objs, ScmObj fn);
 
 
 SCM_DECL_END
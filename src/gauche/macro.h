@@ -45,6 +45,14 @@ typedef struct ScmSyntaxRuleBranchRec {
     ScmObj templat;             /* template to be expanded */
     int numPvars;               /* # of pattern variables */
     int maxLevel;               /* maximum # of nested subpatterns */
+    /* The following fields describe the shape of the arguments the
+       pattern can match, so that the expander can rule out a branch
+       without running the matcher. */
+    int minArgs;                /* minimum # of arguments */
+    int maxArgs;                /* maximum # of arguments, -1 if unlimited */
+    int properArgs;             /* TRUE if arguments must be a proper list */
+    ScmObj headLiteral;         /* literal identifier the first argument
+                                   must match, or #f */
 } ScmSyntaxRuleBranch;
 
 typedef struct ScmSyntaxRules {
@@ -66,6 +66,11 @@ struct ScmModuleRec {
     ScmObj prefix;              /* if symbol, all bindings in this module
                                    appear to have the prefix.  used in an
                                    anonymous wrapper modules. */
+    void *bindingCache;         /* cache of Scm_FindBinding results.
+                                   private to module.c */
+    u_long bindingEpoch;        /* epoch when the bindings visible from
+                                   this module last changed.
+                                   private to module.c */
 };
 
 #define SCM_MODULE(obj)       ((ScmModule*)(obj))
@@ -318,11 +318,14 @@ SCM_EXTERN ScmObj Scm_PortSeek(ScmPort *port, ScmObj off, int whence);
 SCM_EXTERN ScmObj Scm_PortSeekUnsafe(ScmPort *port, ScmObj off, int whence);
 SCM_EXTERN int    Scm_PortFileNo(ScmPort *port);
 SCM_EXTERN void   Scm_PortFdDup(ScmPort *dst, ScmPort *src);
+SCM_EXTERN ScmObj Scm_PortTakeBuffer(ScmPort *port);
 SCM_EXTERN int    Scm_FdReady(int fd, int dir);
 SCM_EXTERN int    Scm_ByteReady(ScmPort *port);
 SCM_EXTERN int    Scm_ByteReadyUnsafe(ScmPort *port);
 SCM_EXTERN int    Scm_CharReady(ScmPort *port);
 SCM_EXTERN int    Scm_CharReadyUnsafe(ScmPort *port);
+SCM_EXTERN int    Scm_LineReady(ScmPort *port);
+SCM_EXTERN int    Scm_LineReadyUnsafe(ScmPort *port);
 
 SCM_EXTERN void   Scm_ClosePort(ScmPort *port);
 
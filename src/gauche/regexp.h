@@ -48,7 +48,9 @@ struct ScmRegexpRec {
     ScmObj grpNames;     /* list of names for named groups. */
     int numSets;         /* # of charsets in sets */
     int flags;           /* internal; CASE_FOLD, BOL_ANCHORED etc. */
-    ScmString *mustMatch;
+    ScmString *mustMatch;/* Literal string every match begins with, or NULL.
+                            If set, the matcher scans input for it to find
+                            the candidate start positions. */
     ScmObj laset;        /* lookahead set (char-set) or #f.
                             If not #f, it represents the condition that can
                             match at the beginning of the regexp.  It can be
@@ -75,6 +77,28 @@ struct ScmRegMatchRec {
 #define SCM_REG_MATCH_SINGLE_BYTE_P(rm) \
     ((rm)->inputSize == (rm)->inputLen)
 
+/* Iterating over matches without allocating a match object for each.
+   See regexp.c for the details. */
+typedef struct ScmRegMatchIterRec {
+    ScmRegexp *rx;
+    const char *input;          /* beginning of the input */
+    const char *end;            /* end of the input */
+    const char *next;           /* where to search next; NULL if done */
+    const char *counted;        /* for Scm_RegMatchIterCharIndex */
+    int count;
+    ScmRegMatch match;          /* reused for every match */
+} ScmRegMatchIter;
+
+SCM_EXTERN void Scm_RegMatchIterInit(ScmRegMatchIter *iter, ScmRegexp *rx,
+                                     ScmString *str);
+SCM_EXTERN ScmRegMatch *Scm_RegMatchIterNext(ScmRegMatchIter *iter);
+SCM_EXTERN int  Scm_RegMatchIterCharIndex(ScmRegMatchIter *iter,
+                                          const char *p);
+
+SCM_EXTERN int    Scm_RegReplaceAll(ScmRegexp *rx, ScmString *str,
+                                    ScmObj subpat, ScmPort *out);
+SCM_EXTERN ScmObj Scm_RegSplit(ScmRegexp *rx, ScmString *str, int limit);
+
 /* Note: The structure of ScmRegexp is changed on 0.9.1.  Shuold be safe,
    for it should never be statically allocated. */
 
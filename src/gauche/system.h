@@ -265,6 +265,10 @@ typedef struct ScmHeaderRec ScmSysFdset;
 #define SCM_SYS_FDSET_P(obj)    (FALSE)
 #endif /*!HAVE_SELECT*/
 
+/* Waits for a set of fds without the FD_SETSIZE limit if possible.
+   Internal; used by control.fiber. */
+SCM_EXTERN ScmObj Scm__PollFds(ScmObj rfds, ScmObj wfds, ScmObj timeout);
+
 /*==============================================================
  * Miscellaneous
  */
@@ -34,9 +34,18 @@
 #ifndef GAUCHE_VM_H
 #define GAUCHE_VM_H
 
-/* Size of stack per VM (in words). */
+/* Default size of the initial stack segment per VM (in words).
+   When a segment overflows, the VM switches to a larger one.
+   See extend_stack() in vm.c. */
 #define SCM_VM_STACK_SIZE      10000
 
+/* Minimum size of the initial stack segment (in words). */
+#define SCM_VM_MIN_STACK_SIZE  1024
+
+/* A new stack segment is twice as large as the overflowed one, but
+   no larger than this times the initial size. */
+#define SCM_VM_STACK_GROWTH_LIMIT 16
+
 /* Maximum # of values allowed for multiple value return */
 #define SCM_VM_MAX_VALUES      20
 
@@ -275,6 +284,8 @@ typedef struct ScmEscapePointRec {
                                    with-error-handler uses the latter model,
                                    but SRFI-34's guard needs the former model.
                                 */
+    struct ScmCoroutineRec *coroutine; /* coroutine running when this ep
+                                   is created, or NULL. */
 } ScmEscapePoint;
 
 /* Link management */
@@ -295,6 +306,25 @@ typedef struct ScmEscapePointRec {
 #define SCM_VM_ESCAPE_CONT   2
 #define SCM_VM_ESCAPE_EXIT   3
 
+/*
+ * Coroutine
+ *
+ *  A coroutine runs a thunk on its own VM stack segment, and switches
+ *  to/from its resumer without copying frames.  It is used to implement
+ *  generators.  See the "Coroutines" section in vm.c for the details.
+ */
+typedef struct ScmCoroutineRec ScmCoroutine;
+
+SCM_CLASS_DECL(Scm_CoroutineClass);
+#define SCM_CLASS_COROUTINE     (&Scm_CoroutineClass)
+#define SCM_COROUTINE(obj)      ((ScmCoroutine*)(obj))
+#define SCM_COROUTINEP(obj)     SCM_XTYPEP(obj, SCM_CLASS_COROUTINE)
+
+SCM_EXTERN ScmObj Scm_MakeCoroutine(ScmObj thunk);
+SCM_EXTERN int    Scm_CoroutineDoneP(ScmCoroutine *co);
+SCM_EXTERN ScmObj Scm_VMCoroutineResume(ScmCoroutine *co, ScmObj val);
+SCM_EXTERN ScmObj Scm_VMCoroutineYield(ScmCoroutine *co, ScmObj val);
+
 /*
  * Signal queue
  *
@@ -468,9 +498,9 @@ struct ScmVMRec {
     ScmObj handlers;            /* chain of active dynamic handlers          */
 
     ScmObj *sp;                 /* stack pointer */
-    ScmObj *stack;              /* bottom of allocated stack area */
-    ScmObj *stackBase;          /* base of current stack area  */
-    ScmObj *stackEnd;           /* end of current stack area */
+    ScmObj *stack;              /* bottom of the initial stack segment */
+    ScmObj *stackBase;          /* base of current stack segment  */
+    ScmObj *stackEnd;           /* end of current stack segment */
 
 #if GAUCHE_FFX
     ScmFlonum *fpsp;            /* flonum stack pointer.  we call it 'stack'
@@ -516,9 +546,15 @@ struct ScmVMRec {
 #if defined(GAUCHE_USE_WTHREADS)
     ScmWinCleanup *winCleanup; /* mimic pthread_cleanup_* */
 #endif /*defined(GAUCHE_USE_WTHREADS)*/
+
+    /* Stack segments */
+    long stackSize;             /* size of the initial stack segment */
+    ScmCoroutine *coroutine;    /* running coroutine, or NULL */
 };
 
 SCM_EXTERN ScmVM *Scm_NewVM(ScmVM *proto, ScmObj name);
+SCM_EXTERN ScmVM *Scm_NewVMWithStackSize(ScmVM *proto, ScmObj name,
+                                         long stackSize);
 SCM_EXTERN int    Scm_AttachVM(ScmVM *vm);
 SCM_EXTERN void   Scm_DetachVM(ScmVM *vm);
 SCM_EXTERN void   Scm_VMDump(ScmVM *vm);
@@ -678,7 +714,9 @@ enum {
     SCM_COMPILE_NO_LIFTING = (1L<<7),      /* Do not run lambda lifting pass
                                               (pass4). */
     SCM_COMPILE_INCLUDE_VERBOSE = (1L<<8), /* Report expansion of 'include' */
-    SCM_COMPILE_ENABLE_CEXPR = (1L<<9)     /* Support C-expressions by reader */
+    SCM_COMPILE_ENABLE_CEXPR = (1L<<9),    /* Support C-expressions by reader */
+    SCM_COMPILE_INLINE_EXPORTS = (1L<<10)  /* Inline small exported procs
+                                              into other modules */
 };
 
 #define SCM_VM_COMPILER_FLAG_IS_SET(vm, flag) ((vm)->compilerFlags & (flag))
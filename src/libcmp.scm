@@ -89,3 +89,55 @@
         [else (SCM_TYPE_ERROR seq "proper list or vector")
               (result SCM_UNDEFINED)]))
 
+;; Stable versions.  Less? can be #f to use the default compare.
+(define-cproc %stable-sort (seq :optional (less? #f))
+  (cond [(SCM_VECTORP seq)
+         (let* ([r (Scm_VectorCopy (SCM_VECTOR seq) 0 -1 SCM_UNDEFINED)])
+           (Scm_StableSortArray (SCM_VECTOR_ELEMENTS r) (SCM_VECTOR_SIZE r)
+                                less?)
+           (result r))]
+        [(>= (Scm_Length seq) 0) (result (Scm_StableSortList seq less?))]
+        [else (SCM_TYPE_ERROR seq "proper list or vector")
+              (result SCM_UNDEFINED)]))
+
+(define-cproc %stable-sort! (seq :optional (less? #f))
+  (cond [(SCM_VECTORP seq)
+         (Scm_StableSortArray (SCM_VECTOR_ELEMENTS seq) (SCM_VECTOR_SIZE seq)
+                              less?)
+         (result seq)]
+        [(>= (Scm_Length seq) 0) (result (Scm_StableSortListX seq less?))]
+        [else (SCM_TYPE_ERROR seq "proper list or vector")
+              (result SCM_UNDEFINED)]))
+
+;; Operations on a range of a vector, so that a vector can be sorted
+;; piecewise, e.g. by multiple threads.
+(inline-stub
+ (define-cise-stmt check-vector-range
+   [(_ vec start end)
+    `(begin
+       (when (< ,end 0) (set! ,end (SCM_VECTOR_SIZE ,vec)))
+       (unless (and (<= 0 ,start) (<= ,start ,end)
+                    (<= ,end (SCM_VECTOR_SIZE ,vec)))
+         (Scm_Error "invalid range [%d, %d) for a vector of size %d"
+                    ,start ,end (SCM_VECTOR_SIZE ,vec))))])
+ )
+
+(define-cproc %vector-stable-sort-range! (vec::<vector> start::<fixnum>
+                                          end::<fixnum>
+                                          :optional (less? #f))
+  ::<void>
+  (check-vector-range vec start end)
+  (Scm_StableSortArray (+ (SCM_VECTOR_ELEMENTS vec) start) (- end start)
+                       less?))
+
+;; Merge sorted ranges [start, mid) and [mid, end) of vec.
+(define-cproc %vector-merge-range! (vec::<vector> start::<fixnum>
+                                    mid::<fixnum> end::<fixnum>
+                                    :optional (less? #f))
+  ::<void>
+  (check-vector-range vec start end)
+  (unless (and (<= start mid) (<= mid end))
+    (Scm_Error "invalid split point %d for range [%d, %d)" mid start end))
+  (Scm_MergeArray (+ (SCM_VECTOR_ELEMENTS vec) start) (- mid start)
+                  (- end start) less?))
+
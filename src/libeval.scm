@@ -328,6 +328,16 @@
 (select-module gauche)
 (define-cproc %exit (:optional (code::<fixnum> 0)) ::<void> Scm_Exit)
 
+;; THUNK is called by Scm_Cleanup, i.e. when the program exits normally.
+;; Errors raised by THUNK are ignored.
+(select-module gauche.internal)
+(inline-stub
+ (define-cfn call-cleanup-thunk (data::void*) ::void :static
+   (Scm_Apply (SCM_OBJ data) SCM_NIL NULL)))
+
+(define-cproc %add-cleanup-handler (thunk::<procedure>) ::<void>
+  (Scm_AddCleanupHandler call_cleanup_thunk thunk))
+
 ;; exit handler.  we don't want to import the fluff with gauche.parameter,
 ;; so we manually allocate parameter slot.
 (select-module gauche.internal)
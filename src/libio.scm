@@ -466,6 +466,11 @@
 
 (define-cproc byte-ready? (port::<input-port>) ::<boolean> Scm_ByteReady)
 
+(select-module gauche.internal)
+;; Used by control.fiber
+(define-cproc %line-ready? (port::<input-port>) ::<boolean> Scm_LineReady)
+(select-module gauche)
+
 (define-cproc read-byte (:optional (port::<input-port> (current-input-port)))
   (let* ([b::int])
     (SCM_GETB b port)
@@ -624,6 +629,91 @@
 
 (define-cproc flush-all-ports () ::<void> (Scm_FlushAllPorts FALSE))
 
+;;
+;; Text tree writer and HTML escaper, used by text.tree and text.html-lite.
+;; They write directly to the port, without generic function dispatch
+;; and intermediate strings.
+;;
+(select-module gauche.internal)
+
+(inline-stub
+ ;; Strings and characters are written out as they are, and lists are
+ ;; walked.  Other objects are passed to FALLBACK with PORT.
+ (define-cfn write-tree-leaf (obj port::ScmPort* fallback) ::void :static
+   (cond [(SCM_STRINGP obj) (Scm_Puts (SCM_STRING obj) port)]
+         [(SCM_CHARP obj) (Scm_Putc (SCM_CHAR_VALUE obj) port)]
+         [(SCM_NULLP obj)]
+         [else (Scm_ApplyRec2 fallback obj (SCM_OBJ port))]))
+
+ ;; A tree can be nested arbitrarily deep in its cars, so we don't
+ ;; recurse on them; the cdrs to come back to are kept in STACK.
+ ;; Only the nested lists other than the last element of a list
+ ;; need an entry.
+ (define-cfn write-tree-rec (tree port::ScmPort* fallback) ::void :static
+   (let* ([stack SCM_NIL])
+     (loop
+      (while (SCM_PAIRP tree)
+        (let* ([x (SCM_CAR tree)])
+          (cond [(SCM_PAIRP x)
+                 (unless (SCM_NULLP (SCM_CDR tree))
+                   (set! stack (Scm_Cons (SCM_CDR tree) stack)))
+                 (set! tree x)]
+                [else
+                 (write-tree-leaf x port fallback)
+                 (set! tree (SCM_CDR tree))])))
+      (write-tree-leaf tree port fallback)
+      (when (SCM_NULLP stack) (return))
+      (set! tree (SCM_CAR stack))
+      (set! stack (SCM_CDR stack)))))
+
+ ;; The characters to be escaped are all ASCII, and none of the supported
+ ;; encodings uses those bytes inside a multibyte character, so we can
+ ;; scan the string bytewise.
+ (define-cfn html-entity (c::char) ::(const char*) :static
+   (case c
+     [(#\<) (return "&lt;")]
+     [(#\>) (return "&gt;")]
+     [(#\&) (return "&amp;")]
+     [(#\") (return "&quot;")]
+     [else (return NULL)]))
+
+ (define-cfn html-escape-needed? (b::(const ScmStringBody*)) ::int :static
+   (let* ([p::(const char*) (SCM_STRING_BODY_START b)]
+          [e::(const char*) (+ p (SCM_STRING_BODY_SIZE b))])
+     (for [() (< p e) (post++ p)]
+       (when (html-entity (* p)) (return TRUE)))
+     (return FALSE)))
+
+ (define-cfn html-escape-rec (b::(const ScmStringBody*) port::ScmPort*)
+   ::void :static
+   (let* ([s::(const char*) (SCM_STRING_BODY_START b)]
+          [e::(const char*) (+ s (SCM_STRING_BODY_SIZE b))]
+          [p::(const char*) s])
+     (for [() (< p e) (post++ p)]
+       (let* ([ent::(const char*) (html-entity (* p))])
+         (when ent
+           (when (< s p) (Scm_Putz s (cast int (- p s)) port))
+           (Scm_Putz ent -1 port)
+           (set! s (+ p 1)))))
+     (when (< s e) (Scm_Putz s (cast int (- e s)) port))))
+ )
+
+(define-cproc %write-tree (tree port::<output-port> fallback) ::<void>
+  (write-tree-rec tree port fallback))
+
+;; Writes escaped S to PORT.  If PORT is #f, returns the escaped string
+;; instead; in that case, an immutable S that needs no escaping is
+;; returned as is.
+(define-cproc %html-escape (s::<string> port::<output-port>?)
+  (let* ([b::(const ScmStringBody*) (SCM_STRING_BODY s)])
+    (cond [port (html-escape-rec b port) (result SCM_UNDEFINED)]
+          [(and (SCM_STRING_IMMUTABLE_P s) (not (html-escape-needed? b)))
+           (result (SCM_OBJ s))]
+          [else
+           (let* ([out (Scm_MakeOutputStringPort TRUE)])
+             (html-escape-rec b (SCM_PORT out))
+             (result (Scm_GetOutputString (SCM_PORT out) 0)))])))
+
 ;;
 ;; Internal recusive writer
 ;;
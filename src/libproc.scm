@@ -74,6 +74,23 @@
 ;; for partial continuation.  See lib/gauche/partcont.scm
 (define-cproc %call/pc (proc) (result (Scm_VMCallPC proc)))
 
+;; native coroutines.  See the "Coroutines" section in src/vm.c.
+;; Used by gauche.generator.
+(inline-stub
+ (define-type <coroutine> "ScmCoroutine*" "coroutine"
+   "SCM_COROUTINEP" "SCM_COROUTINE" "SCM_OBJ"))
+
+(define-cproc %make-coroutine (thunk::<procedure>)
+  (result (Scm_MakeCoroutine (SCM_OBJ thunk))))
+(define-cproc %coroutine-done? (co::<coroutine>) ::<boolean>
+  Scm_CoroutineDoneP)
+(define-cproc %coroutine-resume (co::<coroutine>
+                                 :optional (val (c "SCM_UNDEFINED")))
+  (result (Scm_VMCoroutineResume co val)))
+(define-cproc %coroutine-yield (co::<coroutine>
+                                :optional (val (c "SCM_UNDEFINED")))
+  (result (Scm_VMCoroutineYield co val)))
+
 ;;;
 ;;; Extended argument parsing
 ;;;
@@ -57,13 +57,53 @@
 (define-cproc regexp-named-groups (regexp::<regexp>)
   (result (-> regexp grpNames)))
 
+(inline-stub
+ ;; Regexp argument may be given as a string.
+ (define-cfn regexp-arg (regexp) ::ScmRegexp* :static
+   (let* ([rx::ScmRegexp* NULL])
+     (cond [(SCM_STRINGP regexp) (set! rx (SCM_REGEXP (Scm_RegComp
+                                                       (SCM_STRING regexp) 0)))]
+           [(SCM_REGEXPP regexp) (set! rx (SCM_REGEXP regexp))]
+           [else (SCM_TYPE_ERROR regexp "regexp")])
+     (return rx)))
+ )
+
 (define-cproc rxmatch (regexp str::<string>)
-  (let* ([rx::ScmRegexp* NULL])
-    (cond [(SCM_STRINGP regexp) (set! rx (SCM_REGEXP (Scm_RegComp
-                                                      (SCM_STRING regexp) 0)))]
-          [(SCM_REGEXPP regexp) (set! rx (SCM_REGEXP regexp))]
-          [else (SCM_TYPE_ERROR regexp "regexp")])
-    (result (Scm_RegExec rx str))))
+  (result (Scm_RegExec (regexp-arg regexp) str)))
+
+;; Bulk operations.  These don't create a match object for each match.
+(define-cproc regexp-count-matches (regexp str::<string>) ::<int>
+  (let* ([iter::ScmRegMatchIter] [cnt::int 0])
+    (Scm_RegMatchIterInit (& iter) (regexp-arg regexp) str)
+    (while (!= (Scm_RegMatchIterNext (& iter)) NULL) (post++ cnt))
+    (result cnt)))
+
+(inline-stub
+ (define-cfn regexp-positions-iter (args::ScmObj* nargs::int data::void*)
+   :static
+   (let* ([iter::ScmRegMatchIter* (cast ScmRegMatchIter* data)]
+          [rm::ScmRegMatch* (Scm_RegMatchIterNext iter)])
+     (if (== rm NULL)
+       (return (values SCM_FALSE SCM_FALSE))
+       (let* ([m::(struct ScmRegMatchSub*) (aref (-> rm matches) 0)]
+              [s::int (Scm_RegMatchIterCharIndex iter (-> m startp))]
+              [e::int (Scm_RegMatchIterCharIndex iter (-> m endp))])
+         (return (values (SCM_MAKE_INT s) (SCM_MAKE_INT e)))))))
+ )
+
+;; Returns a procedure that returns start and end character indexes of
+;; the successive matches, or #f and #f when exhausted.
+(define-cproc regexp-positions-iterator (regexp str::<string>)
+  (let* ([iter::ScmRegMatchIter* (SCM_NEW ScmRegMatchIter)])
+    (Scm_RegMatchIterInit iter (regexp-arg regexp) str)
+    (result (Scm_MakeSubr regexp_positions_iter iter 0 0
+                          '"regexp-positions-iterator"))))
+
+(define (regexp-fold-positions regexp kons knil str)
+  (let1 iter (regexp-positions-iterator regexp str)
+    (let loop ([seed knil])
+      (receive (s e) (iter)
+        (if s (loop (kons s e seed)) seed)))))
 
 (inline-stub
  (define-cise-stmt rxmatchop
@@ -146,23 +186,27 @@
       (with-output-to-string (cut %regexp-replace-rec match subpat display))
       string)))
 
+(define-cproc %regexp-replace-all (regexp str::<string> subpat
+                                          port::<output-port>)
+  ::<boolean>
+  (result (Scm_RegReplaceAll (regexp-arg regexp) str subpat port)))
+
+(define-cproc %regexp-split (regexp str::<string> limit::<int>)
+  (result (Scm_RegSplit (regexp-arg regexp) str limit)))
+
 (define-in-module gauche (regexp-replace-all rx string sub)
   (let ([subpat (%regexp-parse-subpattern sub)]
-        [match  (rxmatch rx string)])
-    (if match
-      (with-output-to-string
-        (^[]
-          (define (loop str)
-            (unless (equal? str "")
-              (cond [(rxmatch rx str)
-                     => (^[match]
-                          (when (= (rxmatch-start match) (rxmatch-end match))
-                            (error "regexp-replace-all: matching zero-length string causes infinite loop:" rx))
-                          (%regexp-replace-rec match subpat loop))]
-                    [else (display str)])))
-          (%regexp-replace-rec match subpat loop)))
+        [out (open-output-string)])
+    (if (%regexp-replace-all rx string subpat out)
+      (get-output-string out)
       string)))
 
+;; Like regexp-replace-all, but writes the result to PORT.
+(define-in-module gauche (regexp-replace-all-to-port
+                          rx string sub :optional (port (current-output-port)))
+  (unless (%regexp-replace-all rx string (%regexp-parse-subpattern sub) port)
+    (display string port)))
+
 (define (regexp-replace-driver name func-1)
   (^[string rx sub . more]
     (cond [(null? more) (func-1 rx string sub)]
@@ -1259,6 +1259,11 @@
    ) ;; when defined(HAVE_SELECT)
  )
 
+(select-module gauche.internal)
+;; Used by control.fiber
+(define-cproc %poll-fds (rfds wfds :optional (timeout #f)) Scm__PollFds)
+(select-module gauche)
+
 ;;;
 ;;; Windows-specific utility
 ;;;
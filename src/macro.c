@@ -107,6 +107,11 @@ typedef struct ScmSyntaxPatternRec {
                                    SyntaxPattern with numFollowingItems=2.
                                    From (x ... . y), `x ...' part becomes
                                    SyntaxPattern with numFollowingItems=0. */
+    short numIterVars;          /* only used in template.  # of entries */
+    int *iterVars;              /*   in iterVars, which lists the pattern
+                                   variables (by count) this repetition
+                                   iterates over, i.e. the ones whose
+                                   level is this level or deeper.  */
 } ScmSyntaxPattern;
 
 SCM_CLASS_DECL(Scm_SyntaxPatternClass);
@@ -134,6 +139,8 @@ ScmSyntaxPattern *make_syntax_pattern(int level, int numFollowing)
     p->vars = SCM_NIL;
     p->level = level;
     p->numFollowingItems = numFollowing;
+    p->numIterVars = 0;
+    p->iterVars = NULL;
     return p;
 }
 
@@ -407,6 +414,25 @@ static ScmObj preprocess_literals(ScmObj literals, ScmModule *mod, ScmObj env)
     return h;
 }
 
+/* precompute the pattern variables a repetition in a template steps
+   through.  nspat->vars may contain duplicates and variables of
+   outer levels; we drop them. */
+static void set_iter_vars(ScmSyntaxPattern *spat)
+{
+    int n = Scm_Length(spat->vars), k = 0;
+    int *vars = SCM_NEW_ATOMIC_ARRAY(int, n);
+    ScmObj vp;
+    SCM_FOR_EACH(vp, spat->vars) {
+        ScmObj pvref = SCM_CAR(vp);
+        if (PVREF_LEVEL(pvref) < spat->level) continue;
+        int count = PVREF_COUNT(pvref), i;
+        for (i=0; i<k; i++) if (vars[i] == count) break;
+        if (i == k) vars[k++] = count;
+    }
+    spat->numIterVars = k;
+    spat->iterVars = vars;
+}
+
 /* compile a pattern or a template.
    In a pattern, replace literal symbols for identifiers; leave
    non-literal symbols (i.e. pattern variables) as they are, but
@@ -482,6 +508,7 @@ static ScmObj compile_rule1(ScmObj form,
                                   " is deeper than pattern's: %S",
                                   ctx->name, form);
                     }
+                    set_iter_vars(nspat);
                 }
                 spat->vars = Scm_Append2(spat->vars, nspat->vars);
                 pp = SCM_CDR(pp);
@@ -535,6 +562,31 @@ static ScmObj compile_rule1(ScmObj form,
     return form;
 }
 
+/* Record the shape of the arguments a compiled pattern can match.
+   Used to filter out branches quickly in synrule_expand. */
+static void set_branch_shape(ScmSyntaxRuleBranch *branch, ScmObj pat)
+{
+    int nfixed = 0, variadic = FALSE;
+
+    branch->headLiteral = SCM_FALSE;
+    if (SCM_PAIRP(pat) && SCM_IDENTIFIERP(SCM_CAR(pat))) {
+        /* NB: identifiers in a compiled pattern are always literals */
+        branch->headLiteral = SCM_CAR(pat);
+    }
+    for (; SCM_PAIRP(pat); pat = SCM_CDR(pat)) {
+        if (SCM_SYNTAX_PATTERN_P(SCM_CAR(pat))) variadic = TRUE;
+        else nfixed++;
+    }
+    branch->minArgs = nfixed;
+    if (SCM_NULLP(pat)) {
+        branch->maxArgs = variadic? -1 : nfixed;
+        branch->properArgs = TRUE;
+    } else {
+        branch->maxArgs = -1;
+        branch->properArgs = FALSE;
+    }
+}
+
 /* compile rules into ScmSyntaxRules structure
    NB: We use ScmSyntaxPattern for the toplevel node of pattern and template;
    they are just a placeholders and they don't represent repetition. */
@@ -584,6 +636,7 @@ static ScmSyntaxRules *compile_rules(ScmObj name,
         sr->rules[i].template = SCM_OBJ(tmpl->pattern);
         sr->rules[i].numPvars = ctx.pvcnt;
         sr->rules[i].maxLevel = ctx.maxlev;
+        set_branch_shape(&sr->rules[i], sr->rules[i].pattern);
         if (ctx.pvcnt > sr->maxNumPvars) sr->maxNumPvars = ctx.pvcnt;
     }
     return sr;
@@ -622,12 +675,13 @@ typedef struct {
     ScmObj branch;              /* current level match */
     ScmObj sprout;              /* current sprout */
     ScmObj root;                /* root of the tree */
+    ScmObj value;               /* used during template expansion; the
+                                   subtree of root for the current
+                                   iteration. */
 } MatchVar;
 
-static MatchVar *alloc_matchvec(int numPvars)
-{
-    return SCM_NEW_ARRAY(MatchVar, numPvars);
-}
+/* synrule_expand uses a matchvec on the stack if it's small enough */
+#define DEFAULT_MATCHVEC_SIZE  16
 
 static void init_matchvec(MatchVar *mvec, int numPvars)
 {
@@ -637,30 +691,6 @@ static void init_matchvec(MatchVar *mvec, int numPvars)
     }
 }
 
-/* get value associated to the pvref.  if exhausted, return SCM_UNBOUND
-   and set exhaust level in *exlev. */
-static ScmObj get_pvref_value(ScmObj pvref, MatchVar *mvec,
-                              int *indices, int *exlev)
-{
-    int level = PVREF_LEVEL(pvref), count = PVREF_COUNT(pvref);
-    ScmObj tree = mvec[count].root;
-    for (int i=1; i<=level; i++) {
-        for (int j=0; j<indices[i]; j++) {
-            if (!SCM_PAIRP(tree)) {
-                *exlev = i;
-                return SCM_UNBOUND;
-            }
-            tree = SCM_CDR(tree);
-        }
-        if (!SCM_PAIRP(tree)) {
-            *exlev = i;
-            return SCM_UNBOUND;
-        }
-        tree = SCM_CAR(tree);
-    }
-    return tree;
-}
-
 /* for debug */
 #ifdef DEBUG_SYNRULE
 static void print_matchvec(MatchVar *mvec, int numPvars, ScmPort *port)
@@ -864,50 +894,75 @@ static int match_synrule(ScmObj form, ScmObj pattern, ScmObj env,
  * pattern language transformer
  */
 
-/* If a pattern variable is exhausted, SCM_UNDEFINED is returned. */
-static ScmObj realize_template_rec(ScmObj template,
-                                   MatchVar *mvec,
-                                   int level,
-                                   int *indices,
-                                   ScmObj *idlist,
-                                   int *exlev)
+/* Template expansion
+ *   While walking the template, mvec[i].value holds the value of the
+ *   i-th pattern variable for the current iteration.  A repetition
+ *   steps all the variables it iterates over (iterVars, precomputed
+ *   at compile time) in lockstep, and ends when any of them runs out.
+ *   So each matched tree is traversed just once.
+ */
+
+static ScmObj realize_template_rec(ScmObj template, MatchVar *mvec,
+                                   ScmObj *idlist);
+
+#define DEFAULT_ITER_VARS  8
+
+/* Expands repetition PAT, appending the results to the list H/T. */
+static void realize_repeat(ScmSyntaxPattern *pat, MatchVar *mvec,
+                           ScmObj *idlist, ScmObj *h, ScmObj *t)
+{
+    int n = pat->numIterVars;
+    ScmObj cbuf[DEFAULT_ITER_VARS*2], *saved = cbuf, *cursors;
+
+    if (n > DEFAULT_ITER_VARS) saved = SCM_NEW_ARRAY(ScmObj, n*2);
+    cursors = saved + n;
+    for (int i=0; i<n; i++) {
+        saved[i] = cursors[i] = mvec[pat->iterVars[i]].value;
+    }
+    for (;;) {
+        for (int i=0; i<n; i++) {
+            if (!SCM_PAIRP(cursors[i])) goto done;
+        }
+        for (int i=0; i<n; i++) {
+            mvec[pat->iterVars[i]].value = SCM_CAR(cursors[i]);
+            cursors[i] = SCM_CDR(cursors[i]);
+        }
+        SCM_APPEND1(*h, *t, realize_template_rec(pat->pattern, mvec, idlist));
+    }
+  done:
+    for (int i=0; i<n; i++) {
+        mvec[pat->iterVars[i]].value = saved[i];
+    }
+}
+
+static ScmObj realize_template_rec(ScmObj template, MatchVar *mvec,
+                                   ScmObj *idlist)
 {
     if (SCM_PAIRP(template)) {
         ScmObj h = SCM_NIL, t = SCM_NIL;
         while (SCM_PAIRP(template)) {
             ScmObj e = SCM_CAR(template);
             if (SCM_SYNTAX_PATTERN_P(e)) {
-                ScmObj r = realize_template_rec(e, mvec, level, indices, idlist, exlev);
-                if (SCM_UNBOUNDP(r)) return r;
-                SCM_APPEND(h, t, r);
+                realize_repeat(SCM_SYNTAX_PATTERN(e), mvec, idlist, &h, &t);
             } else {
-                ScmObj r = realize_template_rec(e, mvec, level, indices, idlist, exlev);
-                if (SCM_UNBOUNDP(r)) return r;
-                SCM_APPEND1(h, t, r);
+                SCM_APPEND1(h, t, realize_template_rec(e, mvec, idlist));
             }
             template = SCM_CDR(template);
         }
         if (!SCM_NULLP(template)) {
-            ScmObj r = realize_template_rec(template, mvec, level, indices, idlist, exlev);
-            if (SCM_UNBOUNDP(r)) return r;
+            ScmObj r = realize_template_rec(template, mvec, idlist);
             if (SCM_NULLP(h)) return r; /* (a ... . b) and a ... is empty */
-            SCM_APPEND(h, t, r);
+            SCM_SET_CDR(t, r);
         }
         return h;
     }
     if (PVREF_P(template)) {
-        return get_pvref_value(template, mvec, indices, exlev);
+        return mvec[PVREF_COUNT(template)].value;
     }
     if (SCM_SYNTAX_PATTERN_P(template)) {
-        ScmSyntaxPattern *pat = SCM_SYNTAX_PATTERN(template);
         ScmObj h = SCM_NIL, t = SCM_NIL;
-        indices[level+1] = 0;
-        for (;;) {
-            ScmObj r = realize_template_rec(pat->pattern, mvec, level+1, indices, idlist, exlev);
-            if (SCM_UNBOUNDP(r)) return (*exlev < pat->level)? r : h;
-            SCM_APPEND1(h, t, r);
-            indices[level+1]++;
-        }
+        realize_repeat(SCM_SYNTAX_PATTERN(template), mvec, idlist, &h, &t);
+        return h;
     }
     if (SCM_VECTORP(template)) {
         ScmObj h = SCM_NIL, t = SCM_NIL;
@@ -916,13 +971,9 @@ static ScmObj realize_template_rec(ScmObj template,
 
         for (int i=0; i<len; i++, pe++) {
             if (SCM_SYNTAX_PATTERN_P(*pe)) {
-                ScmObj r = realize_template_rec(*pe, mvec, level, indices, idlist, exlev);
-                if (SCM_UNBOUNDP(r)) return r;
-                SCM_APPEND(h, t, r);
+                realize_repeat(SCM_SYNTAX_PATTERN(*pe), mvec, idlist, &h, &t);
             } else {
-                ScmObj r = realize_template_rec(*pe, mvec, level, indices, idlist, exlev);
-                if (SCM_UNBOUNDP(r)) return r;
-                SCM_APPEND1(h, t, r);
+                SCM_APPEND1(h, t, realize_template_rec(*pe, mvec, idlist));
             }
         }
         return Scm_ListToVector(h, 0, -1);
@@ -944,24 +995,48 @@ static ScmObj realize_template_rec(ScmObj template,
     return template;
 }
 
-#define DEFAULT_MAX_LEVEL  10
-
 static ScmObj realize_template(ScmSyntaxRuleBranch *branch,
                                MatchVar *mvec)
 {
-    int index[DEFAULT_MAX_LEVEL], *indices = index;
-    int exlev = 0;
     ScmObj idlist = SCM_NIL;
 
-    if (branch->maxLevel > DEFAULT_MAX_LEVEL)
-        indices = SCM_NEW_ATOMIC2(int*, (branch->maxLevel+1) * sizeof(int));
-    for (int i=0; i<=branch->maxLevel; i++) indices[i] = 0;
-    return realize_template_rec(branch->template, mvec, 0, indices, &idlist, &exlev);
+    for (int i=0; i<branch->numPvars; i++) mvec[i].value = mvec[i].root;
+    return realize_template_rec(branch->template, mvec, &idlist);
+}
+
+/* Returns TRUE if the arguments of the macro call, whose shape is
+   given by NARGS, PROPER and HEAD, can possibly match BRANCH. */
+static inline int branch_shape_match(ScmSyntaxRuleBranch *branch,
+                                     int nargs, int proper, ScmObj head)
+{
+    if (nargs < branch->minArgs) return FALSE;
+    if (branch->maxArgs >= 0 && nargs > branch->maxArgs) return FALSE;
+    if (branch->properArgs && !proper) return FALSE;
+    if (SCM_IDENTIFIERP(branch->headLiteral)
+        && SCM_OBJ(SCM_IDENTIFIER(branch->headLiteral)->name) != head) {
+        return FALSE;
+    }
+    return TRUE;
 }
 
 static ScmObj synrule_expand(ScmObj form, ScmObj env, ScmSyntaxRules *sr)
 {
-    MatchVar *mvec = alloc_matchvec(sr->maxNumPvars);
+    MatchVar mbuf[DEFAULT_MATCHVEC_SIZE], *mvec = mbuf;
+    if (sr->maxNumPvars > DEFAULT_MATCHVEC_SIZE) {
+        mvec = SCM_NEW_ARRAY(MatchVar, sr->maxNumPvars);
+    }
+
+    /* Examine the shape of the arguments once, so that we can skip
+       the branches that can't match without running the matcher. */
+    ScmObj args = SCM_CDR(form), ap, head = SCM_FALSE;
+    int nargs = 0;
+    SCM_FOR_EACH(ap, args) nargs++;
+    int proper = SCM_NULLP(ap);
+    if (SCM_PAIRP(args)) {
+        ScmObj a = SCM_CAR(args);
+        if (SCM_SYMBOLP(a)) head = a;
+        else if (SCM_IDENTIFIERP(a)) head = SCM_OBJ(SCM_IDENTIFIER(a)->name);
+    }
 
 #ifdef DEBUG_SYNRULE
     Scm_Printf(SCM_CUROUT, "**** synrule_transform: %S\n", form);
@@ -970,8 +1045,9 @@ static ScmObj synrule_expand(ScmObj form, ScmObj env, ScmSyntaxRules *sr)
 #ifdef DEBUG_SYNRULE
         Scm_Printf(SCM_CUROUT, "pattern #%d: %S\n", i, sr->rules[i].pattern);
 #endif
+        if (!branch_shape_match(&sr->rules[i], nargs, proper, head)) continue;
         init_matchvec(mvec, sr->rules[i].numPvars);
-        if (match_synrule(SCM_CDR(form), sr->rules[i].pattern, env, mvec)) {
+        if (match_synrule(args, sr->rules[i].pattern, env, mvec)) {
 #ifdef DEBUG_SYNRULE
             Scm_Printf(SCM_CUROUT, "success #%d:\n", i);
             print_matchvec(mvec, sr->rules[i].numPvars, SCM_CUROUT);
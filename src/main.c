@@ -100,6 +100,8 @@ void usage(void)
             "  -f<flag> Sets various flags\n"
             "      case-fold       uses case-insensitive reader (as in R5RS)\n"
             "      load-verbose    report while loading files\n"
+            "      inline-exports  inline small exported procedures into other\n"
+            "                      modules.\n"
             "      no-inline       don't inline procedures & constants (combined\n"
             "                      no-inline-globals, no-inline-locals, and\n"
             "                      no-inline-constants.)\n"
@@ -146,6 +148,9 @@ void further_options(const char *optarg)
         SCM_VM_COMPILER_FLAG_SET(vm, SCM_COMPILE_NOINLINE_LOCALS);
         SCM_VM_COMPILER_FLAG_SET(vm, SCM_COMPILE_NOINLINE_CONSTS);
     }
+    else if (strcmp(optarg, "inline-exports") == 0) {
+        SCM_VM_COMPILER_FLAG_SET(vm, SCM_COMPILE_INLINE_EXPORTS);
+    }
     else if (strcmp(optarg, "no-post-inline-pass") == 0) {
         SCM_VM_COMPILER_FLAG_SET(vm, SCM_COMPILE_NO_POST_INLINE_OPT);
     }
@@ -193,7 +198,7 @@ void further_options(const char *optarg)
     }
     else {
         fprintf(stderr, "unknown -f option: %s\n", optarg);
-        fprintf(stderr, "supported options are: -fcase-fold or -fload-verbose, -fno-inline, -fno-inline-globals, -fno-inline-locals, -fno-inline-constants, -fno-source-info, -fno-post-inline-pass, -fno-lambda-lifting-pass, -ftest\n");
+        fprintf(stderr, "supported options are: -fcase-fold or -fload-verbose, -finline-exports, -fno-inline, -fno-inline-globals, -fno-inline-locals, -fno-inline-constants, -fno-source-info, -fno-post-inline-pass, -fno-lambda-lifting-pass, -ftest\n");
         exit(1);
     }
 }
@@ -33,6 +33,12 @@
 
 #define LIBGAUCHE_BODY
 #include "gauche.h"
+
+/* Platforms that lack reliable atomic operations; see lazy.c. */
+#if defined(__SH4__) || defined(__ARMEL__)
+#define AO_USE_PTHREAD_DEFS 1
+#endif
+#include "atomic_ops.h"
 #include "gauche/priv/builtin-syms.h"
 #include "gauche/class.h"
 
@@ -77,6 +83,64 @@
  * Benchmark showed the change made program loading 30% faster.
  */
 
+/* Binding lookup cache
+ *
+ * Scm_FindBinding is called from eval and global-variable-ref at
+ * runtime, possibly from many threads at once.  Each module has a small
+ * direct-mapped cache of the lookup results (including negative ones),
+ * which is read without the lock.
+ *
+ * Every operation that may change the result of a lookup (creating a
+ * binding, import, export, extending modules, etc.) increments the
+ * global binding_epoch while holding modules.mutex, and records the new
+ * epoch in the bindingEpoch of the module it alters.  A lookup in a
+ * module M depends on M and the modules reachable from it through
+ * imports and precedence lists, so the cache keeps the latest
+ * bindingEpoch of those (deps), computed in the global epoch `checked'.
+ * An entry is valid if it was recorded at or after deps.  So a define
+ * in an unrelated module only costs each cache one recomputation of
+ * deps, and the entries survive it.
+ *
+ * The symbol and flags of an entry don't change once it's published by
+ * a release store of the pointer to it.  When an entry is found stale,
+ * it is refreshed in place; gloc is stored before epoch, so a reader
+ * that sees the new epoch sees the new gloc.  A reader that sees the
+ * old epoch rejects it, or, if it still read an older `checked', it may
+ * get the new gloc, which is as good.
+ * Since such changes mostly happen during loading, the cache stays
+ * warm in the steady state.
+ */
+#define BINDING_CACHE_SIZE 128      /* must be power of 2 */
+
+typedef struct binding_cache_entry_rec {
+    ScmSymbol *symbol;
+    int flags;
+    volatile AO_t epoch;
+    volatile AO_t gloc;         /* ScmGloc*; NULL if the binding isn't found */
+} binding_cache_entry;
+
+typedef struct binding_cache_rec {
+    volatile AO_t checked;      /* global epoch when deps is computed */
+    volatile AO_t deps;         /* latest bindingEpoch of the modules
+                                   the lookup depends on */
+    volatile AO_t entries[BINDING_CACHE_SIZE]; /* binding_cache_entry* */
+} binding_cache;
+
+static volatile AO_t binding_epoch = 0;
+
+/* Must be called while holding modules.mutex */
+#define BINDING_CHANGED(mod)                                    \
+    do {                                                        \
+        AO_store_release(&binding_epoch, binding_epoch+1);      \
+        (mod)->bindingEpoch = binding_epoch;                    \
+    } while (0)
+
+static inline u_long binding_cache_index(ScmSymbol *symbol, int flags)
+{
+    return ((SCM_WORD(symbol) >> 4) * 2654435761UL + flags)
+        & (BINDING_CACHE_SIZE - 1);
+}
+
 static void module_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
 {
     if (SCM_MODULEP(SCM_MODULE(obj)->origin)) {
@@ -131,6 +195,8 @@ static void init_module(ScmModule *m, ScmObj name)
     m->internal = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
     m->external = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
     m->origin = m->prefix = SCM_FALSE;
+    m->bindingCache = NULL;
+    m->bindingEpoch = 0;
 }
 
 /* Internal */
@@ -334,14 +400,92 @@ static ScmGloc *search_binding(ScmModule *module, ScmSymbol *symbol,
     return NULL;
 }
 
+/* Computes the latest bindingEpoch of the modules a lookup in MODULE
+   may visit.  It follows imports transitively, since a phantom binding
+   leads the search to the imports of an imported module.
+   Must be called while holding modules.mutex. */
+static void binding_deps_rec(ScmModule *module, module_cache *visited,
+                             u_long *deps)
+{
+    ScmObj p;
+    if (module_visited_p(visited, SCM_OBJ(module))) return;
+    module_add_visited(visited, SCM_OBJ(module));
+    if (module->bindingEpoch > *deps) *deps = module->bindingEpoch;
+    SCM_FOR_EACH(p, module->imported) {
+        binding_deps_rec(SCM_MODULE(SCM_CAR(p)), visited, deps);
+    }
+    SCM_FOR_EACH(p, SCM_CDR(module->mpl)) {
+        binding_deps_rec(SCM_MODULE(SCM_CAR(p)), visited, deps);
+    }
+}
+
+static inline int binding_cache_entry_match(binding_cache_entry *e,
+                                            ScmSymbol *symbol, int flags)
+{
+    return (e != NULL && e->symbol == symbol && e->flags == flags);
+}
+
 ScmGloc *Scm_FindBinding(ScmModule *module, ScmSymbol *symbol, int flags)
 {
     int stay_in_module = flags&SCM_BINDING_STAY_IN_MODULE;
     int external_only = flags&SCM_BINDING_EXTERNAL;
     ScmGloc *gloc = NULL;
+    u_long k = binding_cache_index(symbol, flags);
+    binding_cache_entry *e = NULL;
+
+    /* Fast path: lock-free lookup of the cache */
+    binding_cache *c =
+        (binding_cache*)AO_load_acquire((volatile AO_t*)&module->bindingCache);
+    if (c != NULL) {
+        AO_t epoch = AO_load_acquire(&binding_epoch);
+        e = (binding_cache_entry*)AO_load_acquire(&c->entries[k]);
+        if (binding_cache_entry_match(e, symbol, flags)
+            && AO_load_acquire(&c->checked) == epoch
+            && AO_load_acquire(&e->epoch) >= AO_load(&c->deps)) {
+            return (ScmGloc*)AO_load(&e->gloc);
+        }
+    }
+
+    /* Allocate outside of the lock */
+    binding_cache_entry *ne = NULL;
+    if (!binding_cache_entry_match(e, symbol, flags)) {
+        ne = SCM_NEW(binding_cache_entry);
+    }
+    if (c == NULL) c = SCM_NEW(binding_cache);
 
     SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(modules.mutex);
-    gloc = search_binding(module, symbol, stay_in_module, external_only, FALSE);
+    if (module->bindingCache == NULL) {
+        AO_store_release((volatile AO_t*)&module->bindingCache, (AO_t)c);
+    }
+    c = (binding_cache*)module->bindingCache;
+    if (c->checked != binding_epoch) {
+        module_cache visited;
+        u_long deps = 0;
+        init_module_cache(&visited);
+        binding_deps_rec(module, &visited, &deps);
+        AO_store(&c->deps, deps);
+        AO_store_release(&c->checked, binding_epoch);
+    }
+    e = (binding_cache_entry*)c->entries[k];
+    if (binding_cache_entry_match(e, symbol, flags)) {
+        if (e->epoch >= c->deps) {
+            gloc = (ScmGloc*)e->gloc;
+        } else {
+            gloc = search_binding(module, symbol, stay_in_module,
+                                  external_only, FALSE);
+            AO_store(&e->gloc, (AO_t)gloc);
+            AO_store_release(&e->epoch, binding_epoch);
+        }
+    } else {
+        if (ne == NULL) ne = SCM_NEW(binding_cache_entry);
+        gloc = search_binding(module, symbol, stay_in_module,
+                              external_only, FALSE);
+        ne->symbol = symbol;
+        ne->flags = flags;
+        ne->epoch = binding_epoch;
+        ne->gloc = (AO_t)gloc;
+        AO_store_release(&c->entries[k], (AO_t)ne);
+    }
     SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
     return gloc;
 }
@@ -391,6 +535,7 @@ ScmGloc *Scm_MakeBinding(ScmModule *module, ScmSymbol *symbol,
         if (module->exportAll) {
             Scm_HashTableSet(module->external, SCM_OBJ(symbol), SCM_OBJ(g), 0);
         }
+        BINDING_CHANGED(module);
     }
     SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
 
@@ -444,6 +589,7 @@ void Scm_HideBinding(ScmModule *module, ScmSymbol *symbol)
         ScmGloc *g = SCM_GLOC(Scm_MakeGloc(symbol, module));
         g->hidden = TRUE;
         Scm_HashTableSet(module->external, SCM_OBJ(symbol), SCM_OBJ(g), 0);
+        BINDING_CHANGED(module);
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
 
@@ -485,6 +631,7 @@ int Scm_AliasBinding(ScmModule *target, ScmSymbol *targetName,
     SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(modules.mutex);
     Scm_HashTableSet(target->external, SCM_OBJ(targetName), SCM_OBJ(g), 0);
     Scm_HashTableSet(target->internal, SCM_OBJ(targetName), SCM_OBJ(g), 0);
+    BINDING_CHANGED(target);
     SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
     return TRUE;
 }
@@ -533,6 +680,7 @@ ScmObj Scm_ImportModule(ScmModule *module,
             break;
         }
         module->imported = p;
+        BINDING_CHANGED(module);
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
 
@@ -617,6 +765,7 @@ ScmObj Scm_ExportSymbols(ScmModule *module, ScmObj specs)
                              SCM_DICT_VALUE(e), 0);
         }
     }
+    BINDING_CHANGED(module);
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
 
     /* Now, if this export changes the meaning of exported symbols, we
@@ -656,6 +805,7 @@ ScmObj Scm_ExportAll(ScmModule *module)
                 (void)SCM_DICT_SET_VALUE(ee, SCM_DICT_VALUE(e));
             }
         }
+        BINDING_CHANGED(module);
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
     return SCM_OBJ(module);
@@ -706,7 +856,11 @@ ScmObj Scm_ExtendModule(ScmModule *module, ScmObj supers)
     if (SCM_FALSEP(mpl)) {
         Scm_Error("can't extend those modules simultaneously because of inconsistent precedence lists: %S", supers);
     }
-    module->mpl = Scm_Cons(SCM_OBJ(module), mpl);
+    mpl = Scm_Cons(SCM_OBJ(module), mpl);
+    (void)SCM_INTERNAL_MUTEX_LOCK(modules.mutex);
+    module->mpl = mpl;
+    BINDING_CHANGED(module);
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
     return module->mpl;
 }
 
@@ -40,6 +40,9 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <ctype.h>
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
 
 #undef MAX
 #undef MIN
@@ -266,11 +269,27 @@ void Scm_PortFdDup(ScmPort *dst, ScmPort *src)
 
 /* Low-level function to find if the file descriptor is ready or not.
    DIR specifies SCM_PORT_INPUT or SCM_PORT_OUTPUT.
-   If the system doesn't have select(), this function returns
-   SCM_FD_UNKNOWN. */
+   If the system doesn't have poll() nor select(), this function returns
+   SCM_FD_UNKNOWN.  We prefer poll(), since select() can't handle
+   fds beyond FD_SETSIZE. */
 int Scm_FdReady(int fd, int dir)
 {
-#if defined(HAVE_SELECT) && !defined(GAUCHE_WINDOWS)
+#if defined(HAVE_POLL) && !defined(GAUCHE_WINDOWS)
+    struct pollfd pfd;
+    int r;
+
+    /* In case if this is called on non-file ports.*/
+    if (fd < 0) return SCM_FD_READY;
+
+    pfd.fd = fd;
+    pfd.events = (dir == SCM_PORT_OUTPUT)? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    SCM_SYSCALL(r, poll(&pfd, 1, 0));
+    if (r < 0) Scm_SysError("poll failed");
+    /* POLLHUP and POLLERR count as ready; the next I/O reports them. */
+    if (r > 0) return SCM_FD_READY;
+    else       return SCM_FD_WOULDBLOCK;
+#elif defined(HAVE_SELECT) && !defined(GAUCHE_WINDOWS)
     fd_set fds;
     int r;
     struct timeval tm;
@@ -306,9 +325,9 @@ int Scm_FdReady(int fd, int dir)
         if (avail == 0) return SCM_FD_WOULDBLOCK;
         else return SCM_FD_READY;
     }
-#else  /*!HAVE_SELECT && !GAUCHE_WINDOWS */
+#else  /*!HAVE_POLL && !HAVE_SELECT && !GAUCHE_WINDOWS */
     return SCM_FD_UNKNOWN;
-#endif /*!HAVE_SELECT && !GAUCHE_WINDOWS */
+#endif /*!HAVE_POLL && !HAVE_SELECT && !GAUCHE_WINDOWS */
 }
 
 /*===============================================================
@@ -679,6 +698,69 @@ static int bufport_read(ScmPort *p, char *dst, int siz)
     return nread;
 }
 
+/* Hands the buffered data over to the caller as a u8vector.  If the
+ * data fills at least half of the buffer, the u8vector shares the
+ * storage with the buffer and the port gets a fresh buffer, so the data
+ * isn't copied.  Smaller data is copied into a u8vector of the exact
+ * size and the port keeps its buffer; allocating a whole new buffer for
+ * each small datagram costs far more than the copy.  Bytes pushed back
+ * by peek-byte and friends are always copied.  If the buffer is empty,
+ * the filler is called once to get whatever immediately available; for
+ * a datagram socket it is one datagram.  Returns EOF at the end.
+ */
+static ScmObj bufport_take(ScmPort *p)
+{
+    char pending[SCM_CHAR_MAX_BYTES];
+    int npending = p->scrcnt;
+
+    if (SCM_PORT_CLOSED_P(p)) {
+        Scm_PortError(p, SCM_PORT_ERROR_CLOSED,
+                      "I/O attempted on closed port: %S", p);
+    }
+    if (p->ungotten != SCM_CHAR_INVALID) {
+        npending = SCM_CHAR_NBYTES(p->ungotten);
+        SCM_CHAR_PUT(pending, p->ungotten);
+        p->ungotten = SCM_CHAR_INVALID;
+    } else if (npending > 0) {
+        memcpy(pending, p->scratch, npending);
+    }
+    p->scrcnt = 0;
+
+    if (npending == 0 && p->src.buf.current >= p->src.buf.end) {
+        if (bufport_fill(p, 0, TRUE) <= 0) return SCM_EOF;
+    }
+
+    int avail = (int)(p->src.buf.end - p->src.buf.current);
+    ScmObj v;
+    if (npending > 0 || avail < p->src.buf.size/2) {
+        v = Scm_MakeU8Vector(npending + avail, 0);
+        memcpy(SCM_U8VECTOR_ELEMENTS(v), pending, npending);
+        memcpy(SCM_U8VECTOR_ELEMENTS(v) + npending, p->src.buf.current, avail);
+    } else {
+        /* The owner keeps the whole old buffer alive. */
+        v = Scm_MakeUVectorFull(SCM_CLASS_U8VECTOR, avail,
+                                p->src.buf.current, FALSE,
+                                p->src.buf.buffer);
+        p->src.buf.buffer = SCM_NEW_ATOMIC2(char*, p->src.buf.size);
+    }
+    p->src.buf.current = p->src.buf.end = p->src.buf.buffer;
+    p->bytes += npending + avail;
+    return v;
+}
+
+ScmObj Scm_PortTakeBuffer(ScmPort *p)
+{
+    ScmObj r = SCM_EOF;
+    if (!SCM_IPORTP(p) || SCM_PORT_TYPE(p) != SCM_PORT_FILE) {
+        Scm_Error("buffered input port required, but got %S", p);
+    }
+    ScmVM *vm = Scm_VM();
+    PORT_LOCK(p, vm);
+    PORT_SAFE_CALL(p, r = bufport_take(p), /*no cleanup*/);
+    PORT_UNLOCK(p);
+    return r;
+}
+
 /* Tracking buffered ports:
  *
  *   The OS doesn't automatically flush the buffered output port,
@@ -898,6 +898,46 @@ int Scm_CharReadyUnsafe(ScmPort *p)
     return r;
 }
 
+/*=================================================================
+ * LineReady
+ *
+ *   Returns TRUE if read-line can return without blocking, i.e. the
+ *   buffer contains a newline or we've reached EOF.  Data that are
+ *   available on the fd are pulled into the buffer while checking.
+ *   If a line doesn't fit in the buffer, we can't tell and return TRUE.
+ *   Used by cooperative schedulers to decide whether to park the caller.
+ */
+
+#ifdef SAFE_PORT_OP
+int Scm_LineReady(ScmPort *p)
+#else
+int Scm_LineReadyUnsafe(ScmPort *p)
+#endif
+{
+    int r = TRUE;
+    VMDECL;
+    SHORTCUT(p, return Scm_LineReadyUnsafe(p));
+    if (!SCM_IPORTP(p)) Scm_Error("input port required, but got %S", p);
+    LOCK(p);
+    if (SCM_PORT_TYPE(p) == SCM_PORT_FILE && p->src.buf.ready != NULL) {
+        for (;;) {
+            const char *cur = p->src.buf.current;
+            int avail = (int)(p->src.buf.end - cur), rdy, n;
+            if (memchr(cur, '\n', avail) != NULL) break;
+            if (avail >= p->src.buf.size) break; /* line too long */
+            SAFE_CALL(p, rdy = p->src.buf.ready(p));
+            if (rdy == SCM_FD_WOULDBLOCK) { r = FALSE; break; }
+            /* The filler is called only once, so it won't block. */
+            SAFE_CALL(p, n = bufport_fill(p, 0, TRUE));
+            if (n <= 0) break;  /* EOF or error */
+        }
+    } else if (SCM_PORT_TYPE(p) == SCM_PORT_PROC) {
+        SAFE_CALL(p, r = p->src.vt.Ready(p, TRUE));
+    }
+    UNLOCK(p);
+    return r;
+}
+
 /*=================================================================
  * PortSeek
  */
@@ -1774,6 +1774,62 @@ static int is_simple_prefixed(ScmObj ast)
 }
 
 
+/* Returns TRUE if we can find a match candidate by scanning bytes, e.g.
+   with memchr, when it begins with a byte B.  In UTF-8 and EUC-JP, such
+   a byte never appears in the middle of a multibyte character if it is
+   an ASCII byte; in UTF-8 it's true for any leading byte as well.  In
+   Shift_JIS, ASCII bytes may appear as a trailing byte, so we give up. */
+static int byte_scannable(unsigned char b)
+{
+#if defined(GAUCHE_CHAR_ENCODING_SJIS)
+    return FALSE;
+#elif defined(GAUCHE_CHAR_ENCODING_EUC_JP)
+    return (b < 0x80);
+#else  /* UTF-8 or no encoding */
+    return TRUE;
+#endif
+}
+
+/* Aux function for literal_prefix.  Appends leading literal characters
+   of AST to DS.  Returns TRUE iff the entire AST is a literal string,
+   so that the caller can continue to collect the following items. */
+static int literal_prefix_rec(ScmObj ast, ScmDString *ds)
+{
+    if (SCM_CHARP(ast)) {
+        Scm_DStringPutc(ds, SCM_CHAR_VALUE(ast));
+        return TRUE;
+    }
+    if (!SCM_PAIRP(ast)) return FALSE;
+
+    ScmObj type = SCM_CAR(ast), items, ip;
+    if (SCM_INTP(type)) items = SCM_CDDR(ast);
+    else if (SCM_EQ(type, SCM_SYM_SEQ)) items = SCM_CDR(ast);
+    /* A case-folded item can begin with more than one byte, e.g. 'a' or
+       'A', so it can't be found by a single byte scan.  We stop the prefix
+       there and leave the rest to laset. */
+    else return FALSE;
+    SCM_FOR_EACH(ip, items) {
+        if (!literal_prefix_rec(SCM_CAR(ip), ds)) return FALSE;
+    }
+    return TRUE;
+}
+
+/* Returns a string every match of AST must begin with, or NULL if there's
+   no such string, e.g. #/abc(d|e)/ => "abc".  See scan_prefix for how
+   it is used. */
+static ScmString *literal_prefix(ScmObj ast)
+{
+    ScmDString ds;
+    Scm_DStringInit(&ds);
+    literal_prefix_rec(ast, &ds);
+    if (Scm_DStringSize(&ds) == 0) return NULL;
+
+    ScmString *s = SCM_STRING(Scm_DStringGet(&ds, SCM_STRING_IMMUTABLE));
+    const char *z = SCM_STRING_BODY_START(SCM_STRING_BODY(s));
+    if (!byte_scannable((unsigned char)z[0])) return NULL;
+    return s;
+}
+
 /* returns lookahead set.  modifies the first arg.  */
 static ScmObj merge_laset(ScmObj la1, ScmObj la2)
 {
@@ -1851,6 +1907,9 @@ static ScmObj rc3(regcomp_ctx *ctx, ScmObj ast)
     if (is_bol_anchored(ast)) ctx->rx->flags |= SCM_REGEXP_BOL_ANCHORED;
     else if (is_simple_prefixed(ast)) ctx->rx->flags |= SCM_REGEXP_SIMPLE_PREFIX;
     ctx->rx->laset = calculate_laset(ast, SCM_NIL);
+    if (!(ctx->rx->flags & SCM_REGEXP_BOL_ANCHORED) && !ctx->casefoldp) {
+        ctx->rx->mustMatch = literal_prefix(ast);
+    }
 
     /* pass 3-1 : count # of insns */
     ctx->codemax = 1;
@@ -2682,52 +2741,81 @@ static void rex_rec(const unsigned char *code,
     }
 }
 
-static ScmObj make_match(ScmRegexp *rx, ScmString *orig,
-                         struct match_ctx *ctx)
+/* Set up the submatch records before trying a match.  We keep using
+   the same records as far as the match fails, and also across the
+   matches if we're iterating over matches. */
+static struct ScmRegMatchSub **alloc_matches(int num)
+{
+    struct ScmRegMatchSub **matches =
+        SCM_NEW_ARRAY(struct ScmRegMatchSub *, num);
+    for (int i = 0; i < num; i++) {
+        matches[i] = SCM_NEW(struct ScmRegMatchSub);
+    }
+    return matches;
+}
+
+static void reset_matches(struct ScmRegMatchSub **matches, int num)
+{
+    for (int i = 0; i < num; i++) {
+        matches[i]->start = -1;
+        matches[i]->length = -1;
+        matches[i]->after = -1;
+        matches[i]->startp = NULL;
+        matches[i]->endp = NULL;
+    }
+}
+
+static void init_match(ScmRegMatch *rm, ScmRegexp *rx,
+                       const char *input, int size, int len,
+                       struct ScmRegMatchSub **matches)
 {
-    ScmRegMatch *rm = SCM_NEW(ScmRegMatch);
     SCM_SET_CLASS(rm, SCM_CLASS_REGMATCH);
     rm->numMatches = rx->numGroups;
     rm->grpNames = rx->grpNames;
+    rm->input = input;
+    rm->inputSize = size;
+    rm->inputLen = len;
+    rm->matches = matches;
+}
+
+static ScmObj make_match(ScmRegexp *rx, ScmString *orig,
+                         struct ScmRegMatchSub **matches)
+{
+    ScmRegMatch *rm = SCM_NEW(ScmRegMatch);
     /* we keep information of original string separately, instead of
        keeping a pointer to orig; For orig may be destructively modified,
        but its elements are not. */
     const ScmStringBody *origb = SCM_STRING_BODY(orig);
-    rm->input = SCM_STRING_BODY_START(origb);
-    rm->inputLen = SCM_STRING_BODY_LENGTH(origb);
-    rm->inputSize = SCM_STRING_BODY_SIZE(origb);
-    rm->matches = ctx->matches;
+    init_match(rm, rx, SCM_STRING_BODY_START(origb),
+               SCM_STRING_BODY_SIZE(origb), SCM_STRING_BODY_LENGTH(origb),
+               matches);
     return SCM_OBJ(rm);
 }
 
-static ScmObj rex(ScmRegexp *rx, ScmString *orig,
-                  const char *start, const char *end)
+/* Try to match RX at START.  INPUT and END delimit the input as seen from
+   the assertions such as ^, $ and lookbehind; START may be after INPUT.
+   Returns TRUE and fills MATCHES on success. */
+static int rex(ScmRegexp *rx, const char *input,
+               const char *start, const char *end,
+               struct ScmRegMatchSub **matches)
 {
     struct match_ctx ctx;
     sigjmp_buf cont;
 
     ctx.rx = rx;
     ctx.codehead = rx->code;
-    ctx.input = SCM_STRING_BODY_START(SCM_STRING_BODY(orig));
+    ctx.input = input;
     ctx.stop = end;
     ctx.begin_stack = (void*)&ctx;
     ctx.cont = &cont;
-    ctx.matches = SCM_NEW_ARRAY(struct ScmRegMatchSub *, rx->numGroups);
-
-    for (int i = 0; i < rx->numGroups; i++) {
-        ctx.matches[i] = SCM_NEW(struct ScmRegMatchSub);
-        ctx.matches[i]->start = -1;
-        ctx.matches[i]->length = -1;
-        ctx.matches[i]->after = -1;
-        ctx.matches[i]->startp = NULL;
-        ctx.matches[i]->endp = NULL;
-    }
+    ctx.matches = matches;
+    reset_matches(matches, rx->numGroups);
 
     if (sigsetjmp(cont, FALSE) == 0) {
         rex_rec(ctx.codehead, start, &ctx);
-        return SCM_FALSE;
+        return FALSE;
     }
-    return make_match(rx, orig, &ctx);
+    return TRUE;
 }
 
 /* advance start pointer while the character matches (skip_match=TRUE) or does
@@ -2735,6 +2823,20 @@ static ScmObj rex(ScmRegexp *rx, ScmString *orig,
 static inline const char *skip_input(const char *start, const char *limit,
                                      ScmObj laset, int skip_match)
 {
+    /* If laset only contains ASCII chars, we can look at bytes without
+       decoding characters; non-ASCII bytes are never in the set, and
+       we never stop in the middle of a multibyte character as far as
+       byte_scannable() says so. */
+    if (SCM_CHAR_SET_SMALLP(laset) && byte_scannable(0)) {
+        const ScmBits *small = SCM_CHAR_SET(laset)->small;
+        for (; start <= limit; start++) {
+            unsigned char b = (unsigned char)*start;
+            int in = (b < SCM_CHAR_SET_SMALL_CHARS && SCM_BITS_TEST(small, b));
+            if (in != skip_match) return start;
+        }
+        return limit;
+    }
+
     while (start <= limit) {
         ScmChar ch;
         SCM_CHAR_GET(start, ch);
@@ -2748,47 +2850,62 @@ static inline const char *skip_input(const char *start, const char *limit,
     return limit;
 }
 
-/*----------------------------------------------------------------------
- * entry point
- */
-ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *str)
+/* Returns the first position between start and limit (inclusive) where
+   the literal prefix of the regexp appears, or NULL if there's none.
+   We let memchr find the candidates, since the libc versions usually
+   scan the input by words or by vector instructions, much faster than
+   we can check it char by char. */
+/* Returns the first position between START and LIMIT where PREFIX appears,
+   or NULL.  We look for the first byte with memchr, which the C library
+   usually implements word-at-a-time, and compare the rest only there.
+   It is much cheaper than running rex() at every character position. */
+static inline const char *scan_prefix(const char *start, const char *limit,
+                                      const char *prefix, int size)
+{
+    int c0 = (unsigned char)prefix[0];
+    while (start <= limit) {
+        const char *p = memchr(start, c0, limit - start + 1);
+        if (p == NULL) return NULL;
+        if (memcmp(p+1, prefix+1, size-1) == 0) return p;
+        start = p + 1;
+    }
+    return NULL;
+}
+
+/* Search the leftmost match of RX in the range between START and END.
+   INPUT is the beginning of the whole input (see rex()).  Returns TRUE
+   and fills MATCHES if found. */
+static int rex_search(ScmRegexp *rx, const char *input,
+                      const char *start, const char *end,
+                      struct ScmRegMatchSub **matches)
 {
-    const ScmStringBody *b = SCM_STRING_BODY(str);
-    const char *start = SCM_STRING_BODY_START(b);
-    const char *end = start + SCM_STRING_BODY_SIZE(b);
     const ScmStringBody *mb = rx->mustMatch? SCM_STRING_BODY(rx->mustMatch) : NULL;
     int mustMatchLen = mb? SCM_STRING_BODY_SIZE(mb) : 0;
     const char *start_limit = end - mustMatchLen;
 
-    if (SCM_STRING_INCOMPLETE_P(str)) {
-        Scm_Error("incomplete string is not allowed: %S", str);
-    }
-#if 0
-    /* Disabled for now; we need to use more heuristics to determine
-       when we should apply mustMatch.  For example, if the regexp
-       begins with BOL assertion and constant string, then it would be
-       faster to go for rex directly. */
-    if (rx->mustMatch) {
-        /* Prescreening.  If the input string doesn't contain mustMatch
-           string, it can't match the entire expression. */
-        if (SCM_FALSEP(Scm_StringScan(str, rx->mustMatch,
-                                      SCM_STRING_SCAN_INDEX))) {
-            return SCM_FALSE;
-        }
-    }
-#endif
     /* short cut : if rx matches only at the beginning of the string,
        we only run from the beginning of the string */
     if (rx->flags & SCM_REGEXP_BOL_ANCHORED) {
-        return rex(rx, str, start, end);
+        return rex(rx, input, start, end, matches);
+    }
+
+    /* if every match begins with a literal string, we jump directly
+       to where it appears. */
+    if (mb) {
+        const char *prefix = SCM_STRING_BODY_START(mb);
+        for (;;) {
+            start = scan_prefix(start, start_limit, prefix, mustMatchLen);
+            if (start == NULL) return FALSE;
+            if (rex(rx, input, start, end, matches)) return TRUE;
+            start += SCM_CHAR_NFOLLOWS(*start)+1;
+        }
     }
 
     /* if we have lookahead-set, we may be able to skip input efficiently. */
     if (!SCM_FALSEP(rx->laset)) {
         if (rx->flags & SCM_REGEXP_SIMPLE_PREFIX) {
             while (start <= start_limit) {
-                ScmObj r = rex(rx, str, start, end);
-                if (!SCM_FALSEP(r)) return r;
+                if (rex(rx, input, start, end, matches)) return TRUE;
                 const char *next = skip_input(start, start_limit, rx->laset,
                                               TRUE);
                 if (start != next) start = next;
@@ -2797,23 +2914,98 @@ ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *str)
         } else {
             while (start <= start_limit) {
                 start = skip_input(start, start_limit, rx->laset, FALSE);
-                ScmObj r = rex(rx, str, start, end);
-                if (!SCM_FALSEP(r)) return r;
+                if (rex(rx, input, start, end, matches)) return TRUE;
                 start += SCM_CHAR_NFOLLOWS(*start)+1;
             }
         }
-        return SCM_FALSE;
+        return FALSE;
     }
 
     /* normal matching */
     while (start <= start_limit) {
-        ScmObj r = rex(rx, str, start, end);
-        if (!SCM_FALSEP(r)) return r;
+        if (rex(rx, input, start, end, matches)) return TRUE;
         start += SCM_CHAR_NFOLLOWS(*start)+1;
     }
+    return FALSE;
+}
+
+/*----------------------------------------------------------------------
+ * entry point
+ */
+ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *str)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    const char *start = SCM_STRING_BODY_START(b);
+    const char *end = start + SCM_STRING_BODY_SIZE(b);
+
+    if (SCM_STRING_INCOMPLETE_P(str)) {
+        Scm_Error("incomplete string is not allowed: %S", str);
+    }
+    struct ScmRegMatchSub **matches = alloc_matches(rx->numGroups);
+    if (rex_search(rx, start, start, end, matches)) {
+        return make_match(rx, str, matches);
+    }
     return SCM_FALSE;
 }
 
+/*----------------------------------------------------------------------
+ * Iterating over matches
+ */
+
+/* An iterator keeps a single match record and reuses it for every
+   match, so that scanning a large input doesn't allocate anything
+   per match.  The ScmRegMatch returned from Scm_RegMatchIterNext is
+   valid only until the next call, and must not be passed to Scheme
+   world.  The matches don't overlap; after an empty match, the next
+   search begins from the next character. */
+void Scm_RegMatchIterInit(ScmRegMatchIter *iter, ScmRegexp *rx,
+                          ScmString *str)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    if (SCM_STRING_BODY_INCOMPLETE_P(b)) {
+        Scm_Error("incomplete string is not allowed: %S", str);
+    }
+    iter->rx = rx;
+    iter->input = SCM_STRING_BODY_START(b);
+    iter->end = iter->input + SCM_STRING_BODY_SIZE(b);
+    iter->next = iter->input;
+    iter->counted = iter->input;
+    iter->count = 0;
+    init_match(&iter->match, rx, iter->input,
+               SCM_STRING_BODY_SIZE(b), SCM_STRING_BODY_LENGTH(b),
+               alloc_matches(rx->numGroups));
+}
+
+ScmRegMatch *Scm_RegMatchIterNext(ScmRegMatchIter *iter)
+{
+    if (iter->next == NULL) return NULL;
+    if (!rex_search(iter->rx, iter->input, iter->next, iter->end,
+                    iter->match.matches)) {
+        iter->next = NULL;
+        return NULL;
+    }
+    struct ScmRegMatchSub *m = iter->match.matches[0];
+    if (m->endp != m->startp) iter->next = m->endp;
+    else if (m->endp < iter->end)
+        iter->next = m->endp + SCM_CHAR_NFOLLOWS(*m->endp) + 1;
+    else iter->next = NULL;
+    return &iter->match;
+}
+
+/* Returns the character index of P in the input.  To avoid counting
+   from the beginning every time, P must not precede the position
+   given in the previous call. */
+int Scm_RegMatchIterCharIndex(ScmRegMatchIter *iter, const char *p)
+{
+    SCM_ASSERT(p >= iter->counted && p <= iter->end);
+    if (SCM_REG_MATCH_SINGLE_BYTE_P(&iter->match)) {
+        return (int)(p - iter->input);
+    }
+    iter->count += Scm_MBLen(iter->counted, p);
+    iter->counted = p;
+    return iter->count;
+}
+
 /*=======================================================================
  * Retrieving matches
  */
@@ -2976,6 +3168,119 @@ ScmObj Scm_RegMatchAfter(ScmRegMatch *rm, ScmObj obj)
                           sub->after, 0);
 }
 
+/*----------------------------------------------------------------------
+ * Global replacement and split
+ */
+
+/* Both operations are defined in terms of repeatedly matching against
+   the rest of the input after the last match, i.e. anchors like ^ match
+   at the beginning of the rest.  We keep that semantics, but we avoid
+   creating substrings and match objects, except when we have to pass
+   a match to a user procedure. */
+
+/* Writes the substitution for a match in RM, a view of the rest of the
+   input.  SUBPAT is either a procedure, which is called with a match
+   object, or a list of strings, integers and symbols, the latter two
+   refer to submatches (see %regexp-parse-subpattern in librx.scm). */
+static void write_substitution(ScmRegMatch *rm, ScmObj subpat, ScmPort *out)
+{
+    if (SCM_PROCEDUREP(subpat)) {
+        ScmRegMatch *m = SCM_NEW(ScmRegMatch);
+        struct ScmRegMatchSub **subs = alloc_matches(rm->numMatches);
+        for (int i = 0; i < rm->numMatches; i++) *subs[i] = *rm->matches[i];
+        *m = *rm;
+        if (m->inputLen < 0) {
+            m->inputLen = Scm_MBLen(rm->input, rm->input + rm->inputSize);
+        }
+        m->matches = subs;
+        Scm_Write(Scm_ApplyRec1(subpat, SCM_OBJ(m)), SCM_OBJ(out),
+                  SCM_WRITE_DISPLAY);
+        return;
+    }
+
+    ScmObj sp;
+    SCM_FOR_EACH(sp, subpat) {
+        ScmObj pat = SCM_CAR(sp);
+        if (SCM_STRINGP(pat)) {
+            Scm_Puts(SCM_STRING(pat), out);
+        } else {
+            struct ScmRegMatchSub *sub = regmatch_ref(rm, pat);
+            if (sub == NULL) {
+                /* we display #f for unmatched submatch for the
+                   backward compatibility. */
+                Scm_Write(SCM_FALSE, SCM_OBJ(out), SCM_WRITE_DISPLAY);
+            } else {
+                Scm_Putz(sub->startp, MSUB_SIZE(rm, sub), out);
+            }
+        }
+    }
+}
+
+/* Replaces all matches of RX in STR by SUBPAT, writing the result to OUT.
+   Returns FALSE without writing anything if there's no match at all.
+   The result is written as we go, so if an error is signaled in the
+   middle, what has been written stays in OUT. */
+int Scm_RegReplaceAll(ScmRegexp *rx, ScmString *str, ScmObj subpat,
+                      ScmPort *out)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    const char *pos = SCM_STRING_BODY_START(b);
+    const char *end = pos + SCM_STRING_BODY_SIZE(b);
+    int singlebyte = SCM_STRING_BODY_SINGLE_BYTE_P(b);
+    struct ScmRegMatchSub **matches = alloc_matches(rx->numGroups);
+    ScmRegMatch rm;
+
+    if (SCM_STRING_BODY_INCOMPLETE_P(b)) {
+        Scm_Error("incomplete string is not allowed: %S", str);
+    }
+    if (!rex_search(rx, pos, pos, end, matches)) return FALSE;
+    for (;;) {
+        struct ScmRegMatchSub *m = matches[0];
+        init_match(&rm, rx, pos, (int)(end - pos),
+                   singlebyte? (int)(end - pos) : -1, matches);
+        Scm_Putz(pos, (int)(m->startp - pos), out);
+        write_substitution(&rm, subpat, out);
+        pos = m->endp;
+        if (pos == end) break;
+        if (!rex_search(rx, pos, pos, end, matches)) {
+            Scm_Putz(pos, (int)(end - pos), out);
+            break;
+        }
+        if (matches[0]->startp == matches[0]->endp) {
+            Scm_Error("regexp-replace-all: matching zero-length string "
+                      "causes infinite loop: %S", rx);
+        }
+    }
+    return TRUE;
+}
+
+/* Splits STR by the matches of RX, up to LIMIT times (negative LIMIT
+   means no limit).  Returns a list of strings. */
+ScmObj Scm_RegSplit(ScmRegexp *rx, ScmString *str, int limit)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    const char *pos = SCM_STRING_BODY_START(b);
+    const char *end = pos + SCM_STRING_BODY_SIZE(b);
+    struct ScmRegMatchSub **matches = alloc_matches(rx->numGroups);
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+
+    if (SCM_STRING_BODY_INCOMPLETE_P(b)) {
+        Scm_Error("incomplete string is not allowed: %S", str);
+    }
+    for (; limit != 0; limit--) {
+        if (!rex_search(rx, pos, pos, end, matches)) break;
+        if (matches[0]->endp == pos) {
+            Scm_Error("string-split: splitter must not match a null string: "
+                      "%S", rx);
+        }
+        SCM_APPEND1(h, t, Scm_MakeString(pos, (int)(matches[0]->startp - pos),
+                                         -1, 0));
+        pos = matches[0]->endp;
+    }
+    SCM_APPEND1(h, t, Scm_MakeString(pos, (int)(end - pos), -1, 0));
+    return h;
+}
+
 /* for debug */
 void Scm_RegMatchDump(ScmRegMatch *rm)
 {
@@ -35,6 +35,12 @@
 #include "gauche.h"
 #include "gauche/priv/builtin-syms.h"
 
+/* Platforms that lack reliable atomic operations; see lazy.c. */
+#if defined(__SH4__) || defined(__ARMEL__)
+#define AO_USE_PTHREAD_DEFS 1
+#endif
+#include "atomic_ops.h"
+
 /*-----------------------------------------------------------
  * Symbols
  */
@@ -55,28 +61,142 @@ SCM_DEFINE_BUILTIN_CLASS(Scm_KeywordClass, symbol_print,
 SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_KeywordClass, symbol_print);
 #endif /*!GAUCHE_UNIFY_SYMBOL_KEYWORD*/
 
+/*-----------------------------------------------------------
+ * Name tables
+ *
+ *   Maps a name to an interned symbol (or keyword).  Since symbols are
+ *   interned all the time by the reader, looking up an existing one
+ *   doesn't take a lock.
+ *
+ *   The table is an open-addressing hash table with linear probing.
+ *   Entries are only added; never removed nor moved.  A writer fills
+ *   the name of an empty slot, then publishes the value with a release
+ *   store, so a reader that sees the value with an acquire load sees
+ *   the name as well.  Writers are serialized by the mutex.  When the
+ *   table gets half full, the writer copies it to a table of double
+ *   size and replaces the table pointer.  A reader still scanning the
+ *   old table sees a consistent, though possibly stale, view; if it
+ *   misses, it retries with the mutex held.
+ */
+
+typedef struct nametab_entry_rec {
+    volatile AO_t name;         /* ScmString* */
+    volatile AO_t value;        /* ScmObj, or 0 if the slot is empty */
+} nametab_entry;
+
+typedef struct nametab_rec {
+    u_long size;                /* power of 2 */
+    u_long count;
+    nametab_entry *entries;
+} nametab;
+
+typedef struct nametab_ref_rec {
+    volatile AO_t table;        /* nametab* */
+    ScmInternalMutex mutex;
+} nametab_ref;
+
+static nametab *nametab_new(u_long size)
+{
+    nametab *t = SCM_NEW(nametab);
+    t->size = size;
+    t->count = 0;
+    t->entries = SCM_NEW_ARRAY(nametab_entry, size);
+    return t;
+}
+
+static void nametab_init(nametab_ref *ref, u_long size)
+{
+    SCM_INTERNAL_MUTEX_INIT(ref->mutex);
+    AO_store_release(&ref->table, (AO_t)nametab_new(size));
+}
+
+/* Returns the value for NAME, or NULL. */
+static ScmObj nametab_find(nametab *t, ScmString *name, u_long hv)
+{
+    u_long mask = t->size - 1;
+    for (u_long i = hv & mask;; i = (i+1) & mask) {
+        AO_t v = AO_load_acquire(&t->entries[i].value);
+        if (v == 0) return NULL;
+        if (Scm_StringEqual(SCM_STRING(t->entries[i].name), name)) {
+            return SCM_OBJ(v);
+        }
+    }
+}
+
+/* Must be called with the mutex held. */
+static void nametab_put(nametab *t, ScmString *name, u_long hv, ScmObj value)
+{
+    u_long mask = t->size - 1;
+    u_long i = hv & mask;
+    while (t->entries[i].value != 0) i = (i+1) & mask;
+    t->entries[i].name = (AO_t)name;
+    AO_store_release(&t->entries[i].value, (AO_t)value);
+    t->count++;
+}
+
+/* Must be called with the mutex held. */
+static nametab *nametab_grow(nametab *t)
+{
+    nametab *nt = nametab_new(t->size * 2);
+    for (u_long i=0; i<t->size; i++) {
+        if (t->entries[i].value == 0) continue;
+        ScmString *name = SCM_STRING(t->entries[i].name);
+        nametab_put(nt, name, Scm_HashString(name, 0),
+                    SCM_OBJ(t->entries[i].value));
+    }
+    return nt;
+}
+
+static ScmObj nametab_ref_find(nametab_ref *ref, ScmString *name)
+{
+    nametab *t = (nametab*)AO_load_acquire(&ref->table);
+    return nametab_find(t, name, Scm_HashString(name, 0));
+}
+
+/* Returns the value registered for NAME.  If there's none, registers
+   VALUE and returns it. */
+static ScmObj nametab_ref_add(nametab_ref *ref, ScmString *name, ScmObj value)
+{
+    u_long hv = Scm_HashString(name, 0);
+    ScmObj r;
+    SCM_INTERNAL_MUTEX_LOCK(ref->mutex);
+    nametab *t = (nametab*)ref->table;
+    r = nametab_find(t, name, hv);
+    if (r == NULL) {
+        if ((t->count + 1) * 2 > t->size) {
+            t = nametab_grow(t);
+            AO_store_release(&ref->table, (AO_t)t);
+        }
+        nametab_put(t, name, hv, value);
+        r = value;
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(ref->mutex);
+    return r;
+}
+
 /* name -> symbol mapper */
-static ScmInternalMutex obtable_mutex = SCM_INTERNAL_MUTEX_INITIALIZER;
-static ScmHashTable *obtable = NULL;
+static nametab_ref obtable;
 
 #if !GAUCHE_UNIFY_SYMBOL_KEYWORD
 /* Global keyword table. */
-static struct {
-    ScmHashTable *table;
-    ScmInternalMutex mutex;
-} keywords = { NULL };
-
+static nametab_ref keywords;
 #endif /*!GAUCHE_UNIFY_SYMBOL_KEYWORD*/
 
+#if GAUCHE_UNIFY_SYMBOL_KEYWORD
+/* Set to a keyword once its constant binding in the keyword module
+   is defined, so that we don't need to redefine it afterwards.
+   NB: See the compatibility note in gauche/symbol.h; we only set
+   this bit on interned symbols. */
+#define SYMBOL_FLAG_KEYWORD_DEFINED  (1L<<1)
+#endif /*GAUCHE_UNIFY_SYMBOL_KEYWORD*/
+
 /* internal constructor.  NAME must be an immutable string. */
 static ScmSymbol *make_sym(ScmClass *klass, ScmString *name, int interned)
 {
     if (interned) {
         /* fast path */
-        SCM_INTERNAL_MUTEX_LOCK(obtable_mutex);
-        ScmObj e = Scm_HashTableRef(obtable, SCM_OBJ(name), SCM_FALSE);
-        SCM_INTERNAL_MUTEX_UNLOCK(obtable_mutex);
-        if (!SCM_FALSEP(e)) return SCM_SYMBOL(e);
+        ScmObj e = nametab_ref_find(&obtable, name);
+        if (e != NULL) return SCM_SYMBOL(e);
     }
 
     ScmSymbol *sym = SCM_NEW(ScmSymbol);
@@ -87,20 +207,21 @@ static ScmSymbol *make_sym(ScmClass *klass, ScmString *name, int interned)
     if (!interned) {
         return sym;
     } else {
-        /* Using SCM_DICT_NO_OVERWRITE ensures that if another thread interns
-           the same name symbol between above HashTableRef and here, we'll
-           get the already interned symbol. */
-        SCM_INTERNAL_MUTEX_LOCK(obtable_mutex);
-        ScmObj e = Scm_HashTableSet(obtable, SCM_OBJ(name), SCM_OBJ(sym),
-                                    SCM_DICT_NO_OVERWRITE);
-        SCM_INTERNAL_MUTEX_UNLOCK(obtable_mutex);
-        return SCM_SYMBOL(e);
+        /* If another thread interns the same name symbol between
+           the above lookup and here, we'll get the already interned
+           symbol. */
+        return SCM_SYMBOL(nametab_ref_add(&obtable, name, SCM_OBJ(sym)));
     }
 }
 
 /* Intern */
 ScmObj Scm_MakeSymbol(ScmString *name, int interned)
 {
+    if (interned) {
+        /* We don't need to copy NAME if the symbol is already there. */
+        ScmObj e = nametab_ref_find(&obtable, name);
+        if (e != NULL) return e;
+    }
     ScmObj sname = Scm_CopyStringWithFlags(name, SCM_STRING_IMMUTABLE,
                                            SCM_STRING_IMMUTABLE);
     return SCM_OBJ(make_sym(SCM_CLASS_SYMBOL, SCM_STRING(sname), interned));
@@ -114,23 +235,19 @@ ScmObj Scm_MakeKeyword(ScmString *name)
     ScmObj prefix = Scm_MakeString(":", 1, 1, SCM_STRING_IMMUTABLE);
     ScmObj sname = Scm_StringAppend2(SCM_STRING(prefix), name);
     ScmSymbol *s = make_sym(SCM_CLASS_KEYWORD, SCM_STRING(sname), TRUE);
-    Scm_DefineConst(Scm_KeywordModule(), s, SCM_OBJ(s));
+    if (!(s->flags & SYMBOL_FLAG_KEYWORD_DEFINED)) {
+        Scm_DefineConst(Scm_KeywordModule(), s, SCM_OBJ(s));
+        if (SCM_KEYWORDP(s)) s->flags |= SYMBOL_FLAG_KEYWORD_DEFINED;
+    }
     return SCM_OBJ(s);
 #else  /*!GAUCHE_UNIFY_SYMBOL_KEYWORD*/
-    (void)SCM_INTERNAL_MUTEX_LOCK(keywords.mutex);
-    ScmObj r = Scm_HashTableRef(keywords.table, SCM_OBJ(name), SCM_FALSE);
-    (void)SCM_INTERNAL_MUTEX_UNLOCK(keywords.mutex);
-
-    if (SCM_KEYWORDP(r)) return r;
+    ScmObj r = nametab_ref_find(&keywords, name);
+    if (r != NULL) return r;
 
     ScmKeyword *k = SCM_NEW(ScmKeyword);
     SCM_SET_CLASS(k, SCM_CLASS_KEYWORD);
     k->name = SCM_STRING(Scm_CopyString(name));
-    (void)SCM_INTERNAL_MUTEX_LOCK(keywords.mutex);
-    r = Scm_HashTableSet(keywords.table, SCM_OBJ(name), SCM_OBJ(k),
-                         SCM_DICT_NO_OVERWRITE);
-    (void)SCM_INTERNAL_MUTEX_UNLOCK(keywords.mutex);
-    return r;
+    return nametab_ref_add(&keywords, k->name, SCM_OBJ(k));
 #endif /*!GAUCHE_UNIFY_SYMBOL_KEYWORD*/
 }
 
@@ -380,12 +497,10 @@ ScmObj Scm_DeleteKeywordX(ScmObj key, ScmObj list)
 
 void Scm__InitSymbol(void)
 {
-    SCM_INTERNAL_MUTEX_INIT(obtable_mutex);
-    obtable = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_STRING, 4096));
+    nametab_init(&obtable, 8192);
     init_builtin_syms();
 #if !GAUCHE_UNIFY_SYMBOL_KEYWORD
-    (void)SCM_INTERNAL_MUTEX_INIT(keywords.mutex);
-    keywords.table = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_STRING, 256));
+    nametab_init(&keywords, 512);
 #else
     /* Temporary: In order to compile 0.9.4 source by 0.9.3.  Should be
        removed after 0.9.4 release.  See lib/gauche/cgen/cise.scm */
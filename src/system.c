@@ -76,6 +76,9 @@ static int win_wait_for_handles(HANDLE *handles, int nhandles, int options,
 #ifdef HAVE_SCHED_H
 #include <sched.h>
 #endif
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
 
 /*
  * Auxiliary system interface functions.   See syslib.stub for
@@ -2146,6 +2149,99 @@ ScmObj Scm_SysSelectX(ScmObj rfds, ScmObj wfds, ScmObj efds, ScmObj timeout)
 
 #endif /* HAVE_SELECT */
 
+/* Waits until some of the fds in the list RFDS become readable, or
+   ones in WFDS become writable, or TIMEOUT microseconds passes (#f to
+   wait indefinitely).  Returns two lists of the ready fds.
+   We use poll(2) whenever possible, since select(2) can't handle fds
+   beyond FD_SETSIZE (usually 1024) at all, regardless of how many fds
+   we wait on.  A closed or invalid fd is reported as ready, so that
+   the waiter finds out the error when it touches it. */
+ScmObj Scm__PollFds(ScmObj rfds, ScmObj wfds, ScmObj timeout)
+{
+    ScmObj rh = SCM_NIL, rt = SCM_NIL, wh = SCM_NIL, wt = SCM_NIL, cp;
+    int nr = Scm_Length(rfds), nw = Scm_Length(wfds), r;
+    long usec = -1;
+
+    if (nr < 0) Scm_Error("list of fds required, but got %S", rfds);
+    if (nw < 0) Scm_Error("list of fds required, but got %S", wfds);
+    if (!SCM_FALSEP(timeout)) {
+        usec = Scm_GetInteger(timeout);
+        if (usec < 0) usec = 0;
+    }
+#if defined(HAVE_POLL) && !defined(GAUCHE_WINDOWS)
+    struct pollfd *pfds = SCM_NEW_ATOMIC_ARRAY(struct pollfd, nr+nw);
+    int i = 0, ms;
+    SCM_FOR_EACH(cp, rfds) {
+        pfds[i].fd = Scm_GetInteger(SCM_CAR(cp));
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+        i++;
+    }
+    SCM_FOR_EACH(cp, wfds) {
+        pfds[i].fd = Scm_GetInteger(SCM_CAR(cp));
+        pfds[i].events = POLLOUT;
+        pfds[i].revents = 0;
+        i++;
+    }
+    if (usec < 0)                      ms = -1;
+    else if (usec / 1000 >= INT_MAX)   ms = INT_MAX;
+    else                               ms = (int)((usec + 999) / 1000);
+    SCM_SYSCALL(r, poll(pfds, nr+nw, ms));
+    if (r < 0) Scm_SysError("poll failed");
+    for (i = 0; r > 0 && i < nr+nw; i++) {
+        if (pfds[i].revents == 0) continue;
+        if (i < nr) SCM_APPEND1(rh, rt, Scm_MakeInteger(pfds[i].fd));
+        else        SCM_APPEND1(wh, wt, Scm_MakeInteger(pfds[i].fd));
+    }
+#elif defined(HAVE_SELECT)
+    fd_set rs, ws;
+    struct timeval tm, *tp = NULL;
+    int maxfd = -1;
+    FD_ZERO(&rs);
+    FD_ZERO(&ws);
+    SCM_FOR_EACH(cp, rfds) {
+        int fd = Scm_GetInteger(SCM_CAR(cp));
+#if !defined(GAUCHE_WINDOWS)
+        if (fd < 0 || fd >= FD_SETSIZE) {
+            Scm_Error("file descriptor out of range for select(2): %d", fd);
+        }
+#endif /*!GAUCHE_WINDOWS*/
+        FD_SET(fd, &rs);
+        if (fd > maxfd) maxfd = fd;
+    }
+    SCM_FOR_EACH(cp, wfds) {
+        int fd = Scm_GetInteger(SCM_CAR(cp));
+#if !defined(GAUCHE_WINDOWS)
+        if (fd < 0 || fd >= FD_SETSIZE) {
+            Scm_Error("file descriptor out of range for select(2): %d", fd);
+        }
+#endif /*!GAUCHE_WINDOWS*/
+        FD_SET(fd, &ws);
+        if (fd > maxfd) maxfd = fd;
+    }
+    if (usec >= 0) {
+        tm.tv_sec = usec / 1000000;
+        tm.tv_usec = usec % 1000000;
+        tp = &tm;
+    }
+    SCM_SYSCALL(r, select(maxfd+1, &rs, &ws, NULL, tp));
+    if (r < 0) Scm_SysError("select failed");
+    SCM_FOR_EACH(cp, rfds) {
+        if (FD_ISSET(Scm_GetInteger(SCM_CAR(cp)), &rs)) {
+            SCM_APPEND1(rh, rt, SCM_CAR(cp));
+        }
+    }
+    SCM_FOR_EACH(cp, wfds) {
+        if (FD_ISSET(Scm_GetInteger(SCM_CAR(cp)), &ws)) {
+            SCM_APPEND1(wh, wt, SCM_CAR(cp));
+        }
+    }
+#else  /*!HAVE_POLL && !HAVE_SELECT*/
+    Scm_Error("waiting on file descriptors isn't supported on this platform");
+#endif /*!HAVE_POLL && !HAVE_SELECT*/
+    return Scm_Values2(rh, wh);
+}
+
 /*===============================================================
  * Environment
  */
@@ -50,6 +50,17 @@
 static void **vm_stack_free_list;
 static int vm_stack_kind;
 static int vm_stack_mark_proc;
+
+/* Each stack segment is preceded by this header.  LIMIT is the number
+   of words vm_stack_mark scans while the segment isn't the current one
+   of VM; the current one is scanned up to VM's SP. */
+typedef struct vm_stack_header_rec {
+    ScmVM *vm;                  /* owner, or NULL if pooled */
+    long size;                  /* # of words in the segment */
+    long limit;                 /* # of words in use */
+} vm_stack_header;
+
+#define STACK_HEADER(stack)  (((vm_stack_header*)(stack))-1)
 #endif /*USE_CUSTOM_STACK_MARKER*/
 
 /* Switch auto-unboxing (Remove this after 0.9.4 release)
@@ -121,6 +132,12 @@ static ScmEnvFrame ccEnvMark = {
 
 #define C_CONTINUATION_P(cont)  ((cont)->env == &ccEnvMark)
 
+/* The bottom frame of a coroutine stack.  See "Coroutines" below. */
+static ScmObj coroutine_finish_cc(ScmObj result, void **data);
+static void coroutine_leave(ScmVM *vm, ScmCoroutine *target);
+#define COROUTINE_BASE_P(cont) \
+    (C_CONTINUATION_P(cont) && (cont)->pc == (ScmWord*)coroutine_finish_cc)
+
 /* A dummy compiled code structure used as 'fill-in', when Scm_Apply
    is called without any VM code running.  See Scm_Apply below. */
 static ScmCompiledCode internal_apply_compiled_code =
@@ -158,7 +175,9 @@ static DWORD vm_key;
 static ScmVM *theVM;
 #endif /* !GAUCHE_USE_PTHREADS */
 
-static void save_stack(ScmVM *vm);
+static void extend_stack(ScmVM *vm, long size);
+static ScmObj *new_stack_segment(ScmVM *vm, long size);
+static void leave_stack_segment(ScmVM *vm, ScmObj *limit);
 
 static ScmSubr default_exception_handler_rec;
 #define DEFAULT_EXCEPTION_HANDLER  SCM_OBJ(&default_exception_handler_rec)
@@ -198,12 +217,25 @@ static ScmEnvFrame *get_env(ScmVM *vm);
  *   thread.
  *   NOTE: the thread should still be created by Boehm-GC's pthread_create,
  *   for it is the only way for GC to see the thread's stack.
+ *
+ *   Scm_NewVMWithStackSize takes the size of the initial stack segment
+ *   in words.  If it is zero or negative, SCM_VM_STACK_SIZE is used.
+ *   The stack grows as needed, so a small size only costs some
+ *   segment switches when the thread happens to recurse deeply.
  */
 
 ScmVM *Scm_NewVM(ScmVM *proto, ScmObj name)
+{
+    return Scm_NewVMWithStackSize(proto, name, 0);
+}
+
+ScmVM *Scm_NewVMWithStackSize(ScmVM *proto, ScmObj name, long stackSize)
 {
     ScmVM *v = SCM_NEW(ScmVM);
 
+    if (stackSize <= 0) stackSize = SCM_VM_STACK_SIZE;
+    if (stackSize < SCM_VM_MIN_STACK_SIZE) stackSize = SCM_VM_MIN_STACK_SIZE;
+
     SCM_SET_CLASS(v, SCM_CLASS_VM);
     v->state = SCM_VM_NEW;
     (void)SCM_INTERNAL_MUTEX_INIT(v->vmlock);
@@ -231,19 +263,15 @@ ScmVM *Scm_NewVM(ScmVM *proto, ScmObj name)
     v->finalizerPending = 0;
     v->stopRequest = 0;
 
-#ifdef USE_CUSTOM_STACK_MARKER
-    v->stack = (ScmObj*)GC_generic_malloc((SCM_VM_STACK_SIZE+1)*sizeof(ScmObj),
-                                          vm_stack_kind);
-    *v->stack++ = SCM_OBJ(v);
-#else  /*!USE_CUSTOM_STACK_MARKER*/
-    v->stack = SCM_NEW_ARRAY(ScmObj, SCM_VM_STACK_SIZE);
-#endif /*!USE_CUSTOM_STACK_MARKER*/
+    v->stack = new_stack_segment(v, stackSize);
+    v->stackSize = stackSize;
     v->sp = v->stack;
     v->stackBase = v->stack;
-    v->stackEnd = v->stack + SCM_VM_STACK_SIZE;
+    v->stackEnd = v->stack + stackSize;
+    v->coroutine = NULL;
 #if GAUCHE_FFX
-    v->fpstack = SCM_NEW_ATOMIC_ARRAY(ScmFlonum, SCM_VM_STACK_SIZE);
-    v->fpstackEnd = v->fpstack + SCM_VM_STACK_SIZE;
+    v->fpstack = SCM_NEW_ATOMIC_ARRAY(ScmFlonum, stackSize);
+    v->fpstackEnd = v->fpstack + stackSize;
     v->fpsp = v->fpstack;
 #endif /* GAUCHE_FFX */
 
@@ -502,15 +530,18 @@ static void vm_unregister(ScmVM *vm)
 #define ARGP  (vm->argp)
 #define BASE  (vm->base)
 
-/* return true if ptr points into the stack area */
-#define IN_STACK_P(ptr)                         \
-      ((unsigned long)((ptr) - vm->stackBase) < SCM_VM_STACK_SIZE)
+/* return true if ptr points into the current stack segment.
+   The frames in the previous segments are treated as if they were
+   in the heap. */
+#define IN_STACK_P(ptr)                                         \
+      ((unsigned long)((ptr) - vm->stackBase)                   \
+       < (unsigned long)(vm->stackEnd - vm->stackBase))
 
-/* Check if stack has room at least size bytes. */
+/* Check if stack has room at least size words. */
 #define CHECK_STACK(size)                                       \
     do {                                                        \
         if (MOSTLY_FALSE(SP >= vm->stackEnd - (size))) {        \
-            save_stack(vm);                                     \
+            extend_stack(vm, (size));                           \
         }                                                       \
     } while (0)
 
@@ -1035,7 +1066,45 @@ static void save_cont(ScmVM *vm)
     }
 }
 
-static void save_stack(ScmVM *vm)
+/* Allocates a stack segment of SIZE words for VM. */
+static ScmObj *new_stack_segment(ScmVM *vm, long size)
+{
+#ifdef USE_CUSTOM_STACK_MARKER
+    vm_stack_header *h =
+        (vm_stack_header*)GC_generic_malloc(sizeof(vm_stack_header)
+                                            + size*sizeof(ScmObj),
+                                            vm_stack_kind);
+    h->vm = vm;
+    h->size = size;
+    h->limit = size;
+    return (ScmObj*)(h+1);
+#else  /*!USE_CUSTOM_STACK_MARKER*/
+    return SCM_NEW_ARRAY(ScmObj, size);
+#endif /*!USE_CUSTOM_STACK_MARKER*/
+}
+
+/* Called when VM switches away from the current stack segment.  Only
+   the words below LIMIT remain live in it. */
+static inline void leave_stack_segment(ScmVM *vm, ScmObj *limit)
+{
+#ifdef USE_CUSTOM_STACK_MARKER
+    STACK_HEADER(vm->stackBase)->limit = limit - vm->stackBase;
+#endif /*USE_CUSTOM_STACK_MARKER*/
+}
+
+/* Called when the current stack segment doesn't have room for SIZE
+   words.  We used to copy all the frames to the heap (save_cont) and
+   reuse the segment, which made deep recursion pay the copying over
+   and over.  Now we leave the frames where they are and switch to
+   a new segment; only the incomplete argument frame is moved.
+
+   The frames left in the old segment are never touched again by the
+   stack discipline: IN_STACK_P is false for them, so they're handled
+   just like the frames saved in the heap, and the segment is collected
+   once nothing refers to them.  The new segment is twice as large as
+   the old one up to SCM_VM_STACK_GROWTH_LIMIT times the initial size,
+   so a deep recursion needs only a few switches. */
+static void extend_stack(ScmVM *vm, long size)
 {
 #if HAVE_GETTIMEOFDAY
     int stats = SCM_VM_RUNTIME_FLAG_IS_SET(vm, SCM_COLLECT_VM_STATS);
@@ -1046,13 +1115,27 @@ static void save_stack(ScmVM *vm)
     }
 #endif
 
-    save_cont(vm);
-    memmove(vm->stackBase, vm->argp,
-            (vm->sp - (ScmObj*)vm->argp) * sizeof(ScmObj*));
-    vm->sp -= (ScmObj*)vm->argp - vm->stackBase;
-    vm->argp = vm->stackBase;
-    /* Clear the stack.  This removes bogus pointers and accelerates GC */
-    for (ScmObj *p = vm->sp; p < vm->stackEnd; p++) *p = NULL;
+#if GAUCHE_FFX
+    /* Scm_VMFlushFPStack only scans the current segment. */
+    if (vm->fpsp != vm->fpstack) Scm_VMFlushFPStack(vm);
+#endif
+
+    long argc = vm->sp - vm->argp;
+    long cursize = vm->stackEnd - vm->stackBase;
+    long newsize = cursize * 2;
+    if (newsize > vm->stackSize * SCM_VM_STACK_GROWTH_LIMIT) {
+        newsize = vm->stackSize * SCM_VM_STACK_GROWTH_LIMIT;
+    }
+    if (newsize < cursize) newsize = cursize;
+    if (newsize <= argc + size) newsize = argc + size + CONT_FRAME_SIZE;
+
+    ScmObj *stack = new_stack_segment(vm, newsize);
+    memcpy(stack, vm->argp, argc * sizeof(ScmObj));
+    leave_stack_segment(vm, vm->argp);
+    vm->stackBase = stack;
+    vm->stackEnd = stack + newsize;
+    vm->argp = stack;
+    vm->sp = stack + argc;
 
 #if HAVE_GETTIMEOFDAY
     if (stats) {
@@ -2151,6 +2234,7 @@ static ScmObj with_error_handler(ScmVM *vm, ScmObj handler,
     ep->ehandler = handler;
     ep->handlers = vm->handlers;
     ep->cstack = vm->cstack;
+    ep->coroutine = vm->coroutine;
     ep->xhandler = vm->exceptionHandler;
     ep->cont = vm->cont;
     ep->errorReporting =
@@ -2267,6 +2351,14 @@ static ScmObj throw_cont_body(ScmObj handlers,    /* after/before thunks
      */
     if (ep->cstack == NULL) save_cont(vm);
 
+    /*
+     * If we're escaping from coroutines by a full continuation captured
+     * outside of them, finish them.
+     */
+    if (ep->cstack != NULL && vm->coroutine != ep->coroutine) {
+        coroutine_leave(vm, ep->coroutine);
+    }
+
     /*
      * now, install the target continuation
      */
@@ -2356,6 +2448,7 @@ ScmObj Scm_VMCallCC(ScmObj proc)
     ep->cont = vm->cont;
     ep->handlers = vm->handlers;
     ep->cstack = vm->cstack;
+    ep->coroutine = vm->coroutine;
 
     ScmObj contproc = Scm_MakeSubr(throw_continuation, ep, 0, 1,
                                    SCM_MAKE_STR("continuation"));
@@ -2376,10 +2469,11 @@ ScmObj Scm_VMCallPC(ScmObj proc)
        performance we'll optimize it later. */
     save_cont(vm);
 
-    /* find the latest boundary frame */
+    /* find the latest boundary frame.  the bottom of a coroutine also
+       delimits the partial continuation. */
     ScmContFrame *c, *cp;
     for (c = vm->cont, cp = NULL;
-         c && !BOUNDARY_FRAME_P(c);
+         c && !BOUNDARY_FRAME_P(c) && !COROUTINE_BASE_P(c);
          cp = c, c = c->prev)
         /*empty*/;
 
@@ -2402,6 +2496,336 @@ ScmObj Scm_VMCallPC(ScmObj proc)
     return Scm_VMApply1(proc, contproc);
 }
 
+/*==============================================================
+ * Coroutines
+ */
+
+/* A coroutine runs a thunk on its own VM stack segment.  Resuming
+   and yielding just swap the VM registers with the ones saved in
+   the coroutine, so no frames are copied---unlike partial continuations,
+   which save the frames to the heap on every capture and copy them
+   back on every invocation.
+
+   - The bottom frame of the coroutine stack is a C continuation
+     (coroutine_finish_cc) whose prev is NULL; it switches back to the
+     resumer for the last time.  So the frames in a coroutine stack
+     never point to the frames in the resumer's stack segments.
+   - The coroutine stack starts small, and grows by extend_stack()
+     just like the VM stack.
+   - The thunk is run under an error handler that finishes the
+     coroutine and reraises the exception in the resumer.
+   - Each side has its own dynamic handlers and escape points.
+     A coroutine inherits them from the first resumer.
+   - A coroutine must yield on the same C stack it is resumed, i.e.
+     it can't yield from a callback called from C.
+   - Continuations captured within a coroutine are delimited by it.
+   - If a full continuation captured outside of a coroutine is invoked
+     within it (e.g. to break out of a generator), the coroutine is
+     finished when the continuation is installed (coroutine_leave).
+   - A suspended coroutine that becomes garbage returns its stack
+     segment to the pool by a finalizer.
+ */
+
+enum {
+    COROUTINE_NEW,
+    COROUTINE_RUNNING,
+    COROUTINE_SUSPENDED,
+    COROUTINE_DONE
+};
+
+typedef struct coroutine_regs_rec {
+    ScmCompiledCode *base;
+    SCM_PCTYPE pc;
+    ScmEnvFrame *env;
+    ScmContFrame *cont;
+    ScmObj *argp;
+    ScmObj *sp;
+    ScmObj *stackBase;
+    ScmObj *stackEnd;
+    ScmObj handlers;
+    ScmObj exceptionHandler;
+    ScmEscapePoint *escapePoint;
+    ScmEscapePoint *escapePointFloating;
+    ScmCoroutine *coroutine;
+} coroutine_regs;
+
+struct ScmCoroutineRec {
+    SCM_HEADER;
+    int state;
+    ScmObj thunk;
+    ScmObj exception;           /* raised from thunk, or SCM_UNBOUND */
+    ScmObj *stack;              /* initial stack segment, while active */
+    ScmCStack *cstack;          /* C stack on which we're resumed */
+    ScmEscapePoint *ep;         /* escape point to catch errors */
+    coroutine_regs regs;        /* registers of the other side; the
+                                   resumer's while we're running, and
+                                   ours while we're suspended */
+};
+
+static void coroutine_print(ScmObj obj, ScmPort *port,
+                            ScmWriteContext *ctx)
+{
+    static const char *states[] = { "new", "running", "suspended", "done" };
+    Scm_Printf(port, "#<coroutine %s %p>",
+               states[SCM_COROUTINE(obj)->state], obj);
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_CoroutineClass, coroutine_print);
+
+/* Most generators don't recurse deeply, so we start with a small
+   segment.  We keep a few of them to be reused, since typical generators
+   are short-lived. */
+#define COROUTINE_STACK_SIZE      SCM_VM_MIN_STACK_SIZE
+#define COROUTINE_STACK_POOL_SIZE 8
+
+static struct {
+    ScmObj *stacks[COROUTINE_STACK_POOL_SIZE];
+    int count;
+    ScmInternalMutex mutex;
+} coroutine_stack_pool;
+
+static ScmObj *coroutine_stack_get(ScmVM *vm)
+{
+    ScmObj *stack = NULL;
+    SCM_INTERNAL_MUTEX_LOCK(coroutine_stack_pool.mutex);
+    if (coroutine_stack_pool.count > 0) {
+        stack = coroutine_stack_pool.stacks[--coroutine_stack_pool.count];
+        coroutine_stack_pool.stacks[coroutine_stack_pool.count] = NULL;
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(coroutine_stack_pool.mutex);
+    if (stack == NULL) {
+        stack = new_stack_segment(vm, COROUTINE_STACK_SIZE);
+    }
+#ifdef USE_CUSTOM_STACK_MARKER
+    else {
+        STACK_HEADER(stack)->vm = vm;
+    }
+#endif /*USE_CUSTOM_STACK_MARKER*/
+    return stack;
+}
+
+static void coroutine_stack_release(ScmObj *stack)
+{
+    /* Clear the stack, so that it won't retain garbage. */
+    memset(stack, 0, COROUTINE_STACK_SIZE * sizeof(ScmObj));
+#ifdef USE_CUSTOM_STACK_MARKER
+    STACK_HEADER(stack)->vm = NULL;
+    STACK_HEADER(stack)->limit = COROUTINE_STACK_SIZE;
+#endif /*USE_CUSTOM_STACK_MARKER*/
+    SCM_INTERNAL_MUTEX_LOCK(coroutine_stack_pool.mutex);
+    if (coroutine_stack_pool.count < COROUTINE_STACK_POOL_SIZE) {
+        coroutine_stack_pool.stacks[coroutine_stack_pool.count++] = stack;
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(coroutine_stack_pool.mutex);
+}
+
+/* Marks CO finished.  STACK is its initial segment if it can be reused,
+   that is, if the stack hasn't grown; otherwise captured continuations
+   may refer to the frames left in it. */
+static void coroutine_done(ScmCoroutine *co, ScmObj *stack)
+{
+    co->state = COROUTINE_DONE;
+    co->thunk = SCM_FALSE;
+    co->stack = NULL;
+    co->ep = NULL;
+    memset(&co->regs, 0, sizeof(co->regs));
+    if (stack) coroutine_stack_release(stack);
+}
+
+/* A suspended coroutine is unreachable; nobody can refer to its stack. */
+static void coroutine_finalize(ScmObj obj, void *data)
+{
+    ScmCoroutine *co = SCM_COROUTINE(obj);
+    if (co->state == COROUTINE_SUSPENDED) {
+        coroutine_done(co, (co->regs.stackBase == co->stack)? co->stack : NULL);
+    }
+}
+
+/* Swap the VM registers with the ones saved in CO. */
+static void coroutine_switch(ScmVM *vm, ScmCoroutine *co)
+{
+    coroutine_regs r = co->regs;
+
+#if GAUCHE_FFX
+    /* The other side may reset the flonum stack, so we can't leave
+       flonum registers in our frames. */
+    if (vm->fpsp != vm->fpstack) Scm_VMFlushFPStack(vm);
+#endif
+    leave_stack_segment(vm, vm->sp);
+    co->regs.base = vm->base;
+    co->regs.pc = vm->pc;
+    co->regs.env = vm->env;
+    co->regs.cont = vm->cont;
+    co->regs.argp = vm->argp;
+    co->regs.sp = vm->sp;
+    co->regs.stackBase = vm->stackBase;
+    co->regs.stackEnd = vm->stackEnd;
+    co->regs.handlers = vm->handlers;
+    co->regs.exceptionHandler = vm->exceptionHandler;
+    co->regs.escapePoint = vm->escapePoint;
+    co->regs.escapePointFloating = vm->escapePointFloating;
+    co->regs.coroutine = vm->coroutine;
+
+    vm->base = r.base;
+    vm->pc = r.pc;
+    vm->env = r.env;
+    vm->cont = r.cont;
+    vm->argp = r.argp;
+    vm->sp = r.sp;
+    vm->stackBase = r.stackBase;
+    vm->stackEnd = r.stackEnd;
+    vm->handlers = r.handlers;
+    vm->exceptionHandler = r.exceptionHandler;
+    vm->escapePoint = r.escapePoint;
+    vm->escapePointFloating = r.escapePointFloating;
+    vm->coroutine = r.coroutine;
+}
+
+static ScmObj coroutine_catch(ScmObj *args, int nargs, void *data)
+{
+    SCM_COROUTINE(data)->exception = args[0];
+    return SCM_UNDEFINED;
+}
+
+ScmObj Scm_MakeCoroutine(ScmObj thunk)
+{
+    ScmCoroutine *co = SCM_NEW(ScmCoroutine);
+    SCM_SET_CLASS(co, SCM_CLASS_COROUTINE);
+    co->state = COROUTINE_NEW;
+    co->thunk = thunk;
+    co->exception = SCM_UNBOUND;
+    co->stack = NULL;
+    co->cstack = NULL;
+    co->ep = NULL;
+    return SCM_OBJ(co);
+}
+
+int Scm_CoroutineDoneP(ScmCoroutine *co)
+{
+    return co->state == COROUTINE_DONE;
+}
+
+/* Called as a SUBR.  Switches to CO, and returns when CO yields or
+   finishes.  VAL becomes the value of the yield in CO. */
+ScmObj Scm_VMCoroutineResume(ScmCoroutine *co, ScmObj val)
+{
+    ScmVM *vm = theVM;
+
+    switch (co->state) {
+    case COROUTINE_NEW: {
+        ScmObj *stack = coroutine_stack_get(vm);
+        co->regs.base = vm->base;
+        co->regs.pc = PC_TO_RETURN;
+        co->regs.env = NULL;
+        co->regs.cont = NULL;
+        co->regs.argp = co->regs.sp = stack;
+        co->regs.stackBase = stack;
+        co->regs.stackEnd = stack + COROUTINE_STACK_SIZE;
+        co->regs.handlers = vm->handlers;
+        co->regs.exceptionHandler = vm->exceptionHandler;
+        co->regs.escapePoint = vm->escapePoint;
+        co->regs.escapePointFloating = vm->escapePointFloating;
+        co->regs.coroutine = co;
+        co->stack = stack;
+        co->cstack = vm->cstack;
+        co->state = COROUTINE_RUNNING;
+        Scm_RegisterFinalizer(SCM_OBJ(co), coroutine_finalize, NULL);
+        coroutine_switch(vm, co);
+
+        void *data[1];
+        data[0] = co;
+        Scm_VMPushCC(coroutine_finish_cc, data, 1);
+        ScmObj catcher = Scm_MakeSubr(coroutine_catch, co, 1, 0, SCM_FALSE);
+        ScmObj r = with_error_handler(vm, catcher, co->thunk, TRUE);
+        co->ep = vm->escapePoint;
+        return r;
+    }
+    case COROUTINE_SUSPENDED:
+        /* The escape points created in the coroutine record the C stack
+           of the previous resume.  Redirect them to the current one. */
+        if (co->cstack != vm->cstack) {
+            for (ScmEscapePoint *ep = co->regs.escapePoint; ep; ep = ep->prev) {
+                if (ep->cstack == co->cstack) ep->cstack = vm->cstack;
+                if (ep == co->ep) break;
+            }
+            co->cstack = vm->cstack;
+        }
+        /* Continuable exceptions go to the current resumer's handlers. */
+        co->ep->prev = vm->escapePoint;
+        co->ep->xhandler = vm->exceptionHandler;
+        co->state = COROUTINE_RUNNING;
+        coroutine_switch(vm, co);
+        vm->numVals = 1;
+        return val;
+    case COROUTINE_RUNNING:
+        Scm_Error("coroutine is already running: %S", co);
+    default:
+        Scm_Error("coroutine has already finished: %S", co);
+    }
+    return SCM_UNDEFINED;       /* dummy */
+}
+
+/* Called as a SUBR within CO.  Switches back to the resumer, making
+   VAL the value of Scm_VMCoroutineResume. */
+ScmObj Scm_VMCoroutineYield(ScmCoroutine *co, ScmObj val)
+{
+    ScmVM *vm = theVM;
+
+    if (co->state != COROUTINE_RUNNING || vm->coroutine != co) {
+        Scm_Error("yield called outside of the coroutine: %S", co);
+    }
+    if (vm->cstack != co->cstack) {
+        Scm_Error("can't yield from a callback called from C: %S", co);
+    }
+    co->state = COROUTINE_SUSPENDED;
+    coroutine_switch(vm, co);
+    vm->numVals = 1;
+    return val;
+}
+
+static ScmObj coroutine_finish_cc(ScmObj result, void **data)
+{
+    ScmCoroutine *co = SCM_COROUTINE(data[0]);
+    ScmVM *vm = theVM;
+
+    if (co->state != COROUTINE_RUNNING || vm->coroutine != co) {
+        /* A continuation captured in CO is invoked outside of it. */
+        Scm_Error("attempt to return to an inactive coroutine: %S", co);
+    }
+    ScmObj *stack = (vm->stackBase == co->stack)? co->stack : NULL;
+    coroutine_switch(vm, co);
+    coroutine_done(co, stack);
+
+    vm->numVals = 1;
+    if (!SCM_UNBOUNDP(co->exception)) {
+        ScmObj e = co->exception;
+        co->exception = SCM_UNBOUND;
+        return Scm_Raise(e);
+    }
+    return result;
+}
+
+/* Called from throw_cont_body when a full continuation captured while
+   TARGET (possibly NULL) was running is invoked in another coroutine.
+   The coroutines above TARGET are switched out and finished, as if
+   they had returned; that pops their escape points and error handlers
+   as well.  The caller installs the continuation afterwards.
+   If TARGET isn't active, the continuation was captured in a finished
+   or suspended coroutine; we leave it to coroutine_finish_cc to
+   complain when it returns. */
+static void coroutine_leave(ScmVM *vm, ScmCoroutine *target)
+{
+    for (ScmCoroutine *c = vm->coroutine; c != target; c = c->regs.coroutine) {
+        if (c == NULL) return;
+    }
+    while (vm->coroutine != target) {
+        ScmCoroutine *co = vm->coroutine;
+        ScmObj *stack = (vm->stackBase == co->stack)? co->stack : NULL;
+        coroutine_switch(vm, co);
+        coroutine_done(co, stack);
+    }
+}
+
 /*==============================================================
  * Unwind protect API
  */
@@ -2770,7 +3194,7 @@ void Scm_VMDump(ScmVM *vm)
     Scm_Printf(out, "   pc: %08x ", vm->pc);
     Scm_Printf(out, "(%08x)\n", *vm->pc);
     Scm_Printf(out, "   sp: %p  base: %p  [%p-%p]\n", vm->sp, vm->stackBase,
-               vm->stack, vm->stackEnd);
+               vm->stackBase, vm->stackEnd);
     Scm_Printf(out, " argp: %p\n", vm->argp);
     Scm_Printf(out, " val0: %#65.1S\n", vm->val0);
 
@@ -2821,18 +3245,27 @@ struct GC_ms_entry *vm_stack_mark(GC_word *addr,
                                   GC_word env)
 {
     struct GC_ms_entry *e = mark_sp;
-    ScmObj *vmsb = ((ScmObj*)addr)+1;
-    ScmVM *vm = (ScmVM*)*addr;
-    int limit = vm->sp - vm->stackBase + 5;
-    void *spb = (void *)vm->stackBase;
-    void *sbe = (void *)(vm->stackBase + SCM_VM_STACK_SIZE);
+    vm_stack_header *h = (vm_stack_header*)addr;
+    ScmObj *vmsb = (ScmObj*)(h+1);
+    ScmVM *vm = h->vm;
+    long limit = h->limit;
+    void *spb = (void *)vmsb;
+    void *sbe = (void *)(vmsb + h->size);
     void *hb = GC_least_plausible_heap_addr;
     void *he = GC_greatest_plausible_heap_addr;
 
-    for (int i=0; i<limit; i++, vmsb++) {
+    if (vm != NULL) {
+        /* The segments may outlive the VM's reference to them, so we
+           keep the VM alive, for we look at its SP below. */
+        e = GC_mark_and_push((void *)vm, e, mark_sp_limit, (void *)addr);
+        if (vm->stackBase == vmsb) limit = vm->sp - vmsb + 5;
+    }
+    if (limit > h->size) limit = h->size;
+
+    for (long i=0; i<limit; i++, vmsb++) {
         ScmObj z = *vmsb;
         if ((hb < (void *)z && (void *)z < spb)
-            || ((void *)z > sbe && (void *)z < he)) {
+            || ((void *)z >= sbe && (void *)z < he)) {
             e = GC_mark_and_push((void *)z, e, mark_sp_limit, (void *)addr);
         }
     }
@@ -2851,11 +3284,12 @@ void Scm__InitVM(void)
     vm_stack_mark_proc = GC_new_proc(vm_stack_mark);
     vm_stack_kind = GC_new_kind(vm_stack_free_list,
                                 GC_MAKE_PROC(vm_stack_mark_proc, 0),
-                                0, 0);
+                                0, 1);
 #endif /*USE_CUSTOM_STACK_MARKER*/
 
     Scm_HashCoreInitSimple(&vm_table, SCM_HASH_EQ, 8, NULL);
     SCM_INTERNAL_MUTEX_INIT(vm_table_mutex);
+    SCM_INTERNAL_MUTEX_INIT(coroutine_stack_pool.mutex);
 
     /* Create root VM */
     rootVM = Scm_NewVM(NULL, SCM_MAKE_STR_IMMUTABLE("root"));
@@ -1463,3 +1463,94 @@
 
 (define-insn LREF-UNBOX 2 none (LREF UNBOX) #f :fold-lref)
 
+
+;;
+;; Type-specialized arithmetic
+;;
+;;  The compiler emits these only when it has proven the types of the
+;;  operands (see "Numeric type inference" in compile.scm), so they
+;;  don't dispatch on types.  The fixnum arithmetic doesn't check
+;;  overflow either, for the compiler has also proven the result
+;;  fits in a fixnum.
+;;
+;; FXADD2, FXSUB2       ; (POP) op VAL0
+;; FXADDI(i)            ; VAL0 + i
+;; FXSUBI(i)            ; i - VAL0
+;; FXEQ2 .. FXGE2       ; (POP) op VAL0
+;; BFXNE .. BFXNGE      ; fixnum versions of BNUMNE .. BNGE
+;; BFXNEI(i)            ; fixnum version of BNUMNEI
+;; LREF-VAL0-BFXNE ..   ; fixnum versions of LREF-VAL0-BNUMNE ..
+;; FLADD2 .. FLDIV2     ; (POP) op VAL0, flonums
+;;
+
+(define-cise-stmt $w/fxargs
+  [(_ x y . body)
+   `($w/argp ,x
+      (let* ([,y VAL0])
+        (VM-ASSERT (and (SCM_INTP ,x) (SCM_INTP ,y)))
+        ,@body))])
+
+(define-cise-stmt $w/fxcmp
+  [(_ r op . body)
+   (let ([x (gensym)] [y (gensym)])
+     `($w/fxargs ,x ,y
+        (let* ([,r :: int (,op (SCM_INT_VALUE ,x) (SCM_INT_VALUE ,y))])
+          ,@body)))])
+
+(define-cise-stmt $w/flargs
+  [(_ x y . body)
+   `($w/argp ,x
+      (let* ([,y VAL0])
+        (VM-ASSERT (and (SCM_FLONUMP ,x) (SCM_FLONUMP ,y)))
+        ,@body))])
+
+(define-insn FXADD2  0 none #f
+  ($w/fxargs x y ($result (SCM_MAKE_INT (+ (SCM_INT_VALUE x)
+                                           (SCM_INT_VALUE y))))))
+(define-insn FXSUB2  0 none #f
+  ($w/fxargs x y ($result (SCM_MAKE_INT (- (SCM_INT_VALUE x)
+                                           (SCM_INT_VALUE y))))))
+
+(define-insn FXADDI  1 none #f
+  (let* ([imm::long (SCM_VM_INSN_ARG code)])
+    ($w/argr v
+      (VM-ASSERT (SCM_INTP v))
+      ($result (SCM_MAKE_INT (+ (SCM_INT_VALUE v) imm))))))
+(define-insn FXSUBI  1 none #f
+  (let* ([imm::long (SCM_VM_INSN_ARG code)])
+    ($w/argr v
+      (VM-ASSERT (SCM_INTP v))
+      ($result (SCM_MAKE_INT (- imm (SCM_INT_VALUE v)))))))
+
+(define-insn FXEQ2   0 none #f ($w/fxcmp r == ($result:b r)))
+(define-insn FXLT2   0 none #f ($w/fxcmp r <  ($result:b r)))
+(define-insn FXLE2   0 none #f ($w/fxcmp r <= ($result:b r)))
+(define-insn FXGT2   0 none #f ($w/fxcmp r >  ($result:b r)))
+(define-insn FXGE2   0 none #f ($w/fxcmp r >= ($result:b r)))
+
+(define-insn BFXNE   0 addr #f ($w/fxcmp r == ($branch* (not r))))
+(define-insn BFXNLT  0 addr #f ($w/fxcmp r <  ($branch* (not r))))
+(define-insn BFXNLE  0 addr #f ($w/fxcmp r <= ($branch* (not r))))
+(define-insn BFXNGT  0 addr #f ($w/fxcmp r >  ($branch* (not r))))
+(define-insn BFXNGE  0 addr #f ($w/fxcmp r >= ($branch* (not r))))
+
+(define-insn BFXNEI  1 addr #f
+  (let* ([imm::long (SCM_VM_INSN_ARG code)])
+    ($w/argr v
+      (VM-ASSERT (SCM_INTP v))
+      ($branch* (not (== (SCM_INT_VALUE v) imm))))))
+
+(define-insn LREF-VAL0-BFXNE  2 addr #f ($arg-source lref ($insn-body BFXNE)))
+(define-insn LREF-VAL0-BFXNLT 2 addr #f ($arg-source lref ($insn-body BFXNLT)))
+(define-insn LREF-VAL0-BFXNLE 2 addr #f ($arg-source lref ($insn-body BFXNLE)))
+(define-insn LREF-VAL0-BFXNGT 2 addr #f ($arg-source lref ($insn-body BFXNGT)))
+(define-insn LREF-VAL0-BFXNGE 2 addr #f ($arg-source lref ($insn-body BFXNGE)))
+
+(define-insn FLADD2  0 none #f
+  ($w/flargs x y ($result:f (+ (SCM_FLONUM_VALUE x) (SCM_FLONUM_VALUE y)))))
+(define-insn FLSUB2  0 none #f
+  ($w/flargs x y ($result:f (- (SCM_FLONUM_VALUE x) (SCM_FLONUM_VALUE y)))))
+(define-insn FLMUL2  0 none #f
+  ($w/flargs x y ($result:f (* (SCM_FLONUM_VALUE x) (SCM_FLONUM_VALUE y)))))
+(define-insn FLDIV2  0 none #f
+  ($w/flargs x y ($result:f (/ (SCM_FLONUM_VALUE x) (SCM_FLONUM_VALUE y)))))
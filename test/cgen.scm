@@ -88,6 +88,64 @@ some_trick();
 (use gauche.cgen.precomp)
 (test-module 'gauche.cgen.precomp)
 
+;;====================================================================
+(test-section "gauche.cgen.precomp-tree")
+(use gauche.cgen.precomp-tree)
+(test-module 'gauche.cgen.precomp-tree)
+
+(remove-directory* "tmp.o.tree")
+(create-directory-tree "."
+                       '("tmp.o.tree"
+                         (("a.scm" "(define-module a (use b) (use c.d))")
+                          ("b.scm" "(define-module b (export x))\n\
+                                    (require \"c/d\")")
+                          ("c" (("d.scm" "(import (only (e) y) srfi-1)")
+                                ("e.scm" "(define-library (c e)\
+                                            (import (scheme base) (b)))"))))))
+
+(let ([tree-sources (with-module gauche.cgen.precomp-tree tree-sources)]
+      [deps (with-module gauche.cgen.precomp-tree source-dependencies)]
+      [stale (with-module gauche.cgen.precomp-tree stale-sources)])
+  (define srcs (tree-sources "tmp.o.tree"))
+  (define graph (map (^s (cons s (deps "tmp.o.tree" s srcs))) srcs))
+
+  (test* "tree sources" '("a.scm" "b.scm" "c/d.scm" "c/e.scm") srcs)
+  (test* "dependencies" '(("a.scm" "b.scm" "c/d.scm")
+                          ("b.scm" "c/d.scm")
+                          ("c/d.scm")
+                          ("c/e.scm" "b.scm"))
+         graph)
+  (test* "stale sources (no output)" srcs (stale "tmp.o.tree" "tmp.o.tree" graph))
+  ;; Pretend b.scm and c/d.scm are compiled, and then c/d.scm is modified.
+  ;; a.scm and b.scm depend on c/d.scm, directly or indirectly.
+  (dolist [f '("b.c" "c--d.c" "c--e.c")]
+    (touch-file (build-path "tmp.o.tree" f))
+    (sys-utime (build-path "tmp.o.tree" f) 2000 2000))
+  (dolist [f srcs]
+    (sys-utime (build-path "tmp.o.tree" f) 1000 1000))
+  (sys-utime "tmp.o.tree/c/d.scm" 3000 3000)
+  (test* "stale sources" '("a.scm" "b.scm" "c/d.scm" "c/e.scm")
+         (stale "tmp.o.tree" "tmp.o.tree" graph))
+  (sys-utime "tmp.o.tree/c/d.scm" 1000 1000)
+  (test* "stale sources" '("a.scm")
+         (stale "tmp.o.tree" "tmp.o.tree" graph)))
+
+(use gauche.process)
+(let1 run-jobs (with-module gauche.cgen.precomp-tree run-jobs)
+  (test* "run-jobs ordering" '("b" "a")
+         (let1 order '()
+           (and (run-jobs '(("a" "b") ("b")) 2
+                          (^[name]
+                            (push! order name)
+                            (run-process '("true"))))
+                (reverse order))))
+  (test* "run-jobs failure" #f
+         (run-jobs '(("a")) 1 (^_ (run-process '("false")))))
+  (test* "run-jobs cycle" (test-error)
+         (run-jobs '(("a" "b") ("b" "a")) 2 (^_ (run-process '("true"))))))
+
+(remove-directory* "tmp.o.tree")
+
 ;;====================================================================
 (test-section "gauche.cgen")
 (use gauche.cgen)
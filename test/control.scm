@@ -67,6 +67,148 @@
   ]
  [else])
 
+;;--------------------------------------------------------------------
+;; control.fiber
+;;
+
+(test-section "control.fiber")
+(use control.fiber)
+(test-module 'control.fiber)
+
+(test* "run-fibers" '(1 2) (values->list (run-fibers (^[] (values 1 2)))))
+
+(test* "spawn and yield" '(a1 b1 a2 b2 a3 b3 done)
+       (run-fibers
+        (^[] (let* ([log '()]
+                    [mk (^[tag]
+                          (spawn-fiber
+                           (^[] (dotimes [i 3]
+                                  (push! log (symbol-append tag (+ i 1)))
+                                  (fiber-yield)))))]
+                    [fs (list (mk 'a) (mk 'b))])
+               (for-each fiber-join fs)
+               (reverse (cons 'done log))))))
+
+(test* "fiber-join results" '(3 4)
+       (run-fibers
+        (^[] (let1 f (spawn-fiber (^[] (values 3 4)) :name 'vals)
+               (values->list (fiber-join f))))))
+
+(test* "fiber-join reraises" "boom"
+       (run-fibers
+        (^[] (let1 f (spawn-fiber (^[] (error "boom")))
+               (guard (e [(error? e) (condition-message e)])
+                 (fiber-join f))))))
+
+(test* "fiber-sleep ordering" '(short long)
+       (run-fibers
+        (^[] (let* ([log '()]
+                    [f1 (spawn-fiber (^[] (fiber-sleep 0.05) (push! log 'long)))]
+                    [f2 (spawn-fiber (^[] (fiber-sleep 0.01) (push! log 'short)))])
+               (fiber-join f1)
+               (fiber-join f2)
+               (reverse log)))))
+
+(test* "deadlock detection" (test-error)
+       (run-fibers (^[] (fiber-join (current-fiber)))))
+
+(test* "read-line parks the fiber" '(tick tick "hello" "world")
+       (receive (in out) (sys-pipe)
+         (unwind-protect
+             (run-fibers
+              (^[] (let* ([log '()]
+                          [reader (spawn-fiber
+                                   (^[] (push! log (read-line in))
+                                        (push! log (read-line in))))])
+                     ;; The reader is parked while we run.
+                     (dotimes [i 2] (push! log 'tick) (fiber-yield))
+                     (display "hello\nwor" out) (flush out)
+                     (fiber-sleep 0.01)
+                     (display "ld\n" out) (flush out)
+                     (fiber-join reader)
+                     (reverse log))))
+           (close-port in)
+           (close-port out))))
+
+;; Carriers must be able to wait on fds beyond FD_SETSIZE.  We run
+;; this only if we can raise the limit of open files enough.
+(cond-expand
+ [gauche.sys.getrlimit
+  (receive (cur max) (sys-getrlimit RLIMIT_NOFILE)
+    (when (or (eqv? max RLIM_INFINITY) (>= max 2200))
+      (when (< cur 2200) (sys-setrlimit RLIMIT_NOFILE 2200))
+      (let* ([pipes (list-tabulate 600 (^_ (values->list (sys-pipe))))]
+             [in  (car (last pipes))]
+             [out (cadr (last pipes))])
+        (test* "waiting on fds beyond FD_SETSIZE" '(#t "far")
+               (unwind-protect
+                   (run-fibers
+                    (^[] (let1 reader (spawn-fiber (^[] (read-line in)))
+                           (fiber-yield)
+                           (display "far\n" out) (flush out)
+                           (list (> (port-file-number in) 1024)
+                                 (fiber-join reader)))))
+                 (dolist [p pipes] (for-each close-port p))))
+        (sys-setrlimit RLIMIT_NOFILE cur))))]
+ [else])
+
+(test* "read-char/read-block outside fibers" '(#\a "bc")
+       (let1 p (open-input-string "abc")
+         (list (read-char p) (read-block 2 p))))
+
+(cond-expand
+ [gauche.sys.threads
+  (test* "multiple carriers" (* 50 51)
+         (run-fibers
+          (^[] (let1 fs (map (^i (spawn-fiber (^[] (fiber-yield) (* i 2))))
+                             (iota 50 1))
+                 (fold + 0 (map fiber-join fs))))
+          :carriers 3))
+  ]
+ [else])
+
+;;--------------------------------------------------------------------
+;; control.parallel-sort
+;;
+
+(cond-expand
+ [gauche.sys.threads
+  (test-section "control.parallel-sort")
+  (use control.parallel-sort)
+  (test-module 'control.parallel-sort)
+
+  (let* ([n 1000]
+         [src (map (^i (cons (modulo (* i 7919) 13) i)) (iota n))]
+         [exp (stable-sort src (^[a b] (< (car a) (car b))))])
+    (define (less a b) (< (car a) (car b)))
+    (dolist [k '(1 2 3 4 7)]
+      (test* #"parallel-sort (list, ~k threads)" exp
+             (parallel-sort src less :threads k :threshold 0))
+      (test* #"parallel-sort! (vector, ~k threads)" (list->vector exp)
+             (parallel-sort! (list->vector src) less
+                             :threads k :threshold 0)))
+    (test* "parallel-sort (default cmp)" (sort (map car src))
+           (parallel-sort (map car src) #f :threshold 10))
+    (test* "parallel-sort (short)" '#(1 2 3)
+           (parallel-sort '#(3 1 2) < :threshold 0))
+    (test* "parallel-sort (empty)" '()
+           (parallel-sort '() < :threshold 0)))
+
+  ;; The chunk sorted in the calling thread raises; the worker must have
+  ;; finished its chunk by the time the error reaches us.
+  (test* "parallel-sort! (error)" '("boom" #(0 1 2 3 4 5 6 7 8 9))
+         (let1 v (vector-append (list->vector (reverse (iota 10)))
+                                (vector 3 'boom 1 2 0 4 5 6 7 8))
+           (define (less a b)
+             (when (or (eq? a 'boom) (eq? b 'boom)) (error "boom"))
+             (sys-nanosleep 1000000)
+             (< a b))
+           (list (guard (e [(error? e) (condition-message e)])
+                   (parallel-sort! v less :threads 2 :threshold 0))
+                 (vector-copy v 0 10))))
+  ]
+ [else])
+
 ;;--------------------------------------------------------------------
 ;; control.thread-pool
 ;;
@@ -183,6 +325,16 @@
              (terminate-all! pool :force-timeout 0.05)
              (job-status xjob))))
 
+  ;; small worker stacks grow as needed
+  (let ([pool (make-thread-pool 2 :stack-size 1024)])
+    (define (deep n) (if (= n 0) 0 (+ 1 (deep (- n 1)))))
+    (test* "stack-size" '(30000 30000)
+           (let1 jobs (list (add-job! pool (cut deep 30000) #t)
+                            (add-job! pool (cut deep 30000) #t))
+             (and (wait-all pool #f 1e7)
+                  (map job-result jobs))))
+    (terminate-all! pool))
+
   ;; This SEGVs on 0.9.3.3 (test code by @cryks)
   (test* "thread pool termination" 'terminated
          (let ([t (thread-start! (make-thread (cut undefined)))]
@@ -245,6 +245,29 @@
 (test-macro "dot3" (1 2 . 3)   (dot3 (1 2) 3))
 (test-macro "dot3" 3           (dot3 () 3))
 
+;; branches are pre-selected by the number of arguments and the
+;; leading literal; make sure it doesn't reject valid matches.
+(define-syntax shape1 (syntax-rules (=>)
+                        ((_ => ?a)        (arrow ?a))
+                        ((_ ?a)           (one ?a))
+                        ((_ ?a ?b)        (two ?a ?b))
+                        ((_ ?a ?b ?c ...) (many ?a ?b ?c ...))
+                        ((_ . ?r)         (rest ?r))))
+(test-macro "shape1" (arrow x)      (shape1 => x))
+(test-macro "shape1" (one =>)       (shape1 =>))
+(test-macro "shape1" (two x y)      (shape1 x y))
+(test-macro "shape1" (many => x y)  (shape1 => x y))
+(test-macro "shape1" (many a b c d) (shape1 a b c d))
+(test-macro "shape1" (rest (x . y)) (shape1 x . y))
+(test-macro "shape1" (rest ())      (shape1))
+
+(define-syntax long-repeat (syntax-rules ()
+                             ((_ (?a ?b) ...) '((?b . ?a) ...))))
+(test "long repetition" (map (^i (cons (- i) i)) (iota 3000))
+      (lambda ()
+        (eval `(long-repeat ,@(map (^i (list i (- i))) (iota 3000)))
+              (interaction-environment))))
+
 ;; see if effective quote introduced by quasiquote properly unwrap
 ;; syntactic enviornment.
 (define-syntax unwrap1 (syntax-rules ()
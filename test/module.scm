@@ -408,6 +408,45 @@
       (lambda ()
         (global-variable-ref 'U 'c 'huh? #t)))
 
+;; lookups are cached; make sure the cache sees later changes
+(test "global-variable-ref (after define)" '(none 1 2)
+      (lambda ()
+        (let* ([p (make-module 'binding-cache.p)]
+               [m (make-module 'binding-cache.m)]
+               [r0 (global-variable-ref m 'cache-test 'none)])
+          (eval '(extend binding-cache.p) m)
+          (eval '(define cache-test 1) p)
+          (let1 r1 (global-variable-ref m 'cache-test 'none)
+            (eval '(define cache-test 2) m)
+            (list r0 r1 (global-variable-ref m 'cache-test 'none))))))
+
+(test "global-variable-ref (after import)" '(none 3)
+      (lambda ()
+        (let* ([e (make-module 'binding-cache.e)]
+               [m (make-module 'binding-cache.i)])
+          (eval '(define cache-test 3) e)
+          (eval '(export cache-test) e)
+          (let1 r0 (global-variable-ref m 'cache-test 'none)
+            (eval '(import binding-cache.e) m)
+            (list r0 (global-variable-ref m 'cache-test 'none))))))
+
+(test "global-variable-ref (after define in a parent of imported)"
+      '(none 4 4)
+      (lambda ()
+        (let* ([p (make-module 'binding-cache.pp)]
+               [e (make-module 'binding-cache.pe)]
+               [m (make-module 'binding-cache.pm)])
+          (eval '(export-all) p)
+          (eval '(extend binding-cache.pp) e)
+          (eval '(import binding-cache.pe) m)
+          (let1 r0 (global-variable-ref m 'cache-test 'none)
+            (eval '(define cache-test 4) p)
+            ;; an unrelated define shouldn't disturb the cache
+            (eval '(define cache-test 5) (make-module #f))
+            (list r0
+                  (global-variable-ref m 'cache-test 'none)
+                  (global-variable-ref m 'cache-test 'none))))))
+
 ;;------------------------------------------------------------------
 ;; creates modules on-the-fly
 
@@ -41,6 +41,136 @@
 (test* "inlining add4 + constant folding" '(((CONSTI 9)) ((RET)))
        (proc->insn/split (^[] (+ (add4 2) 3))))
 
+;; Cross-module inlining with -finline-exports
+(define (with-inline-exports thunk)
+  (with-module gauche.internal
+    (vm-compiler-flag-set! SCM_COMPILE_INLINE_EXPORTS))
+  (unwind-protect (thunk)
+    (with-module gauche.internal
+      (vm-compiler-flag-clear! SCM_COMPILE_INLINE_EXPORTS))))
+
+(with-inline-exports
+ (^[]
+   (eval '(define-module inline-exports.a
+            (export twice loop-down)
+            (define (twice x) (* x 2))
+            (define (loop-down n) (if (= n 0) 0 (loop-down (- n 1)))))
+         (current-module))
+   (eval '(define-module inline-exports.b
+            (import inline-exports.a)
+            (define (call-twice) (twice 21))
+            (define (call-loop-down) (loop-down 3)))
+         (current-module))))
+
+(test* "inlining exported proc" '(((CONSTI 42)) ((RET)))
+       (proc->insn/split
+        (global-variable-ref 'inline-exports.b 'call-twice)))
+(test* "recursive exported proc isn't inlined" 1
+       (length (filter-insn
+                (global-variable-ref 'inline-exports.b 'call-loop-down)
+                'GREF-TAIL-CALL)))
+(test* "redefining inlined proc" "redefining"
+       (let1 s (with-output-to-string
+                 (^[] (with-error-to-port (current-output-port)
+                        (^[] (eval '(define (twice x) (+ x x))
+                                   (find-module 'inline-exports.a))))))
+         (and-let* ([m (#/redefining/ s)]) (m 0))))
+(test* "redefining inlined proc (dependents are forgotten)" ""
+       (with-output-to-string
+         (^[] (with-error-to-port (current-output-port)
+                (^[] (eval '(define (twice x) (* x 2))
+                           (find-module 'inline-exports.a)))))))
+
+(with-inline-exports
+ (^[]
+   (eval '(define (twice x) (* x 2)) (find-module 'inline-exports.a))
+   (eval '(define (call-twice) (twice 21)) (find-module 'inline-exports.b))))
+
+(test* "assigning to inlined proc" '("assigning" ())
+       (let1 s (with-output-to-string
+                 (^[] (with-error-to-port (current-output-port)
+                        (^[] (eval '(set! twice (lambda (x) (+ x x)))
+                                   (find-module 'inline-exports.a))))))
+         (list (and-let* ([m (#/assigning/ s)]) (m 0))
+               ;; it is no longer inlined
+               (begin
+                 (with-inline-exports
+                  (^[] (eval '(define (call-twice) (twice 21))
+                             (find-module 'inline-exports.b))))
+                 (filter-insn
+                  (global-variable-ref 'inline-exports.b 'call-twice)
+                  'CONSTI)))))
+
+;; Reloading a module of which the user module has inlined a procedure.
+;; The user module can't be reloaded, so it is left alone with a warning.
+(use gauche.reload)
+(add-load-path "tmp.o")
+
+(define (write-inline-exports-c body)
+  (with-output-to-file "tmp.o/inline-exports/c.scm"
+    (^[]
+      (write '(define-module inline-exports.c (export scale)))
+      (write '(select-module inline-exports.c))
+      (write body))))
+
+(sys-system "rm -rf tmp.o")
+(sys-mkdir "tmp.o" #o755)
+(sys-mkdir "tmp.o/inline-exports" #o755)
+(write-inline-exports-c '(define (scale x) (* x 2)))
+(with-inline-exports
+ (^[]
+   (eval '(use inline-exports.c) (current-module))
+   (eval '(define (call-scale) (scale 21)) (current-module))))
+
+(test* "reloading module inlined into user" '(#t 63)
+       (begin
+         (write-inline-exports-c '(define (scale x) (* x 3)))
+         (let1 s (with-output-to-string
+                   (^[] (with-error-to-port (current-output-port)
+                          (^[] (reload 'inline-exports.c)))))
+           (list (boolean (#/module user inlined/ s))
+                 ((global-variable-ref 'inline-exports.c 'scale) 21)))))
+
+(sys-system "rm -rf tmp.o")
+
+(test-section "numeric type inference")
+
+(define (count-to-10) (let loop ([i 0]) (if (< i 10) (loop (+ i 1)) i)))
+(define (count-to n) (let loop ([i 0]) (if (< i n) (loop (+ i 1)) i)))
+(define (sum-index v)
+  (let loop ([i 0] [s 0])
+    (if (< i (vector-length v))
+      (loop (+ i 1) (+ s i))
+      s)))
+(define (half-sum) (let loop ([i 0] [s 0.0]) (if (< i 10) (loop (+ i 1) (+ s 0.5)) s)))
+(define (guarded-negative? x) (if (fixnum? x) (< x 0) 'no))
+
+(test* "fixnum loop" '(1 1)
+       (list (length (filter-insn count-to-10 'LREF-VAL0-BFXNLT))
+             (length (filter-insn count-to-10 'FXADDI))))
+(test* "fixnum loop" 10 (count-to-10))
+(test* "unbounded loop isn't specialized" '()
+       (filter-insn count-to 'FXADDI))
+(test* "unbounded loop" 100000000000000000000 (count-to 100000000000000000000))
+(test* "loop bounded by vector-length" 1 (length (filter-insn sum-index 'FXADDI)))
+(test* "loop bounded by vector-length" 45 (sum-index (make-vector 10 #f)))
+(test* "flonum accumulation" 1 (length (filter-insn half-sum 'FLADD2)))
+(test* "flonum accumulation" 5.0 (half-sum))
+(test* "fixnum? guard" 1 (length (filter-insn guarded-negative? 'FXLT2)))
+(test* "fixnum? guard" '(#t #f no no)
+       (map guarded-negative? `(-1 1 ,(expt 2 100) -1.0)))
+
+;; Inference of nested loops must not take exponential time.
+(define (nested-loops depth)
+  (let loop ([d depth])
+    (if (= d 0)
+      '(set! count (+ count 1))
+      (let ([l (string->symbol (format "loop~d" d))]
+            [i (string->symbol (format "i~d" d))])
+        `(let ,l ([,i 0]) (when (< ,i 2) ,(loop (- d 1)) (,l (+ ,i 1))))))))
+(test* "deeply nested loops" 4096
+       (eval `(let ([count 0]) ,(nested-loops 12) count) (current-module)))
+
 (test-section "lambda lifting")
 
 ;; bug reported by teppey
@@ -103,6 +233,34 @@
 (test* "make sure define-inline'd procs be optimized" '()
        (filter-insn foo 'LOCAL-ENV-CLOSURES))
 
+;; for-each, map and fold with a literal lambda are expanded into loops,
+;; so the lambda doesn't become a closure even if it has free variables.
+(test* "inlining for-each" '()
+       (filter-insn (^[xs y] (for-each (^[x] (print (+ x y))) xs)) 'CLOSURE))
+(test* "inlining map" '()
+       (filter-insn (^[xs y] (map (^[x] (+ x y)) xs)) 'CLOSURE))
+(test* "inlining fold" '()
+       (filter-insn (^[xs y] (fold (^[x a] (+ x y a)) 0 xs)) 'CLOSURE))
+
+(test* "inlined for-each" '(13 12 11)
+       (let ([y 10] [r '()])
+         (for-each (^[x] (push! r (+ x y))) '(1 2 3))
+         r))
+(test* "inlined map" '(11 12 13)
+       (let1 y 10 (map (^[x] (+ x y)) '(1 2 3))))
+(test* "inlined fold" '(30 20 10)
+       (let1 y 10 (fold (^[x a] (cons (* x y) a)) '() '(1 2 3))))
+(test* "inlined map (improper list)" (test-error)
+       (map (^[x] x) '(1 2 . 3)))
+(test* "inlined map (reentrance)" '(1 20 3)
+       (let ([k #f] [n 0])
+         (let1 r (map (^[x] (call/cc (^[c] (when (= x 2) (set! k c)) x)))
+                      '(1 2 3))
+           (inc! n)
+           (if (< n 3) (k (* n 10)) r))))
+(test* "locally bound map isn't inlined" 'mine
+       (let ([map (^[f l] 'mine)]) (map (^[x] x) '(1))))
+
 (test-section "eta reduction")
 
 ;; This is actually to check when eta reductino isn't done
@@ -212,6 +212,18 @@
 (test-re #/|abc/ "abc" '(""))
 (test-re #/abc|/ "abc" '("abc"))
 (test-re #/abc|/ "abd" '(""))
+;; literal prefix scanning
+(test-re #/abcd/ "abcabcabcd" '("abcd"))
+(test-re #/abcd/ "abcabcabc" '())
+(test-re #/abcd/ "xxxxxxabc" '())
+(test-re #/ab(c)d+/ "abcabcdd" '("abcdd" "c"))
+(test-re #/(ab)c[0-9]/ "abcxabc1" '("abc1" "ab"))
+(test-re #/(?:ab)c|d/ "xxd" '("d"))
+(test-re #/a\(b/ "aba(b" '("a(b"))
+(test-re #/[ab]c/ "aabbbc" '("bc"))
+(test-re #/[ab]+c/ "xxaabbbcd" '("aabbbc"))
+(test-re #/ab(?i:cd)/ "abCabcD" '("abcD"))
+(test-re #/(?i:ab)cd/ "abcABcd" '("ABcd"))
 
 ;;-------------------------------------------------------------------------
 (test-section "parens")
@@ -804,6 +816,49 @@
                             #/aba/ "abc"
                             #/bc/  "zz"))
 
+(test* "regexp-replace-all (anchor)" "XXa"
+       (regexp-replace-all #/^b/ "bba" "X"))
+(test* "regexp-replace-all (unmatched group)" "#f-b"
+       (regexp-replace-all #/(x)?a/ "ab" "\\1-"))
+(test* "regexp-replace-all (no match)" "abc"
+       (regexp-replace-all #/z/ "abc" "X"))
+(test* "regexp-replace-all-to-port" "a<b>c<b>"
+       (with-output-to-string
+         (cut regexp-replace-all-to-port #/b/ "abcb" "<\\0>")))
+(test* "regexp-replace-all-to-port" "abc"
+       (call-with-output-string
+         (cut regexp-replace-all-to-port #/z/ "abc" "X" <>)))
+(test* "regexp-replace-all-to-port (output before error stays)" '(#t "X")
+       (let* ([out (open-output-string)]
+              [err (guard (e [(error? e) #t])
+                     (regexp-replace-all-to-port #/a*/ "aab" "X" out)
+                     #f)])
+         (list err (get-output-string out))))
+
+;;-------------------------------------------------------------------------
+(test-section "bulk match operations")
+
+(test* "regexp-count-matches" 4
+       (regexp-count-matches #/\w+/ "a quick brown fox!?"))
+(test* "regexp-count-matches" 0
+       (regexp-count-matches #/\d/ "a quick brown fox!?"))
+(test* "regexp-count-matches (empty match)" 4
+       (regexp-count-matches #/x*/ "abc"))
+(test* "regexp-count-matches (anchor)" 1
+       (regexp-count-matches #/^a/ "aaa"))
+(test* "regexp-count-matches (string)" 2
+       (regexp-count-matches "ab" "abcabc"))
+(test* "regexp-fold-positions" '((14 . 17) (8 . 13) (2 . 7) (0 . 1))
+       (regexp-fold-positions #/\w+/ acons '() "a quick brown fox!?"))
+(test* "regexp-fold-positions (empty match)"
+       '((3 . 3) (2 . 2) (1 . 2) (0 . 0))
+       (regexp-fold-positions #/b*/ acons '() "abc"))
+(test* "regexp-positions-iterator" '(1 2 4 5 #f #f)
+       (let1 iter (regexp-positions-iterator #/b/ "abcbc")
+         (append (values->list (iter))
+                 (values->list (iter))
+                 (values->list (iter)))))
+
 ;;-------------------------------------------------------------------------
 (test-section "regexp cimatch")
 
@@ -281,6 +281,22 @@ Content-Length: 4349
 (test* "url-safe encode" "YTA-YTA_" (base64-encode-string "a0>a0?" :url-safe #t))
 (test* "url-safe decode" "a0>a0?" (base64-decode-string "YTA-YTA_" :url-safe #t))
 
+(test* "encode bytevector" "AAECAw==" (base64-encode-bytevector '#u8(0 1 2 3)))
+(test* "decode bytevector" '#u8(0 1 2 255)
+       (base64-decode-bytevector "AAEC/w=="))
+(test* "decode bytevector (url-safe)" '#u8(0 1 2 255)
+       (base64-decode-bytevector "AAEC_w" :url-safe #t))
+(test* "encode/decode port" '(#t #t)
+       (let* ([data (with-output-to-string
+                      (^[] (dotimes [i 20000] (write-byte (modulo (* i 7) 256)))))]
+              [enc (with-string-io data base64-encode)])
+         (list (equal? enc (base64-encode-string data))
+               (equal? (with-string-io enc base64-decode) data))))
+(test* "decode port stops after pad" '("BAR0er9" "=rest")
+       (with-input-from-string "QkFSMGVyOQ==rest"
+         (^[] (list (with-output-to-string base64-decode)
+                    (port->string (current-input-port))))))
+
 ;;--------------------------------------------------------------------
 (test-section "rfc.quoted-printable")
 (use rfc.quoted-printable)
@@ -329,6 +345,19 @@ Content-Length: 4349
 (test* "decode (robustness)"
        "foo=1qr =  j\r\n"
        (quoted-printable-decode-string "foo=1qr =  j\r\n="))
+(test* "encode bytevector" "a=00=FF=3F"
+       (quoted-printable-encode-bytevector '#u8(97 0 255 63)))
+(test* "decode bytevector" '#u8(97 0 255 63)
+       (quoted-printable-decode-bytevector "a=00=ff=3F"))
+(test* "encode/decode port" #t
+       (let1 data (with-output-to-string
+                    (^[] (dotimes [i 20000]
+                           (write-byte (modulo (* i 7) 256))
+                           (when (zero? (modulo i 37)) (display "=  \r\n")))))
+         (equal? (with-string-io (with-string-io data
+                                   (cut quoted-printable-encode :binary #t))
+                   quoted-printable-decode)
+                 data)))
 
 
 ;;--------------------------------------------------------------------
@@ -1148,4 +1177,130 @@ Content-Length: 4349
 
 (sys-waitpid -1)
 
+;; Connection pool, pipelining and concurrent requests.  This server
+;; keeps connections alive, and replies "<connection-id> <method> <uri>"
+;; so that we can tell which socket served the request.
+(cond-expand
+ [gauche.sys.threads
+  (use gauche.threads)
+  (define *keepalive-port* 6727)
+
+  (define *keepalive-httpd*
+    '(
+      (use gauche.net)
+      (use gauche.threads)
+      (use rfc.822)
+      (define *port* 6727)
+
+      (define (reply out status content . hdrs)
+        (format out "HTTP/1.1 ~a\r\nContent-Length: ~a\r\n~a\r\n~a"
+                status (string-size content)
+                (apply string-append (map (^h #"~|h|\r\n") hdrs))
+                content)
+        (flush out))
+
+      (define (serve client id)
+        (let ([in  (socket-input-port client)]
+              [out (socket-output-port client)])
+          (let loop ()
+            (rxmatch-if (let1 line (read-line in)
+                          (and (string? line)
+                               (#/^(\S+) (\S+) HTTP\/1\.1$/ line)))
+                (#f method uri)
+              (begin
+                (rfc822-read-headers in)
+                (cond
+                 [(equal? uri "/exit") (sys-exit 0)]
+                 [(equal? uri "/close")
+                  (reply out "200 OK" #"~id ~method ~uri" "Connection: close")]
+                 [else
+                  (when (equal? uri "/slow") (sys-nanosleep #e1e8))
+                  (reply out "200 OK" #"~id ~method ~uri")
+                  (loop)]))
+              #f))
+          (socket-close client)))
+
+      (define (main args)
+        (let1 socket (make-server-socket 'inet *port* :reuse-addr? #t)
+          (print "ready") (flush)
+          (let loop ([id 0])
+            (let1 client (socket-accept socket)
+              (thread-start! (make-thread (cut serve client id)))
+              (loop (+ id 1))))))))
+
+  (with-output-to-file "testsrv.o"
+    (lambda () (for-each write *keepalive-httpd*)))
+  (let1 p (run-process '("./gosh" "-ftest" "./testsrv.o") :output :pipe)
+    (read-line (process-output p)))
+
+  (let ([host #"localhost:~*keepalive-port*"]
+        [pool (make-http-connection-pool :max-per-host 3)])
+    ;; returns (connection-id uri)
+    (define (parse body)
+      (rxmatch-if (#/^(\d+) \S+ (\S+)$/ body) (#f id uri)
+        (list (string->number id) uri)
+        body))
+    (define (get uri . opts)
+      (receive (code headers body) (apply http-request 'GET host uri opts)
+        (parse body)))
+
+    (test* "pooled connection reuse" #t
+           (let* ([a (get "/a" :pool pool)]
+                  [b (get "/b" :pool pool)])
+             (and (equal? (cadr a) "/a")
+                  (equal? (cadr b) "/b")
+                  (= (car a) (car b)))))
+
+    (test* "pooled connection, server closes" #t
+           (let* ([a (get "/close" :pool pool)]
+                  [b (get "/b" :pool pool)])
+             (not (= (car a) (car b)))))
+
+    (test* "pipelining" '("/p1" "/p2" "/p3")
+           (let1 rs (map (^r (parse (caddr r)))
+                         (http-pipeline host '((GET "/p1") (GET "/p2")
+                                               (GET "/p3"))
+                                        :pool pool))
+             (and (apply = (map car rs))
+                  (map cadr rs))))
+
+    (test* "pipelining, server closes in the middle" '("/p1" "/close" "/p3")
+           (map (^r (cadr (parse (caddr r))))
+                (http-pipeline host '((GET "/p1") (GET "/close") (GET "/p3"))
+                               :pool pool)))
+
+    (test* "pipelining, bad method" (test-error)
+           (http-pipeline host '((POST "/p1")) :pool pool))
+
+    (let1 uris (map (^i #"/slow~i") (iota 12))
+      (test* "concurrent requests" uris
+             (map (^r (cadr (parse (caddr r))))
+                  (http-request-all (map (^u `(GET ,host ,u)) uris)
+                                    :pool pool :concurrency 6)))
+      (test* "concurrent requests, bounded sockets" #t
+             (<= (length (delete-duplicates
+                          (map (^r (car (parse (caddr r))))
+                               (http-request-all (map (^u `(GET ,host ,u)) uris)
+                                                 :pool pool :concurrency 6))))
+                 3)))
+
+    (test* "concurrent requests, error" '(#t #f)
+           (map condition?
+                (http-request-all `((GET "localhost:1" "/")
+                                    (GET ,host "/ok")))))
+
+    ;; A socket in use when the pool is closed isn't pooled again.
+    (test* "closing pool while a socket is in use" #t
+           (let* ([t (thread-start!
+                      (make-thread (^[] (get "/slow" :pool pool))))]
+                  [_ (sys-nanosleep #e5e7)]
+                  [_ (http-connection-pool-close! pool)]
+                  [a (thread-join! t)]
+                  [b (get "/b" :pool pool)])
+             (not (= (car a) (car b)))))
+
+    (guard (e [else #f]) (http-request 'GET host "/exit"))
+    (sys-waitpid -1))]
+ [else])
+
 (test-end)
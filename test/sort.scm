@@ -96,6 +96,46 @@
            '("bbb" "CCC" "AAA" "aaa" "BBB" "ccc")
            '("CCC" "ccc" "bbb" "BBB" "AAA" "aaa"))
 
+;; longer inputs, exercising run detection and merging
+(let ()
+  (define (check name in)
+    (let ([exp (map car (sort (map (^[x i] (cons x i)) in (iota (length in)))
+                              (^[a b] (or (< (car a) (car b))
+                                          (and (= (car a) (car b))
+                                               (< (cdr a) (cdr b))))))))])
+      (test* #"stable-sort ~name (list)" exp
+             (map car (stable-sort (map (^[x i] (cons x i))
+                                        in (iota (length in)))
+                                   (^[a b] (< (car a) (car b))))))
+      (test* #"stable-sort ~name (vector)" (list->vector exp)
+             (vector-map car
+                         (stable-sort! (list->vector
+                                        (map (^[x i] (cons x i))
+                                             in (iota (length in))))
+                                       (^[a b] (< (car a) (car b))))))
+      (test* #"stable-sort ~name (nocmp)" (map car exp)
+             (stable-sort in))))
+  (define (pseudo-random n m)
+    (let loop ([i 0] [x 12345] [r '()])
+      (if (= i n)
+        r
+        (loop (+ i 1) (modulo (+ (* x 1103515245) 12345) 2147483648)
+              (cons (modulo (quotient x 65536) m) r)))))
+  (check "ascending"  (iota 300))
+  (check "descending" (reverse (iota 300)))
+  (check "equal keys" (make-list 300 1))
+  (check "sawtooth"   (append-map (^_ (iota 37)) (iota 9)))
+  (check "random"     (pseudo-random 1000 1000))
+  (check "few keys"   (pseudo-random 1000 5))
+  )
+
+(test* "stable-sort! range" '#(9 8 0 1 2 5 7 3 2)
+       (rlet1 v (vector 9 8 7 5 2 1 0 3 2)
+         ((with-module gauche.internal %vector-stable-sort-range!) v 2 7)))
+(test* "merge range" '#(9 1 2 3 5 4 6 0)
+       (rlet1 v (vector 9 1 5 2 3 4 6 0)
+         ((with-module gauche.internal %vector-merge-range!) v 1 3 5)))
+
 (test-section "sort-by")
 
 (define (sort-by-nocmp key . in&exps)
@@ -116,6 +116,22 @@ fuga
        "&lt;class&gt;"
        (html-escape-string '<class>))
 
+(test* "html-escape-string (nothing to escape)" "abc"
+       (html-escape-string "abc"))
+
+(cond-expand
+ [gauche.ces.utf8
+  (test* "html-escape-string (multibyte)" "&lt;漢字&amp;かな&gt;"
+         (html-escape-string "<漢字&かな>"))]
+ [else])
+
+(test* "html-escape" "a&lt;b&gt;&amp;&quot;&quot;c"
+       (with-string-io "a<b>&\"\"c" html-escape))
+
+(test* "write-html-escaped" "&lt;p&gt;123"
+       (with-output-to-string
+         (^[] (write-html-escaped "<p>") (write-html-escaped 123))))
+
 (test* "html-doctype"
        '("<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01//EN\""
          "\"http://www.w3.org/TR/html4/strict.dtd\">" "")
@@ -414,5 +430,20 @@ fuga
 (test* "tree->string" "ab" (tree->string '(a b)))
 (test* "tree->string" "Ab" (tree->string '(|A| . :b)))
 (test* "tree->string" "ab" (tree->string '((((() ())) . a) ((((b)))))))
+(test* "tree->string" "a1b2.5" (tree->string '(#\a 1 ("b" 2.5))))
+(test* "tree->string (deep)" 100000
+       (string-length
+        (tree->string (fold (^(x acc) (list acc x)) '() (make-list 100000 "a")))))
+(test* "tree->string (deep, nested in the middle)" "abcd"
+       (tree->string `("a" ,(fold (^(x acc) (list acc x)) '() '("b" "c")) "d")))
+
+(define-class <tree-test-node> ()
+  ((name :init-keyword :name)))
+(define-method write-tree ((node <tree-test-node>) out)
+  (write-tree `("<" ,(~ node'name) ">") out))
+
+(test* "tree->string (custom node)" "x<foo>y<bar>"
+       (tree->string `("x" ,(make <tree-test-node> :name "foo")
+                       ("y" (,(make <tree-test-node> :name 'bar))))))
 
 (test-end)